@@ -83,6 +83,9 @@ static dummy_class dummy___;
 #include "txn_info.h"
 #include "graph.hpp"
 #include "rcc_rpc.h"
+#include "piece_profile.h"
+#include "contention.h"
+#include "trace.h"
 #include "dtxn.h"
 #include "txn_reg.hpp"
 #include "rcc.hpp"
@@ -93,10 +96,13 @@ static dummy_class dummy___;
 #include "coordinator.h"
 #include "sharding.h"
 #include "timer.h"
+#include "arrival.h"
+#include "key_dist.h"
 #include "benchmark_control_rpc.h"
 #include "piece.h"
 #include "txn_req_factory.h"
 #include "batch_start_args_helper.h"
+#include "site.h"
 
 // for tpca benchmark
 #include "tpca/piece.h"
@@ -122,6 +128,14 @@ static dummy_class dummy___;
 #include "micro/piece.h"
 #include "micro/chopper.h"
 
+// ycsb
+#include "ycsb/piece.h"
+#include "ycsb/chopper.h"
+
+// smallbank
+#include "smallbank/piece.h"
+#include "smallbank/chopper.h"
+
 #include "txn-chopper-factory.h"
 
 
@@ -0,0 +1,127 @@
+#include <cmath>
+#include <deque>
+#include <fstream>
+
+#include "all.h"
+
+namespace rococo {
+
+Arrival *Arrival::create(uint32_t coo_id) {
+    Config *config = Config::get_config();
+    switch (config->get_arrival()) {
+        case ARRIVAL_CLOSED:
+            return NULL;
+        case ARRIVAL_POISSON:
+            verify(config->get_arrival_rate() > 0);
+            return new PoissonArrival(config->get_arrival_rate());
+        case ARRIVAL_FIXED:
+            verify(config->get_arrival_rate() > 0);
+            return new FixedArrival(config->get_arrival_rate());
+        case ARRIVAL_TRACE:
+            return new TraceArrival(config->get_arrival_trace(), coo_id);
+        default:
+            verify(0);
+            return NULL;
+    }
+}
+
+uint64_t PoissonArrival::next_gap_us() {
+    // exponential gaps, by inverting its cdf
+    double u = RandomGenerator::rand_double(0.0, 1.0);
+    if (u >= 1.0)
+        u = 0.999999;
+    return (uint64_t)(-std::log(1.0 - u) * mean_us_);
+}
+
+/**
+ * Open loop: txns arrive on the schedule of arrival, not as others reply.
+ * At most concurrent_txn are in flight, later arrivals queue here; a txn
+ * counts from its arrival, so the time it queued shows in its latency.
+ * The queue depth is sampled at every arrival.
+ */
+void Arrival::open_loop(Coordinator *coo, uint32_t coo_id, unsigned int id,
+                        unsigned int concurrent_txn,
+                        ClientControlServiceImpl *ccsi,
+                        std::function<void(TxnReply&)> on_reply) {
+    rrr::Mutex mtx;
+    rrr::CondVar cond;
+    std::deque<struct timespec> queued;
+    unsigned int in_flight = 0;
+
+    std::function<void(TxnReply&)> callback;
+    auto issue = [coo_id, coo, &callback] (const struct timespec &due) {
+        TxnRequest req;
+        TxnRequestFactory::init_txn_req(&req, coo_id);
+        req.start_time_ = due;
+        req.callback_ = callback;
+        coo->do_one(req);
+    };
+    callback = [&] (TxnReply &txn_reply) {
+        if (on_reply)
+            on_reply(txn_reply);
+        mtx.lock();
+        if (!queued.empty()) {
+            struct timespec due = queued.front();
+            queued.pop_front();
+            mtx.unlock();
+            issue(due);
+        } else {
+            in_flight--;
+            if (in_flight == 0)
+                cond.signal();
+            mtx.unlock();
+        }
+    };
+
+    struct timespec next;
+    clock_gettime(&next);
+    while (TimerLoop::is_run()) {
+        uint64_t gap_us = next_gap_us();
+        next.tv_sec += gap_us / 1000000;
+        next.tv_nsec += (gap_us % 1000000) * 1000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        struct timespec now;
+        clock_gettime(&now);
+        // behind schedule the txn is issued at once, still due at next
+        if (now < next)
+            usleep((useconds_t)(
+                    (timespec2ms(next) - timespec2ms(now)) * 1000));
+
+        mtx.lock();
+        if (ccsi != NULL)
+            ccsi->queue_depth_one(id, queued.size());
+        if (in_flight < concurrent_txn) {
+            in_flight++;
+            mtx.unlock();
+            issue(next);
+        } else {
+            queued.push_back(next);
+            mtx.unlock();
+        }
+    }
+
+    // time up, what still queues is never issued
+    mtx.lock();
+    queued.clear();
+    while (in_flight > 0)
+        cond.wait(mtx);
+    mtx.unlock();
+}
+
+TraceArrival::TraceArrival(const std::string &path, uint32_t coo_id) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        Log_fatal("cannot open arrival trace %s", path.c_str());
+        verify(0);
+    }
+    uint64_t gap;
+    while (in >> gap)
+        gaps_.push_back(gap);
+    verify(gaps_.size() > 0);
+    next_ = coo_id % gaps_.size();
+}
+
+} // namespace rococo
@@ -0,0 +1,71 @@
+#pragma once
+
+namespace rococo {
+
+class Coordinator;
+class ClientControlServiceImpl;
+class TxnReply;
+
+/**
+ * When an open loop coordinator thread starts its next txn, see the
+ * arrival option of the config.
+ */
+class Arrival {
+public:
+    /** for the thread of coordinator coo_id, NULL in closed loop */
+    static Arrival *create(uint32_t coo_id);
+
+    virtual ~Arrival() {}
+
+    /** us from the last arrival to the next */
+    virtual uint64_t next_gap_us() = 0;
+
+    /** run txns of coordinator coo_id on this schedule until time is up,
+     *  then wait for the ones in flight; on_reply, if any, sees every
+     *  reply. id: the thread's index in this process, for ccsi */
+    void open_loop(Coordinator *coo, uint32_t coo_id, unsigned int id,
+                   unsigned int concurrent_txn,
+                   ClientControlServiceImpl *ccsi,
+                   std::function<void(TxnReply&)> on_reply);
+};
+
+class PoissonArrival : public Arrival {
+public:
+    PoissonArrival(double rate) : mean_us_(1000000.0 / rate) {}
+
+    virtual uint64_t next_gap_us();
+
+private:
+    double mean_us_;
+};
+
+class FixedArrival : public Arrival {
+public:
+    FixedArrival(double rate) : gap_us_((uint64_t)(1000000.0 / rate)) {}
+
+    virtual uint64_t next_gap_us() {
+        return gap_us_;
+    }
+
+private:
+    uint64_t gap_us_;
+};
+
+/** replays the gaps of a file over and over, each thread from its own
+ *  offset so that they do not arrive in step */
+class TraceArrival : public Arrival {
+public:
+    TraceArrival(const std::string &path, uint32_t coo_id);
+
+    virtual uint64_t next_gap_us() {
+        uint64_t gap = gaps_[next_];
+        next_ = (next_ + 1) % gaps_.size();
+        return gap;
+    }
+
+private:
+    std::vector<uint64_t> gaps_;
+    size_t next_;
+};
+
+} // namespace rococo
@@ -80,6 +80,21 @@ void ServerControlServiceImpl::server_heart_beat() {
     alarm(timeout_);
 }
 
+void ServerControlServiceImpl::server_dump_trace(std::string *trace) {
+    *trace = Trace::dump();
+}
+
+void ServerControlServiceImpl::server_piece_profile(const rrr::i32 &on) {
+    PieceProfile::init(on != 0);
+}
+
+void ServerControlServiceImpl::server_contention(const rrr::i32 &top_k,
+                                                 const rrr::i32 &sample,
+                                                 const rrr::i32 &key_cols) {
+    ContentionTracker::init(std::max(top_k, 0), std::max(sample, 0),
+                            std::max(key_cols, 0));
+}
+
 void ServerControlServiceImpl::server_heart_beat_with_data(ServerResponse *res) {
 
     res->cpu_util = rrr::CPUInfo::cpu_stat();
@@ -121,6 +136,11 @@ void ServerControlServiceImpl::server_heart_beat_with_data(ServerResponse *res)
 
     //pthread_mutex_unlock(&stat_m_);
     stat_m_.unlock();
+
+    // also after it was turned off, for what it counted until then
+    PieceProfile::drain(&res->piece_stats, &res->rows_touched);
+    if (ContentionTracker::on())
+        ContentionTracker::report(&res->hot_keys, &res->table_conflicts);
 }
 
 ServerControlServiceImpl::ServerControlServiceImpl(unsigned int timeout,
@@ -218,59 +238,36 @@ void ClientControlServiceImpl::client_response(ClientResponse* res) {
     //pthread_mutex_unlock(&status_mutex_);
     status_mutex_.unlock();
 
-    pthread_rwlock_wrlock(&collect_lock_);
     before_last_time_ = last_time_;
     clock_gettime(&last_time_);
+    before_last_ms_.store(last_ms_.load());
+    last_ms_.store(timespec2ms(last_time_));
     res->run_sec = (rrr::i64)(last_time_.tv_sec - start_time_.tv_sec);
     res->run_nsec = (rrr::i64)(last_time_.tv_nsec - start_time_.tv_nsec);
 
     res->period_sec = (rrr::i64)(last_time_.tv_sec - before_last_time_.tv_sec);
     res->period_nsec = (rrr::i64)(last_time_.tv_nsec - before_last_time_.tv_nsec);
 
-    txn_info_switch_ = !txn_info_switch_;
-
-    for (int i = 0; i < num_threads_; i++) {
-        for (std::map<int32_t, txn_info_t>::iterator it = txn_info_[i].begin();
-                it != txn_info_[i].end(); it++) {
-            res->txn_info[it->first].start_txn += it->second.start_txn;
-            res->txn_info[it->first].total_txn += it->second.total_txn;
-            res->txn_info[it->first].total_try += it->second.total_try;
-            res->txn_info[it->first].commit_txn += it->second.commit_txn;
-            res->txn_info[it->first].interval_latency.insert(
-                    res->txn_info[it->first].interval_latency.end(),
-                    it->second.interval_latency.begin(),
-                    it->second.interval_latency.end());
-            it->second.interval_latency.clear();
-        }
-    }
-    pthread_rwlock_unlock(&collect_lock_);
-
-    int use = 0;
-    if (txn_info_switch_)
-        use = 1;
+    // the coordinators keep recording meanwhile, what they add after a
+    // histogram is drained goes to the next response
     for (int i = 0; i < num_threads_; i++) {
         for (std::map<int32_t, txn_info_t>::iterator it = txn_info_[i].begin();
                 it != txn_info_[i].end(); it++) {
-
-            res->txn_info[it->first].this_latency.insert(
-                    res->txn_info[it->first].this_latency.end(),
-                    it->second.interval_latencies[use]->begin(), it->second.interval_latencies[use]->end());
-            res->txn_info[it->first].last_latency.insert(
-                    res->txn_info[it->first].last_latency.end(),
-                    it->second.last_interval_latencies[use]->begin(), it->second.last_interval_latencies[use]->end());
-            res->txn_info[it->first].attempt_latency.insert(
-                    res->txn_info[it->first].attempt_latency.end(),
-                    it->second.interval_attempt_latencies[use]->begin(), it->second.interval_attempt_latencies[use]->end());
-
-            res->txn_info[it->first].num_try.insert(
-                    res->txn_info[it->first].num_try.end(),
-                    it->second.num_try[use]->begin(), it->second.num_try[use]->end());
-
-            it->second.num_try[use]->clear();
-            it->second.interval_latencies[use]->clear();
-            it->second.last_interval_latencies[use]->clear();
-            it->second.interval_attempt_latencies[use]->clear();
+            TxnInfoRes &info = res->txn_info[it->first];
+            info.start_txn += it->second.start_txn.load();
+            info.total_txn += it->second.total_txn.load();
+            info.total_try += it->second.total_try.load();
+            info.commit_txn += it->second.commit_txn.load();
+            it->second.interval_latency.drain(&info.interval_latency);
+            it->second.interval_latencies.drain(&info.this_latency);
+            it->second.last_interval_latencies.drain(&info.last_latency);
+            it->second.interval_attempt_latencies.drain(&info.attempt_latency);
+            it->second.num_try.drain(&info.num_try);
+            info.phase_latency.resize(PHASE_N);
+            for (int p = 0; p < PHASE_N; p++)
+                it->second.phase_latencies[p].drain(&info.phase_latency[p]);
         }
+        queue_depths_[i].drain(&res->queue_depth);
     }
 }
 
@@ -308,10 +305,16 @@ void ClientControlServiceImpl::client_start() {
     clock_gettime(&start_time_);
     last_time_ = start_time_;
     before_last_time_ = start_time_;
+    last_ms_.store(timespec2ms(start_time_));
+    before_last_ms_.store(timespec2ms(start_time_));
     //pthread_mutex_unlock(&status_mutex_);
     status_mutex_.unlock();
 }
 
+void ClientControlServiceImpl::client_dump_trace(std::string *trace) {
+    *trace = Trace::dump();
+}
+
 //void ClientControlServiceImpl::set_ready() {
 //    pthread_mutex_lock(&status_mutex_);
 //    status_ = CCS_READY;
@@ -356,12 +359,13 @@ void ClientControlServiceImpl::client_get_txn_names(std::map<i32, std::string> *
 }
 
 ClientControlServiceImpl::ClientControlServiceImpl(unsigned int num_threads, const std::map<int32_t, std::string> &txn_types) : status_(CCS_INIT), txn_info_(NULL), num_threads_(num_threads), num_ready_(0), num_finish_(0) {
-    pthread_rwlock_init(&collect_lock_, NULL);
     //pthread_mutex_init(&status_mutex_, NULL);
     //pthread_cond_init(&status_cond_, NULL);
     coo_threads_ = (pthread_t **)malloc(sizeof(pthread_t *) * num_threads_);
     txn_info_ = new std::map<int32_t, txn_info_t>[num_threads_];
-    txn_info_switch_ = true;
+    queue_depths_ = new LatencyHist[num_threads_];
+    last_ms_.store(0);
+    before_last_ms_.store(0);
     for (int i = 0; i < num_threads_; i++)
         for (std::map<int32_t, std::string>::const_iterator cit = txn_types.begin();
                 cit != txn_types.end(); cit++) {
@@ -371,19 +375,16 @@ ClientControlServiceImpl::ClientControlServiceImpl(unsigned int num_threads, con
 }
 
 ClientControlServiceImpl::~ClientControlServiceImpl() {
-    pthread_rwlock_destroy(&collect_lock_);
     //pthread_mutex_destroy(&status_mutex_);
     //pthread_cond_destroy(&status_cond_);
     int i = 0;
     for (; i < num_threads_; i++) {
-        for (std::map<int32_t, txn_info_t>::iterator it = txn_info_[i].begin();
-                it != txn_info_[i].end(); it++)
-            it->second.destroy();
         if (coo_threads_[i] != NULL)
             free(coo_threads_[i]);
     }
     free(coo_threads_);
     delete [] txn_info_;
+    delete [] queue_depths_;
 }
 
 }
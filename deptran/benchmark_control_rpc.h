@@ -2,6 +2,7 @@
 #define BENCHMARK_CTRL_H_
 
 #include "rcc_rpc.h"
+#include "latency_hist.h"
 
 #include <time.h>
 #include <sys/time.h>
@@ -65,6 +66,11 @@ public:
     void server_ready(rrr::i32* res);
     void server_heart_beat_with_data(ServerResponse *res);
     void server_heart_beat();
+    void server_dump_trace(std::string *trace);
+    void server_piece_profile(const rrr::i32 &on);
+    void server_contention(const rrr::i32 &top_k,
+                           const rrr::i32 &sample,
+                           const rrr::i32 &key_cols);
 
     ServerControlServiceImpl(unsigned int timeout = 5, Recorder *recorder = NULL);
     ~ServerControlServiceImpl();
@@ -108,94 +114,77 @@ private:
         CCS_STOP,
     } status_t;
 
+    // one per coordinator thread and txn type, written by that thread
+    // only and drained by client_response without stopping it
     typedef struct txn_info_t {
         int32_t txn_type;
-        int32_t commit_txn;
-        int32_t start_txn;
-        int32_t total_txn;
-        int32_t total_try;
-        std::vector<double> *interval_latencies[2];
-        std::vector<double> *last_interval_latencies[2];
-        std::vector<double> *interval_attempt_latencies[2];
-        std::vector<int32_t> *num_try[2];
-        std::vector<double> interval_latency;
-
-        txn_info_t() {
+        std::atomic<int32_t> commit_txn;
+        std::atomic<int32_t> start_txn;
+        std::atomic<int32_t> total_txn;
+        std::atomic<int32_t> total_try;
+        LatencyHist interval_latencies;     // in us
+        LatencyHist last_interval_latencies;
+        LatencyHist interval_attempt_latencies;
+        LatencyHist interval_latency;
+        LatencyHist num_try;
+        LatencyHist phase_latencies[PHASE_N];
+
+        txn_info_t() : interval_latencies(0.001),
+                       last_interval_latencies(0.001),
+                       interval_attempt_latencies(0.001),
+                       interval_latency(0.001),
+                       num_try(1.0) {
             txn_type = -1;
             start_txn = 0;
             commit_txn = 0;
             total_txn = 0;
             total_try = 0;
-            num_try[0] = new std::vector<int32_t>();
-            num_try[1] = new std::vector<int32_t>();
-
-            interval_latencies[0] = new std::vector<double>();
-            interval_latencies[1] = new std::vector<double>();
-
-            last_interval_latencies[0] = new std::vector<double>();
-            last_interval_latencies[1] = new std::vector<double>();
-
-            interval_attempt_latencies[0] = new std::vector<double>();
-            interval_attempt_latencies[1] = new std::vector<double>();
+            for (int i = 0; i < PHASE_N; i++)
+                phase_latencies[i].set_unit(0.001);
         }
 
         void init(int32_t _txn_type) {
             txn_type = _txn_type;
         }
 
-        void destroy() {
-            delete interval_latencies[0];
-            delete interval_latencies[1];
-            delete last_interval_latencies[0];
-            delete last_interval_latencies[1];
-            delete interval_attempt_latencies[0];
-            delete interval_attempt_latencies[1];
-            delete num_try[0];
-            delete num_try[1];
-        }
-
-        void start(bool switzh) {
+        void start() {
             start_txn++;
         }
 
-        void retry(bool switzh, double attempt_latency) {
+        void retry(double attempt_latency) {
             total_try++;
-            if (switzh)
-                interval_attempt_latencies[0]->push_back(attempt_latency);
-            else
-                interval_attempt_latencies[1]->push_back(attempt_latency);
+            interval_attempt_latencies.record_value(attempt_latency);
+        }
+
+        void phases(const double *phase_ms) {
+            for (int i = 0; i < PHASE_N; i++)
+                phase_latencies[i].record_value(phase_ms[i]);
         }
 
-        void succ(bool switzh, latency_collection_status_t lcs, double latency, double attempt_latency, int32_t tried) {
+        void succ(latency_collection_status_t lcs, double latency, double attempt_latency, int32_t tried) {
             total_txn++;
             total_try++;
             commit_txn++;
-            int use = 1;
-            if (switzh)
-                use = 0;
-            num_try[use]->push_back(tried);
+            num_try.record(tried);
             switch (lcs) {
                 case LCS_THIS_PERIOD:
-                    interval_latencies[use]->push_back(latency);
+                    interval_latencies.record_value(latency);
                     break;
                 case LCS_LAST_PERIOD:
-                    last_interval_latencies[use]->push_back(latency);
+                    last_interval_latencies.record_value(latency);
                     break;
                 case LCS_IGNORE:
                 default:
                     break;
             }
-            interval_attempt_latencies[use]->push_back(attempt_latency);
-            interval_latency.push_back(latency);
+            interval_attempt_latencies.record_value(attempt_latency);
+            interval_latency.record_value(latency);
         }
 
-        void rej(bool switzh, latency_collection_status_t lcs, double latency, double attempt_latency, int32_t tried) {
+        void rej(latency_collection_status_t lcs, double latency, double attempt_latency, int32_t tried) {
             total_txn++;
             total_try++;
-            if (switzh)
-                interval_attempt_latencies[0]->push_back(attempt_latency);
-            else
-                interval_attempt_latencies[1]->push_back(attempt_latency);
+            interval_attempt_latencies.record_value(attempt_latency);
         }
     } txn_info_t;
 
@@ -207,15 +196,16 @@ private:
     status_t status_;
     pthread_t **coo_threads_;
     std::map<int32_t, txn_info_t> *txn_info_;
-    bool txn_info_switch_;
-
-    pthread_rwlock_t collect_lock_;
+    // per coordinator thread, open loop txns queued at each arrival
+    LatencyHist *queue_depths_;
 
     unsigned int num_threads_;
     unsigned int num_ready_;
     unsigned int num_finish_;
     struct timespec start_time_;
     struct timespec last_time_, before_last_time_;
+    // ms of the last two collections, read by the recording threads
+    std::atomic<double> last_ms_, before_last_ms_;
 
     std::map<int32_t, std::string> txn_names_;
 
@@ -228,6 +218,7 @@ public:
             rrr::DeferredReply *defer);
     void client_ready(rrr::i32* res);
     void client_start();
+    void client_dump_trace(std::string *trace);
 
     ClientControlServiceImpl(unsigned int num_threads, const std::map<int32_t, std::string> &txn_types);
     ~ClientControlServiceImpl();
@@ -235,37 +226,34 @@ public:
     void wait_for_shutdown();
 
     inline void txn_start_one(unsigned int id, int32_t txn_type) {
-        pthread_rwlock_rdlock(&collect_lock_);
-        txn_info_[id][txn_type].start(txn_info_switch_);
-        pthread_rwlock_unlock(&collect_lock_);
+        txn_info_[id][txn_type].start();
+    }
+
+    inline void queue_depth_one(unsigned int id, uint64_t depth) {
+        queue_depths_[id].record(depth);
     }
 
     inline void txn_retry_one(unsigned int id, int32_t txn_type, double attempt_latency) {
-        pthread_rwlock_rdlock(&collect_lock_);
-        txn_info_[id][txn_type].retry(txn_info_switch_, attempt_latency);
-        pthread_rwlock_unlock(&collect_lock_);
+        txn_info_[id][txn_type].retry(attempt_latency);
+    }
+
+    inline latency_collection_status_t period_of(struct timespec start_time) {
+        double start_ms = timespec2ms(start_time);
+        if (last_ms_.load() < start_ms)
+            return LCS_THIS_PERIOD;
+        else if (before_last_ms_.load() < start_ms)
+            return LCS_LAST_PERIOD;
+        return LCS_IGNORE;
     }
 
-    inline void txn_success_one(unsigned int id, int32_t txn_type, struct timespec start_time, double latency, double attempt_latency, int32_t tried) {
-        pthread_rwlock_rdlock(&collect_lock_);
-        latency_collection_status_t lcs = LCS_IGNORE;
-        if (last_time_ < start_time)
-            lcs = LCS_THIS_PERIOD;
-        else if (before_last_time_ < start_time)
-            lcs = LCS_LAST_PERIOD;
-        txn_info_[id][txn_type].succ(txn_info_switch_, lcs, latency, attempt_latency, tried);
-        pthread_rwlock_unlock(&collect_lock_);
+    inline void txn_success_one(unsigned int id, int32_t txn_type, struct timespec start_time, double latency, double attempt_latency, int32_t tried, const double *phase_ms) {
+        txn_info_[id][txn_type].succ(period_of(start_time), latency, attempt_latency, tried);
+        txn_info_[id][txn_type].phases(phase_ms);
     }
 
-    inline void txn_reject_one(unsigned int id, int32_t txn_type, struct timespec start_time, double latency, double attempt_latency, int32_t tried) {
-        pthread_rwlock_rdlock(&collect_lock_);
-        latency_collection_status_t lcs = LCS_IGNORE;
-        if (last_time_ < start_time)
-            lcs = LCS_THIS_PERIOD;
-        else if (before_last_time_ < start_time)
-            lcs = LCS_LAST_PERIOD;
-        txn_info_[id][txn_type].rej(txn_info_switch_, lcs, latency, attempt_latency, tried);
-        pthread_rwlock_unlock(&collect_lock_);
+    inline void txn_reject_one(unsigned int id, int32_t txn_type, struct timespec start_time, double latency, double attempt_latency, int32_t tried, const double *phase_ms) {
+        txn_info_[id][txn_type].rej(period_of(start_time), latency, attempt_latency, tried);
+        txn_info_[id][txn_type].phases(phase_ms);
     }
 };
 
@@ -30,6 +30,7 @@ void *coo_work(void *_attr) {
     rrr::CondVar finish_cond;
     //pthread_mutex_init(&finish_mutex, NULL);
     //pthread_cond_init(&finish_cond, NULL);
+    Arrival *arrival = Arrival::create(coo_id);
     if (ccsi != NULL) {
         std::function<void(TxnReply&)> callback = [coo_id, id, coo, ccsi,
 						   &callback, &finish_mutex,
@@ -55,19 +56,24 @@ void *coo_work(void *_attr) {
 
         ccsi->wait_for_start(id);
         TIMER_SET(duration);
-        for (unsigned int n_txn = 0; n_txn < concurrent_txn; n_txn++) {
-            TxnRequest req;
-            TxnRequestFactory::init_txn_req(&req, coo_id);
-            req.callback_ = callback;
-            coo->do_one(req);
+        if (arrival != NULL) {
+            arrival->open_loop(coo, coo_id, id, concurrent_txn, ccsi,
+                               nullptr);
+        } else {
+            for (unsigned int n_txn = 0; n_txn < concurrent_txn; n_txn++) {
+                TxnRequest req;
+                TxnRequestFactory::init_txn_req(&req, coo_id);
+                req.callback_ = callback;
+                coo->do_one(req);
+            }
+            //pthread_mutex_lock(&finish_mutex);
+            finish_mutex.lock();
+            while (concurrent_txn > 0)
+                //pthread_cond_wait(&finish_cond, &finish_mutex);
+                finish_cond.wait(finish_mutex);
+            //pthread_mutex_unlock(&finish_mutex);
+            finish_mutex.unlock();
         }
-        //pthread_mutex_lock(&finish_mutex);
-        finish_mutex.lock();
-        while (concurrent_txn > 0)
-            //pthread_cond_wait(&finish_cond, &finish_mutex);
-            finish_cond.wait(finish_mutex);
-        //pthread_mutex_unlock(&finish_mutex);
-        finish_mutex.unlock();
         ccsi->wait_for_shutdown();
     }
     else {
@@ -98,23 +104,34 @@ void *coo_work(void *_attr) {
             num_try.fetch_add(txn_reply.n_try_);
         };
         TIMER_SET(duration);
-        //pthread_mutex_lock(&finish_mutex);
-        finish_mutex.lock();
-        for (unsigned int n_txn = 0; n_txn < concurrent_txn; n_txn++) {
-            TxnRequest req;
-            TxnRequestFactory::init_txn_req(&req, coo_id);
-            req.callback_ = callback;
-            coo->do_one(req);
+        if (arrival != NULL) {
+            arrival->open_loop(coo, coo_id, id, concurrent_txn, NULL,
+                               [&num_txn, &success, &num_try] (TxnReply &txn_reply) {
+                if (txn_reply.res_ == SUCCESS)
+                    success++;
+                num_txn++;
+                num_try.fetch_add(txn_reply.n_try_);
+            });
+        } else {
+            //pthread_mutex_lock(&finish_mutex);
+            finish_mutex.lock();
+            for (unsigned int n_txn = 0; n_txn < concurrent_txn; n_txn++) {
+                TxnRequest req;
+                TxnRequestFactory::init_txn_req(&req, coo_id);
+                req.callback_ = callback;
+                coo->do_one(req);
+            }
+            while (concurrent_txn > 0)
+                //pthread_cond_wait(&finish_cond, &finish_mutex);
+                finish_cond.wait(finish_mutex);
+            //pthread_mutex_unlock(&finish_mutex);
+            finish_mutex.unlock();
         }
-        while (concurrent_txn > 0)
-            //pthread_cond_wait(&finish_cond, &finish_mutex);
-            finish_cond.wait(finish_mutex);
-        //pthread_mutex_unlock(&finish_mutex);
-        finish_mutex.unlock();
         Log_info("Finish:\nTotal: %u, Commit: %u, Attempts: %u, Running for %u\n", num_txn.load(), success.load(), num_try.load(), Config::get_config()->get_duration());
     }
 
     delete coo;
+    delete arrival;
     //pthread_mutex_destroy(&finish_mutex);
     //pthread_cond_destroy(&finish_cond);
 
@@ -132,6 +149,12 @@ int main(int argc, char *argv[]) {
     bool hb = Config::get_config()->do_heart_beat();
     unsigned int num_threads = Config::get_config()->get_num_threads(); // func
 
+    // clients after the sites in the trace
+    unsigned int cid = Config::get_config()->get_client_id();
+    Trace::init(Config::get_config()->get_trace_ring(),
+                Config::get_config()->get_num_site() + cid,
+                "client " + std::to_string(cid));
+
     TxnRequestFactory::init_txn_req(NULL, 0);
 
     std::map<int32_t, std::string> txn_types;
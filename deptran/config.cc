@@ -238,8 +238,12 @@ void Config::init_sharding(const char *filename) {
         mode_ = MODE_OCC;
     } else if (mode_str == "rcc") {
         mode_ = MODE_RCC;
+    } else if (mode_str == "ro6") {
+        mode_ = MODE_ROT;
     } else if (mode_str == "none") {
         mode_ = MODE_NONE;
+    } else if (mode_str == "calvin") {
+        mode_ = MODE_CALVIN;
     } else if (mode_str == "deptran") {
         // deprecated
         mode_ = MODE_DEPTRAN;
@@ -282,6 +286,12 @@ void Config::init_sharding(const char *filename) {
     else if (benchmark_name == "micro_bench") {
         benchmark_ = MICRO_BENCH;
     }
+    else if (benchmark_name == "ycsb") {
+        benchmark_ = YCSB;
+    }
+    else if (benchmark_name == "smallbank") {
+        benchmark_ = SMALLBANK;
+    }
     else {
         Log_error("No implementation for benchmark: %s", benchmark_name.c_str());
         verify(0);
@@ -293,6 +303,104 @@ void Config::init_sharding(const char *filename) {
 
     concurrent_txn_ = pt.get<unsigned int>("benchmark.<xmlattr>.concurrent_txn", 1);
     batch_start_ = pt.get<bool>("benchmark.<xmlattr>.batch_start", false);
+    // 0: send commit/abort right away; otherwise buffer commits for the
+    // next start request to each server, flushing at least every
+    // piggyback_ms. Saves messages, not latency: locks stay held and the
+    // client waits until the commit lands
+    piggyback_ms_ = pt.get<unsigned int>("benchmark.<xmlattr>.piggyback_ms", 0);
+    // 0: one start request per piece; otherwise pieces of different txns
+    // to the same server share a request of up to batch_size pieces,
+    // flushed every batch_tick_us
+    batch_size_ = pt.get<unsigned int>("benchmark.<xmlattr>.batch_size", 0);
+    batch_tick_us_ = pt.get<unsigned int>("benchmark.<xmlattr>.batch_tick_us", 100);
+    // forward piece outputs server to server where the chopper allows
+    chain_pieces_ = pt.get<bool>("benchmark.<xmlattr>.chain_pieces", false);
+    // ship txns that touch a single server there whole
+    one_shot_ = pt.get<bool>("benchmark.<xmlattr>.one_shot", false);
+    // calvin mode: how often each server closes a batch of the txns it
+    // sequenced
+    epoch_ms_ = pt.get<unsigned int>("benchmark.<xmlattr>.epoch_ms", 10);
+    // single site occ read only txns started within the same ro_epoch_us
+    // read the same snapshots, which the server takes once. 0: a snapshot
+    // per txn
+    ro_epoch_us_ = pt.get<unsigned int>("benchmark.<xmlattr>.ro_epoch_us", 1000);
+    // ro6 servers drop the snapshot of a read only txn whose
+    // rcc_ro_end_txn has not come within ro_pin_timeout_us
+    ro_pin_timeout_us_ = pt.get<unsigned int>("benchmark.<xmlattr>.ro_pin_timeout_us", 1000000);
+    // servers time every piece type and count the rows it touches, see
+    // PieceProfile. server_piece_profile switches it while running
+    piece_profile_ = pt.get<bool>("benchmark.<xmlattr>.piece_profile", false);
+    // 0: no contention tracking; otherwise servers keep the top k keys
+    // txns conflict on, looking at one in contention_sample conflicts and
+    // the first contention_key_cols key columns (0 for all).
+    // server_contention switches it while running
+    contention_top_k_ = pt.get<unsigned int>("benchmark.<xmlattr>.contention_top_k", 0);
+    contention_sample_ = pt.get<unsigned int>("benchmark.<xmlattr>.contention_sample", 1);
+    contention_key_cols_ = pt.get<unsigned int>("benchmark.<xmlattr>.contention_key_cols", 0);
+    // 0: no tracing; otherwise every thread keeps its last trace_ring
+    // trace events, dumped by run.py at the end of the run
+    trace_ring_ = pt.get<unsigned int>("benchmark.<xmlattr>.trace_ring", 0);
+    // closed: each of concurrent_txn slots starts a txn when its last one
+    // ends; otherwise every coordinator thread starts txns at
+    // arrival_rate per second, poisson or fixed, or after the gaps (us,
+    // one a line) in the file arrival_trace, concurrent_txn at most at a
+    // time, the rest queue
+    std::string arrival_str = pt.get<std::string>("benchmark.<xmlattr>.arrival", "closed");
+    if (arrival_str == "poisson") {
+        arrival_ = ARRIVAL_POISSON;
+    } else if (arrival_str == "fixed") {
+        arrival_ = ARRIVAL_FIXED;
+    } else if (arrival_str == "trace") {
+        arrival_ = ARRIVAL_TRACE;
+    } else {
+        verify(arrival_str == "closed");
+        arrival_ = ARRIVAL_CLOSED;
+    }
+    arrival_rate_ = pt.get<double>("benchmark.<xmlattr>.arrival_rate", 1000.0);
+    arrival_trace_ = pt.get<std::string>("benchmark.<xmlattr>.arrival_trace", "");
+    // ycsb: ycsb_workload a to f is the standard mix of read, update, rmw,
+    // scan and insert when txn_weight is not given; every read, update or
+    // rmw touches keys_per_txn records, a scan 1 to scan_length; each field
+    // is a string of field_length chars
+    std::string ycsb_workload_str = pt.get<std::string>("benchmark.<xmlattr>.ycsb_workload", "a");
+    verify(ycsb_workload_str.size() == 1
+            && ycsb_workload_str[0] >= 'a' && ycsb_workload_str[0] <= 'f');
+    ycsb_workload_ = ycsb_workload_str[0];
+    keys_per_txn_ = pt.get<unsigned int>("benchmark.<xmlattr>.keys_per_txn", 1);
+    scan_length_ = pt.get<unsigned int>("benchmark.<xmlattr>.scan_length", 100);
+    field_length_ = pt.get<unsigned int>("benchmark.<xmlattr>.field_length", 100);
+    verify(keys_per_txn_ > 0 && scan_length_ > 0);
+    // how clients pick the keys that are not fixed by the benchmark:
+    // uniform; zipf over the key range, skewed by zipf_theta (0 < theta <
+    // 1); hotspot, hot_access of the picks among hot_fraction of the keys,
+    // or hot_keys of them if set; both hash the hot ones over the range;
+    // latest, zipf counting down from the newest key. ycsb defaults to zipf, latest for workload d, as
+    // the standard mixes do; smallbank to hotspot, on its hot accounts
+    std::string key_dist_str = pt.get<std::string>("benchmark.<xmlattr>.key_dist", "");
+    if (key_dist_str == "") {
+        if (benchmark_ == SMALLBANK)
+            key_dist_str = "hotspot";
+        else if (benchmark_ != YCSB)
+            key_dist_str = "uniform";
+        else if (ycsb_workload_ == 'd')
+            key_dist_str = "latest";
+        else
+            key_dist_str = "zipf";
+    }
+    if (key_dist_str == "zipf") {
+        key_dist_ = KEY_DIST_ZIPF;
+    } else if (key_dist_str == "hotspot") {
+        key_dist_ = KEY_DIST_HOTSPOT;
+    } else if (key_dist_str == "latest") {
+        key_dist_ = KEY_DIST_LATEST;
+    } else {
+        verify(key_dist_str == "uniform");
+        key_dist_ = KEY_DIST_UNIFORM;
+    }
+    zipf_theta_ = pt.get<double>("benchmark.<xmlattr>.zipf_theta", 0.99);
+    hot_fraction_ = pt.get<double>("benchmark.<xmlattr>.hot_fraction", 0.2);
+    hot_access_ = pt.get<double>("benchmark.<xmlattr>.hot_access", 0.8);
+    hot_keys_ = pt.get<unsigned int>("benchmark.<xmlattr>.hot_keys", 0);
 
     std::string txn_weight_str = pt.get<std::string>("benchmark.<xmlattr>.txn_weight", "");
     size_t txn_weight_str_i = 0, end_txn_weight_str_i;
@@ -307,6 +415,23 @@ void Config::init_sharding(const char *filename) {
     double d = strtod(txn_weight_str.c_str() + txn_weight_str_i, &txn_weight_str_endptr);
     verify(*txn_weight_str_endptr == '\0');
     txn_weight_.push_back(d);
+    if (benchmark_ == YCSB && txn_weight_str == "") {
+        // read : update : rmw : scan : insert
+        switch (ycsb_workload_) {
+            case 'a': txn_weight_ = {50, 50, 0, 0, 0}; break;
+            case 'b': txn_weight_ = {95, 5, 0, 0, 0}; break;
+            case 'c': txn_weight_ = {100, 0, 0, 0, 0}; break;
+            case 'd': txn_weight_ = {95, 0, 0, 0, 5}; break;
+            case 'e': txn_weight_ = {0, 0, 0, 95, 5}; break;
+            case 'f': txn_weight_ = {50, 0, 50, 0, 0}; break;
+            default: verify(0);
+        }
+    }
+    if (benchmark_ == SMALLBANK && txn_weight_str == "") {
+        // amalgamate : balance : deposit_checking : send_payment :
+        // transact_savings : write_check
+        txn_weight_ = {15, 15, 15, 25, 15, 15};
+    }
 
     num_site_ = pt.get<int>("benchmark.hosts.<xmlattr>.number");
     site_ = (char **)malloc(sizeof(char *) * num_site_);
@@ -665,6 +790,25 @@ int Config::get_my_addr(std::string &server) {
     return 0;
 }
 
+void Config::localize_sites() {
+    std::set<std::string> ports;
+    for (unsigned int i = 0; i < num_site_; i++) {
+        char *colon = strchr(site_[i], ':');
+        verify(colon != NULL && colon[1] != '\0');
+        std::string port(colon + 1);
+        if (!ports.insert(port).second) {
+            Log_fatal("site %u shares port %s with another site", i,
+                      port.c_str());
+            verify(0);
+        }
+        std::string addr = "127.0.0.1:" + port;
+        free(site_[i]);
+        site_[i] = (char *)malloc((addr.size() + 1) * sizeof(char));
+        verify(site_[i] != NULL);
+        strcpy(site_[i], addr.c_str());
+    }
+}
+
 int Config::get_threads(unsigned int &threads) {
     if (site_threads_ == NULL)
         return -1;
@@ -722,6 +866,102 @@ bool Config::get_batch_start() {
     return batch_start_;
 }
 
+unsigned int Config::get_piggyback_ms() {
+    return piggyback_ms_;
+}
+
+unsigned int Config::get_batch_size() {
+    return batch_size_;
+}
+
+unsigned int Config::get_batch_tick_us() {
+    return batch_tick_us_;
+}
+
+bool Config::do_chain_pieces() {
+    return chain_pieces_;
+}
+
+bool Config::do_one_shot() {
+    return one_shot_;
+}
+
+unsigned int Config::get_epoch_ms() {
+    return epoch_ms_;
+}
+
+unsigned int Config::get_ro_epoch_us() {
+    return ro_epoch_us_;
+}
+
+unsigned int Config::get_ro_pin_timeout_us() {
+    return ro_pin_timeout_us_;
+}
+
+bool Config::do_piece_profile() {
+    return piece_profile_;
+}
+
+unsigned int Config::get_contention_top_k() {
+    return contention_top_k_;
+}
+
+unsigned int Config::get_contention_sample() {
+    return contention_sample_;
+}
+
+unsigned int Config::get_contention_key_cols() {
+    return contention_key_cols_;
+}
+
+unsigned int Config::get_trace_ring() {
+    return trace_ring_;
+}
+
+int Config::get_arrival() {
+    return arrival_;
+}
+
+double Config::get_arrival_rate() {
+    return arrival_rate_;
+}
+
+const std::string &Config::get_arrival_trace() {
+    return arrival_trace_;
+}
+
+int Config::get_key_dist() {
+    return key_dist_;
+}
+
+double Config::get_zipf_theta() {
+    return zipf_theta_;
+}
+
+double Config::get_hot_fraction() {
+    return hot_fraction_;
+}
+
+double Config::get_hot_access() {
+    return hot_access_;
+}
+
+unsigned int Config::get_hot_keys() {
+    return hot_keys_;
+}
+
+unsigned int Config::get_keys_per_txn() {
+    return keys_per_txn_;
+}
+
+unsigned int Config::get_scan_length() {
+    return scan_length_;
+}
+
+unsigned int Config::get_field_length() {
+    return field_length_;
+}
+
 std::vector<double> &Config::get_txn_weight() {
     return txn_weight_;
 }
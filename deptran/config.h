@@ -44,6 +44,31 @@ private:
     single_server_t single_server_;
     unsigned int concurrent_txn_;
     bool batch_start_;
+    unsigned int piggyback_ms_;
+    unsigned int batch_size_;
+    unsigned int batch_tick_us_;
+    bool chain_pieces_;
+    bool one_shot_;
+    unsigned int epoch_ms_;
+    unsigned int ro_epoch_us_;
+    unsigned int ro_pin_timeout_us_;
+    bool piece_profile_;
+    unsigned int contention_top_k_;
+    unsigned int contention_sample_;
+    unsigned int contention_key_cols_;
+    unsigned int trace_ring_;
+    int arrival_;
+    double arrival_rate_;
+    std::string arrival_trace_;
+    int key_dist_;
+    double zipf_theta_;
+    double hot_fraction_;
+    double hot_access_;
+    unsigned int hot_keys_;
+    char ycsb_workload_;
+    unsigned int keys_per_txn_;
+    unsigned int scan_length_;
+    unsigned int field_length_;
     int server_or_client_; // 0 for server, 1 for client, init -1
     std::vector<double> txn_weight_;
     bool early_return_;
@@ -106,6 +131,10 @@ public:
 
     int get_my_addr(std::string &server);
 
+    /** every site at 127.0.0.1, on the port it has in the config; the
+     *  ports have to differ */
+    void localize_sites();
+
     int get_threads(unsigned int &threads);
 
     int get_mode();
@@ -128,6 +157,53 @@ public:
 
     bool get_batch_start();
 
+    unsigned int get_piggyback_ms();
+
+    unsigned int get_batch_size();
+
+    unsigned int get_batch_tick_us();
+
+    bool do_chain_pieces();
+
+    bool do_one_shot();
+
+    unsigned int get_epoch_ms();
+
+    unsigned int get_ro_epoch_us();
+    unsigned int get_ro_pin_timeout_us();
+
+    bool do_piece_profile();
+
+    unsigned int get_contention_top_k();
+
+    unsigned int get_contention_sample();
+
+    unsigned int get_contention_key_cols();
+
+    unsigned int get_trace_ring();
+
+    int get_arrival();
+
+    double get_arrival_rate();
+
+    const std::string &get_arrival_trace();
+
+    int get_key_dist();
+
+    double get_zipf_theta();
+
+    double get_hot_fraction();
+
+    double get_hot_access();
+
+    unsigned int get_hot_keys();
+
+    unsigned int get_keys_per_txn();
+
+    unsigned int get_scan_length();
+
+    unsigned int get_field_length();
+
     bool do_early_return();
 
 #ifdef CPU_PROFILE
@@ -26,12 +26,14 @@ namespace rococo {
 #define CONTENTION  (-1)
 #define REJECT      (-1)
 #define DELAYED     (1)
+#define READ_ONLY   (2)
 
 #define MODE_NONE   (0)
 #define MODE_2PL    (1)
 #define MODE_OCC    (2)
 #define MODE_RCC    (4)
 #define MODE_ROT    (8)
+#define MODE_CALVIN (16)
 #define MODE_RPC_NULL   (64)
 
     // deprecated.
@@ -54,6 +56,30 @@ namespace rococo {
 #define DRW (0x1)
 #define WDR (0x1)
 
+/** where the time of a txn goes at the coordinator, see TxnChopper::phase.
+ *  one_shot and calvin run and commit a txn in one request, all of it is
+ *  PHASE_START */
+#define PHASE_START     (0) // start requests in flight, none held back
+#define PHASE_PREPARE   (1) // prepare round of 2PL/OCC
+#define PHASE_FINISH    (2) // commit/abort, or finish (and asks) of deptran
+#define PHASE_RETRY     (3) // every attempt but the last, backoff included
+#define PHASE_QUEUE     (4) // open loop: due but waiting for a free slot
+#define PHASE_WAIT      (5) // pieces held back on the outputs of others
+#define PHASE_N         (6)
+
+/** how clients issue txns, see Arrival */
+#define ARRIVAL_CLOSED  (0) // a new txn as soon as one finishes
+#define ARRIVAL_POISSON (1)
+#define ARRIVAL_FIXED   (2)
+#define ARRIVAL_TRACE   (3) // gaps read from a file
+
+/** how clients pick keys, see KeyDist */
+#define KEY_DIST_UNIFORM    (0)
+#define KEY_DIST_ZIPF       (1)
+#define KEY_DIST_HOTSPOT    (2) // a hot fraction of the keys, a hot share
+                                // of the picks
+#define KEY_DIST_LATEST     (3) // zipf, the newest keys the hottest
+
 
 /** TPCA */
 #define TPCA (0)
@@ -76,6 +102,12 @@ namespace rococo {
 /** micro Benchmark */
 #define MICRO_BENCH (5)
 
+/** YCSB */
+#define YCSB (6)
+
+/** SmallBank */
+#define SMALLBANK (7)
+
 }
 
 #endif // CONSTANTS_HPP_
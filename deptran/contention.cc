@@ -0,0 +1,143 @@
+#include "all.h"
+
+namespace rococo {
+
+std::atomic<unsigned int> ContentionTracker::top_k_s(0);
+std::atomic<unsigned int> ContentionTracker::sample_s(1);
+std::atomic<unsigned int> ContentionTracker::key_cols_s(0);
+std::mutex ContentionTracker::mtx_s;
+std::map<const mdb::Table *, std::string> ContentionTracker::table_names_s;
+std::map<const mdb::Table *,
+         std::vector<uint64_t>> ContentionTracker::table_counts_s;
+std::vector<ContentionTracker::hot_key_t> ContentionTracker::slots_s;
+std::map<std::pair<const mdb::Table *, std::string>,
+         int> ContentionTracker::index_s;
+
+void ContentionTracker::init(unsigned int top_k,
+                             unsigned int sample,
+                             unsigned int key_cols) {
+    if (top_k == 0)
+        mdb::TxnMgr::conflict_hook_s.store(nullptr);
+    {
+        std::lock_guard<std::mutex> guard(mtx_s);
+        if (top_k != top_k_s.load()) {
+            slots_s.clear();
+            index_s.clear();
+            table_counts_s.clear();
+        }
+        sample_s.store(sample == 0 ? 1 : sample);
+        key_cols_s.store(key_cols);
+        top_k_s.store(top_k);
+    }
+    // hooked once everything it reads is set
+    if (top_k > 0)
+        mdb::TxnMgr::conflict_hook_s.store(ContentionTracker::conflict);
+}
+
+void ContentionTracker::reg_table(const std::string &name,
+                                  const mdb::Table *tbl) {
+    std::lock_guard<std::mutex> guard(mtx_s);
+    table_names_s[tbl] = name;
+}
+
+std::string ContentionTracker::key_of(const mdb::Row *row) {
+    const std::vector<mdb::column_id_t> &cols = row->schema()->key_columns_id();
+    size_t n = cols.size();
+    unsigned int key_cols = key_cols_s.load(std::memory_order_relaxed);
+    if (key_cols > 0 && key_cols < n)
+        n = key_cols;
+    std::string key;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0)
+            key += ",";
+        key += mdb::to_string(row->get_column(cols[i]));
+    }
+    return key;
+}
+
+void ContentionTracker::conflict(mdb::conflict_t kind,
+                                 const mdb::Row *row) {
+    static thread_local unsigned int n_seen = 0;
+    if (row == nullptr
+            || ++n_seen < sample_s.load(std::memory_order_relaxed))
+        return;
+    n_seen = 0;
+
+    const mdb::Table *tbl = row->get_table();
+    std::string key = key_of(row);
+
+    std::lock_guard<std::mutex> guard(mtx_s);
+    // rococo reports from outside the hook, and a switch may be under way
+    unsigned int top_k = top_k_s.load();
+    if (top_k == 0)
+        return;
+    std::vector<uint64_t> &tc = table_counts_s[tbl];
+    if (tc.empty())
+        tc.resize(mdb::CONFLICT_N, 0);
+    tc[kind]++;
+
+    auto index_key = std::make_pair(tbl, key);
+    auto it = index_s.find(index_key);
+    int i;
+    if (it != index_s.end()) {
+        i = it->second;
+    } else if (slots_s.size() < top_k) {
+        i = slots_s.size();
+        slots_s.push_back(hot_key_t());
+        hot_key_t &slot = slots_s.back();
+        slot.tbl = tbl;
+        slot.key = key;
+        slot.count = 0;
+        slot.error = 0;
+        memset(slot.by_kind, 0, sizeof(slot.by_kind));
+        index_s[index_key] = i;
+    } else {
+        // evict the coldest key, the new one may have been counted there
+        i = 0;
+        for (int j = 1; j < slots_s.size(); j++)
+            if (slots_s[j].count < slots_s[i].count)
+                i = j;
+        hot_key_t &slot = slots_s[i];
+        index_s.erase(std::make_pair(slot.tbl, slot.key));
+        slot.tbl = tbl;
+        slot.key = key;
+        slot.error = slot.count;
+        memset(slot.by_kind, 0, sizeof(slot.by_kind));
+        index_s[index_key] = i;
+    }
+    slots_s[i].count++;
+    slots_s[i].by_kind[kind]++;
+}
+
+void ContentionTracker::report(
+        std::vector<HotKey> *hot_keys,
+        std::map<std::string, std::vector<rrr::i64>> *tables) {
+    std::lock_guard<std::mutex> guard(mtx_s);
+    std::vector<const hot_key_t *> hot;
+    for (auto &slot : slots_s)
+        hot.push_back(&slot);
+    std::sort(hot.begin(), hot.end(),
+              [] (const hot_key_t *a, const hot_key_t *b) {
+                  return a->count > b->count;
+              });
+    for (auto slot : hot) {
+        HotKey hk;
+        auto name = table_names_s.find(slot->tbl);
+        hk.table = (name == table_names_s.end()) ? "" : name->second;
+        hk.key = slot->key;
+        hk.count = slot->count;
+        hk.error = slot->error;
+        hk.by_kind.assign(slot->by_kind, slot->by_kind + mdb::CONFLICT_N);
+        hot_keys->push_back(hk);
+    }
+    for (auto &it : table_counts_s) {
+        auto name = table_names_s.find(it.first);
+        std::string tb = (name == table_names_s.end()) ? "" : name->second;
+        std::vector<rrr::i64> &counts = (*tables)[tb];
+        counts.resize(mdb::CONFLICT_N, 0);
+        for (int k = 0; k < mdb::CONFLICT_N; k++)
+            counts[k] += it.second[k];
+    }
+}
+
+} // namespace rococo
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "rcc_rpc.h"
+
+namespace rococo {
+
+/**
+ * Which rows the txns fight over, on when the config sets contention_top_k
+ * or server_contention switches it on.
+ * memdb reports every conflict it sees through TxnMgr::conflict_hook_s and
+ * rococo reports the dependencies it adds; one in contention_sample of them
+ * is kept. Rows that share their first contention_key_cols key columns are
+ * counted as one key, 0 keeps the whole key.
+ *
+ * The hottest keys are kept in a space saving sketch of top_k slots: a key
+ * that finds no slot takes over the coldest one, inheriting its count as
+ * the error bound. Counts add up from when it was last switched on.
+ */
+class ContentionTracker {
+public:
+    /** may be called at any time, top_k 0 turns it off; a new top_k
+     *  drops what was counted */
+    static void init(unsigned int top_k,
+                     unsigned int sample,
+                     unsigned int key_cols);
+
+    static bool on() {
+        return top_k_s.load(std::memory_order_relaxed) > 0;
+    }
+
+    static void reg_table(const std::string &name, const mdb::Table *tbl);
+
+    /** the memdb conflict hook */
+    static void conflict(mdb::conflict_t kind, const mdb::Row *row);
+
+    /** hottest keys first, and the conflicts of each table by kind */
+    static void report(std::vector<HotKey> *hot_keys,
+                       std::map<std::string, std::vector<rrr::i64>> *tables);
+
+private:
+    typedef struct {
+        const mdb::Table *tbl;
+        std::string key;
+        uint64_t count;
+        uint64_t error;
+        uint64_t by_kind[mdb::CONFLICT_N];
+    } hot_key_t;
+
+    static std::string key_of(const mdb::Row *row);
+
+    static std::atomic<unsigned int> top_k_s;
+    static std::atomic<unsigned int> sample_s;
+    static std::atomic<unsigned int> key_cols_s;
+
+    static std::mutex mtx_s;
+    static std::map<const mdb::Table *, std::string> table_names_s;
+    static std::map<const mdb::Table *,
+                    std::vector<uint64_t>> table_counts_s;
+    static std::vector<hot_key_t> slots_s;
+    // (table, key) => index in slots_s
+    static std::map<std::pair<const mdb::Table *, std::string>, int> index_s;
+};
+
+} // namespace rococo
@@ -30,7 +30,12 @@ Coordinator::Coordinator(
                               site_prepare_(addrs.size(), 0),
                               site_commit_(addrs.size(), 0),
                               site_abort_(addrs.size(), 0),
-                              site_piece_(addrs.size(), 0) {
+                              site_piece_(addrs.size(), 0),
+                              piggy_stop_(false),
+                              piggy_commits_(addrs.size()),
+                              piggy_waiting_(addrs.size()),
+                              batch_stop_(false),
+                              batches_(addrs.size()) {
 
     uint64_t k = coo_id_;
     k <<= 32;
@@ -57,6 +62,37 @@ Coordinator::Coordinator(
     }
 
     retry_wait_ = Config::get_config()->retry_wait();
+
+    ro_epoch_us_ = Config::get_config()->get_ro_epoch_us();
+
+    piggyback_ms_ = 0;
+    if (mode_ == MODE_OCC || mode_ == MODE_2PL)
+        piggyback_ms_ = Config::get_config()->get_piggyback_ms();
+    if (piggyback_ms_ > 0)
+        verify(0 == pthread_create(&piggy_th_, NULL,
+                                   &Coordinator::piggy_flush_loop, this));
+
+    // one_shot_txn runs the start_pie path on the server, not rcc or calvin
+    one_shot_ = false;
+    if (mode_ == MODE_OCC || mode_ == MODE_2PL || mode_ == MODE_NONE)
+        one_shot_ = Config::get_config()->do_one_shot();
+
+    // forwards ride on start_pie, which deptran and calvin do not send
+    chain_ = false;
+    if (mode_ == MODE_OCC || mode_ == MODE_2PL || mode_ == MODE_NONE)
+        chain_ = Config::get_config()->do_chain_pieces();
+
+    // a piece waiting on a lock would hold back the whole batch reply,
+    // so only the modes that never block a piece batch across txns.
+    // deptran replies carry one dependency graph per request, it batches
+    // the pieces of a single txn instead, see deptran_batch_start
+    batch_size_ = 0;
+    batch_tick_us_ = Config::get_config()->get_batch_tick_us();
+    if (mode_ == MODE_OCC || mode_ == MODE_NONE)
+        batch_size_ = Config::get_config()->get_batch_size();
+    if (batch_size_ > 0)
+        verify(0 == pthread_create(&batch_th_, NULL,
+                                   &Coordinator::batch_flush_loop, this));
 }
 
 
@@ -80,9 +116,10 @@ BatchRequestHeader Coordinator::gen_batch_header(TxnChopper* ch) {
 /** thread safe */
 void Coordinator::do_one(TxnRequest& req) {
     // pre-process
-    ScopedLock(this->mtx_);
+    ScopedLock lock(mtx_);
     TxnChopper *ch = TxnChopperFactory::gen_chopper(req, benchmark_);
     ch->txn_id_ = this->next_txn_id();
+    Trace::async_begin(Trace::TR_TXN, ch->txn_id_, 0);
 
     // turn off batch now
     // if (batch_optimal_)
@@ -116,6 +153,7 @@ void Coordinator::do_one(TxnRequest& req) {
         }
         break;
     case MODE_DEPTRAN:
+    case MODE_ROT:
         if (recorder_) {
                std::string log_s;
             req.get_log(ch->txn_id_, log_s);
@@ -144,6 +182,9 @@ void Coordinator::do_one(TxnRequest& req) {
     case MODE_RPC_NULL:
         rpc_null_start(ch);
         break;
+    case MODE_CALVIN:
+        calvin_start(ch);
+        break;
     default:
         verify(0);
     }
@@ -169,13 +210,20 @@ void Coordinator::rpc_null_start(TxnChopper *ch) {
 }
 
 void Coordinator::restart(TxnChopper* ch) {
-    ScopedLock(this->mtx_);
+    ScopedLock lock(mtx_);
+    ch->phase_retry();
     ch->n_start_sent_ = 0;
+    ch->ro_proxies_.clear();
+    ch->ro_snapshot_ts_ = -1;
+    ch->ro_fallback_ = false;
+    ch->ro_snapshot_read_ = false;
     ch->retry();
     double last_latency = ch->last_attempt_latency();
     if (ccsi_)
         ccsi_->txn_retry_one(this->thread_id_, ch->txn_type_, last_latency);
-    if (batch_optimal_)
+    if (mode_ == MODE_CALVIN)
+        calvin_start(ch);
+    else if (batch_optimal_)
         naive_batch_start(ch);
     else
         start(ch);
@@ -185,6 +233,32 @@ void Coordinator::start(TxnChopper* ch) {
     // new txn id for every new and retry.
     RequestHeader header = gen_header(ch);
 
+    int32_t sid;
+    if (one_shot_ && ch->n_started_ == 0 && ch->n_start_sent_ == 0
+            && ch->single_site(&sid)) {
+        one_shot_start(ch, sid);
+        return;
+    }
+
+    if (chain_)
+        ch->ready_chained();
+
+    bool ro = (mode_ == MODE_OCC && ch->is_read_only());
+    if (ro && ch->n_started_ == 0 && ch->n_start_sent_ == 0) {
+        // a snapshot is a consistent cut of one server only, nothing orders
+        // the snapshots of different servers. Single site txns read one,
+        // the txns of the same epoch share it
+        int32_t sid;
+        if (ch->single_site(&sid)
+                && ro_multi_site_.find(ch->txn_type_) == ro_multi_site_.end()) {
+            ch->ro_snapshot_ts_ = rrr::Time::now();
+            if (ro_epoch_us_ > 0)
+                ch->ro_snapshot_ts_ -= ch->ro_snapshot_ts_ % ro_epoch_us_;
+        } else {
+            ch->ro_snapshot_ts_ = -1;
+        }
+    }
+
     int pi;
     std::vector<Value>* input;
     int32_t server_id;
@@ -197,65 +271,244 @@ void Coordinator::start(TxnChopper* ch) {
                                  header.p_type)) == 0) {
         header.pid = next_pie_id();
 
-        rrr::FutureAttr fuattr;
-        // remember this a asynchronous call!
-        // variable funtional range is important!
-        fuattr.callback = [ch, pi, this] (Future* fu) {
-            bool callback = false;
-            {
-                ScopedLock(this->mtx_);
+        if (chain_ && !ro && ch->is_chained(pi)) {
+            // inputs come from, and outputs go to, other servers directly
+            int n_wait = 0;
+            std::vector<PieceForward> forwards;
+            ch->chain_of(pi, &n_wait, &forwards);
 
+            i64 tid = header.tid, pid = header.pid;
+            rrr::FutureAttr fuattr;
+            fuattr.callback = [ch, pi, this, tid, pid] (Future* fu) {
+                Trace::rpc_reply(tid, pid);
                 int res;
                 std::vector<mdb::Value> output;
                 fu->get_reply() >> res >> output;
-                ch->n_started_++;
-                ch->n_start_sent_--;
+                this->start_piece_callback(ch, pi, res, output);
+            };
+            RococoProxy* proxy = vec_rpc_proxy_[server_id];
+            Trace::rpc_send(tid, pid);
+            Future::safe_release(proxy->async_chain_start_pie(header,
+                                                              pi,
+                                                              *input,
+                                                              (i32)output_size,
+                                                              n_wait,
+                                                              forwards,
+                                                              fuattr));
+            ch->n_start_sent_++;
+            site_piece_[server_id]++;
+            continue;
+        }
 
-                if (res == REJECT) {
-                    verify(this->mode_ == MODE_2PL);
-                    ch->commit_.store(false);
-                }
-                if (!ch->commit_.load()) {
-                    if (ch->n_start_sent_ == 0) {
-                        this->finish(ch);
-                    }
+        if (batch_size_ > 0 && !ro) {
+            // shares one naive_batch_start_pie with pieces of other txns
+            batch_piece(server_id, header, *input, output_size, ch, pi);
+            ch->n_start_sent_++;
+            site_piece_[server_id]++;
+            continue;
+        }
+
+        std::vector<i64> commits, aborts;
+        std::vector<TxnChopper*> waiting;
+        bool piggy = !ro && take_decisions(server_id, &commits, &waiting);
+
+        i64 tid = header.tid, pid = header.pid;
+        rrr::FutureAttr fuattr;
+        // remember this a asynchronous call!
+        // variable funtional range is important!
+        fuattr.callback = [ch, pi, this, tid, pid, waiting, ro] (Future* fu) {
+            Trace::rpc_reply(tid, pid);
+            int res;
+            std::vector<mdb::Value> output;
+            fu->get_reply() >> res >> output;
+            if (ro) {
+                ScopedLock lock(mtx_);
+                if (res == READ_ONLY) {
+                    res = SUCCESS;
+                    ch->ro_snapshot_read_ = true;
                 } else {
-                    if (ch->start_callback(pi, res, output))
-                        this->start(ch);
-                    else if (ch->n_started_ == ch->n_pieces_) {
-                        if (this->mode_ == MODE_OCC) {
-                            this->prepare(ch);
-                        } else if (this->mode_ == MODE_NONE) {
-                            callback = true;
-                            ch->reply_.res_ = SUCCESS;
-                        } else if (this->mode_ == MODE_2PL) {
-                            this->prepare(ch);
-                        }
-                    }
+                    ch->ro_fallback_ = true;
                 }
             }
-
-            if (callback) {
-                TxnReply &txn_reply_buf = ch->get_reply();
-                double last_latency = ch->last_attempt_latency();
-                this->report(txn_reply_buf, last_latency
-#ifdef TXN_STAT
-                        , ch
-#endif
-                        );
-                ch->callback_(txn_reply_buf);
-                delete ch;
-            }
+            this->start_piece_callback(ch, pi, res, output);
+            // the commits that rode along were applied before the piece
+            if (!waiting.empty())
+                this->decisions_done(waiting);
         };
 
         RococoProxy* proxy = vec_rpc_proxy_[server_id];
-        Future::safe_release(proxy->async_start_pie(header,
-                                                    *input,
-                                                    (i32)output_size,
-                                                    fuattr));
+        Trace::rpc_send(tid, pid);
+        if (ro) {
+            Future::safe_release(proxy->async_ro_start_pie(header,
+                                                           *input,
+                                                           (i32)output_size,
+                                                           ch->ro_snapshot_ts_,
+                                                           fuattr));
+        } else if (piggy) {
+            Future::safe_release(proxy->async_piggy_start_pie(header,
+                                                              *input,
+                                                              (i32)output_size,
+                                                              commits,
+                                                              aborts,
+                                                              fuattr));
+        } else {
+            Future::safe_release(proxy->async_start_pie(header,
+                                                        *input,
+                                                        (i32)output_size,
+                                                        fuattr));
+        }
         ch->n_start_sent_++;
         site_piece_[server_id]++;
     }
+    ch->phase_sent(res);
+}
+
+void Coordinator::start_piece_callback(TxnChopper *ch,
+                                       int pi,
+                                       int res,
+                                       std::vector<mdb::Value> &output) {
+    bool callback = false;
+    {
+        ScopedLock lock(mtx_);
+
+        ch->n_started_++;
+        ch->n_start_sent_--;
+
+        if (res == REJECT) {
+            verify(this->mode_ == MODE_2PL);
+            ch->commit_.store(false);
+        }
+        if (!ch->commit_.load()) {
+            if (ch->n_start_sent_ == 0) {
+                this->finish(ch);
+            }
+        } else {
+            if (ch->start_callback(pi, res, output))
+                this->start(ch);
+            else if (ch->n_started_ == ch->n_pieces_) {
+                if (this->mode_ == MODE_OCC && ch->ro_snapshot_read_
+                        && ch->proxies_.size() > 1) {
+                    // later pieces went to another server, the snapshots
+                    // may not be of one serial order and nothing validates
+                    // them. Run it again, and the txns of its type from now
+                    // on, as plain OCC
+                    ro_multi_site_.insert(ch->txn_type_);
+                    ch->commit_.store(false);
+                    ch->reply_.res_ = REJECT;
+                    this->finish(ch);
+                } else if (this->mode_ == MODE_OCC && ch->is_read_only()
+                        && !ch->ro_fallback_) {
+                    // the only server read a snapshot, there is nothing to
+                    // validate. Release it without waiting for the server
+                    for (auto sid : ch->proxies_) {
+                        Future::safe_release(this->vec_rpc_proxy_[sid]
+                                ->async_ro_end_txn(ch->txn_id_));
+                    }
+                    callback = true;
+                    ch->reply_.res_ = SUCCESS;
+                } else if (this->mode_ == MODE_OCC) {
+                    this->prepare(ch);
+                } else if (this->mode_ == MODE_NONE) {
+                    callback = true;
+                    ch->reply_.res_ = SUCCESS;
+                } else if (this->mode_ == MODE_2PL) {
+                    this->prepare(ch);
+                }
+            }
+        }
+    }
+
+    if (callback) {
+        TxnReply &txn_reply_buf = ch->get_reply();
+        double last_latency = ch->last_attempt_latency();
+        this->report(txn_reply_buf, last_latency
+#ifdef TXN_STAT
+                , ch
+#endif
+                );
+        ch->callback_(txn_reply_buf);
+        delete ch;
+    }
+}
+
+/** thread safe */
+void Coordinator::batch_piece(int32_t server_id,
+                              const RequestHeader &header,
+                              const std::vector<Value> &input,
+                              int output_size,
+                              TxnChopper *ch,
+                              int pi) {
+    piece_batch_t full;
+    {
+        ScopedLock lock(batch_mtx_);
+        piece_batch_t &batch = batches_[server_id];
+        batch.headers.push_back(header);
+        batch.inputs.push_back(input);
+        batch.output_sizes.push_back(output_size);
+        batch.pieces.push_back(std::make_pair(ch, pi));
+        if (batch.headers.size() < batch_size_)
+            return;
+        full.swap(batch);
+    }
+    send_batch(server_id, full);
+}
+
+void Coordinator::send_batch(int32_t server_id, piece_batch_t &batch) {
+    std::vector<std::pair<TxnChopper*, int>> pieces;
+    pieces.swap(batch.pieces);
+
+    rrr::FutureAttr fuattr;
+    fuattr.callback = [pieces, this] (Future *fu) {
+        std::vector<i32> results;
+        std::vector<std::vector<Value>> outputs;
+        fu->get_reply() >> results >> outputs;
+        verify(results.size() == pieces.size());
+        // one piece may end its txn only after all of that txn's pieces
+        // came back, so walking them in order is safe
+        for (int i = 0; i < pieces.size(); i++)
+            this->start_piece_callback(pieces[i].first, pieces[i].second,
+                                       results[i], outputs[i]);
+    };
+
+    Log::debug("send batch of %d pieces to server %d",
+               (int) pieces.size(), server_id);
+    RococoProxy* proxy = vec_rpc_proxy_[server_id];
+    Future::safe_release(proxy->async_naive_batch_start_pie(
+                batch.headers,
+                batch.inputs,
+                batch.output_sizes,
+                fuattr));
+}
+
+/** thread safe */
+void Coordinator::flush_batches() {
+    for (int32_t sid = 0; sid < batches_.size(); sid++) {
+        piece_batch_t batch;
+        {
+            ScopedLock lock(batch_mtx_);
+            batch.swap(batches_[sid]);
+        }
+        if (batch.headers.size() > 0)
+            send_batch(sid, batch);
+    }
+}
+
+void *Coordinator::batch_flush_loop(void *arg) {
+    Coordinator *coo = (Coordinator *)arg;
+    double tick = coo->batch_tick_us_ / 1000000.0;
+    while (true) {
+        bool stop;
+        coo->batch_mtx_.lock();
+        if (!coo->batch_stop_)
+            coo->batch_cond_.timed_wait(coo->batch_mtx_, tick);
+        stop = coo->batch_stop_;
+        coo->batch_mtx_.unlock();
+        // flush on the way out too, ~Coordinator joins us after that
+        coo->flush_batches();
+        if (stop)
+            break;
+    }
+    return NULL;
 }
 
 void Coordinator::naive_batch_start(TxnChopper *ch) {
@@ -291,7 +544,7 @@ void Coordinator::naive_batch_start(TxnChopper *ch) {
             bool callback = false;
             {
                 Log::debug("Batch back");
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 std::vector<i32> results;
                 std::vector<std::vector<Value>> outputs;
@@ -363,6 +616,7 @@ void Coordinator::naive_batch_start(TxnChopper *ch) {
         Log::debug("naive start sent: tid: %ld", header.tid);
         ch->n_start_sent_ += it->second.headers.size();
     }
+    ch->phase_sent(res);
 }
 
 /** thread safe */
@@ -382,7 +636,7 @@ void Coordinator::batch_start(TxnChopper* ch) {
         fuattr.callback = [ch, pi, this](Future* fu) {
             bool callback = false;
             {
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 i32 res;
                 std::vector<mdb::Value> output;
@@ -432,39 +686,62 @@ void Coordinator::batch_start(TxnChopper* ch) {
         Future::safe_release(proxy->async_batch_start_pie(batch_header, input, fuattr));
         ch->n_start_sent_++;
     }
+    ch->phase_sent(res);
 }
 
 /** caller should be thread_safe */
 void Coordinator::prepare(TxnChopper *ch) {
     verify(mode_ == MODE_OCC || mode_== MODE_2PL);
+    ch->phase(PHASE_PREPARE);
+    if (ch->proxies_.size() == 1) {
+        one_phase_commit(ch);
+        return;
+    }
     RequestHeader header = gen_header(ch);
 
-    // prepare piece, currently only useful for OCC
-    rrr::FutureAttr fuattr;
-    fuattr.callback = [ch, this] (Future *fu) {
-        ScopedLock(this->mtx_);
-        ch->n_prepared_++;
-        int32_t e = fu->get_error_code();
-        if (e != 0) {
-            ch->commit_.store(false);
-            Log_debug("2PL prepare failed");
-        } else {
-            int res;
-            fu->get_reply() >> res;
-            Log::debug("pre res: %d", res);
-            if (res == REJECT) {
-                ch->commit_.store(false);
-            }
-        }
-        if (ch->n_prepared_ == ch->proxies_.size()) {
-            this->finish(ch);
-        }
-    };
     std::vector<i32> sids;
     sids.reserve(ch->proxies_.size());
     for (auto& rp: ch->proxies_)
         sids.push_back(rp);
     for (auto& rp: ch->proxies_) {
+        // prepare piece, currently only useful for OCC
+        rrr::FutureAttr fuattr;
+        int32_t sid = rp;
+        fuattr.callback = [ch, this, sid] (Future *fu) {
+            bool decided = false;
+            {
+                ScopedLock lock(mtx_);
+                ch->n_prepared_++;
+                int32_t e = fu->get_error_code();
+                if (e != 0) {
+                    ch->commit_.store(false);
+                    Log_debug("2PL prepare failed");
+                } else {
+                    int res;
+                    fu->get_reply() >> res;
+                    Log::debug("pre res: %d", res);
+                    if (res == REJECT) {
+                        ch->commit_.store(false);
+                    } else if (res == READ_ONLY) {
+                        // already released on that server, no commit needed
+                        ch->ro_proxies_.insert(sid);
+                    }
+                }
+                if (ch->n_prepared_ == ch->proxies_.size()) {
+                    if (ch->commit_.load()
+                            && ch->ro_proxies_.size() == ch->proxies_.size()) {
+                        // every server voted read only, the txn is done
+                        ch->reply_.res_ = SUCCESS;
+                        decided = true;
+                    } else {
+                        this->finish(ch);
+                    }
+                }
+            }
+            if (decided) {
+                this->end(ch);
+            }
+        };
         Log::debug("send prepare tid: %ld", header.tid);
 
         RococoProxy* proxy = vec_rpc_proxy_[rp];
@@ -477,18 +754,41 @@ void Coordinator::prepare(TxnChopper *ch) {
 /** caller should be thread safe */
 void Coordinator::finish(TxnChopper *ch) {
     verify(mode_ == MODE_OCC || mode_== MODE_2PL);
+    ch->phase(PHASE_FINISH);
+
+    // read only servers released the txn at prepare, skip them
+    std::vector<int32_t> sites;
+    for (auto& rp: ch->proxies_)
+        if (ch->ro_proxies_.find(rp) == ch->ro_proxies_.end())
+            sites.push_back(rp);
+    verify(sites.size() > 0);
+    int n_sites = sites.size();
+
+    if (piggyback_ms_ > 0 && ch->commit_.load()) {
+        // rides on later requests, the client hears back once every server
+        // applied it, see decisions_done
+        ch->reply_.res_ = SUCCESS;
+        ch->n_finished_ = 0;
+        ScopedLock lock(piggy_mtx_);
+        for (auto& rp: sites) {
+            piggy_commits_[rp].push_back(ch->txn_id_);
+            piggy_waiting_[rp].push_back(ch);
+            site_commit_[rp]++;
+        }
+        return;
+    }
 
     // commit or abort piece
     rrr::FutureAttr fuattr;
-    fuattr.callback = [ch, this] (Future *fu) {
+    fuattr.callback = [ch, this, n_sites] (Future *fu) {
         bool callback = false;
         bool retry = false;
         {
-            ScopedLock(this->mtx_);
+            ScopedLock lock(mtx_);
             ch->n_finished_++;
 
             Log::debug("finish");
-            if (ch->n_finished_ == ch->proxies_.size()) {
+            if (ch->n_finished_ == n_sites) {
                 if (ch->reply_.res_ == REJECT && ch->can_retry()) {
                     retry = true;
                 } else {
@@ -532,7 +832,7 @@ void Coordinator::finish(TxnChopper *ch) {
     if (ch->commit_.load()) {
         Log::debug("send finish");
         ch->reply_.res_ = SUCCESS;
-        for (auto& rp: ch->proxies_) {
+        for (auto& rp: sites) {
             RococoProxy* proxy = vec_rpc_proxy_[rp];
             Future::safe_release(proxy->async_commit_txn(ch->txn_id_, fuattr));
             site_commit_[rp]++;
@@ -540,7 +840,7 @@ void Coordinator::finish(TxnChopper *ch) {
     } else {
         Log::debug("send abort");
         ch->reply_.res_ = REJECT;
-        for (auto& rp: ch->proxies_) {
+        for (auto& rp: sites) {
             RococoProxy* proxy = vec_rpc_proxy_[rp];
             Future::safe_release(proxy->async_abort_txn(ch->txn_id_, fuattr));
             site_abort_[rp]++;
@@ -548,6 +848,179 @@ void Coordinator::finish(TxnChopper *ch) {
     }
 }
 
+/** caller should NOT hold the lock */
+void Coordinator::end(TxnChopper *ch) {
+    if (ch->reply_.res_ == REJECT && ch->can_retry()) {
+        this->restart(ch);
+        return;
+    }
+    TxnReply &txn_reply_buf = ch->get_reply();
+    double last_latency = ch->last_attempt_latency();
+    this->report(txn_reply_buf, last_latency
+#ifdef TXN_STAT
+            , ch
+#endif
+            );
+    ch->callback_(txn_reply_buf);
+    delete ch;
+}
+
+/** thread safe */
+bool Coordinator::take_decisions(int32_t sid,
+                                 std::vector<i64> *commits,
+                                 std::vector<TxnChopper*> *waiting) {
+    if (piggyback_ms_ == 0)
+        return false;
+    ScopedLock lock(piggy_mtx_);
+    commits->swap(piggy_commits_[sid]);
+    waiting->swap(piggy_waiting_[sid]);
+    return !commits->empty();
+}
+
+/** caller should NOT hold the lock */
+void Coordinator::decisions_done(const std::vector<TxnChopper*> &waiting) {
+    std::vector<TxnChopper*> done;
+    {
+        ScopedLock lock(piggy_mtx_);
+        for (auto ch: waiting) {
+            int n_sites = ch->proxies_.size() - ch->ro_proxies_.size();
+            if (++ch->n_finished_ == n_sites)
+                done.push_back(ch);
+        }
+    }
+    for (auto ch: done)
+        this->end(ch);
+}
+
+/** thread safe */
+void Coordinator::flush_decisions(bool wait) {
+    for (int32_t sid = 0; sid < vec_rpc_proxy_.size(); sid++) {
+        std::vector<i64> commits, aborts;
+        std::vector<TxnChopper*> waiting;
+        if (!take_decisions(sid, &commits, &waiting))
+            continue;
+        rrr::FutureAttr fuattr;
+        fuattr.callback = [this, waiting] (Future *fu) {
+            this->decisions_done(waiting);
+        };
+        RococoProxy* proxy = vec_rpc_proxy_[sid];
+        Future *fu = proxy->async_decide_txns(commits, aborts, fuattr);
+        if (wait)
+            fu->wait();
+        Future::safe_release(fu);
+    }
+}
+
+void *Coordinator::piggy_flush_loop(void *arg) {
+    Coordinator *coo = (Coordinator *)arg;
+    double timeout = coo->piggyback_ms_ / 1000.0;
+    while (true) {
+        bool stop;
+        coo->piggy_mtx_.lock();
+        if (!coo->piggy_stop_)
+            coo->piggy_cond_.timed_wait(coo->piggy_mtx_, timeout);
+        stop = coo->piggy_stop_;
+        coo->piggy_mtx_.unlock();
+        if (stop)
+            break;
+        coo->flush_decisions(false);
+    }
+    return NULL;
+}
+
+/** caller should be thread safe */
+void Coordinator::one_phase_commit(TxnChopper *ch) {
+    verify(mode_ == MODE_OCC || mode_== MODE_2PL);
+    verify(ch->proxies_.size() == 1);
+    ch->phase(PHASE_FINISH);
+
+    rrr::FutureAttr fuattr;
+    fuattr.callback = [ch, this] (Future *fu) {
+        bool callback = false;
+        bool retry = false;
+        {
+            ScopedLock lock(mtx_);
+            int res = REJECT;
+            if (fu->get_error_code() == 0)
+                fu->get_reply() >> res;
+            Log::debug("one phase commit res: %d", res);
+            ch->reply_.res_ = (res == SUCCESS) ? SUCCESS : REJECT;
+            if (ch->reply_.res_ == REJECT && ch->can_retry()) {
+                retry = true;
+            } else {
+                callback = true;
+            }
+        }
+        if (retry) {
+            this->restart(ch);
+        }
+        if (callback) {
+            TxnReply &txn_reply_buf = ch->get_reply();
+            double last_latency = ch->last_attempt_latency();
+            this->report(txn_reply_buf, last_latency
+#ifdef TXN_STAT
+                    , ch
+#endif
+                    );
+            ch->callback_(txn_reply_buf);
+            delete ch;
+        }
+    };
+
+    int32_t sid = *ch->proxies_.begin();
+    RococoProxy* proxy = vec_rpc_proxy_[sid];
+    Future::safe_release(proxy->async_one_phase_commit_txn(ch->txn_id_,
+                                                           fuattr));
+    site_commit_[sid]++;
+}
+
+/** caller should be thread safe */
+void Coordinator::one_shot_start(TxnChopper *ch, int32_t sid) {
+    RequestHeader header = gen_header(ch);
+    ch->proxies_.insert(sid);
+
+    rrr::FutureAttr fuattr;
+    fuattr.callback = [ch, this] (Future *fu) {
+        {
+            ScopedLock lock(mtx_);
+            int res = REJECT;
+            if (fu->get_error_code() == 0)
+                fu->get_reply() >> res;
+            Log::debug("one shot res: %d", res);
+            ch->reply_.res_ = (res == SUCCESS) ? SUCCESS : REJECT;
+        }
+        this->end(ch);
+    };
+
+    RococoProxy* proxy = vec_rpc_proxy_[sid];
+    Future::safe_release(proxy->async_one_shot_txn(header, ch->req_input_,
+                                                   fuattr));
+    site_piece_[sid] += ch->n_pieces_;
+    site_commit_[sid]++;
+}
+
+void Coordinator::calvin_start(TxnChopper *ch) {
+    RequestHeader header = gen_header(ch);
+    // any server can sequence, spread the coordinators over them
+    int32_t sid = coo_id_ % vec_rpc_proxy_.size();
+
+    rrr::FutureAttr fuattr;
+    fuattr.callback = [ch, this] (Future *fu) {
+        {
+            ScopedLock lock(mtx_);
+            int res = REJECT;
+            if (fu->get_error_code() == 0)
+                fu->get_reply() >> res;
+            ch->reply_.res_ = (res == SUCCESS) ? SUCCESS : REJECT;
+        }
+        this->end(ch);
+    };
+
+    RococoProxy* proxy = vec_rpc_proxy_[sid];
+    Future::safe_release(proxy->async_calvin_submit(header, ch->req_input_,
+                                                    fuattr));
+}
+
 void Coordinator::deptran_batch_start(TxnChopper *ch) {
 
     // new txn id for every new and retry.
@@ -580,7 +1053,7 @@ void Coordinator::deptran_batch_start(TxnChopper *ch) {
             bool early_return = false;
             {
                 Log::debug("Batch back");
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 BatchChopStartResponse res;
                 fu->get_reply() >> res;
@@ -634,6 +1107,7 @@ void Coordinator::deptran_batch_start(TxnChopper *ch) {
                     it->second.fuattr
                     ));
     }
+    ch->phase_sent(res);
 }
 
 void Coordinator::deptran_start(TxnChopper* ch) {
@@ -652,10 +1126,11 @@ void Coordinator::deptran_start(TxnChopper* ch) {
         rrr::FutureAttr fuattr;
         // remember this a asynchronous call! variable funtional range is important!
         fuattr.callback = [ch, pi, this, header](Future* fu) {
+            Trace::rpc_reply(header.tid, header.pid);
             bool early_return = false;
             {
            //     Log::debug("try locking at start response, tid: %llx, pid: %llx", header.tid, header.pid);
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 ChopStartResponse res;
                 fu->get_reply() >> res;
@@ -697,15 +1172,17 @@ void Coordinator::deptran_start(TxnChopper* ch) {
         RococoProxy* proxy = vec_rpc_proxy_[server_id];
         Log::debug("send deptran start request, tid: %llx, pid: %llx", ch->txn_id_, header.pid);
         verify(input != nullptr);
+        Trace::rpc_send(header.tid, header.pid);
         Future::safe_release(proxy->async_rcc_start_pie(header, *input, fuattr));
     }
-
+    ch->phase_sent(res);
 }
 
 /** caller should be thread safe */
 void Coordinator::deptran_finish(TxnChopper *ch) {
-    verify(mode_ == MODE_DEPTRAN);
+    verify(mode_ == MODE_DEPTRAN || mode_ == MODE_ROT);
     Log::debug("deptran finish, %llx", ch->txn_id_);
+    ch->phase(PHASE_FINISH);
 
     // commit or abort piece
     rrr::FutureAttr fuattr;
@@ -715,7 +1192,7 @@ void Coordinator::deptran_finish(TxnChopper *ch) {
 
         bool callback = false;
         {
-            ScopedLock(this->mtx_);
+            ScopedLock lock(mtx_);
             ch->n_finished_++;
 
             ChopFinishResponse res;
@@ -778,8 +1255,9 @@ void Coordinator::deptran_start_ro(TxnChopper* ch) {
         rrr::FutureAttr fuattr;
         // remember this a asynchronous call! variable funtional range is important!
         fuattr.callback = [ch, pi, this, header](Future* fu) {
+            bool callback = false;
             {
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 std::vector<Value> res;
                 fu->get_reply() >> res;
@@ -790,10 +1268,34 @@ void Coordinator::deptran_start_ro(TxnChopper* ch) {
                 if (ch->read_only_start_callback(pi, NULL, res))
                     this->deptran_start_ro(ch);
                 else if (ch->n_started_ == ch->n_pieces_) {
-                    ch->read_only_reset();
-                    this->deptran_finish_ro(ch);
+                    if (this->mode_ == MODE_ROT) {
+                        // servers replied from a snapshot, there is
+                        // nothing to check in a second round. Release the
+                        // snapshots without waiting for the servers
+                        for (auto sid : ch->proxies_) {
+                            Future::safe_release(this->vec_rpc_proxy_[sid]
+                                    ->async_rcc_ro_end_txn(ch->txn_id_));
+                        }
+                        ch->reply_.res_ = SUCCESS;
+                        callback = true;
+                    } else {
+                        ch->read_only_reset();
+                        this->deptran_finish_ro(ch);
+                    }
                 }
             }
+            if (callback) {
+                Log::debug("deptran RO callback, %llx", ch->txn_id_);
+                TxnReply &txn_reply_buf = ch->get_reply();
+                double last_latency = ch->last_attempt_latency();
+                this->report(txn_reply_buf, last_latency
+#ifdef TXN_STAT
+                        , ch
+#endif
+                        );
+                ch->callback_(txn_reply_buf);
+                delete ch;
+            }
         };
 
         RococoProxy* proxy = vec_rpc_proxy_[server_id];
@@ -801,9 +1303,11 @@ void Coordinator::deptran_start_ro(TxnChopper* ch) {
         verify(input != nullptr);
         Future::safe_release(proxy->async_rcc_ro_start_pie(header, *input, fuattr));
     }
+    ch->phase_sent(res);
 }
 
 void Coordinator::deptran_finish_ro(TxnChopper* ch) {
+    ch->phase(PHASE_FINISH);
 
     RequestHeader header = gen_header(ch);
     int pi;
@@ -819,7 +1323,7 @@ void Coordinator::deptran_finish_ro(TxnChopper* ch) {
         fuattr.callback = [ch, pi, this, header](Future* fu) {
             bool callback = false;
             {
-                ScopedLock(this->mtx_);
+                ScopedLock lock(mtx_);
 
                 int res;
                 std::vector<Value> output;
@@ -838,6 +1342,7 @@ void Coordinator::deptran_finish_ro(TxnChopper* ch) {
                     }
                     else if (ch->can_retry()) {
                         ch->read_only_reset();
+                        ch->phase_retry();
                         double last_latency = ch->last_attempt_latency();
                         if (ccsi_)
                             ccsi_->txn_retry_one(this->thread_id_, ch->txn_type_, last_latency);
@@ -883,10 +1388,10 @@ void Coordinator::report(TxnReply &txn_reply,
 #ifdef TXN_STAT
             txn_stats_[ch->txn_type_].one(ch->proxies_.size(), ch->p_types_);
 #endif
-            ccsi_->txn_success_one(thread_id_, txn_reply.txn_type_, txn_reply.start_time_, txn_reply.time_, last_latency, txn_reply.n_try_);
+            ccsi_->txn_success_one(thread_id_, txn_reply.txn_type_, txn_reply.start_time_, txn_reply.time_, last_latency, txn_reply.n_try_, txn_reply.phase_ms_);
         }
         else
-            ccsi_->txn_reject_one(thread_id_, txn_reply.txn_type_, txn_reply.start_time_, txn_reply.time_, last_latency, txn_reply.n_try_);
+            ccsi_->txn_reject_one(thread_id_, txn_reply.txn_type_, txn_reply.start_time_, txn_reply.time_, last_latency, txn_reply.n_try_, txn_reply.phase_ms_);
     }
 }
 
@@ -29,6 +29,11 @@ public:
     uint32_t thread_id_;
     bool batch_optimal_;
     bool retry_wait_;
+    // occ read only txns round their snapshot timestamp down to this
+    unsigned int ro_epoch_us_;
+    // read only txn types seen to span servers, they never read snapshots:
+    // those of different servers are unrelated cuts. Under mtx_
+    std::set<int32_t> ro_multi_site_;
 
     std::atomic<uint64_t> next_pie_id_;
     std::atomic<uint64_t> next_txn_id_;
@@ -39,6 +44,48 @@ public:
     std::vector<int> site_commit_;
     std::vector<int> site_abort_;
     std::vector<int> site_piece_;
+
+    // commit decisions waiting to ride on the next start request to their
+    // server, flushed by piggy_th_ every piggyback_ms_ at the latest. The
+    // txns in piggy_waiting_ are told once every server acked. Aborts are
+    // always sent right away. 0 disables buffering.
+    unsigned int piggyback_ms_;
+    rrr::Mutex piggy_mtx_;
+    rrr::CondVar piggy_cond_;
+    bool piggy_stop_;
+    pthread_t piggy_th_;
+    std::vector<std::vector<i64>> piggy_commits_;
+    std::vector<std::vector<TxnChopper*>> piggy_waiting_;
+
+    // start pieces of any txn headed to the same server, sent as one
+    // naive_batch_start_pie once batch_size_ of them queue up or at the
+    // next tick of batch_th_. batch_size_ 0 disables batching.
+    typedef struct piece_batch_t {
+        std::vector<RequestHeader> headers;
+        std::vector<std::vector<Value>> inputs;
+        std::vector<i32> output_sizes;
+        std::vector<std::pair<TxnChopper*, int>> pieces; // chopper, pi
+        void swap(piece_batch_t &o) {
+            headers.swap(o.headers);
+            inputs.swap(o.inputs);
+            output_sizes.swap(o.output_sizes);
+            pieces.swap(o.pieces);
+        }
+    } piece_batch_t;
+    // ship pieces declared with TxnChopper::chain() along with the piece
+    // they depend on, the servers pass the values between them
+    bool chain_;
+
+    // send txns that touch one server there as a whole, see one_shot_txn
+    bool one_shot_;
+
+    unsigned int batch_size_;
+    unsigned int batch_tick_us_;
+    rrr::Mutex batch_mtx_;
+    rrr::CondVar batch_cond_;
+    bool batch_stop_;
+    pthread_t batch_th_;
+    std::vector<piece_batch_t> batches_;
 #ifdef TXN_STAT
     typedef struct txn_stat_t {
         uint64_t n_serv_tch;
@@ -80,6 +127,21 @@ public:
                 bool batch_optimal = false);
 
     virtual ~Coordinator() {
+        if (piggyback_ms_ > 0) {
+            piggy_mtx_.lock();
+            piggy_stop_ = true;
+            piggy_cond_.signal();
+            piggy_mtx_.unlock();
+            pthread_join(piggy_th_, NULL);
+            flush_decisions(true);
+        }
+        if (batch_size_ > 0) {
+            batch_mtx_.lock();
+            batch_stop_ = true;
+            batch_cond_.signal();
+            batch_mtx_.unlock();
+            pthread_join(batch_th_, NULL);
+        }
         for (int i = 0; i < site_prepare_.size(); i++) {
             Log::info("Coo: %u, Site: %d, piece: %d, "
                       "prepare: %d, commit: %d, abort: %d",
@@ -121,6 +183,24 @@ public:
 
     void start(TxnChopper* ch);
 
+    void start_piece_callback(TxnChopper *ch,
+                              int pi,
+                              int res,
+                              std::vector<mdb::Value> &output);
+
+    void batch_piece(int32_t server_id,
+                     const RequestHeader &header,
+                     const std::vector<Value> &input,
+                     int output_size,
+                     TxnChopper *ch,
+                     int pi);
+
+    void send_batch(int32_t server_id, piece_batch_t &batch);
+
+    void flush_batches();
+
+    static void *batch_flush_loop(void *arg);
+
     void rpc_null_start(TxnChopper *ch);
 
     void naive_batch_start(TxnChopper *ch);
@@ -131,6 +211,30 @@ public:
 
     void finish(TxnChopper* ch);
 
+    /** retry or report a decided txn, caller should not hold the lock */
+    void end(TxnChopper* ch);
+
+    /** move the commits buffered for server sid out, return: any */
+    bool take_decisions(int32_t sid,
+                        std::vector<i64> *commits,
+                        std::vector<TxnChopper*> *waiting);
+
+    /** a server applied the commits of waiting, end the txns that all
+     *  their servers acked, caller should not hold the lock */
+    void decisions_done(const std::vector<TxnChopper*> &waiting);
+
+    /** send every buffered decision on its own */
+    void flush_decisions(bool wait);
+
+    static void *piggy_flush_loop(void *arg);
+
+    void one_phase_commit(TxnChopper* ch);
+
+    void one_shot_start(TxnChopper* ch, int32_t sid);
+
+    /** hand the whole txn to a sequencer, see calvin_submit */
+    void calvin_start(TxnChopper* ch);
+
     void occ_start(TxnChopper* ch) {};
 
     void occ_prepare(TxnChopper* ch) {};
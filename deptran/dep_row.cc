@@ -11,14 +11,17 @@ DepRow::~DepRow() {
 }
 
 void DepRow::copy_into(DepRow* row) const {
-    mdb::CoarseLockedRow::copy_into((mdb::CoarseLockedRow *)row);
+    mdb::MultiVersionedRow::copy_into((mdb::MultiVersionedRow *)row);
     int n_columns = schema_->columns_count();
     row->init_dep(n_columns);
-    memcpy(row->dep_entry_, dep_entry_, n_columns * sizeof(entry_t));
+    // entry_t holds the pending adds, copy it member by member
+    std::copy(dep_entry_, dep_entry_ + n_columns, row->dep_entry_);
 }
 
 entry_t *DepRow::get_dep_entry(int col_id) {
     verify(schema_->columns_count() > col_id);
+    if (ContentionTracker::on())
+        entry_t::row_s = this;
     return dep_entry_ + col_id;
 }
 
@@ -8,7 +8,10 @@ namespace rococo {
 
 struct entry_t;
 
-class DepRow : public mdb::CoarseLockedRow {
+// Created versioned under ro6 only, where old column versions let read only
+// pieces read a snapshot without waiting for in-flight writers. Otherwise
+// updates go in place, as on any plain row.
+class DepRow : public mdb::MultiVersionedRow {
 private:
     entry_t *dep_entry_;
     void init_dep(int n_columns);
@@ -31,7 +34,8 @@ public:
     virtual entry_t *get_dep_entry(int col_id);
 
     template <class Container>
-    static DepRow* create(const mdb::Schema* schema, const Container& values) {
+    static DepRow* create(const mdb::Schema* schema, const Container& values,
+            bool versioned = false) {
         verify(values.size() == schema->columns_count());
         std::vector<const Value*> values_ptr(values.size(), nullptr);
         size_t fill_counter = 0;
@@ -40,6 +44,9 @@ public:
             fill_counter++;
         }
         DepRow* raw_row = new DepRow();
+        if (versioned) {
+            raw_row->init_ver(schema->columns_count(), write_version());
+        }
         raw_row->init_dep(schema->columns_count());
         return (DepRow * ) mdb::Row::create(raw_row, schema, values_ptr);
     }
@@ -2,9 +2,27 @@
 
 namespace rococo {
 
+thread_local const mdb::Row *entry_t::row_s = NULL;
+
 void entry_t::touch(Vertex<TxnInfo> *tv, bool immediate ) {
     int8_t edge_type = immediate ? EDGE_I : EDGE_D;
-    if (last_ != NULL) {
+    if (!adds_.empty()) {
+        // the pending adds all follow last_, order after each of them
+        bool ordered = false;
+        for (auto add : adds_) {
+            if (add == tv)
+                continue;
+            add->to_[tv] |= edge_type;
+            tv->from_[add] |= edge_type;
+            ordered = true;
+        }
+        if (ordered && ContentionTracker::on())
+            ContentionTracker::conflict(mdb::CONFLICT_DEP, row_s);
+        adds_.clear();
+        last_ = tv;
+    } else if (last_ != NULL) {
+        if (last_ != tv && ContentionTracker::on())
+            ContentionTracker::conflict(mdb::CONFLICT_DEP, row_s);
         last_->to_[tv] |= edge_type;
         tv->from_[last_] |= edge_type;
     } else {
@@ -12,6 +30,24 @@ void entry_t::touch(Vertex<TxnInfo> *tv, bool immediate ) {
     }
 }
 
+void entry_t::touch_add(Vertex<TxnInfo> *tv, bool immediate) {
+    int8_t edge_type = immediate ? EDGE_I : EDGE_D;
+    if (last_ != NULL && last_ != tv) {
+        if (ContentionTracker::on())
+            ContentionTracker::conflict(mdb::CONFLICT_DEP, row_s);
+        last_->to_[tv] |= edge_type;
+        tv->from_[last_] |= edge_type;
+    }
+    // a cell only ever added to never sees a touch, drop the adds that
+    // already ran here, nothing left to order after them
+    size_t n = 0;
+    for (auto add : adds_)
+        if (!add->data_.committed_)
+            adds_[n++] = add;
+    adds_.resize(n);
+    adds_.push_back(tv);
+}
+
 int MultiValue::compare(const MultiValue& mv) const {
     int i = 0;
     for (i = 0; i < n_ && i < mv.n_; i++) {
@@ -33,6 +69,23 @@ map<std::pair<base::i32, base::i32>,
 //map<std::pair<base::i32, base::i32>, TxnRegistry::LockSetOracle> TxnRegistry::lck_oracle_;
 
 
+void TxnRegistry::profile(const TxnHandler& txn_handler,
+                          const RequestHeader& header,
+                          const Value* input,
+                          rrr::i32 input_size,
+                          rrr::i32* res,
+                          Value* output,
+                          rrr::i32* output_size,
+                          row_map_t *row_map,
+                          Vertex<PieInfo> *pv,
+                          Vertex<TxnInfo> *tv,
+                          std::vector<TxnInfo *> *ro_conflict_txns) {
+    PieceProfile::Scope scope(header.t_type, header.p_type,
+                              TxnRunner::get_txn(header));
+    txn_handler(header, input, input_size, res, output, output_size,
+            row_map, pv, tv, ro_conflict_txns);
+}
+
 void TxnRegistry::pre_execute_2pl(const RequestHeader& header,
                            const std::vector<mdb::Value>& input,
                            rrr::i32* res,
@@ -111,14 +164,29 @@ void TxnRegistry::pre_execute_2pl(const RequestHeader& header,
 //
 int TxnRunner::running_mode_s = MODE_OCC;
 map<i64, mdb::Txn *> TxnRunner::txn_map_s;
+map<i64, mdb::Txn *> TxnRunner::ro_txn_map_s;
 //pthread_mutex_t TxnRunner::txn_map_mutex_s = PTHREAD_MUTEX_INITIALIZER;
 mdb::TxnMgr *TxnRunner::txn_mgr_s = NULL;
+std::vector<std::string> TxnRunner::ro_tables_s;
+bool TxnRunner::ro_snapshot_s = true;
+std::map<i64, TxnRunner::ro_epoch_t> TxnRunner::ro_epochs_s;
+std::map<i64, i64> TxnRunner::ro_epoch_of_s;
+
+void TxnRunner::reg_ro_table(const std::string &name, mdb::Table *tbl) {
+    if (tbl->rtti() == mdb::TBL_SNAPSHOT)
+        ro_tables_s.push_back(name);
+    else
+        ro_snapshot_s = false;
+}
 
 void TxnRunner::reg_table(const std::string &name,
         mdb::Table *tbl
         ) {
     verify(txn_mgr_s != NULL);
     txn_mgr_s->reg_table(name, tbl);
+    reg_ro_table(name, tbl);
+    PieceProfile::reg_table(name, tbl);
+    ContentionTracker::reg_table(name, tbl);
     if (name == TPCC_TB_ORDER) {
         mdb::Schema *schema = new mdb::Schema();
         const mdb::Schema *o_schema = tbl->schema();
@@ -129,8 +197,16 @@ void TxnRunner::reg_table(const std::string &name,
                     schema->add_column(it->name.c_str(), it->type, true);
         schema->add_column("o_c_id", Value::I32, true);
         schema->add_column("o_id", Value::I32, false);
-        txn_mgr_s->reg_table(TPCC_TB_ORDER_C_ID_SECONDARY,
-                new mdb::SortedTable(schema));
+        // keep the secondary index snapshotable along with its table
+        mdb::Table *secondary;
+        if (tbl->rtti() == mdb::TBL_SNAPSHOT)
+            secondary = new mdb::SnapshotTable(schema);
+        else
+            secondary = new mdb::SortedTable(schema);
+        txn_mgr_s->reg_table(TPCC_TB_ORDER_C_ID_SECONDARY, secondary);
+        reg_ro_table(TPCC_TB_ORDER_C_ID_SECONDARY, secondary);
+        PieceProfile::reg_table(TPCC_TB_ORDER_C_ID_SECONDARY, secondary);
+        ContentionTracker::reg_table(TPCC_TB_ORDER_C_ID_SECONDARY, secondary);
     }
 }
 
@@ -258,6 +334,7 @@ mdb::Txn *TxnRunner::del_txn(const i64 tid) {
         txn = it->second;
     }
     txn_map_s.erase(it);
+    release_ro_epoch(tid);
     return txn;
 }
 
@@ -281,8 +358,15 @@ mdb::Txn *TxnRunner::get_txn(const i64 tid) {
 }
 
 mdb::Txn *TxnRunner::get_txn(const RequestHeader &header) {
+    if (running_mode_s == MODE_ROT) {
+        auto it = ro_txn_map_s.find(header.tid);
+        if (it != ro_txn_map_s.end()) {
+            return it->second;
+        }
+    }
     if (running_mode_s == MODE_NONE
-     || running_mode_s == MODE_RCC) {
+     || running_mode_s == MODE_RCC
+     || running_mode_s == MODE_ROT) {
         if (txn_map_s.empty()) {
             mdb::Txn *txn = txn_mgr_s->start(0);
             txn_map_s[0] = txn;
@@ -297,10 +381,63 @@ mdb::Txn *TxnRunner::get_txn(const RequestHeader &header) {
     }
 }
 
+mdb::Txn *TxnRunner::get_ro_txn(const i64 tid, const i64 snapshot_ts) {
+    verify(running_mode_s == MODE_OCC);
+    auto it = txn_map_s.find(tid);
+    if (it != txn_map_s.end())
+        return it->second;
+    // -1: the coordinator asks for plain, validated reads
+    if (snapshot_ts < 0 || !is_ro_snapshot())
+        return get_txn(tid);
+    ro_epoch_t &epoch = ro_epochs_s[snapshot_ts];
+    if (epoch.snapshots.empty()) {
+        epoch.n_txn = 0;
+        for (auto &name : ro_tables_s)
+            epoch.snapshots[name] =
+                txn_mgr_s->get_snapshot_table(name)->snapshot();
+    }
+    epoch.n_txn++;
+    ro_epoch_of_s[tid] = snapshot_ts;
+    mdb::Txn *txn = ((mdb::TxnMgrOCC *)txn_mgr_s)->start_readonly(tid,
+            epoch.snapshots);
+    auto ret = txn_map_s.insert(std::make_pair(tid, txn));
+    verify(ret.second);
+    return txn;
+}
+
+void TxnRunner::release_ro_epoch(const i64 tid) {
+    auto it = ro_epoch_of_s.find(tid);
+    if (it == ro_epoch_of_s.end())
+        return;
+    auto e_it = ro_epochs_s.find(it->second);
+    verify(e_it != ro_epochs_s.end());
+    ro_epoch_of_s.erase(it);
+    if (--e_it->second.n_txn > 0)
+        return;
+    for (auto &snapshot : e_it->second.snapshots)
+        delete snapshot.second;
+    ro_epochs_s.erase(e_it);
+}
+
+mdb::Txn *TxnRunner::start_ro_txn(const i64 tid, mdb::version_t ver) {
+    verify(running_mode_s == MODE_ROT);
+    mdb::Txn *txn = ((mdb::TxnMgrUnsafe *)txn_mgr_s)->start_readonly(tid, ver);
+    auto ret = ro_txn_map_s.insert(std::make_pair(tid, txn));
+    verify(ret.second);
+    return txn;
+}
+
+void TxnRunner::end_ro_txn(const i64 tid) {
+    auto it = ro_txn_map_s.find(tid);
+    verify(it != ro_txn_map_s.end());
+    delete it->second;
+    ro_txn_map_s.erase(it);
+}
 
 void TxnRunner::get_prepare_log(i64 txn_id,
         const std::vector<i32> &sids,
-        std::string *str) {
+        std::string *str,
+        const char tag) {
     map<i64, mdb::Txn *>::iterator it = txn_map_s.find(txn_id);
     verify(it != txn_map_s.end() && it->second != NULL);
 
@@ -311,11 +448,10 @@ void TxnRunner::get_prepare_log(i64 txn_id,
     len += sizeof(txn_id);
     verify(len == str->size());
 
-    // p denotes prepare log
-    const char prepare_tag = 'p';
-    str->resize(len + sizeof(prepare_tag));
-    memcpy((void *)(str->data() + len), (void *)&prepare_tag, sizeof(prepare_tag));
-    len += sizeof(prepare_tag);
+    // p denotes prepare log, o a one phase commit
+    str->resize(len + sizeof(tag));
+    memcpy((void *)(str->data() + len), (void *)&tag, sizeof(tag));
+    len += sizeof(tag);
     verify(len == str->size());
 
     // marshal related servers
@@ -354,6 +490,7 @@ void TxnRunner::init(int mode) {
             txn_mgr_s = new mdb::TxnMgrOCC();
             break;
         case MODE_DEPTRAN:
+        case MODE_ROT:
             txn_mgr_s = new mdb::TxnMgrUnsafe(); //XXX is it OK to use unsafe for deptran
             break;
         default:
@@ -366,13 +503,19 @@ void TxnRunner::fini() {
     //if (running_mode_s == MODE_2PL)
     //    pthread_mutex_lock(&txn_map_mutex_s);
     map<i64, mdb::Txn *>::iterator it = txn_map_s.begin();
-    for (; it != txn_map_s.end(); it++)
+    for (; it != txn_map_s.end(); it++) {
         Log::info("tid: %ld still running",  it->first);
         if (it->second) {
             delete it->second;
             it->second = NULL;
         }
+    }
     txn_map_s.clear();
+    for (auto &epoch : ro_epochs_s)
+        for (auto &snapshot : epoch.second.snapshots)
+            delete snapshot.second;
+    ro_epochs_s.clear();
+    ro_epoch_of_s.clear();
     //if (running_mode_s == MODE_2PL)
     //    pthread_mutex_unlock(&txn_map_mutex_s);
 
@@ -6,9 +6,17 @@ namespace rococo {
 
 struct entry_t {
     Vertex<TxnInfo> *last_ = NULL;
+    // commutative adds since last_ not yet run here, they need no order
+    // among themselves
+    std::vector<Vertex<TxnInfo> *> adds_;
+
+    // row of the entry being touched, set by DepRow::get_dep_entry while
+    // the contention tracker is on
+    static thread_local const mdb::Row *row_s;
 
     const entry_t &operator=(const entry_t &rhs) {
         last_ = rhs.last_;
+        adds_ = rhs.adds_;
         return *this;
     }
 
@@ -17,13 +25,20 @@ struct entry_t {
 
     entry_t(const entry_t &o) {
         last_ = o.last_;
+        adds_ = o.adds_;
     }
 
     void touch(Vertex<TxnInfo> *tv, bool immediate);
 
+    // for pieces that only add_column to the cell, drops the pending adds
+    // that were committed
+    void touch_add(Vertex<TxnInfo> *tv, bool immediate);
+
     void ro_touch(std::vector<TxnInfo *> *conflict_txns) {
         if (last_)
             conflict_txns->push_back(&last_->data_);
+        for (auto add : adds_)
+            conflict_txns->push_back(&add->data_);
     }
 };
 
@@ -255,7 +270,45 @@ public:
         auto func_key = std::make_pair(t_type, p_type);
         auto it = all_.find(func_key);
         verify(it == all_.end());
-        all_[func_key] = (txn_handler_defer_pair_t){txn_handler, defer};
+        // PieceProfile can be turned on and off while running
+        TxnHandler wrapped = [txn_handler] (
+                const RequestHeader& header,
+                const Value* input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32* output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv,
+                Vertex<TxnInfo> *tv,
+                std::vector<TxnInfo *> *ro_conflict_txns) {
+            if (PieceProfile::on()) {
+                profile(txn_handler, header, input, input_size, res, output,
+                        output_size, row_map, pv, tv, ro_conflict_txns);
+                return;
+            }
+            txn_handler(header, input, input_size, res, output,
+                    output_size, row_map, pv, tv, ro_conflict_txns);
+        };
+        all_[func_key] = (txn_handler_defer_pair_t){wrapped, defer};
+    }
+
+    // runs txn_handler in a PieceProfile::Scope on the txn of header
+    static void profile(const TxnHandler& txn_handler,
+                        const RequestHeader& header,
+                        const Value* input,
+                        rrr::i32 input_size,
+                        rrr::i32* res,
+                        Value* output,
+                        rrr::i32* output_size,
+                        row_map_t *row_map,
+                        Vertex<PieInfo> *pv,
+                        Vertex<TxnInfo> *tv,
+                        std::vector<TxnInfo *> *ro_conflict_txns);
+
+    // forget every handler, for another benchmark to reg its own
+    static inline void clear() {
+        all_.clear();
     }
 
     static inline txn_handler_defer_pair_t get(
@@ -322,9 +375,11 @@ private:
 class TxnRunner {
 public:
 
+    // tag 'p' for a 2PC prepare, 'o' for a one phase commit
     static void get_prepare_log(i64 txn_id,
             const std::vector<i32> &sids,
-            std::string *str);
+            std::string *str,
+            const char tag = 'p');
 
     static void init(int mode);
     // finalize, free up resource
@@ -339,6 +394,23 @@ public:
 
     static mdb::Txn *get_txn(const RequestHeader &req);
 
+    // MODE_ROT: while a read only piece runs, get_txn(header) hands out
+    // a snapshot reader at ver for its tid
+    static mdb::Txn *start_ro_txn(const i64 tid, mdb::version_t ver);
+
+    static void end_ro_txn(const i64 tid);
+
+    // MODE_OCC: read only txns run on SnapshotTable snapshots, so they
+    // never validate nor abort. txns that carry the same snapshot_ts share
+    // the snapshots taken when the first of them arrived. snapshot_ts -1,
+    // or a server holding any non snapshot table, hands out a plain OCC
+    // txn instead, see is_ro_snapshot.
+    static mdb::Txn *get_ro_txn(const i64 tid, const i64 snapshot_ts);
+
+    static inline bool is_ro_snapshot() {
+        return ro_snapshot_s && !ro_tables_s.empty();
+    }
+
     static mdb::Txn *del_txn(const i64 tid);
 
     static inline
@@ -355,8 +427,24 @@ private:
     static int running_mode_s;
 
     static map<i64, mdb::Txn *> txn_map_s;
+    static map<i64, mdb::Txn *> ro_txn_map_s;
     static mdb::TxnMgr *txn_mgr_s;
 
+    // names of the registered snapshot tables, and whether all tables are
+    static std::vector<std::string> ro_tables_s;
+    static bool ro_snapshot_s;
+
+    // snapshots shared by the read only txns of one snapshot_ts
+    typedef struct {
+        std::map<std::string, mdb::SnapshotTable *> snapshots;
+        int n_txn;
+    } ro_epoch_t;
+    static std::map<i64, ro_epoch_t> ro_epochs_s;
+    static std::map<i64, i64> ro_epoch_of_s;    // tid => snapshot_ts
+
+    static void release_ro_epoch(const i64 tid);
+
+    static void reg_ro_table(const string& name, mdb::Table *tbl);
 };
 
 
@@ -372,6 +460,8 @@ public:
     DTxn(i64 tid, DTxnMgr* mgr) : tid_(tid), mgr_(mgr) {
 
     }
+
+    virtual ~DTxn() {}
 };
 
 
@@ -383,7 +473,7 @@ public:
 
     }
 
-    void start(
+    virtual void start(
             const RequestHeader &header,
             const std::vector<mdb::Value> &input,
             bool *deferred,
@@ -408,7 +498,7 @@ public:
             rrr::DeferredReply* defer
     );
 
-    void exe_deferred(
+    virtual void exe_deferred(
             std::vector<std::pair<RequestHeader, std::vector<mdb::Value> > > &outputs
     );
 
@@ -428,17 +518,67 @@ public:
     static DepGraph *dep_s;
 };
 
+/**
+ * RO-6: read only pieces never wait for in-flight writers. The writes of a
+ * txn stay stamped pending, invisible to every snapshot, until it is
+ * decided here, then all of them get one commit version, see
+ * mdb::MultiVersionedRow::publish. A read only txn pins the stable version
+ * when its first piece arrives, all its pieces here read it and reply at
+ * once, and the coordinator ends it with rcc_ro_end_txn. A pin that is
+ * not ended within ro_pin_timeout_us is dropped.
+ */
 class RO6DTxn : public RCCDTxn {
+    mdb::MultiVersionedRow::write_set_t ws_;
+
+    typedef struct {
+        mdb::MultiVersionedRow::pin_t pin;
+        uint64_t since;
+    } ro_pin_t;
+
+    // snapshots of the read only txns in flight
+    static std::map<i64, ro_pin_t> ro_pins_s;
+
+    // drop the pins of read only txns whose end never came
+    static void expire_ro(uint64_t now);
+
 public:
     RO6DTxn(i64 tid, DTxnMgr* mgr): RCCDTxn(tid, mgr) {
 
     }
+
+    ~RO6DTxn();
+
+    virtual void start(
+            const RequestHeader &header,
+            const std::vector<mdb::Value> &input,
+            bool *deferred,
+            std::vector<mdb::Value> *output
+    );
+
+    virtual void exe_deferred(
+            std::vector<std::pair<RequestHeader, std::vector<mdb::Value> > > &outputs
+    );
+
+    // the txn is decided here, whether or not its deferred pieces ran.
+    // Every txn decided together passes the same ver
+    void publish(mdb::version_t ver);
+
+    static void start_ro(
+            const RequestHeader &header,
+            const std::vector<mdb::Value> &input,
+            std::vector<mdb::Value> &output
+    );
+
+    static void end_ro(i64 tid);
 };
 
 class TPL {
 public:
     static int do_prepare(i64 txn_id);
 
+    // whether the txn staged any write on this server
+    static bool has_writes(i64 txn_id);
+
     static int do_commit(i64 txn_id);
 
     static int do_abort(i64 txn_id);
@@ -0,0 +1,343 @@
+#include "all.h"
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace rococo;
+
+/**
+ * deptran_harness: a whole run on one box, from one command. Takes the
+ * options of deptran_client (-f config, -d duration, -c client id, 0 if
+ * not given), forks every site of the config as a server on 127.0.0.1,
+ * then runs the coordinator threads of the client in this process. After
+ * duration seconds it prints one line of json and kills the sites.
+ *
+ * The sites are processes, not threads: a server keeps its tables, its
+ * pieces and its config in process wide singletons.
+ */
+
+// one per txn type and coordinator thread, the replies of a coordinator
+// all come back on its one poll thread, the only one to record
+typedef struct txn_stat_t {
+    std::atomic<int64_t> commit;
+    std::atomic<int64_t> reject;
+    std::atomic<int64_t> attempt;
+    LatencyHist latency;    // of the committed txns, in us
+
+    txn_stat_t() : latency(0.001) {
+        commit.store(0);
+        reject.store(0);
+        attempt.store(0);
+    }
+
+    void one(TxnReply &txn_reply) {
+        if (txn_reply.res_ == SUCCESS) {
+            commit++;
+            latency.record_value(txn_reply.time_);
+        } else {
+            reject++;
+        }
+        attempt.fetch_add(txn_reply.n_try_);
+    }
+} txn_stat_t;
+
+typedef struct {
+    unsigned int coo_id;
+    unsigned int id;
+    std::vector<std::string> *servers;
+    std::map<int32_t, txn_stat_t> *stats;
+} worker_attr_t;
+
+static std::vector<char *> make_argv(const std::vector<std::string> &args) {
+    std::vector<char *> argv;
+    for (auto &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(NULL);
+    return argv;
+}
+
+// the harness options as a deptran_client command line (role "-c", the
+// -c given kept, else client id) or a deptran_server one (role "-s", -c
+// dropped)
+static std::vector<std::string> config_args(int argc, char *argv[],
+                                            const char *role,
+                                            unsigned int id) {
+    bool client = strcmp(role, "-c") == 0;
+    bool have_cid = false;
+    std::vector<std::string> args;
+    args.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            if (client) {
+                have_cid = true;
+                args.push_back(argv[i]);
+                args.push_back(argv[i + 1]);
+            }
+            i++;
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    if (!have_cid) {
+        args.push_back(role);
+        args.push_back(std::to_string(id));
+    }
+    return args;
+}
+
+// in the forked child, never returns: serves as site sid, writes a byte
+// to ready_fd once it listens
+static void run_site(int argc, char *argv[], uint32_t sid, int ready_fd) {
+    int ret;
+    // the config inherited is the client's
+    Config::destroy_config();
+    std::vector<std::string> args = config_args(argc, argv, "-s", sid);
+    std::vector<char *> site_argv = make_argv(args);
+    if (0 != (ret = Config::create_config(args.size(), site_argv.data()))) {
+        Log_fatal("site %u: read config failed", sid);
+        _exit(1);
+    }
+    Config::get_config()->localize_sites();
+
+    Site site;
+    if (0 != site.start(sid, NULL)) {
+        Log_fatal("site %u: start failed", sid);
+        _exit(1);
+    }
+
+    char ready = 0;
+    verify(1 == write(ready_fd, &ready, 1));
+    close(ready_fd);
+    while (1)
+        sleep(1000);
+}
+
+static void *coo_work(void *_attr) {
+    worker_attr_t *attr = (worker_attr_t *)_attr;
+    Config *config = Config::get_config();
+    uint32_t coo_id = attr->coo_id;
+    unsigned int concurrent_txn = config->get_concurrent_txn();
+    std::map<int32_t, txn_stat_t> *stats = attr->stats;
+    Coordinator *coo = new Coordinator(coo_id, *(attr->servers),
+                                       config->get_benchmark(),
+                                       config->get_mode(), NULL, attr->id,
+                                       config->get_batch_start());
+    Arrival *arrival = Arrival::create(coo_id);
+
+    // replies after time is up are not counted
+    auto count = [stats] (TxnReply &txn_reply) {
+        TIMER_IF_NOT_END {
+            auto it = stats->find(txn_reply.txn_type_);
+            verify(it != stats->end());
+            it->second.one(txn_reply);
+        }
+    };
+
+    if (arrival != NULL) {
+        arrival->open_loop(coo, coo_id, attr->id, concurrent_txn, NULL,
+                           count);
+    } else {
+        rrr::Mutex finish_mutex;
+        rrr::CondVar finish_cond;
+        unsigned int n_running = concurrent_txn;
+        std::function<void(TxnReply&)> callback = [coo_id, coo, &count,
+                                                   &callback, &finish_mutex,
+                                                   &finish_cond, &n_running]
+                                                  (TxnReply &txn_reply) {
+            count(txn_reply);
+            TIMER_IF_NOT_END {
+                TxnRequest req;
+                TxnRequestFactory::init_txn_req(&req, coo_id);
+                req.callback_ = callback;
+                coo->do_one(req);
+            }
+            else {
+                finish_mutex.lock();
+                n_running--;
+                if (n_running == 0)
+                    finish_cond.signal();
+                finish_mutex.unlock();
+            }
+        };
+        finish_mutex.lock();
+        for (unsigned int n_txn = 0; n_txn < concurrent_txn; n_txn++) {
+            TxnRequest req;
+            TxnRequestFactory::init_txn_req(&req, coo_id);
+            req.callback_ = callback;
+            coo->do_one(req);
+        }
+        while (n_running > 0)
+            finish_cond.wait(finish_mutex);
+        finish_mutex.unlock();
+    }
+
+    delete coo;
+    delete arrival;
+    return NULL;
+}
+
+// "name": {commit, reject, attempt, throughput, abort_rate, latency_ms},
+// no trailing comma
+static void print_stat(const std::string &name, int64_t commit,
+                       int64_t reject, int64_t attempt, Histogram &hist,
+                       unsigned int duration) {
+    double abort_rate = attempt > 0
+        ? (double)(attempt - commit) / attempt : 0.0;
+    double mean = hist.count > 0 ? hist.sum * hist.unit / hist.count : 0.0;
+    printf("\"%s\": {\"commit\": %lld, \"reject\": %lld, \"attempt\": %lld, "
+           "\"throughput\": %.2f, \"abort_rate\": %.6f, "
+           "\"latency_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+           "\"p99\": %.3f, \"p999\": %.3f}}",
+           name.c_str(), (long long)commit, (long long)reject,
+           (long long)attempt, (double)commit / duration, abort_rate, mean,
+           LatencyHist::percentile(hist, 0.5),
+           LatencyHist::percentile(hist, 0.9),
+           LatencyHist::percentile(hist, 0.99),
+           LatencyHist::percentile(hist, 0.999));
+}
+
+static void print_report(std::map<int32_t, std::string> &txn_types,
+                         std::vector<std::map<int32_t, txn_stat_t>> &stats,
+                         unsigned int num_site, unsigned int num_threads,
+                         unsigned int duration) {
+    Histogram all;
+    all.sub_bits = LatencyHist::SUB_BITS;
+    all.unit = 0.001;
+    all.count = 0;
+    all.sum = 0;
+    int64_t commit = 0, reject = 0, attempt = 0;
+
+    printf("{\"sites\": %u, \"coordinators\": %u, \"concurrent_txn\": %u, "
+           "\"duration_s\": %u, \"txn_types\": {",
+           num_site, num_threads,
+           Config::get_config()->get_concurrent_txn(), duration);
+    bool first = true;
+    for (auto &type : txn_types) {
+        Histogram hist;
+        hist.count = 0;
+        hist.sum = 0;
+        int64_t t_commit = 0, t_reject = 0, t_attempt = 0;
+        for (auto &thread_stats : stats) {
+            txn_stat_t &stat = thread_stats[type.first];
+            stat.latency.drain(&hist);
+            t_commit += stat.commit.load();
+            t_reject += stat.reject.load();
+            t_attempt += stat.attempt.load();
+        }
+        for (auto &b : hist.buckets)
+            all.buckets[b.first] += b.second;
+        all.count += hist.count;
+        all.sum += hist.sum;
+        commit += t_commit;
+        reject += t_reject;
+        attempt += t_attempt;
+        if (!first)
+            printf(", ");
+        first = false;
+        print_stat(type.second, t_commit, t_reject, t_attempt, hist,
+                   duration);
+    }
+    printf("}, ");
+    print_stat("all", commit, reject, attempt, all, duration);
+    printf("}\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    int ret;
+
+    std::vector<std::string> args = config_args(argc, argv, "-c", 0);
+    std::vector<char *> client_argv = make_argv(args);
+    if (0 != (ret = Config::create_config(args.size(), client_argv.data()))) {
+        Log_fatal("Read config failed");
+        return ret;
+    }
+    Config::get_config()->localize_sites();
+
+    unsigned int duration = Config::get_config()->get_duration();
+    if (duration == 0) {
+        Log_fatal("no duration, give one with -d");
+        return -1;
+    }
+
+    // fork the sites before this process has any thread
+    unsigned int num_site = Config::get_config()->get_num_site();
+    int ready_pipe[2];
+    verify(0 == pipe(ready_pipe));
+    std::vector<pid_t> sites;
+    pid_t harness = getpid();
+    for (uint32_t sid = 0; sid < num_site; sid++) {
+        pid_t pid = fork();
+        verify(pid >= 0);
+        if (pid == 0) {
+            // die with the harness, however it ends
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != harness)
+                _exit(1);
+            close(ready_pipe[0]);
+            run_site(argc, argv, sid, ready_pipe[1]);
+        }
+        sites.push_back(pid);
+    }
+    close(ready_pipe[1]);
+
+    // populating can take a while; a site that dies closes its end early
+    unsigned int n_ready = 0;
+    char ready;
+    while (n_ready < num_site && 1 == read(ready_pipe[0], &ready, 1))
+        n_ready++;
+    close(ready_pipe[0]);
+    if (n_ready < num_site) {
+        Log_fatal("only %u of %u sites came up", n_ready, num_site);
+        for (auto pid : sites)
+            kill(pid, SIGKILL);
+        for (auto pid : sites)
+            waitpid(pid, NULL, 0);
+        return -2;
+    }
+
+    unsigned int cid = Config::get_config()->get_client_id();
+    Trace::init(Config::get_config()->get_trace_ring(), num_site + cid,
+                "client " + std::to_string(cid));
+
+    TxnRequestFactory::init_txn_req(NULL, 0);
+    std::map<int32_t, std::string> txn_types;
+    TxnRequestFactory::get_txn_types(txn_types);
+    std::vector<std::string> servers;
+    verify(num_site == Config::get_config()->get_all_site_addr(servers));
+
+    unsigned int num_threads = Config::get_config()->get_num_threads();
+    // every entry in place before the threads look them up
+    std::vector<std::map<int32_t, txn_stat_t>> stats(num_threads);
+    for (auto &thread_stats : stats)
+        for (auto &it : txn_types)
+            thread_stats[it.first];
+
+    unsigned int start_coo_id = Config::get_config()->get_start_coordinator_id();
+    std::vector<worker_attr_t> worker_attrs(num_threads);
+    std::vector<pthread_t> coo_threads(num_threads);
+    TIMER_SET(duration);
+    for (unsigned int i = 0; i < num_threads; i++) {
+        worker_attrs[i].coo_id = start_coo_id + i;
+        worker_attrs[i].id = i;
+        worker_attrs[i].servers = &servers;
+        worker_attrs[i].stats = &stats[i];
+        pthread_create(&coo_threads[i], NULL, &coo_work, &worker_attrs[i]);
+    }
+    for (unsigned int i = 0; i < num_threads; i++)
+        pthread_join(coo_threads[i], NULL);
+
+    print_report(txn_types, stats, num_site, num_threads, duration);
+
+    for (auto pid : sites)
+        kill(pid, SIGKILL);
+    for (auto pid : sites)
+        waitpid(pid, NULL, 0);
+
+    TxnRequestFactory::destroy();
+    RandomGenerator::destroy();
+    Config::destroy_config();
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+
+#include "all.h"
+
+namespace rococo {
+
+KeyDist *KeyDist::create(int n) {
+    verify(n > 0);
+    Config *config = Config::get_config();
+    switch (config->get_key_dist()) {
+        case KEY_DIST_UNIFORM:
+            return new UniformDist(n);
+        case KEY_DIST_ZIPF:
+            return new ZipfDist(n, config->get_zipf_theta());
+        case KEY_DIST_HOTSPOT:
+        {
+            int n_hot;
+            if (config->get_hot_keys() > 0) {
+                n_hot = std::min((unsigned int)n, config->get_hot_keys());
+            } else {
+                double hot_fraction = config->get_hot_fraction();
+                verify(hot_fraction > 0 && hot_fraction <= 1);
+                n_hot = std::max(1, (int)(n * hot_fraction));
+            }
+            return new HotspotDist(n, n_hot, config->get_hot_access());
+        }
+        case KEY_DIST_LATEST:
+            return new LatestDist(n, config->get_zipf_theta());
+        default:
+            verify(0);
+            return NULL;
+    }
+}
+
+int KeyDist::scramble(int i, int n) {
+    // an invertible mix of the smallest power of two that holds n, walked
+    // until it lands back in [0, n): a bijection of [0, n), less than two
+    // rounds on average
+    int bits = 1;
+    while ((1u << bits) < (unsigned int)n)
+        bits++;
+    uint32_t mask = (1u << bits) - 1;
+    uint32_t x = i;
+    do {
+        for (int r = 0; r < 3; r++) {
+            x = (x * 0x9e3779b1u + 0x7f4a7c15u) & mask;
+            x ^= x >> ((bits + 1) / 2);
+        }
+    } while (x >= (uint32_t)n);
+    return x;
+}
+
+ZipfDist::ZipfDist(int n, double theta) : n_(n) {
+    // the closed form below has a pole at 1
+    verify(theta > 0 && theta < 1);
+    zetan_ = 0;
+    for (int i = 1; i <= n; i++)
+        zetan_ += 1.0 / std::pow((double)i, theta);
+    double zeta2 = 1.0 + std::pow(0.5, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    half_pow_theta_ = std::pow(0.5, theta);
+    eta_ = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+}
+
+int ZipfDist::next_rank() {
+    double u = RandomGenerator::rand_double(0.0, 1.0);
+    double uz = u * zetan_;
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + half_pow_theta_)
+        return n_ > 1 ? 1 : 0;
+    int key = (int)(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return key < n_ ? key : n_ - 1;
+}
+
+HotspotDist::HotspotDist(int n, int n_hot, double hot_access)
+        : n_(n), n_hot_(n_hot), hot_access_(hot_access) {
+    verify(n_hot > 0 && n_hot <= n);
+}
+
+} // namespace rococo
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+
+namespace rococo {
+
+/**
+ * Which key of [0, n), or of the ones inserted since, a client picks next,
+ * see the key_dist option of the config. One per key range, shared by the coordinator threads of the
+ * process; all the setup is done in the constructor, a pick is a few
+ * arithmetic ops.
+ */
+class KeyDist {
+public:
+    /** as the config says, over the keys [0, n) */
+    static KeyDist *create(int n);
+
+    virtual ~KeyDist() {}
+
+    virtual int next() = 0;
+
+    /** key was inserted, it may be picked from now on */
+    virtual void inserted(int key) {}
+
+    /**
+     * A fixed permutation of [0, n) that hashes rank i to its key, so the
+     * hot ranks of a skewed pick land all over the key range, and over the
+     * servers, instead of on the lowest ids; the scrambled zipfian of YCSB,
+     * but one to one so no key is lost to a collision
+     */
+    static int scramble(int i, int n);
+};
+
+class UniformDist : public KeyDist {
+public:
+    UniformDist(int n) : n_(n) {}
+
+    virtual int next() {
+        return RandomGenerator::rand(0, n_ - 1);
+    }
+
+private:
+    int n_;
+};
+
+/**
+ * Rank i with probability proportional to 1 / (i + 1)^theta, rank 0 the
+ * hottest, picked as key scramble(i). Gray et al., "Quickly generating
+ * billion-record synthetic databases": zeta(n) is summed once here and
+ * every pick after that is one uniform draw and one pow().
+ */
+class ZipfDist : public KeyDist {
+public:
+    ZipfDist(int n, double theta);
+
+    virtual int next() {
+        return scramble(next_rank(), n_);
+    }
+
+    /** the rank, unscrambled */
+    int next_rank();
+
+private:
+    int n_;
+    double alpha_;
+    double zetan_;
+    double eta_;
+    double half_pow_theta_;
+};
+
+class HotspotDist : public KeyDist {
+public:
+    /** hot_access of the picks among the keys scramble([0, n_hot)) */
+    HotspotDist(int n, int n_hot, double hot_access);
+
+    virtual int next() {
+        if (n_hot_ == n_
+                || RandomGenerator::rand_double(0.0, 1.0) < hot_access_)
+            return scramble(RandomGenerator::rand(0, n_hot_ - 1), n_);
+        return scramble(RandomGenerator::rand(n_hot_, n_ - 1), n_);
+    }
+
+private:
+    int n_;
+    int n_hot_;
+    double hot_access_;
+};
+
+/** zipf over the age of the keys, the newest the hottest, not scrambled.
+ *  With no inserts the top of [0, n) is the newest; keys inserted from n
+ *  up move the window of the n newest keys along */
+class LatestDist : public KeyDist {
+public:
+    LatestDist(int n, double theta) : zipf_(n, theta) {
+        latest_.store(n - 1);
+    }
+
+    virtual int next() {
+        return latest_.load(std::memory_order_relaxed) - zipf_.next_rank();
+    }
+
+    virtual void inserted(int key) {
+        int latest = latest_.load(std::memory_order_relaxed);
+        while (key > latest && !latest_.compare_exchange_weak(latest, key))
+            ;
+    }
+
+private:
+    ZipfDist zipf_;
+    std::atomic<int> latest_;
+};
+
+} // namespace rococo
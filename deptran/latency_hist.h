@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+
+#include "rcc_rpc.h"
+
+namespace rococo {
+
+/**
+ * Log-bucketed histogram of non-negative integers, HdrHistogram style.
+ * Values below 2 * SUB_BUCKETS have a bucket each; above that every
+ * power of two range is split into SUB_BUCKETS equal buckets, so a
+ * value is known to within 1 / SUB_BUCKETS of itself. Values from
+ * 2^MAX_BITS up land in the last bucket.
+ *
+ * One thread records, lock free; any other thread may drain it at the
+ * same time, taking what was recorded so far and leaving it empty.
+ */
+class LatencyHist {
+public:
+    static const int SUB_BITS = 7;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_BITS = 32;
+    static const int N_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    /** unit: what a recorded 1 stands for, e.g. 0.001 for ms in us */
+    LatencyHist(double unit = 1.0) : unit_(unit) {
+        for (int i = 0; i < N_BUCKETS; i++)
+            counts_[i].store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+    }
+
+    static inline int bucket_of(uint64_t v) {
+        if (v < SUB_BUCKETS)
+            return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        if (msb >= MAX_BITS)
+            return N_BUCKETS - 1;
+        int shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + (int)((v >> shift) - SUB_BUCKETS);
+    }
+
+    /** smallest value in bucket b */
+    static inline uint64_t bucket_low(int b) {
+        if (b < SUB_BUCKETS)
+            return b;
+        int shift = (b >> SUB_BITS) - 1;
+        return (uint64_t)(SUB_BUCKETS + (b & (SUB_BUCKETS - 1))) << shift;
+    }
+
+    /** number of values in bucket b */
+    static inline uint64_t bucket_width(int b) {
+        if (b < SUB_BUCKETS)
+            return 1;
+        return (uint64_t)1 << ((b >> SUB_BITS) - 1);
+    }
+
+    /** before anything is recorded */
+    void set_unit(double unit) {
+        unit_ = unit;
+    }
+
+    /** recording thread only */
+    inline void record(uint64_t v) {
+        counts_[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    /** record x / unit, rounded */
+    inline void record_value(double x) {
+        record(x <= 0 ? 0 : (uint64_t)(x / unit_ + 0.5));
+    }
+
+    /** add everything recorded so far to h and start over */
+    void drain(Histogram *h) {
+        h->sub_bits = SUB_BITS;
+        h->unit = unit_;
+        h->count += count_.exchange(0, std::memory_order_relaxed);
+        h->sum += sum_.exchange(0, std::memory_order_relaxed);
+        for (int i = 0; i < N_BUCKETS; i++) {
+            if (counts_[i].load(std::memory_order_relaxed) == 0)
+                continue;
+            h->buckets[i] += counts_[i].exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+    /** value at quantile q of h, in units, to within a bucket */
+    static double percentile(const Histogram &h, double q) {
+        uint64_t total = 0;
+        for (auto &it : h.buckets)
+            total += it.second;
+        if (total == 0)
+            return 0.0;
+        uint64_t rank = (uint64_t)(q * total);
+        if (rank >= total)
+            rank = total - 1;
+        uint64_t seen = 0;
+        for (auto &it : h.buckets) {
+            seen += it.second;
+            if (seen > rank)
+                return (bucket_low(it.first)
+                        + (bucket_width(it.first) - 1) / 2.0) * h.unit;
+        }
+        verify(0);
+        return 0.0;
+    }
+
+private:
+    double unit_;
+    std::atomic<uint64_t> counts_[N_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+};
+
+} // namespace rococo
@@ -16,6 +16,10 @@ Piece *Piece::get_piece(int benchmark) {
             return new RWPiece();
         case MICRO_BENCH:
             return new MicroBenchPiece();
+        case YCSB:
+            return new YcsbPiece();
+        case SMALLBANK:
+            return new SmallbankPiece();
         default:
             verify(0);
             return NULL;
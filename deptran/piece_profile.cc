@@ -0,0 +1,114 @@
+#include "all.h"
+
+namespace rococo {
+
+std::atomic<bool> PieceProfile::on_s(false);
+std::mutex PieceProfile::all_mtx_s;
+std::vector<PieceProfile::thread_prof_t *> PieceProfile::all_s;
+std::map<const mdb::Table *, std::string> PieceProfile::table_names_s;
+
+PieceProfile::thread_prof_t *PieceProfile::mine() {
+    static thread_local thread_prof_t *prof = nullptr;
+    if (prof == nullptr) {
+        // one per thread for the life of the process
+        prof = new thread_prof_t();
+        std::lock_guard<std::mutex> guard(all_mtx_s);
+        all_s.push_back(prof);
+    }
+    return prof;
+}
+
+PieceProfile::Scope::Scope(rrr::i32 t_type,
+                           rrr::i32 p_type,
+                           const mdb::Txn *txn)
+        : t_type_(t_type), p_type_(p_type), txn_(txn),
+          n_touched_(txn->n_touched()) {
+    // a nested handler's rows are already counted by table by the outer
+    if (mine()->depth++ == 0)
+        n_touched_by_table_ = txn->n_touched_by_table();
+    begin_ = std::chrono::steady_clock::now();
+}
+
+PieceProfile::Scope::~Scope() {
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - begin_).count();
+    thread_prof_t *prof = mine();
+    std::lock_guard<std::mutex> guard(prof->mtx);
+    piece_stat_t &stat = prof->pieces[std::make_pair(t_type_, p_type_)];
+    stat.n_exec++;
+    // a nested handler's time and rows are counted by both
+    stat.exec_us += us;
+    stat.n_rows += txn_->n_touched() - n_touched_;
+    if (--prof->depth == 0) {
+        for (auto &it : txn_->n_touched_by_table()) {
+            uint64_t before = n_touched_by_table_[it.first];
+            if (it.second > before)
+                prof->rows[it.first] += it.second - before;
+        }
+    }
+}
+
+void PieceProfile::reg_table(const std::string &name,
+                             const mdb::Table *tbl) {
+    std::lock_guard<std::mutex> guard(all_mtx_s);
+    table_names_s[tbl] = name;
+}
+
+void PieceProfile::piece_done(rrr::i32 t_type,
+                              rrr::i32 p_type,
+                              bool deferred,
+                              uint64_t wait_us) {
+    thread_prof_t *prof = mine();
+    std::lock_guard<std::mutex> guard(prof->mtx);
+    piece_stat_t &stat = prof->pieces[std::make_pair(t_type, p_type)];
+    if (deferred) {
+        stat.n_deferred++;
+        stat.wait_us += wait_us;
+    } else {
+        stat.n_immediate++;
+    }
+}
+
+void PieceProfile::drain(std::vector<PieceStat> *pieces,
+                         std::map<std::string, rrr::i64> *rows) {
+    std::map<std::pair<rrr::i32, rrr::i32>, piece_stat_t> all_pieces;
+    std::map<const mdb::Table *, uint64_t> all_rows;
+    std::lock_guard<std::mutex> guard(all_mtx_s);
+    for (auto prof : all_s) {
+        std::lock_guard<std::mutex> prof_guard(prof->mtx);
+        for (auto &it : prof->pieces) {
+            piece_stat_t &stat = all_pieces[it.first];
+            stat.n_exec += it.second.n_exec;
+            stat.exec_us += it.second.exec_us;
+            stat.n_immediate += it.second.n_immediate;
+            stat.n_deferred += it.second.n_deferred;
+            stat.wait_us += it.second.wait_us;
+            stat.n_rows += it.second.n_rows;
+        }
+        prof->pieces.clear();
+        for (auto &it : prof->rows)
+            all_rows[it.first] += it.second;
+        prof->rows.clear();
+    }
+
+    for (auto &it : all_pieces) {
+        PieceStat ps;
+        ps.t_type = it.first.first;
+        ps.p_type = it.first.second;
+        ps.n_exec = it.second.n_exec;
+        ps.exec_us = it.second.exec_us;
+        ps.n_immediate = it.second.n_immediate;
+        ps.n_deferred = it.second.n_deferred;
+        ps.wait_us = it.second.wait_us;
+        ps.n_rows = it.second.n_rows;
+        pieces->push_back(ps);
+    }
+    for (auto &it : all_rows) {
+        auto name = table_names_s.find(it.first);
+        // rows not in a table yet, or in a table of no name
+        std::string tb = (name == table_names_s.end()) ? "" : name->second;
+        (*rows)[tb] += it.second;
+    }
+}
+
+} // namespace rococo
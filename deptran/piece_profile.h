@@ -0,0 +1,78 @@
+#pragma once
+
+#include "rcc_rpc.h"
+
+namespace rococo {
+
+/**
+ * Server side profile of the stored procedures, on when the config says
+ * piece_profile or server_piece_profile turns it on. Every thread counts
+ * into its own slot, the heart beat drains all slots into the
+ * ServerResponse.
+ */
+class PieceProfile {
+public:
+    typedef struct {
+        uint64_t n_exec = 0;        // handler runs, 2PL runs one per lock
+                                    // round and one for the real work
+        uint64_t exec_us = 0;       // time in the handler
+        uint64_t n_immediate = 0;   // pieces answered right away
+        uint64_t n_deferred = 0;    // pieces answered after a wait
+        uint64_t wait_us = 0;       // of the deferred ones, time waited
+                                    // on locks, 2PL only; rococo defers
+                                    // to the commit, which is not timed
+        uint64_t n_rows = 0;        // rows touched through the txn
+    } piece_stat_t;
+
+    /** times one handler run on txn and counts the rows it touched,
+     *  by piece and, for the outermost run, by table */
+    class Scope {
+    public:
+        Scope(rrr::i32 t_type, rrr::i32 p_type, const mdb::Txn *txn);
+        ~Scope();
+    private:
+        rrr::i32 t_type_, p_type_;
+        const mdb::Txn *txn_;
+        uint64_t n_touched_;
+        std::map<const mdb::Table *, uint64_t> n_touched_by_table_;
+        std::chrono::steady_clock::time_point begin_;
+    };
+
+    /** may be called at any time, handlers check on() per run */
+    static void init(bool on) {
+        on_s.store(on, std::memory_order_relaxed);
+    }
+
+    static bool on() {
+        return on_s.load(std::memory_order_relaxed);
+    }
+
+    static void reg_table(const std::string &name, const mdb::Table *tbl);
+
+    /** a piece got its answer, wait_us after the handler first returned */
+    static void piece_done(rrr::i32 t_type,
+                           rrr::i32 p_type,
+                           bool deferred,
+                           uint64_t wait_us);
+
+    /** move everything counted so far into pieces and rows, by name */
+    static void drain(std::vector<PieceStat> *pieces,
+                      std::map<std::string, rrr::i64> *rows);
+
+private:
+    typedef struct {
+        std::mutex mtx;
+        std::map<std::pair<rrr::i32, rrr::i32>, piece_stat_t> pieces;
+        std::map<const mdb::Table *, uint64_t> rows;
+        int depth = 0; // open Scopes, this thread only
+    } thread_prof_t;
+
+    static thread_prof_t *mine();
+
+    static std::atomic<bool> on_s;
+    static std::mutex all_mtx_s;
+    static std::vector<thread_prof_t *> all_s;
+    static std::map<const mdb::Table *, std::string> table_names_s;
+};
+
+} // namespace rococo
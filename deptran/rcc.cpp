@@ -109,6 +109,100 @@ void RCCDTxn::start_ro(
     output.resize(output_size);
 }
 
+std::map<i64, RO6DTxn::ro_pin_t> RO6DTxn::ro_pins_s;
+
+RO6DTxn::~RO6DTxn() {
+    if (!ws_.rows.empty()) {
+        // never decided here, its writes are no use pending forever
+        mdb::version_t ver = mdb::MultiVersionedRow::next_version();
+        publish(ver);
+        mdb::MultiVersionedRow::make_stable(ver);
+    }
+}
+
+void RO6DTxn::publish(mdb::version_t ver) {
+    mdb::MultiVersionedRow::publish(&ws_, ver);
+}
+
+void RO6DTxn::start(
+        const RequestHeader &header,
+        const std::vector<mdb::Value> &input,
+        bool *deferred,
+        std::vector<mdb::Value> *output) {
+    // our writes stay pending until we are decided here
+    mdb::MultiVersionedRow::begin_write(&ws_);
+    RCCDTxn::start(header, input, deferred, output);
+    mdb::MultiVersionedRow::end_write();
+}
+
+void RO6DTxn::exe_deferred(
+        std::vector<std::pair<RequestHeader, std::vector<mdb::Value> > >
+        &outputs) {
+    mdb::MultiVersionedRow::begin_write(&ws_);
+    RCCDTxn::exe_deferred(outputs);
+    mdb::MultiVersionedRow::end_write();
+}
+
+void RO6DTxn::start_ro(
+        const RequestHeader &header,
+        const std::vector<mdb::Value> &input,
+        std::vector<mdb::Value> &output) {
+    auto it = ro_pins_s.find(header.tid);
+    if (it == ro_pins_s.end()) {
+        uint64_t now = rrr::Time::now();
+        expire_ro(now);
+        // the newest version no txn is published in part, kept for the
+        // later pieces of the txn
+        ro_pin_t ro_pin;
+        ro_pin.pin = mdb::MultiVersionedRow::pin_snapshot(
+                mdb::MultiVersionedRow::stable_version());
+        ro_pin.since = now;
+        it = ro_pins_s.insert(std::make_pair(header.tid, ro_pin)).first;
+    }
+    TxnRunner::start_ro_txn(header.tid, it->second.pin.ver);
+
+    auto txn_handler_pair = TxnRegistry::get(header.t_type, header.p_type);
+    int output_size = 300;
+    output.resize(output_size);
+    int res = SUCCESS;
+    txn_handler_pair.txn_handler(header, input.data(), input.size(), &res,
+            output.data(), &output_size, NULL, NULL,
+            NULL, NULL);
+    // the snapshot is pinned, no read misses its version
+    verify(res == SUCCESS);
+    output.resize(output_size);
+
+    TxnRunner::end_ro_txn(header.tid);
+}
+
+void RO6DTxn::end_ro(i64 tid) {
+    auto it = ro_pins_s.find(tid);
+    if (it == ro_pins_s.end()) {
+        return;
+    }
+    mdb::MultiVersionedRow::unpin_snapshot(it->second.pin);
+    ro_pins_s.erase(it);
+    mdb::MultiVersionedRow::collect();
+}
+
+void RO6DTxn::expire_ro(uint64_t now) {
+    uint64_t timeout = Config::get_config()->get_ro_pin_timeout_us();
+    bool expired = false;
+    for (auto it = ro_pins_s.begin(); it != ro_pins_s.end(); ) {
+        if (now - it->second.since > timeout) {
+            Log::info("tid %llx: rcc_ro_end_txn never came, unpin", it->first);
+            mdb::MultiVersionedRow::unpin_snapshot(it->second.pin);
+            it = ro_pins_s.erase(it);
+            expired = true;
+        } else {
+            ++it;
+        }
+    }
+    if (expired) {
+        mdb::MultiVersionedRow::collect();
+    }
+}
+
 void RCCDTxn::commit(
         const ChopFinishRequest &req,
         ChopFinishResponse* res,
@@ -137,12 +231,14 @@ void RCCDTxn::to_decide(
     } else {
         tinfo.during_commit = true;
     }
+    Trace::async_begin(Trace::TR_TO_DECIDE, tinfo.id(), 0);
 
     Graph<TxnInfo> &txn_gra = RCCDTxn::dep_s->txn_gra_;
     // a commit function.
 
     std::function<void(void)> scc_anc_commit_cb = [&txn_gra, v, defer, this] () {
         uint64_t txn_id = v->data_.id();
+        Trace::async_end(Trace::TR_TO_DECIDE, txn_id, 0);
         Log::debug("all scc ancestors have committed for txn id: %llx", txn_id);
         // after all scc ancestors become DECIDED
         // sort, and commit.
@@ -151,6 +247,10 @@ void RCCDTxn::to_decide(
         } else {
             std::vector<Vertex<TxnInfo>*> sscc;
             txn_gra.sorted_scc(v, &sscc);
+            // under ro6 the whole scc is published at one version
+            mdb::version_t ver = 0;
+            if (TxnRunner::get_running_mode() == MODE_ROT)
+                ver = mdb::MultiVersionedRow::next_version();
             //static int64_t sample = 0;
             //if (RandomGenerator::rand(1, 100)==1) {
             //    scsi_->do_statistics(S_RES_KEY_N_SCC, sscc.size());
@@ -166,7 +266,14 @@ void RCCDTxn::to_decide(
                     if (vv->data_.res != nullptr) {
                         auto txn = (RCCDTxn*) mgr_->get(vv->data_.id());
                         txn->exe_deferred(vv->data_.res->outputs);
+                        if (ver != 0)
+                            ((RO6DTxn*) txn)->publish(ver);
                         mgr_->destroy(vv->data_.id());
+                    } else if (ver != 0
+                            && mgr_->dtxns_.count(vv->data_.id()) > 0) {
+                        // decided before our finish request came in, what
+                        // it wrote must not stay pending
+                        ((RO6DTxn*) mgr_->get(vv->data_.id()))->publish(ver);
                     }
 
                     Log::debug("txn commit. tid:%llx", vv->data_.id());
@@ -178,6 +285,9 @@ void RCCDTxn::to_decide(
                 }
             }
 
+            if (ver != 0)
+                mdb::MultiVersionedRow::make_stable(ver);
+
             for (auto& vv: sscc) {
                 vv->data_.trigger();
             }
@@ -300,6 +410,7 @@ void RCCDTxn::exe_deferred(
         //verify(0);
     } else {
         // delayed execution
+        Trace::Scope trace(Trace::TR_EXE_DEFERRED, tid_, 0);
         outputs.clear(); // FIXME does this help? seems it does, why?
         for (auto &req: dreqs_) {
             auto &header = req.header;
@@ -1,5 +1,7 @@
 #include "all.h"
 
+extern rrr::PollMgr *poll_mgr_g;
+
 namespace rococo {
 
 
@@ -21,6 +23,15 @@ RococoServiceImpl::RococoServiceImpl(ServerControlServiceImpl *scsi) :
     }
 }
 
+RococoServiceImpl::~RococoServiceImpl() {
+    mtx_.lock();
+    bool calvin_started = calvin_started_;
+    calvin_stop_ = true;
+    mtx_.unlock();
+    if (calvin_started)
+        pthread_join(calvin_th_, NULL);
+}
+
 // deprecated
 void RococoServiceImpl::do_start_pie(
         const RequestHeader &header,
@@ -94,31 +105,21 @@ void RococoServiceImpl::naive_batch_start_pie(
         rrr::DeferredReply *defer) {
     std::lock_guard<std::mutex> guard(mtx_);
 
-    DragonBall *defer_reply_db = NULL;
-    if (TxnRunner::get_running_mode() == MODE_2PL) {
-        defer_reply_db = new DragonBall(headers.size(), [/*&headers, */defer/*, results*/]() {
-                //for (int i = 0; i < results->size(); i++) {
-                //    Log::debug("tid: %ld, pid: %ld, results[%d]: %d", headers[i].tid, headers[i].pid, i, (*results)[i]);
-                //}
-                defer->reply();
-                });
-    }
+    // one reply once every piece ran, a 2PL one maybe after its locks
+    DragonBall *defer_reply_db = new DragonBall(headers.size(), [defer]() {
+            defer->reply();
+            });
     Log::debug("naive_batch_start_pie: tid: %ld", headers[0].tid);
     results->resize(headers.size());
     outputs->resize(headers.size());
     int num_pieces = headers.size();
     for (int i = 0; i < num_pieces; i++) {
         (*outputs)[i].resize(output_sizes[i]);
-        if (defer_reply_db) {
-            TxnRegistry::pre_execute_2pl(headers[i], inputs[i],
-                     &((*results)[i]), &((*outputs)[i]), defer_reply_db);
-        }
-        else
-            TxnRegistry::execute(headers[i], inputs[i],
-                     &(*results)[i], &(*outputs)[i]);
+        run_piece_job(headers[i], inputs[i], &(*results)[i], &(*outputs)[i],
+                      [defer_reply_db] () {
+            defer_reply_db->trigger();
+        });
     }
-    if (!defer_reply_db)
-        defer->reply();
     Log::debug("still fine");
 }
 
@@ -130,6 +131,31 @@ void RococoServiceImpl::start_pie(
         std::vector<mdb::Value>* output,
         rrr::DeferredReply* defer) {
     std::lock_guard<std::mutex> guard(mtx_);
+    start_pie_job(header, input, output_size, res, output, defer);
+}
+
+void RococoServiceImpl::piggy_start_pie(
+        const RequestHeader& header,
+        const std::vector<mdb::Value>& input,
+        const rrr::i32 &output_size,
+        const std::vector<rrr::i64> &commits,
+        const std::vector<rrr::i64> &aborts,
+        rrr::i32* res,
+        std::vector<mdb::Value>* output,
+        rrr::DeferredReply* defer) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    // the decided txns may hold locks this piece is about to ask for
+    decide_txns_job(commits, aborts);
+    start_pie_job(header, input, output_size, res, output, defer);
+}
+
+void RococoServiceImpl::start_pie_job(
+        const RequestHeader& header,
+        const std::vector<mdb::Value>& input,
+        const rrr::i32 &output_size,
+        rrr::i32* res,
+        std::vector<mdb::Value>* output,
+        rrr::DeferredReply* defer) {
 
 #ifdef PIECE_COUNT
     piece_count_key_t piece_count_key = 
@@ -144,25 +170,208 @@ void RococoServiceImpl::start_pie(
     piece_count_tid_.insert(header.tid);
 #endif
 
+    Trace::Scope trace(Trace::TR_PIECE, header.tid, header.pid);
+    Trace::rpc_receive(header.tid, header.pid);
+
     output->resize(output_size);
     // find stored procedure, and run it
     *res = SUCCESS;
-    if (TxnRunner::get_running_mode() == MODE_2PL) {
-        DragonBall *defer_reply_db = new DragonBall(1, [defer]() {
-                defer->reply();
-                });
-        TxnRegistry::pre_execute_2pl(header, input, res, output, defer_reply_db);
-    }
-    else if (TxnRunner::get_running_mode() == MODE_NONE) {
-        TxnRegistry::execute(header, input, res, output);
+    verify(TxnRunner::get_running_mode() == MODE_2PL
+        || TxnRunner::get_running_mode() == MODE_NONE
+        || TxnRunner::get_running_mode() == MODE_OCC);
+    run_piece_job(header, input, res, output, [defer] () {
         defer->reply();
-    }
-    else if (TxnRunner::get_running_mode() == MODE_OCC) {
+    });
+}
+
+void RococoServiceImpl::run_piece_job(
+        const RequestHeader& header,
+        const std::vector<mdb::Value>& input,
+        rrr::i32* res,
+        std::vector<mdb::Value>* output,
+        const std::function<void(void)> &done) {
+    if (TxnRunner::get_running_mode() != MODE_2PL) {
         TxnRegistry::execute(header, input, res, output);
-        defer->reply();
+        if (PieceProfile::on())
+            PieceProfile::piece_done(header.t_type, header.p_type, false, 0);
+        done();
+        return;
+    }
+    if (!PieceProfile::on() && !Trace::on()) {
+        TxnRegistry::pre_execute_2pl(header, input, res, output,
+                                     new DragonBall(1, done));
+        return;
+    }
+    // the ball goes off inside pre_execute_2pl unless some lock has to
+    // wait, then later with mtx_ held by whoever let go
+    typedef struct {
+        bool fired;
+        bool waiting;
+        std::chrono::steady_clock::time_point since;
+    } wait_t;
+    auto w = std::make_shared<wait_t>();
+    w->fired = false;
+    w->waiting = false;
+    i32 t_type = header.t_type, p_type = header.p_type;
+    i64 tid = header.tid, pid = header.pid;
+    DragonBall *db = new DragonBall(1,
+            [done, w, t_type, p_type, tid, pid]() {
+            w->fired = true;
+            uint64_t us = 0;
+            if (w->waiting) {
+                us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - w->since).count();
+                Trace::async_end(Trace::TR_LOCK_WAIT, tid, pid);
+            }
+            if (PieceProfile::on())
+                PieceProfile::piece_done(t_type, p_type, w->waiting, us);
+            done();
+            });
+    TxnRegistry::pre_execute_2pl(header, input, res, output, db);
+    if (!w->fired) {
+        w->waiting = true;
+        w->since = std::chrono::steady_clock::now();
+        Trace::async_begin(Trace::TR_LOCK_WAIT, tid, pid);
     }
-    else
-        verify(0);
+}
+
+void RococoServiceImpl::chain_start_pie(
+        const RequestHeader& header,
+        const rrr::i32 &pi,
+        const std::vector<mdb::Value>& input,
+        const rrr::i32 &output_size,
+        const rrr::i32 &n_wait,
+        const std::vector<PieceForward> &forwards,
+        rrr::i32* res,
+        std::vector<mdb::Value>* output,
+        rrr::DeferredReply* defer) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    auto key = std::make_pair(header.tid, pi);
+    chain_wait_t &w = chain_waits_[key];
+    w.header = header;
+    w.input = input;
+    for (auto &it : w.early)
+        w.input[it.first] = it.second;
+    w.early.clear();
+    w.forwards = forwards;
+    w.n_wait += n_wait;
+    w.res = res;
+    w.output = output;
+    w.output->resize(output_size);
+    w.defer = defer;
+    chain_try_run_job(key);
+}
+
+void RococoServiceImpl::forward_pie_output(
+        const rrr::i64 &tid,
+        const rrr::i32 &pi,
+        const rrr::i32 &res,
+        const std::map<rrr::i32, Value> &values) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    chain_input_job(tid, pi, res, values);
+}
+
+void RococoServiceImpl::chain_input_job(
+        const rrr::i64 &tid,
+        const rrr::i32 &pi,
+        const rrr::i32 &res,
+        const std::map<rrr::i32, Value> &values) {
+    auto key = std::make_pair(tid, pi);
+    chain_wait_t &w = chain_waits_[key];
+    if (res != SUCCESS)
+        w.rejected = true;
+    for (auto &it : values) {
+        if (w.defer)
+            w.input[it.first] = it.second;
+        else
+            w.early[it.first] = it.second;
+    }
+    w.n_wait--;
+    chain_try_run_job(key);
+}
+
+void RococoServiceImpl::chain_try_run_job(
+        const std::pair<rrr::i64, rrr::i32> &key) {
+    chain_wait_t &w = chain_waits_[key];
+    if (w.defer == NULL || w.n_wait > 0)
+        return;
+    verify(w.n_wait == 0);
+    Log::debug("chained piece runs, tid: %ld, pi: %d", key.first, key.second);
+
+    // the entry keeps the input alive until a 2PL piece got its locks
+    auto done = [this, key] () {
+        chain_wait_t &w = chain_waits_[key];
+        chain_forward_job(key.first, *w.res, *w.output, w.forwards);
+        w.defer->reply();
+        chain_waits_.erase(key);
+    };
+    *w.res = SUCCESS;
+    if (w.rejected) {
+        // an upstream piece failed, so does this one
+        *w.res = REJECT;
+        w.output->resize(0);
+        done();
+    } else {
+        run_piece_job(w.header, w.input, w.res, w.output, done);
+    }
+}
+
+void RococoServiceImpl::chain_forward_job(
+        const rrr::i64 &tid,
+        const rrr::i32 &res,
+        const std::vector<Value> &output,
+        const std::vector<PieceForward> &forwards) {
+    // one message per downstream piece
+    std::map<std::pair<rrr::i32, rrr::i32>, std::map<rrr::i32, Value>> msgs;
+    for (auto &f : forwards) {
+        std::map<rrr::i32, Value> &values = msgs[std::make_pair(f.sid, f.pi)];
+        if (res == SUCCESS) {
+            verify(f.out_idx < output.size());
+            values[f.in_idx] = output[f.out_idx];
+        }
+    }
+    rrr::i32 my_sid = Config::get_config()->get_site_id();
+    for (auto &it : msgs) {
+        if (it.first.first == my_sid) {
+            chain_input_job(tid, it.first.second, res, it.second);
+        } else {
+            RococoProxy *proxy = RCCDTxn::dep_s->get_server_proxy(
+                    it.first.first);
+            Future::safe_release(proxy->async_forward_pie_output(
+                        tid, it.first.second, res, it.second));
+        }
+    }
+}
+
+void RococoServiceImpl::ro_start_pie(
+        const RequestHeader& header,
+        const std::vector<mdb::Value>& input,
+        const rrr::i32 &output_size,
+        const rrr::i64 &snapshot_ts,
+        rrr::i32* res,
+        std::vector<mdb::Value>* output,
+        rrr::DeferredReply* defer) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    verify(TxnRunner::get_running_mode() == MODE_OCC);
+
+    output->resize(output_size);
+    *res = SUCCESS;
+    // pin the snapshots before the first piece runs, the handler then picks
+    // the same txn up through get_txn(header)
+    TxnRunner::get_ro_txn(header.tid, snapshot_ts);
+    TxnRegistry::execute(header, input, res, output);
+    if (PieceProfile::on())
+        PieceProfile::piece_done(header.t_type, header.p_type, false, 0);
+    if (*res == SUCCESS && snapshot_ts >= 0 && TxnRunner::is_ro_snapshot())
+        *res = READ_ONLY;
+    defer->reply();
+}
+
+void RococoServiceImpl::ro_end_txn(const rrr::i64 &tid) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    verify(TxnRunner::get_running_mode() == MODE_OCC);
+    // a snapshot reader has nothing to install, committing only drops it
+    TPL::do_commit(tid);
 }
 
 void RococoServiceImpl::prepare_txn(
@@ -199,14 +408,22 @@ void RococoServiceImpl::prepare_txn_job(
         std::string *log_s) {
 
     std::lock_guard<std::mutex> guard(mtx_);
-    if (log_s)
+    bool read_only = !TPL::has_writes(tid);
+    if (log_s && !read_only)
         TxnRunner::get_prepare_log(tid, sids, log_s);
 
     *res = TPL::do_prepare(tid);
 
+    // nothing to install here, so release the txn now and leave this
+    // server out of the commit round
+    if (read_only && *res == SUCCESS) {
+        TPL::do_commit(tid);
+        *res = READ_ONLY;
+    }
+
 #ifdef PIECE_COUNT
     std::map<piece_count_key_t, uint64_t>::iterator pc_it;
-    if (*res != SUCCESS)
+    if (*res == REJECT)
         piece_count_prepare_fail_++;
     else
         piece_count_prepare_success_++;
@@ -230,7 +447,12 @@ void RococoServiceImpl::commit_txn(
         rrr::DeferredReply* defer) {
 
     std::lock_guard<std::mutex> guard(mtx_);
-    *res = TPL::do_commit(tid);
+    *res = commit_txn_job(tid);
+    defer->reply();
+}
+
+rrr::i32 RococoServiceImpl::commit_txn_job(const rrr::i64& tid) {
+    rrr::i32 res = TPL::do_commit(tid);
     if (Config::get_config()->do_logging()) {
         const char commit_tag = 'c';
         std::string log_s;
@@ -239,7 +461,7 @@ void RococoServiceImpl::commit_txn(
         memcpy((void *)log_s.data(), (void *)&commit_tag, sizeof(commit_tag));
         recorder_->submit(log_s);
     }
-    defer->reply();
+    return res;
 }
 
 void RococoServiceImpl::abort_txn(
@@ -257,7 +479,13 @@ void RococoServiceImpl::abort_txn(
     //else {
     //    TxnRunner::do_abort(tid, defer);
     //}
-    *res = TPL::do_abort(tid);
+    *res = abort_txn_job(tid);
+    defer->reply();
+    Log::debug("abort finish");
+}
+
+rrr::i32 RococoServiceImpl::abort_txn_job(const rrr::i64& tid) {
+    rrr::i32 res = TPL::do_abort(tid);
     if (Config::get_config()->do_logging()) {
         const char abort_tag = 'a';
         std::string log_s;
@@ -266,10 +494,534 @@ void RococoServiceImpl::abort_txn(
         memcpy((void *)log_s.data(), (void *)&abort_tag, sizeof(abort_tag));
         recorder_->submit(log_s);
     }
+    return res;
+}
+
+void RococoServiceImpl::decide_txns(
+        const std::vector<rrr::i64> &commits,
+        const std::vector<rrr::i64> &aborts,
+        rrr::DeferredReply* defer) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    decide_txns_job(commits, aborts);
     defer->reply();
-    Log::debug("abort finish");
 }
 
+void RococoServiceImpl::decide_txns_job(
+        const std::vector<rrr::i64> &commits,
+        const std::vector<rrr::i64> &aborts) {
+    Log::debug("decide txns: commit %d, abort %d",
+               (int) commits.size(), (int) aborts.size());
+    for (auto tid : commits)
+        commit_txn_job(tid);
+    for (auto tid : aborts)
+        abort_txn_job(tid);
+}
+
+void RococoServiceImpl::one_phase_commit_txn(
+        const rrr::i64& tid,
+        rrr::i32* res,
+        rrr::DeferredReply* defer) {
+
+    std::lock_guard<std::mutex> guard(mtx_);
+    bool logging = Config::get_config()->do_logging();
+    std::string log_s;
+
+    // the only participant, nobody else to wait for: decide right here
+    *res = TPL::do_prepare(tid);
+    if (*res == SUCCESS) {
+        // one record holds both the writes and the decision
+        if (logging)
+            TxnRunner::get_prepare_log(tid, std::vector<i32>(), &log_s, 'o');
+        TPL::do_commit(tid);
+    } else {
+        TPL::do_abort(tid);
+    }
+
+    if (logging && *res == SUCCESS) {
+        auto job = [defer] () {
+            defer->reply();
+        };
+        recorder_->submit(log_s, job);
+    } else {
+        defer->reply();
+    }
+}
+
+void RococoServiceImpl::one_shot_txn(
+        const RequestHeader &header,
+        const std::vector<Value> &input,
+        rrr::i32* res,
+        rrr::DeferredReply* defer) {
+
+    std::lock_guard<std::mutex> guard(mtx_);
+    verify(TxnRunner::get_running_mode() == MODE_OCC
+        || TxnRunner::get_running_mode() == MODE_2PL
+        || TxnRunner::get_running_mode() == MODE_NONE);
+
+    // the same chopper the coordinator would use wires the pieces
+    TxnRequest req;
+    req.txn_type_ = header.t_type;
+    req.input_ = input;
+    one_shot_t *os = new one_shot_t();
+    os->ch = TxnChopperFactory::gen_chopper(req,
+            Config::get_config()->get_benchmark());
+    os->ch->txn_id_ = header.tid;
+    os->header = header;
+    os->res = res;
+    os->defer = defer;
+    os->launching = false;
+    one_shot_run_job(os);
+}
+
+void RococoServiceImpl::one_shot_run_job(one_shot_t *os) {
+    TxnChopper *ch = os->ch;
+    if (ch->commit_.load()) {
+        // collect first, a 2PL piece may be done as soon as it starts
+        std::vector<int> pis;
+        std::vector<Value> *input;
+        int output_size;
+        int32_t sid;
+        int pi;
+        while (ch->next_piece(input, output_size, sid, pi,
+                              os->header.p_type) == 0) {
+            verify(sid == Config::get_config()->get_site_id());
+            pis.push_back(pi);
+            ch->n_start_sent_++;
+        }
+
+        os->launching = true;
+        for (auto pi : pis) {
+            RequestHeader header = os->header;
+            header.p_type = ch->p_types_[pi];
+            header.pid = pi;
+            std::vector<Value> *output =
+                new std::vector<Value>(ch->output_size_[pi]);
+            rrr::i32 *res = new rrr::i32(SUCCESS);
+            auto done = [this, os, pi, res, output] () {
+                one_shot_piece_job(os, pi, *res, *output);
+                delete res;
+                delete output;
+            };
+            run_piece_job(header, ch->inputs_[pi], res, output, done);
+        }
+        os->launching = false;
+
+        if (pis.size() > 0) {
+            // their outputs may have readied more pieces
+            one_shot_run_job(os);
+            return;
+        }
+    }
+    if (ch->n_start_sent_ == 0)
+        one_shot_end_job(os);
+}
+
+void RococoServiceImpl::one_shot_piece_job(
+        one_shot_t *os,
+        int pi,
+        rrr::i32 res,
+        const std::vector<Value> &output) {
+    TxnChopper *ch = os->ch;
+    ch->n_started_++;
+    ch->n_start_sent_--;
+    if (res == REJECT)
+        ch->commit_.store(false);
+    else if (ch->commit_.load())
+        ch->start_callback(pi, res, output);
+    // a piece that waited for its locks picks the txn up again
+    if (!os->launching)
+        one_shot_run_job(os);
+}
+
+void RococoServiceImpl::one_shot_end_job(one_shot_t *os) {
+    rrr::i64 tid = os->header.tid;
+    bool logging = Config::get_config()->do_logging();
+    std::string log_s;
+    rrr::DeferredReply *defer = os->defer;
+
+    if (TxnRunner::get_running_mode() == MODE_NONE) {
+        *os->res = SUCCESS;
+    } else if (os->ch->commit_.load()) {
+        *os->res = TPL::do_prepare(tid);
+        if (*os->res == SUCCESS) {
+            if (logging)
+                TxnRunner::get_prepare_log(tid, std::vector<i32>(),
+                                           &log_s, 'o');
+            TPL::do_commit(tid);
+        } else {
+            TPL::do_abort(tid);
+        }
+    } else {
+        *os->res = REJECT;
+        TPL::do_abort(tid);
+    }
+
+    bool submit = logging && *os->res == SUCCESS
+               && TxnRunner::get_running_mode() != MODE_NONE;
+    delete os->ch;
+    delete os;
+    if (submit) {
+        auto job = [defer] () {
+            defer->reply();
+        };
+        recorder_->submit(log_s, job);
+    } else {
+        defer->reply();
+    }
+}
+
+void RococoServiceImpl::calvin_submit(
+        const RequestHeader &header,
+        const std::vector<Value> &input,
+        rrr::i32* res,
+        rrr::DeferredReply* defer) {
+
+    std::lock_guard<std::mutex> guard(mtx_);
+    verify(Config::get_config()->get_mode() == MODE_CALVIN);
+    calvin_start_job();
+
+    // only to count the servers that will report back
+    TxnRequest req;
+    req.txn_type_ = header.t_type;
+    req.input_ = input;
+    TxnChopper *ch = TxnChopperFactory::gen_chopper(req,
+            Config::get_config()->get_benchmark());
+    std::set<rrr::i32> sids(ch->sharding_.begin(), ch->sharding_.end());
+    delete ch;
+
+    calvin_wait_t &w = calvin_waits_[header.tid];
+    w.n_left = sids.size();
+    w.res = res;
+    w.defer = defer;
+    *res = SUCCESS;
+
+    CalvinTxn txn;
+    txn.header = header;
+    txn.input = input;
+    calvin_pending_.push_back(txn);
+}
+
+void RococoServiceImpl::calvin_batch(
+        const rrr::i32 &sid,
+        const rrr::i64 &epoch,
+        const std::vector<CalvinTxn> &txns) {
+
+    std::lock_guard<std::mutex> guard(mtx_);
+    calvin_start_job();
+    calvin_epochs_[epoch][sid] = txns;
+
+    // an epoch goes in once every sequencer's batch for it is here, in
+    // sequencer order, so every server queues the same txns the same way
+    unsigned int n_site = Config::get_config()->get_num_site();
+    while (true) {
+        auto it = calvin_epochs_.find(calvin_next_epoch_);
+        if (it == calvin_epochs_.end() || it->second.size() < n_site)
+            break;
+        for (auto &b : it->second)
+            for (auto &txn : b.second)
+                calvin_queue_job(txn, b.first);
+        calvin_epochs_.erase(it);
+        calvin_next_epoch_++;
+    }
+    calvin_run_job();
+}
+
+void RococoServiceImpl::calvin_output(
+        const rrr::i64 &seq,
+        const rrr::i32 &pi,
+        const rrr::i32 &res,
+        const std::vector<Value> &output) {
+
+    std::lock_guard<std::mutex> guard(mtx_);
+    // queued and gone: it was rejected here and this one was on the way
+    if (seq < calvin_next_seq_ && calvin_queue_.count(seq) == 0)
+        return;
+    calvin_outputs_t &o = calvin_outputs_[seq];
+    if (res == SUCCESS)
+        o.outputs[pi] = output;
+    else
+        o.rejected = true;
+    calvin_run_job();
+}
+
+void RococoServiceImpl::calvin_done(const rrr::i64 &tid, const rrr::i32 &res) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    calvin_done_job(tid, res);
+}
+
+void RococoServiceImpl::calvin_start_job() {
+    if (calvin_started_ || calvin_stop_)
+        return;
+    // no server starts its epochs before it hears from a client or from
+    // another server that did, by then every server is up
+    calvin_started_ = true;
+    verify(0 == pthread_create(&calvin_th_, NULL,
+                               &RococoServiceImpl::calvin_epoch_loop, this));
+}
+
+void *RococoServiceImpl::calvin_epoch_loop(void *arg) {
+    RococoServiceImpl *s = (RococoServiceImpl *)arg;
+    rrr::i32 my_sid = Config::get_config()->get_site_id();
+    unsigned int epoch_ms = Config::get_config()->get_epoch_ms();
+
+    // own connections, the dep graph ones belong to the handler thread;
+    // the batch to this server goes the same way so that txns only ever
+    // run in handlers
+    std::vector<std::string> addrs;
+    Config::get_config()->get_all_site_addr(addrs);
+    std::vector<rrr::Client *> clients;
+    std::vector<RococoProxy *> proxies;
+    for (auto &addr : addrs) {
+        verify(poll_mgr_g != nullptr);
+        rrr::Client *rpc_cli = new rrr::Client(poll_mgr_g);
+        verify(0 == rpc_cli->connect(addr.c_str()));
+        clients.push_back(rpc_cli);
+        proxies.push_back(new RococoProxy(rpc_cli));
+    }
+
+    for (rrr::i64 epoch = 0; ; epoch++) {
+        usleep(epoch_ms * 1000);
+        std::vector<CalvinTxn> txns;
+        s->mtx_.lock();
+        bool stop = s->calvin_stop_;
+        txns.swap(s->calvin_pending_);
+        s->mtx_.unlock();
+        if (stop)
+            break;
+        for (auto proxy : proxies)
+            Future::safe_release(proxy->async_calvin_batch(my_sid, epoch,
+                                                           txns));
+    }
+
+    for (auto proxy : proxies)
+        delete proxy;
+    for (auto rpc_cli : clients)
+        rpc_cli->close_and_release();
+    return NULL;
+}
+
+void RococoServiceImpl::calvin_queue_job(const CalvinTxn &txn,
+                                         rrr::i32 seq_sid) {
+    rrr::i64 seq = calvin_next_seq_++;
+    rrr::i32 my_sid = Config::get_config()->get_site_id();
+    TxnRequest req;
+    req.txn_type_ = txn.header.t_type;
+    req.input_ = txn.input;
+    TxnChopper *ch = TxnChopperFactory::gen_chopper(req,
+            Config::get_config()->get_benchmark());
+    ch->txn_id_ = txn.header.tid;
+    std::set<rrr::i32> sids(ch->sharding_.begin(), ch->sharding_.end());
+    if (sids.count(my_sid) == 0) {
+        delete ch;
+        return;
+    }
+
+    calvin_txn_t &t = calvin_queue_[seq];
+    t.txn = txn;
+    t.seq_sid = seq_sid;
+    t.ch = ch;
+    t.sids = sids;
+    t.granted = false;
+    t.res = SUCCESS;
+
+    // read only txns share their keys, a piece with keys unknown takes
+    // the whole server, the others share it
+    bool excl = !ch->is_read_only();
+    bool whole = false;
+    for (int pi = 0; pi < ch->n_pieces_ && !whole; pi++) {
+        if (ch->sharding_[pi] != my_sid)
+            continue;
+        std::set<std::string> keys;
+        whole = !ch->lock_keys(pi, &keys);
+        for (auto &k : keys)
+            t.locks[k] = excl;
+    }
+    if (whole)
+        t.locks.clear();
+    t.locks[""] = whole;
+    for (auto &l : t.locks)
+        calvin_locks_[l.first].push_back({seq, l.second});
+}
+
+void RococoServiceImpl::calvin_run_job() {
+    // a txn only ever waits for the ones ahead of it, one pass in order
+    // runs everything that can run
+    for (auto it = calvin_queue_.begin(); it != calvin_queue_.end(); ) {
+        calvin_txn_t &t = it->second;
+        if (!t.granted)
+            t.granted = calvin_granted_job(it->first, t);
+        if (!t.granted || !calvin_step_job(it->first, t)) {
+            it++;
+            continue;
+        }
+        calvin_end_job(it->first, t);
+        it = calvin_queue_.erase(it);
+    }
+}
+
+bool RococoServiceImpl::calvin_granted_job(rrr::i64 seq,
+                                           const calvin_txn_t &t) {
+    for (auto &l : t.locks) {
+        for (auto &q : calvin_locks_[l.first]) {
+            if (q.seq == seq)
+                break;
+            if (q.excl || l.second)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool RococoServiceImpl::calvin_locked_job(const calvin_txn_t &t, int pi) {
+    if (t.locks.at(""))
+        return true;
+    std::set<std::string> keys;
+    if (!t.ch->lock_keys(pi, &keys))
+        return false;
+    bool excl = !t.ch->is_read_only();
+    for (auto &k : keys) {
+        auto it = t.locks.find(k);
+        if (it == t.locks.end() || (excl && !it->second))
+            return false;
+    }
+    return true;
+}
+
+bool RococoServiceImpl::calvin_step_job(rrr::i64 seq, calvin_txn_t &t) {
+    TxnChopper *ch = t.ch;
+    rrr::i32 my_sid = Config::get_config()->get_site_id();
+    RequestHeader header = t.txn.header;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        // ours run right away, the others' outputs come by calvin_output
+        std::vector<Value> *input;
+        int output_size;
+        int32_t sid;
+        int pi;
+        while (ch->next_piece(input, output_size, sid, pi,
+                              header.p_type) == 0) {
+            // a piece added at run time can only go where the txn was
+            // queued and locked, nobody else would run it
+            if (t.sids.count(sid) == 0
+                    || (sid == my_sid && !calvin_locked_job(t, pi))) {
+                Log::error("calvin: txn %lld piece %d is on server %d, "
+                           "not known when it was queued",
+                           (long long)header.tid, pi, sid);
+                calvin_reject_job(seq, t, pi);
+                return true;
+            }
+            if (sid != my_sid)
+                continue;
+            header.pid = pi;
+            rrr::i32 res = SUCCESS;
+            std::vector<Value> output(output_size);
+            // the locks keep out every conflicting txn, it only fails on
+            // its own. its writes are logged, and the locks are held until
+            // the end, so a reject anywhere takes them back
+            mdb::TxnUnsafe *txn = (mdb::TxnUnsafe *)TxnRunner::get_txn(header);
+            verify(txn->rtti() == mdb::symbol_t::TXN_UNSAFE);
+            txn->set_undo(&t.undo);
+            TxnRegistry::execute(header, *input, &res, &output);
+            txn->set_undo(nullptr);
+            if (PieceProfile::on())
+                PieceProfile::piece_done(header.t_type, header.p_type,
+                                         false, 0);
+            if (res != SUCCESS) {
+                calvin_reject_job(seq, t, pi);
+                return true;
+            }
+            for (auto s : t.sids) {
+                if (s == my_sid)
+                    continue;
+                RococoProxy *proxy = RCCDTxn::dep_s->get_server_proxy(s);
+                Future::safe_release(proxy->async_calvin_output(
+                            seq, pi, SUCCESS, output));
+            }
+            ch->start_callback(pi, res, output);
+            ch->status_[pi] = 2;
+            ch->n_started_++;
+        }
+
+        auto it = calvin_outputs_.find(seq);
+        if (it == calvin_outputs_.end())
+            break;
+        if (it->second.rejected) {
+            t.res = REJECT;
+            return true;
+        }
+        auto &outputs = it->second.outputs;
+        for (auto o = outputs.begin(); o != outputs.end(); ) {
+            // only once this chopper sent the piece too
+            if (o->first < ch->status_.size() && ch->status_[o->first] == 1) {
+                ch->start_callback(o->first, SUCCESS, o->second);
+                ch->status_[o->first] = 2;
+                ch->n_started_++;
+                o = outputs.erase(o);
+                progress = true;
+            } else {
+                o++;
+            }
+        }
+    }
+    return ch->n_started_ == ch->n_pieces_;
+}
+
+void RococoServiceImpl::calvin_reject_job(rrr::i64 seq, calvin_txn_t &t,
+                                          int pi) {
+    rrr::i32 my_sid = Config::get_config()->get_site_id();
+    t.res = REJECT;
+    for (auto s : t.sids) {
+        if (s == my_sid)
+            continue;
+        RococoProxy *proxy = RCCDTxn::dep_s->get_server_proxy(s);
+        Future::safe_release(proxy->async_calvin_output(
+                    seq, pi, REJECT, std::vector<Value>()));
+    }
+}
+
+void RococoServiceImpl::calvin_end_job(rrr::i64 seq, calvin_txn_t &t) {
+    // every piece ran everywhere, or none of its writes stay
+    if (t.res == SUCCESS)
+        mdb::TxnUnsafe::keep(&t.undo);
+    else
+        mdb::TxnUnsafe::rollback(&t.undo);
+    for (auto &l : t.locks) {
+        auto q = calvin_locks_.find(l.first);
+        verify(q != calvin_locks_.end());
+        for (auto it = q->second.begin(); it != q->second.end(); it++) {
+            if (it->seq == seq) {
+                q->second.erase(it);
+                break;
+            }
+        }
+        if (q->second.empty())
+            calvin_locks_.erase(q);
+    }
+    calvin_outputs_.erase(seq);
+
+    rrr::i64 tid = t.txn.header.tid;
+    if (t.seq_sid == Config::get_config()->get_site_id()) {
+        calvin_done_job(tid, t.res);
+    } else {
+        RococoProxy *proxy = RCCDTxn::dep_s->get_server_proxy(t.seq_sid);
+        Future::safe_release(proxy->async_calvin_done(tid, t.res));
+    }
+    delete t.ch;
+}
+
+void RococoServiceImpl::calvin_done_job(const rrr::i64 &tid, rrr::i32 res) {
+    auto it = calvin_waits_.find(tid);
+    verify(it != calvin_waits_.end());
+    calvin_wait_t &w = it->second;
+    if (res != SUCCESS)
+        *w.res = REJECT;
+    if (--w.n_left > 0)
+        return;
+    w.defer->reply();
+    calvin_waits_.erase(it);
+}
 
 void RococoServiceImpl::rcc_batch_start_pie(
         const std::vector<RequestHeader> &headers,
@@ -283,8 +1035,12 @@ void RococoServiceImpl::rcc_batch_start_pie(
     res->is_defers.resize(headers.size());
     res->outputs.resize(headers.size());
 
+    static bool do_record = Config::get_config()->do_logging();
+
     auto job = [&headers, &inputs, res, defer, this, txn] () {
         std::lock_guard<std::mutex> guard(mtx_);
+        if (do_record)
+            Trace::async_end(Trace::TR_LOG_FLUSH, headers[0].tid, 0);
 
         Log::debug("batch req, headers size:%u", headers.size());
         auto &tid = headers[0].tid;
@@ -297,21 +1053,25 @@ void RococoServiceImpl::rcc_batch_start_pie(
 
             //    Log::debug("receive start request. txn_id: %llx, pie_id: %llx", header.tid, header.pid);
 
+            Trace::Scope trace(Trace::TR_PIECE, header.tid, header.pid);
+            Trace::rpc_receive(header.tid, header.pid);
             bool deferred;
             txn->start(header, input, &deferred, &output);
             res->is_defers[i] = deferred ? 1 : 0;
+            if (PieceProfile::on())
+                PieceProfile::piece_done(header.t_type, header.p_type,
+                                         deferred, 0);
 
         }
         RCCDTxn::dep_s->sub_txn_graph(tid, res->gra_m);
         defer->reply();
 
     };
-    static bool do_record = Config::get_config()->do_logging();
-
     if (do_record) {
         rrr::Marshal m;
         m << headers << inputs;
 
+        Trace::async_begin(Trace::TR_LOG_FLUSH, headers[0].tid, 0);
         recorder_->submit(m, job);
     } else {
         job();
@@ -331,10 +1091,17 @@ void RococoServiceImpl::rcc_start_pie(
 
     auto job = [&header, &input, res, defer, this, txn] () {
         std::lock_guard<std::mutex> guard(this->mtx_);
+        if (do_record)
+            Trace::async_end(Trace::TR_LOG_FLUSH, header.tid, header.pid);
+        Trace::Scope trace(Trace::TR_PIECE, header.tid, header.pid);
+        Trace::rpc_receive(header.tid, header.pid);
         bool deferred;
         txn->start(header, input, &deferred, &res->output);
 
         res->is_defered = deferred ? 1 : 0;
+        if (PieceProfile::on())
+            PieceProfile::piece_done(header.t_type, header.p_type,
+                                     deferred, 0);
         auto sz_sub_gra = RCCDTxn::dep_s->sub_txn_graph(header.tid, res->gra_m);
         stat_sz_gra_start_.sample(sz_sub_gra);
 
@@ -346,6 +1113,7 @@ void RococoServiceImpl::rcc_start_pie(
         Marshal m;
         m << header;
         m << input;
+        Trace::async_begin(Trace::TR_LOG_FLUSH, header.tid, header.pid);
         recorder_->submit(m, job);
     } else {
         job();
@@ -382,7 +1150,7 @@ void RococoServiceImpl::rcc_ask_txn(
 
     std::lock_guard<std::mutex> guard(mtx_);
 
-    verify(TxnRunner::get_running_mode() == MODE_RCC);
+    verify(TxnRunner::get_running_mode() & (MODE_RCC | MODE_ROT));
     Vertex<TxnInfo> *v = RCCDTxn::dep_s->txn_gra_.find(tid);
 
     std::function<void(void)> callback = [this, res, defer, tid] () {
@@ -415,6 +1183,13 @@ void RococoServiceImpl::rcc_ro_start_pie(
         rrr::DeferredReply *defer) {
     std::lock_guard<std::mutex> guard(mtx_);
 
+    if (TxnRunner::get_running_mode() == MODE_ROT) {
+        // read a snapshot, no need to wait for conflicting txns
+        RO6DTxn::start_ro(header, input, *output);
+        defer->reply();
+        return;
+    }
+
     auto txn = (RCCDTxn*) txn_mgr_.get_or_create(header.tid);
 
     // do read only transaction
@@ -446,6 +1221,12 @@ void RococoServiceImpl::rcc_ro_start_pie(
 
 }
 
+void RococoServiceImpl::rcc_ro_end_txn(const rrr::i64 &tid) {
+    std::lock_guard<std::mutex> guard(mtx_);
+    verify(TxnRunner::get_running_mode() == MODE_ROT);
+    RO6DTxn::end_ro(tid);
+}
+
 void RococoServiceImpl::rpc_null(rrr::DeferredReply* defer) {
     defer->reply();
 }
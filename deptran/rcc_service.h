@@ -8,6 +8,7 @@
 namespace rococo {
 
 class ServerControlServiceImpl;
+class TxnChopper;
 
 class RococoServiceImpl : public RococoService {
 
@@ -24,6 +25,79 @@ public:
     ServerControlServiceImpl *scsi_; // for statistics;
     DTxnMgr txn_mgr_;
 
+    // chained pieces, by txn id and piece index, from the first of the
+    // piece itself or a forwarded input arriving until the piece is done
+    typedef struct {
+        RequestHeader header;
+        std::vector<Value> input;
+        std::vector<PieceForward> forwards;
+        rrr::i32 n_wait = 0; // forwarded inputs still missing
+        bool rejected = false;
+        std::map<rrr::i32, Value> early; // forwarded before the piece came
+        rrr::i32 *res = NULL;
+        std::vector<Value> *output = NULL;
+        rrr::DeferredReply *defer = NULL; // NULL until the piece came
+    } chain_wait_t;
+    std::map<std::pair<rrr::i64, rrr::i32>, chain_wait_t> chain_waits_;
+
+    // a txn run by one_shot_txn, alive until its reply
+    typedef struct {
+        TxnChopper *ch;
+        RequestHeader header;
+        rrr::i32 *res;
+        rrr::DeferredReply *defer;
+        bool launching;
+    } one_shot_t;
+
+    // calvin: txns this server sequenced, to be sent with the next epoch
+    std::vector<CalvinTxn> calvin_pending_;
+    bool calvin_started_ = false;
+    bool calvin_stop_ = false;
+    pthread_t calvin_th_;
+    // sequenced here, waiting for calvin_done from each server involved
+    typedef struct {
+        rrr::i32 n_left;
+        rrr::i32 *res;
+        rrr::DeferredReply *defer;
+    } calvin_wait_t;
+    std::map<rrr::i64, calvin_wait_t> calvin_waits_;
+    // batches by epoch then sequencer, until every sequencer's is in
+    std::map<rrr::i64, std::map<rrr::i32, std::vector<CalvinTxn>>>
+        calvin_epochs_;
+    rrr::i64 calvin_next_epoch_ = 0;
+    // position in the agreed order of the next txn queued, the same on
+    // every server, the servers name a txn by it
+    rrr::i64 calvin_next_seq_ = 0;
+    // txns running here by position, each holds its locks from being
+    // queued until it is done here
+    typedef struct {
+        CalvinTxn txn;
+        rrr::i32 seq_sid;
+        TxnChopper *ch;
+        std::set<rrr::i32> sids; // servers running its pieces
+        std::map<std::string, bool> locks; // key, exclusive
+        bool granted;
+        rrr::i32 res;
+        // its writes here, taken back if it is rejected anywhere
+        mdb::TxnUnsafe::undo_log_t undo;
+    } calvin_txn_t;
+    std::map<rrr::i64, calvin_txn_t> calvin_queue_;
+    // lock queues by key in the agreed order, a txn gets a key once no
+    // txn ahead holds it in a conflicting mode. Conflicting txns run in
+    // the same order on every server, the others go around a txn that
+    // waits for another server. Key "" is the whole server.
+    typedef struct {
+        rrr::i64 seq;
+        bool excl;
+    } calvin_lock_t;
+    std::map<std::string, std::deque<calvin_lock_t>> calvin_locks_;
+    // from other servers by position, until the txn here takes them
+    typedef struct {
+        bool rejected = false;
+        std::map<rrr::i32, std::vector<Value>> outputs; // by piece index
+    } calvin_outputs_t;
+    std::map<rrr::i64, calvin_outputs_t> calvin_outputs_;
+
     void do_start_pie(const RequestHeader &header,
             const Value *input,
             rrr::i32 input_size,
@@ -56,6 +130,71 @@ public:
             std::vector<Value>* output,
             rrr::DeferredReply* defer);
 
+    void start_pie_job(const RequestHeader &header,
+            const std::vector<Value>& input,
+            const rrr::i32 &output_size,
+            rrr::i32* res,
+            std::vector<Value>* output,
+            rrr::DeferredReply* defer);
+
+    void piggy_start_pie(const RequestHeader &header,
+            const std::vector<Value>& input,
+            const rrr::i32 &output_size,
+            const std::vector<rrr::i64> &commits,
+            const std::vector<rrr::i64> &aborts,
+            rrr::i32* res,
+            std::vector<Value>* output,
+            rrr::DeferredReply* defer);
+
+    void chain_start_pie(const RequestHeader &header,
+            const rrr::i32 &pi,
+            const std::vector<Value>& input,
+            const rrr::i32 &output_size,
+            const rrr::i32 &n_wait,
+            const std::vector<PieceForward> &forwards,
+            rrr::i32* res,
+            std::vector<Value>* output,
+            rrr::DeferredReply* defer);
+
+    void forward_pie_output(const rrr::i64 &tid,
+            const rrr::i32 &pi,
+            const rrr::i32 &res,
+            const std::map<rrr::i32, Value> &values);
+
+    // caller holds mtx_
+    void chain_input_job(const rrr::i64 &tid,
+            const rrr::i32 &pi,
+            const rrr::i32 &res,
+            const std::map<rrr::i32, Value> &values);
+
+    // caller holds mtx_, runs the piece once nothing is missing
+    void chain_try_run_job(const std::pair<rrr::i64, rrr::i32> &key);
+
+    // caller holds mtx_. runs one piece, done goes off once it ran; a 2PL
+    // piece may wait for its locks first, done then runs later with mtx_
+    // held by whoever let go. PieceProfile and Trace see the wait
+    void run_piece_job(const RequestHeader& header,
+            const std::vector<Value>& input,
+            rrr::i32* res,
+            std::vector<Value>* output,
+            const std::function<void(void)> &done);
+
+    // caller holds mtx_
+    void chain_forward_job(const rrr::i64 &tid,
+            const rrr::i32 &res,
+            const std::vector<Value> &output,
+            const std::vector<PieceForward> &forwards);
+
+    void ro_start_pie(const RequestHeader &header,
+            const std::vector<Value>& input,
+            const rrr::i32 &output_size,
+            const rrr::i64 &snapshot_ts,
+            rrr::i32* res,
+            std::vector<Value>* output,
+            rrr::DeferredReply* defer);
+
+    void ro_end_txn(const rrr::i64 &tid);
+
     void prepare_txn(const rrr::i64& tid,
             const std::vector<i32> &sids,
             rrr::i32* res,
@@ -71,10 +210,90 @@ public:
             rrr::i32* res,
             rrr::DeferredReply* defer);
 
+    rrr::i32 commit_txn_job(const rrr::i64& tid);
+
     void abort_txn(const rrr::i64& tid,
             rrr::i32* res,
             rrr::DeferredReply* defer);
 
+    rrr::i32 abort_txn_job(const rrr::i64& tid);
+
+    void decide_txns(const std::vector<rrr::i64> &commits,
+            const std::vector<rrr::i64> &aborts,
+            rrr::DeferredReply* defer);
+
+    // caller holds mtx_
+    void decide_txns_job(const std::vector<rrr::i64> &commits,
+            const std::vector<rrr::i64> &aborts);
+
+    void one_phase_commit_txn(const rrr::i64& tid,
+            rrr::i32* res,
+            rrr::DeferredReply* defer);
+
+    void one_shot_txn(const RequestHeader &header,
+            const std::vector<Value> &input,
+            rrr::i32* res,
+            rrr::DeferredReply* defer);
+
+    // caller holds mtx_, start the ready pieces, end the txn once none
+    // is left running
+    void one_shot_run_job(one_shot_t *os);
+
+    // caller holds mtx_
+    void one_shot_piece_job(one_shot_t *os,
+            int pi,
+            rrr::i32 res,
+            const std::vector<Value> &output);
+
+    // caller holds mtx_
+    void one_shot_end_job(one_shot_t *os);
+
+    void calvin_submit(const RequestHeader &header,
+            const std::vector<Value> &input,
+            rrr::i32* res,
+            rrr::DeferredReply* defer);
+
+    void calvin_batch(const rrr::i32 &sid,
+            const rrr::i64 &epoch,
+            const std::vector<CalvinTxn> &txns);
+
+    void calvin_output(const rrr::i64 &seq,
+            const rrr::i32 &pi,
+            const rrr::i32 &res,
+            const std::vector<Value> &output);
+
+    void calvin_done(const rrr::i64 &tid, const rrr::i32 &res);
+
+    // caller holds mtx_, starts sending this server's epochs
+    void calvin_start_job();
+
+    static void *calvin_epoch_loop(void *arg);
+
+    // caller holds mtx_, give the txn the next position and queue its
+    // locks if it runs here
+    void calvin_queue_job(const CalvinTxn &txn, rrr::i32 seq_sid);
+
+    // caller holds mtx_, run whatever the locks and outputs let run
+    void calvin_run_job();
+
+    // caller holds mtx_
+    bool calvin_granted_job(rrr::i64 seq, const calvin_txn_t &t);
+
+    // caller holds mtx_, return: the txn holds the locks piece pi needs
+    bool calvin_locked_job(const calvin_txn_t &t, int pi);
+
+    // caller holds mtx_, return: the txn is done here
+    bool calvin_step_job(rrr::i64 seq, calvin_txn_t &t);
+
+    // caller holds mtx_, piece pi failed, the txn ends everywhere
+    void calvin_reject_job(rrr::i64 seq, calvin_txn_t &t, int pi);
+
+    // caller holds mtx_, release the locks and report to the sequencer
+    void calvin_end_job(rrr::i64 seq, calvin_txn_t &t);
+
+    // caller holds mtx_
+    void calvin_done_job(const rrr::i64 &tid, rrr::i32 res);
+
 #ifdef PIECE_COUNT
     typedef struct piece_count_key_t{
         i32 t_type;
@@ -102,6 +321,8 @@ public:
 
     RococoServiceImpl(ServerControlServiceImpl *scsi = NULL);
 
+    virtual ~RococoServiceImpl();
+
     void rcc_batch_start_pie(
             const std::vector<RequestHeader> &headers,
             const std::vector<std::vector<Value>> &inputs,
@@ -130,6 +351,8 @@ public:
             vector<Value> *output,
             rrr::DeferredReply *reply);
 
+    void rcc_ro_end_txn(const rrr::i64 &tid);
+
     uint64_t n_asking_ = 0;
 };
 
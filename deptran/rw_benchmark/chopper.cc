@@ -70,6 +70,11 @@ bool RWChopper::is_read_only() {
         verify(0);
 }
 
+bool RWChopper::lock_keys(int pi, std::set<std::string> *keys) {
+    keys->insert(lock_key(RW_BENCHMARK_TABLE, inputs_[pi][0]));
+    return true;
+}
+
 void RWChopper::retry() {
     status_ = {0};
     commit_.store(true);
@@ -23,6 +23,8 @@ public:
 
     virtual bool is_read_only();
 
+    virtual bool lock_keys(int pi, std::set<std::string> *keys);
+
     virtual void retry();
 
     virtual ~RWChopper();
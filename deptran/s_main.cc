@@ -5,58 +5,12 @@
 
 using namespace rococo;
 
-extern rrr::PollMgr *poll_mgr_g;
-
 
 static ServerControlServiceImpl *scsi = NULL;
 static rrr::PollMgr *hb_poll_mgr = NULL;
 static rrr::Server *hb_server = NULL;
 static base::ThreadPool *hb_thread_pool = NULL;
 
-static int pop_table(uint32_t sid) {
-    int ret = 0;
-    // get all tables
-    std::vector<std::string> table_names;
-    if (0 >= (ret = Sharding::get_table_names(sid, table_names)))
-        return ret;
-
-    int running_mode = Config::get_config()->get_mode();
-    // set running mode
-    TxnRunner::init(running_mode);
-
-    std::vector<std::string>::iterator table_it = table_names.begin();
-
-    for (; table_it != table_names.end(); table_it++) {
-        mdb::Schema *schema = new mdb::Schema();
-        mdb::symbol_t symbol;
-        Sharding::init_schema(*table_it, schema, &symbol);
-        mdb::Table *tb;
-        switch(symbol) {
-            case mdb::TBL_SORTED:
-                tb = new mdb::SortedTable(schema);
-                break;
-            case mdb::TBL_UNSORTED:
-                tb = new mdb::UnsortedTable(schema);
-                break;
-            case mdb::TBL_SNAPSHOT:
-                tb = new mdb::SnapshotTable(schema);
-                break;
-            default:
-                verify(0);
-        }
-        TxnRunner::reg_table(*table_it, tb);
-    }
-    Sharding::populate_table(table_names, sid);
-    return ret;
-}
-
-static void reg_piece() {
-    Piece *piece = Piece::get_piece(Config::get_config()->get_benchmark());
-    piece->reg_all();
-    delete piece;
-    piece = NULL;
-}
-
 static void run_scsi() {
     //ServerControlServiceImpl *scsi = NULL;
     scsi = new ServerControlServiceImpl(Config::get_config()->get_ctrl_timeout());
@@ -89,68 +43,10 @@ int main(int argc, char *argv[]) {
         run_scsi();
     }
 
-    // populate table
-    ret = pop_table(sid);
-    verify(ret > 0);
-
-    // register piece
-    reg_piece();
-
-    std::string bind_addr;
-    if (0 != (ret = Config::get_config()->get_my_addr(bind_addr))) {
-        return ret;
-    }
-
-    // init service implement
-    auto *rococo_service = new RococoServiceImpl(scsi);
-
-    // init rrr::PollMgr 1 threads
-    int n_io_threads = 1;
-    poll_mgr_g = new rrr::PollMgr(n_io_threads);
-
-    auto &alarm = TimeoutALock::get_alarm_s();
-    poll_mgr_g->add(&alarm);
-
-    // TODO replace below with set_stat
-    auto &recorder = ((RococoServiceImpl*)rococo_service)->recorder_;
-    if (recorder != NULL) {
-        poll_mgr_g->add(recorder);
-    }
-
-    if (scsi) {
-        scsi->set_recorder(recorder);
-        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_SCC,
-                &rococo_service->stat_sz_scc_);
-        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_START,
-                &rococo_service->stat_sz_gra_start_);
-        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_COMMIT,
-                &rococo_service->stat_sz_gra_commit_);
-        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_ASK,
-                &rococo_service->stat_sz_gra_ask_);
-        scsi->set_stat(ServerControlServiceImpl::STAT_N_ASK,
-                &rococo_service->stat_n_ask_);
-    }
-    // TODO replace above with set_stat
-
-
-    // init base::ThreadPool
-    unsigned int num_threads;
-    if (0 != (ret = Config::get_config()->get_threads(num_threads))) {
+    Site site;
+    if (0 != (ret = site.start(sid, scsi))) {
         return ret;
     }
-    base::ThreadPool *thread_pool = new base::ThreadPool(num_threads);
-
-    // init rrr::Server
-    rrr::Server *server = new rrr::Server(poll_mgr_g, thread_pool);
-
-    // reg service
-    server->reg(rococo_service);
-
-    // start rpc server
-    server->start(bind_addr.c_str());
-
-    Log_info("Server ready");
-
 
     if (hb) {
 #ifdef CPU_PROFILE
@@ -166,7 +62,7 @@ int main(int argc, char *argv[]) {
         hb_poll_mgr->release();
         hb_thread_pool->release();
 
-        auto &recorder = ((DepTranServiceImpl*)rococo_service)->recorder_;
+        auto &recorder = site.service_->recorder_;
         if (recorder) {
             auto n_flush_avg_ = recorder->stat_cnt_.peek().avg_;
             auto sz_flush_avg_ = recorder->stat_sz_.peek().avg_;
@@ -186,12 +82,9 @@ int main(int argc, char *argv[]) {
     }
 
     Log::info("asking other server finish request count: %d",
-              ((DepTranServiceImpl*)rococo_service)->n_asking_);
+              site.service_->n_asking_);
 
-    delete server;
-    delete rococo_service;
-    thread_pool->release();
-    poll_mgr_g->release();
+    site.stop();
     TxnRunner::fini();
     RandomGenerator::destroy();
     Config::destroy_config();
@@ -541,12 +541,16 @@ int Sharding::do_tpcc_real_dist_partition_populate_table(
                                             table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                             break;
                                         case MODE_NONE: //FIXME
+                                        case MODE_CALVIN:
                                         case MODE_OCC:
                                             table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
                                             break;
                                         case MODE_DEPTRAN:
                                             table_ptr->insert(DepRow::create(schema, row_data));
                                             break;
+                                        case MODE_ROT:
+                                            table_ptr->insert(DepRow::create(schema, row_data, true));
+                                            break;
                                         default:
                                             verify(0);
                                     }
@@ -571,12 +575,16 @@ int Sharding::do_tpcc_real_dist_partition_populate_table(
                                             table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                             break;
                                         case MODE_NONE: //FIXME
+                                        case MODE_CALVIN:
                                         case MODE_OCC:
                                             table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
                                             break;
                                         case MODE_DEPTRAN:
                                             table_ptr->insert(DepRow::create(schema, row_data));
                                             break;
+                                        case MODE_ROT:
+                                            table_ptr->insert(DepRow::create(schema, row_data, true));
+                                            break;
                                         default:
                                             verify(0);
                                     }
@@ -598,12 +606,16 @@ int Sharding::do_tpcc_real_dist_partition_populate_table(
                                         r = mdb::FineLockedRow::create(schema, row_data);
                                         break;
                                     case MODE_NONE: //FIXME
+                                    case MODE_CALVIN:
                                     case MODE_OCC:
                                         r = mdb::VersionedRow::create(schema, row_data);
                                         break;
                                     case MODE_DEPTRAN:
                                         r = DepRow::create(schema, row_data);
                                         break;
+                                    case MODE_ROT:
+                                        r = DepRow::create(schema, row_data, true);
+                                        break;
                                     default:
                                         verify(0);
                                 }
@@ -636,12 +648,16 @@ int Sharding::do_tpcc_real_dist_partition_populate_table(
                                                 r_buf = mdb::FineLockedRow::create(sch_buf, sec_row_data_buf);
                                                 break;
                                             case MODE_NONE: //FIXME
+                                            case MODE_CALVIN:
                                             case MODE_OCC:
                                                 r_buf = mdb::VersionedRow::create(sch_buf, sec_row_data_buf);
                                                 break;
                                             case MODE_DEPTRAN:
                                                 r_buf = DepRow::create(sch_buf, sec_row_data_buf);
                                                 break;
+                                            case MODE_ROT:
+                                                r_buf = DepRow::create(sch_buf, sec_row_data_buf, true);
+                                                break;
                                             default:
                                                 verify(0);
                                         }
@@ -902,12 +918,16 @@ int Sharding::do_tpcc_dist_partition_populate_table(
                                             table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                             break;
                                         case MODE_NONE: //FIXME
+                                        case MODE_CALVIN:
                                         case MODE_OCC:
                                             table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
                                             break;
                                         case MODE_DEPTRAN:
                                             table_ptr->insert(DepRow::create(schema, row_data));
                                             break;
+                                        case MODE_ROT:
+                                            table_ptr->insert(DepRow::create(schema, row_data, true));
+                                            break;
                                         default:
                                             verify(0);
                                     }
@@ -932,12 +952,16 @@ int Sharding::do_tpcc_dist_partition_populate_table(
                                             table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                             break;
                                         case MODE_NONE: //FIXME
+                                        case MODE_CALVIN:
                                         case MODE_OCC:
                                             table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
                                             break;
                                         case MODE_DEPTRAN:
                                             table_ptr->insert(DepRow::create(schema, row_data));
                                             break;
+                                        case MODE_ROT:
+                                            table_ptr->insert(DepRow::create(schema, row_data, true));
+                                            break;
                                         default:
                                             verify(0);
                                     }
@@ -959,12 +983,16 @@ int Sharding::do_tpcc_dist_partition_populate_table(
                                         r = mdb::FineLockedRow::create(schema, row_data);
                                         break;
                                     case MODE_NONE: //FIXME
+                                    case MODE_CALVIN:
                                     case MODE_OCC:
                                         r = mdb::VersionedRow::create(schema, row_data);
                                         break;
                                     case MODE_DEPTRAN:
                                         r = DepRow::create(schema, row_data);
                                         break;
+                                    case MODE_ROT:
+                                        r = DepRow::create(schema, row_data, true);
+                                        break;
                                     default:
                                         verify(0);
                                 }
@@ -1083,12 +1111,16 @@ int Sharding::do_tpcc_populate_table(const std::vector<std::string> &table_names
                                     table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                     break;
                                 case MODE_NONE: //FIXME
+                                case MODE_CALVIN:
                                 case MODE_OCC:
                                     table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
                                     break;
                                 case MODE_DEPTRAN:
                                     table_ptr->insert(DepRow::create(schema, row_data));
                                     break;
+                                case MODE_ROT:
+                                    table_ptr->insert(DepRow::create(schema, row_data, true));
+                                    break;
                                 default:
                                     verify(0);
                             }
@@ -1249,12 +1281,16 @@ int Sharding::do_tpcc_populate_table(const std::vector<std::string> &table_names
                                         r = mdb::FineLockedRow::create(schema, row_data);
                                         break;
                                     case MODE_NONE: //FIXME
+                                    case MODE_CALVIN:
                                     case MODE_OCC:
                                         r = mdb::VersionedRow::create(schema, row_data);
                                         break;
                                     case MODE_DEPTRAN:
                                         r = DepRow::create(schema, row_data);
                                         break;
+                                    case MODE_ROT:
+                                        r = DepRow::create(schema, row_data, true);
+                                        break;
                                     default:
                                         verify(0);
                                 }
@@ -1287,12 +1323,16 @@ int Sharding::do_tpcc_populate_table(const std::vector<std::string> &table_names
                                                 r_buf = mdb::FineLockedRow::create(sch_buf, sec_row_data_buf);
                                                 break;
                                             case MODE_NONE: //FIXME
+                                            case MODE_CALVIN:
                                             case MODE_OCC:
                                                 r_buf = mdb::VersionedRow::create(sch_buf, sec_row_data_buf);
                                                 break;
                                             case MODE_DEPTRAN:
                                                 r_buf = DepRow::create(sch_buf, sec_row_data_buf);
                                                 break;
+                                            case MODE_ROT:
+                                                r_buf = DepRow::create(sch_buf, sec_row_data_buf, true);
+                                                break;
                                             default:
                                                 verify(0);
                                         }
@@ -1347,6 +1387,9 @@ int Sharding::do_tpcc_populate_table(const std::vector<std::string> &table_names
 
 int Sharding::do_populate_table(const std::vector<std::string> &table_names, unsigned int sid) {
     int mode = Config::get_config()->get_mode();
+    // ycsb records are strings of field_length
+    unsigned int str_len = Config::get_config()->get_benchmark() == YCSB
+        ? Config::get_config()->get_field_length() : 0;
     unsigned int number2populate = tb_info_.size();
     while (number2populate > 0) {
         std::map<std::string, tb_info_t>::iterator tb_it = tb_info_.begin();
@@ -1397,6 +1440,9 @@ int Sharding::do_populate_table(const std::vector<std::string> &table_names, uns
 
                             //std::cerr << tb_info_ptr->columns[col_index].name << "(foreign:" << tb_info_ptr->columns[col_index].foreign->name << "):" << v_buf << "; ";
                         }
+                        else if (str_len > 0 && tb_info_ptr->columns[col_index].type == Value::STR) {
+                            row_data.push_back(random_str_value(str_len));
+                        }
                         else {
                             Value v_buf;
                             // TODO (ycui) use RandomGenerator
@@ -1412,6 +1458,7 @@ int Sharding::do_populate_table(const std::vector<std::string> &table_names, uns
                                 table_ptr->insert(mdb::FineLockedRow::create(schema, row_data));
                                 break;
                             case MODE_NONE:
+                            case MODE_CALVIN:
                             case MODE_RPC_NULL:
                             case MODE_OCC:
                                 table_ptr->insert(mdb::VersionedRow::create(schema, row_data));
@@ -1419,6 +1466,9 @@ int Sharding::do_populate_table(const std::vector<std::string> &table_names, uns
                             case MODE_DEPTRAN:
                                 table_ptr->insert(DepRow::create(schema, row_data));
                                 break;
+                            case MODE_ROT:
+                                table_ptr->insert(DepRow::create(schema, row_data, true));
+                                break;
                             default:
                                 verify(0);
                         }
@@ -1551,6 +1601,17 @@ Value random_value(Value::kind k) {
     }
 }
 
+// one draw a string, the chars come from a cheap lcg off it
+Value random_str_value(int len) {
+    std::string str(len, 'a');
+    uint32_t x = (uint32_t)RandomGenerator::rand();
+    for (int i = 0; i < len; i++) {
+        x = x * 1103515245 + 12345;
+        str[i] = 'a' + (x >> 16) % 26;
+    }
+    return Value(str);
+}
+
 Value value_get_zero(Value::kind k) {
     switch(k) {
         case Value::I32:
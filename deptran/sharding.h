@@ -17,6 +17,7 @@ Value value_get_n(Value::kind k, int n);
 Value &operator ++(Value &lhs);
 Value operator ++(Value &lhs, int);
 Value random_value(Value::kind k);
+Value random_str_value(int len);
 Value value_rr_get_next(const std::string &s, Value::kind k, int max, int start = 0);
 
 int init_index(std::map<unsigned int, std::pair<unsigned int, unsigned int> > &index);
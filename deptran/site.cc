@@ -0,0 +1,139 @@
+#include "all.h"
+
+extern rrr::PollMgr *poll_mgr_g;
+
+namespace rococo {
+
+int Site::pop_table(uint32_t sid) {
+    int ret = 0;
+    // get all tables
+    std::vector<std::string> table_names;
+    if (0 >= (ret = Sharding::get_table_names(sid, table_names)))
+        return ret;
+
+    int running_mode = Config::get_config()->get_mode();
+    // calvin orders conflicting txns with its own locks and runs one
+    // piece at a time, the store needs no concurrency control of its own
+    if (running_mode == MODE_CALVIN)
+        running_mode = MODE_NONE;
+    // set running mode
+    TxnRunner::init(running_mode);
+
+    std::vector<std::string>::iterator table_it = table_names.begin();
+
+    for (; table_it != table_names.end(); table_it++) {
+        mdb::Schema *schema = new mdb::Schema();
+        mdb::symbol_t symbol;
+        Sharding::init_schema(*table_it, schema, &symbol);
+        mdb::Table *tb;
+        switch(symbol) {
+            case mdb::TBL_SORTED:
+                tb = new mdb::SortedTable(schema);
+                break;
+            case mdb::TBL_UNSORTED:
+                tb = new mdb::UnsortedTable(schema);
+                break;
+            case mdb::TBL_SNAPSHOT:
+                tb = new mdb::SnapshotTable(schema);
+                break;
+            default:
+                verify(0);
+        }
+        TxnRunner::reg_table(*table_it, tb);
+    }
+    Sharding::populate_table(table_names, sid);
+    return ret;
+}
+
+void Site::reg_piece() {
+    Piece *piece = Piece::get_piece(Config::get_config()->get_benchmark());
+    piece->reg_all();
+    delete piece;
+    piece = NULL;
+}
+
+int Site::start(uint32_t sid, ServerControlServiceImpl *scsi) {
+    int ret;
+    Config *config = Config::get_config();
+
+    // before any piece is registered, the handlers get wrapped when on
+    PieceProfile::init(config->do_piece_profile());
+    ContentionTracker::init(config->get_contention_top_k(),
+                            config->get_contention_sample(),
+                            config->get_contention_key_cols());
+    Trace::init(config->get_trace_ring(), sid, "site " + std::to_string(sid));
+
+    // populate table
+    ret = pop_table(sid);
+    verify(ret > 0);
+
+    // register piece
+    reg_piece();
+
+    std::string bind_addr;
+    if (0 != (ret = config->get_my_addr(bind_addr)))
+        return ret;
+
+    // init service implement
+    service_ = new RococoServiceImpl(scsi);
+
+    // init rrr::PollMgr 1 threads
+    int n_io_threads = 1;
+    poll_mgr_g = new rrr::PollMgr(n_io_threads);
+
+    auto &alarm = TimeoutALock::get_alarm_s();
+    poll_mgr_g->add(&alarm);
+
+    // TODO replace below with set_stat
+    auto &recorder = service_->recorder_;
+    if (recorder != NULL) {
+        poll_mgr_g->add(recorder);
+    }
+
+    if (scsi) {
+        scsi->set_recorder(recorder);
+        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_SCC,
+                &service_->stat_sz_scc_);
+        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_START,
+                &service_->stat_sz_gra_start_);
+        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_COMMIT,
+                &service_->stat_sz_gra_commit_);
+        scsi->set_stat(ServerControlServiceImpl::STAT_SZ_GRAPH_ASK,
+                &service_->stat_sz_gra_ask_);
+        scsi->set_stat(ServerControlServiceImpl::STAT_N_ASK,
+                &service_->stat_n_ask_);
+    }
+    // TODO replace above with set_stat
+
+    // init base::ThreadPool
+    unsigned int num_threads;
+    if (0 != (ret = config->get_threads(num_threads)))
+        return ret;
+    thread_pool_ = new base::ThreadPool(num_threads);
+
+    // init rrr::Server
+    server_ = new rrr::Server(poll_mgr_g, thread_pool_);
+
+    // reg service
+    server_->reg(service_);
+
+    // start rpc server
+    server_->start(bind_addr.c_str());
+
+    Log_info("site %u ready on %s", sid, bind_addr.c_str());
+    return 0;
+}
+
+void Site::stop() {
+    delete server_;
+    server_ = NULL;
+    delete service_;
+    service_ = NULL;
+    if (thread_pool_)
+        thread_pool_->release();
+    thread_pool_ = NULL;
+    poll_mgr_g->release();
+    poll_mgr_g = NULL;
+}
+
+} // namespace rococo
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace rococo {
+
+/**
+ * Setup every site does before it serves, whether it runs alone in
+ * deptran_server or as one of the sites of deptran_harness.
+ */
+class Site {
+public:
+    /** create the tables sid holds and populate them; return: number of
+     *  tables, not positive on error */
+    static int pop_table(uint32_t sid);
+
+    /** register the pieces of the benchmark in the config */
+    static void reg_piece();
+
+    /** set up the profilers, the tables and the pieces of sid, then serve
+     *  on its address in the config; scsi, if any, gets the stats.
+     *  return: 0, or the error of the config */
+    int start(uint32_t sid, ServerControlServiceImpl *scsi);
+
+    /** stop serving, free what start made */
+    void stop();
+
+    RococoServiceImpl *service_ = NULL;
+
+private:
+    base::ThreadPool *thread_pool_ = NULL;
+    rrr::Server *server_ = NULL;
+};
+
+} // namespace rococo
@@ -0,0 +1,186 @@
+#include "all.h"
+
+namespace deptran {
+
+SmallbankChopper::SmallbankChopper() {
+}
+
+void SmallbankChopper::add_piece(int p_type, const char *table,
+        const std::vector<Value> &input, int output_size, int status) {
+    inputs_.push_back(input);
+    output_size_.push_back(output_size);
+    p_types_.push_back(p_type);
+    tables_.push_back(table);
+    sharding_.push_back(0);
+    Sharding::get_site_id(table, input[0], sharding_.back());
+    status_.push_back(status);
+}
+
+void SmallbankChopper::amalgamate_init(TxnRequest &req) {
+    // piece 0, Ri & W savings of c0
+    add_piece(SMALLBANK_AMALGAMATE_0, SMALLBANK_SAVINGS, {req.input_[0]}, 1, 0);
+    // piece 1, Ri & W checking of c0
+    add_piece(SMALLBANK_AMALGAMATE_1, SMALLBANK_CHECKING, {req.input_[0]}, 1, 0);
+    // piece 2, W checking of c1, depends on piece 0 & 1
+    add_piece(SMALLBANK_AMALGAMATE_2, SMALLBANK_CHECKING, {
+            req.input_[1],  // 0 ==> c1
+            Value((i64)0),  // 1 ==> savings of c0, depends on piece 0
+            Value((i64)0)   // 2 ==> checking of c0, depends on piece 1
+            }, 0, -1);
+    chain(0, 0, 2, 1);
+    chain(1, 0, 2, 2);
+    amalgamate_in_[0] = false;
+    amalgamate_in_[1] = false;
+}
+
+void SmallbankChopper::balance_init(TxnRequest &req) {
+    add_piece(SMALLBANK_BALANCE_0, SMALLBANK_SAVINGS, {req.input_[0]}, 1, 0);
+    add_piece(SMALLBANK_BALANCE_1, SMALLBANK_CHECKING, {req.input_[0]}, 1, 0);
+}
+
+void SmallbankChopper::send_payment_init(TxnRequest &req) {
+    Value amount = req.input_[2];
+    add_piece(SMALLBANK_SEND_PAYMENT_0, SMALLBANK_CHECKING,
+            {req.input_[0], Value(-amount.get_i64())}, 0, 0);
+    add_piece(SMALLBANK_SEND_PAYMENT_0, SMALLBANK_CHECKING,
+            {req.input_[1], amount}, 0, 0);
+}
+
+void SmallbankChopper::write_check_init(TxnRequest &req) {
+    // piece 0, Ri savings
+    add_piece(SMALLBANK_WRITE_CHECK_0, SMALLBANK_SAVINGS, {req.input_[0]}, 1, 0);
+    // piece 1, R & W checking, depends on piece 0
+    add_piece(SMALLBANK_WRITE_CHECK_1, SMALLBANK_CHECKING, {
+            req.input_[0],  // 0 ==> c
+            req.input_[1],  // 1 ==> amount
+            Value((i64)0)   // 2 ==> savings, depends on piece 0
+            }, 0, -1);
+    chain(0, 0, 1, 2);
+}
+
+void SmallbankChopper::init(TxnRequest &req) {
+    txn_type_ = req.txn_type_;
+    callback_ = req.callback_;
+    max_try_ = req.n_try_;
+    n_try_ = 1;
+    commit_.store(true);
+
+    inputs_.clear();
+    output_size_.clear();
+    p_types_.clear();
+    tables_.clear();
+    sharding_.clear();
+    status_.clear();
+    switch (req.txn_type_) {
+        case SMALLBANK_AMALGAMATE:
+            amalgamate_init(req);
+            break;
+        case SMALLBANK_BALANCE:
+            balance_init(req);
+            break;
+        case SMALLBANK_DEPOSIT_CHECKING:
+            add_piece(SMALLBANK_DEPOSIT_CHECKING_0, SMALLBANK_CHECKING,
+                    req.input_, 0, 0);
+            break;
+        case SMALLBANK_SEND_PAYMENT:
+            send_payment_init(req);
+            break;
+        case SMALLBANK_TRANSACT_SAVINGS:
+            add_piece(SMALLBANK_TRANSACT_SAVINGS_0, SMALLBANK_SAVINGS,
+                    req.input_, 0, 0);
+            break;
+        case SMALLBANK_WRITE_CHECK:
+            write_check_init(req);
+            break;
+        default:
+            verify(0);
+    }
+    n_pieces_ = inputs_.size();
+}
+
+bool SmallbankChopper::amalgamate_callback(int pi, int res,
+        const Value *output, uint32_t output_size) {
+    if (pi != 0 && pi != 1)
+        return false;
+    verify(output_size == 1);
+    // piece 2 shipped chained is out already, leave it alone
+    inputs_[2][pi + 1] = output[0];
+    amalgamate_in_[pi] = true;
+    if (amalgamate_in_[0] && amalgamate_in_[1] && status_[2] == -1) {
+        status_[2] = 0;
+        return true;
+    }
+    return false;
+}
+
+bool SmallbankChopper::write_check_callback(int pi, int res,
+        const Value *output, uint32_t output_size) {
+    if (pi != 0)
+        return false;
+    verify(output_size == 1);
+    inputs_[1][2] = output[0];
+    if (status_[1] == -1) {
+        status_[1] = 0;
+        return true;
+    }
+    return false;
+}
+
+bool SmallbankChopper::callback(int pi, int res, const Value *output,
+        uint32_t output_size) {
+    switch (txn_type_) {
+        case SMALLBANK_AMALGAMATE:
+            return amalgamate_callback(pi, res, output, output_size);
+        case SMALLBANK_WRITE_CHECK:
+            return write_check_callback(pi, res, output, output_size);
+        default:
+            return false;
+    }
+}
+
+bool SmallbankChopper::start_callback(int pi, int res, const std::vector<mdb::Value> &output) {
+    return callback(pi, res, output.data(), output.size());
+}
+
+bool SmallbankChopper::start_callback(const std::vector<int> &pi, int res, BatchStartArgsHelper &bsah) {
+    rrr::i32 res_buf;
+    const Value *output;
+    uint32_t output_size;
+    bool ret = false;
+    int i = 0;
+    while (0 == bsah.get_next_output_client(&res_buf, &output, &output_size)) {
+        if (callback(pi[i], res_buf, output, output_size))
+            ret = true;
+        i++;
+    }
+    return ret;
+}
+
+bool SmallbankChopper::is_read_only() {
+    return txn_type_ == SMALLBANK_BALANCE;
+}
+
+bool SmallbankChopper::lock_keys(int pi, std::set<std::string> *keys) {
+    keys->insert(lock_key(tables_[pi], inputs_[pi][0]));
+    return true;
+}
+
+void SmallbankChopper::retry() {
+    n_started_ = 0;
+    n_prepared_ = 0;
+    n_finished_ = 0;
+    status_.assign(n_pieces_, 0);
+    // the pieces waiting for others, as in init
+    for (auto &c : chains_)
+        status_[c.to_pi] = -1;
+    amalgamate_in_[0] = false;
+    amalgamate_in_[1] = false;
+    commit_.store(true);
+    proxies_.clear();
+    n_try_++;
+}
+
+SmallbankChopper::~SmallbankChopper() {
+}
+
+} // namespace deptran
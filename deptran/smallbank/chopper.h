@@ -0,0 +1,52 @@
+#pragma once
+
+#include "coordinator.h"
+
+namespace deptran {
+
+class SmallbankChopper : public TxnChopper {
+private:
+    // amalgamate: which of the balances of c0 are in
+    bool amalgamate_in_[2];
+    // table of each piece, the customer id is its input 0
+    std::vector<const char *> tables_;
+
+    void add_piece(int p_type, const char *table, const std::vector<Value> &input,
+            int output_size, int status);
+
+    void amalgamate_init(TxnRequest &req);
+
+    void balance_init(TxnRequest &req);
+
+    void send_payment_init(TxnRequest &req);
+
+    void write_check_init(TxnRequest &req);
+
+    bool amalgamate_callback(int pi, int res, const Value *output,
+            uint32_t output_size);
+
+    bool write_check_callback(int pi, int res, const Value *output,
+            uint32_t output_size);
+
+    bool callback(int pi, int res, const Value *output, uint32_t output_size);
+
+public:
+    SmallbankChopper();
+
+    virtual void init(TxnRequest &req);
+
+    virtual bool start_callback(const std::vector<int> &pi, int res, BatchStartArgsHelper &bsah);
+
+    virtual bool start_callback(int pi, int res, const std::vector<mdb::Value> &output);
+
+    virtual bool is_read_only();
+
+    virtual bool lock_keys(int pi, std::set<std::string> *keys);
+
+    virtual void retry();
+
+    virtual ~SmallbankChopper();
+
+};
+
+} // namespace deptran
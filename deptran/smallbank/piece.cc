@@ -0,0 +1,224 @@
+#include "all.h"
+
+namespace deptran {
+
+char SMALLBANK_SAVINGS[] = "savings";
+char SMALLBANK_CHECKING[] = "checking";
+
+// column of the balance, the customer id is the key
+#define SMALLBANK_BAL 1
+
+static mdb::Row *smallbank_row(mdb::Txn *txn, char *table, const Value &c_id,
+        bool retrieve, i64 pid) {
+    mdb::ResultSet rs = txn->query(txn->get_table(table), c_id, retrieve, pid);
+    verify(rs.has_next());
+    return rs.next();
+}
+
+// 2pl first run: the one lock a smallbank piece takes
+static void smallbank_lock(const RequestHeader &header, const Value *input,
+        i32 input_size, i32 *res, mdb::Txn *txn, mdb::Row *r,
+        ALock::type_t type) {
+    mdb::Txn2PL::PieceStatus *ps
+        = ((mdb::Txn2PL *)txn)->get_piece_status(header.pid);
+    ps->reg_rw_lock(
+            std::vector<mdb::column_lock_t>({
+                mdb::column_lock_t(r, SMALLBANK_BAL, type)
+                }),
+            TPL::get_2pl_succ_callback(header, input, input_size, res, ps),
+            TPL::get_2pl_fail_callback(header, res, ps));
+}
+
+// input: c_id; output: bal, zeroed after the read if zero. Runs at once
+// under deptran, read only txns included
+static TxnHandler smallbank_read(char *table, bool zero) {
+    return [table, zero] (const RequestHeader& header,
+            const Value *input,
+            rrr::i32 input_size,
+            rrr::i32* res,
+            Value* output,
+            rrr::i32 *output_size,
+            row_map_t *row_map,
+            Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(row_map == NULL);
+        verify(input_size == 1);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        i32 output_index = 0;
+        Value buf;
+
+        mdb::Row *r = smallbank_row(txn, table, input[0], output_size != NULL,
+                header.pid);
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            smallbank_lock(header, input, input_size, res, txn, r,
+                    zero ? ALock::WLOCK : ALock::RLOCK);
+            return;
+        }
+
+        if (pv)
+            ((DepRow *)r)->get_dep_entry(SMALLBANK_BAL)->touch(tv, true);
+        else if (conflict_txns)
+            ((DepRow *)r)->get_dep_entry(SMALLBANK_BAL)->ro_touch(conflict_txns);
+
+        if (!txn->read_column(r, SMALLBANK_BAL, &buf)) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+        output[output_index++] = buf;
+        if (zero && !txn->write_column(r, SMALLBANK_BAL, Value((i64)0))) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    };
+}
+
+// input: c_id, then the amounts to add to bal, any sign. Commutes with
+// the other adds under deptran and 2pl alike
+static TxnHandler smallbank_add(char *table) {
+    return [table] (const RequestHeader& header,
+            const Value *input,
+            rrr::i32 input_size,
+            rrr::i32* res,
+            Value* output,
+            rrr::i32 *output_size,
+            row_map_t *row_map,
+            Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(input_size >= 2);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        i32 output_index = 0;
+        mdb::Row *r = NULL;
+
+        if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
+            r = smallbank_row(txn, table, input[0], output_size != NULL,
+                    header.pid);
+        }
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            smallbank_lock(header, input, input_size, res, txn, r,
+                    ALock::WLOCK);
+            return;
+        }
+
+        if (row_map) { // deptran
+            if (pv) { // start req
+                (*row_map)[table][r->get_key()] = r;
+                ((DepRow *)r)->get_dep_entry(SMALLBANK_BAL)->touch_add(tv, false);
+                return;
+            }
+            r = row_map->begin()->second.begin()->second;
+            verify(r != NULL);
+        }
+
+        i64 delta = 0;
+        for (i32 i = 1; i < input_size; i++)
+            delta += input[i].get_i64();
+        if (!txn->add_column(r, SMALLBANK_BAL, Value(delta))) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    };
+}
+
+void SmallbankPiece::reg_all() {
+    reg_pieces();
+}
+
+void SmallbankPiece::reg_pieces() {
+    // amalgamate: move all of c0's money into c1's checking
+    TxnRegistry::reg(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_0, DF_NO,
+            smallbank_read(SMALLBANK_SAVINGS, true));
+    TxnRegistry::reg(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_1, DF_NO,
+            smallbank_read(SMALLBANK_CHECKING, true));
+    // input: c1, savings of c0, checking of c0
+    TxnRegistry::reg(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_2, DF_REAL,
+            smallbank_add(SMALLBANK_CHECKING));
+
+    TxnRegistry::reg(SMALLBANK_BALANCE, SMALLBANK_BALANCE_0, DF_NO,
+            smallbank_read(SMALLBANK_SAVINGS, false));
+    TxnRegistry::reg(SMALLBANK_BALANCE, SMALLBANK_BALANCE_1, DF_NO,
+            smallbank_read(SMALLBANK_CHECKING, false));
+
+    TxnRegistry::reg(SMALLBANK_DEPOSIT_CHECKING, SMALLBANK_DEPOSIT_CHECKING_0,
+            DF_REAL, smallbank_add(SMALLBANK_CHECKING));
+
+    // input: c, -amount for the payer and amount for the payee
+    TxnRegistry::reg(SMALLBANK_SEND_PAYMENT, SMALLBANK_SEND_PAYMENT_0,
+            DF_REAL, smallbank_add(SMALLBANK_CHECKING));
+
+    TxnRegistry::reg(SMALLBANK_TRANSACT_SAVINGS, SMALLBANK_TRANSACT_SAVINGS_0,
+            DF_REAL, smallbank_add(SMALLBANK_SAVINGS));
+
+    TxnRegistry::reg(SMALLBANK_WRITE_CHECK, SMALLBANK_WRITE_CHECK_0, DF_NO,
+            smallbank_read(SMALLBANK_SAVINGS, false));
+
+    // input: c, amount, savings of c; a check that overdraws savings and
+    // checking together costs one more
+    TxnRegistry::reg(SMALLBANK_WRITE_CHECK, SMALLBANK_WRITE_CHECK_1, DF_REAL,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(input_size == 3);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        i32 output_index = 0;
+        mdb::Row *r = NULL;
+        Value buf;
+
+        if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
+            r = smallbank_row(txn, SMALLBANK_CHECKING, input[0],
+                    output_size != NULL, header.pid);
+        }
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            smallbank_lock(header, input, input_size, res, txn, r,
+                    ALock::WLOCK);
+            return;
+        }
+
+        if (row_map) { // deptran
+            if (pv) { // start req
+                (*row_map)[SMALLBANK_CHECKING][r->get_key()] = r;
+                ((DepRow *)r)->get_dep_entry(SMALLBANK_BAL)->touch(tv, false);
+                return;
+            }
+            r = row_map->begin()->second.begin()->second;
+            verify(r != NULL);
+        }
+
+        if (!txn->read_column(r, SMALLBANK_BAL, &buf)) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+        i64 amount = input[1].get_i64();
+        if (input[2].get_i64() + buf.get_i64() < amount)
+            amount++;
+        buf.set_i64(buf.get_i64() - amount);
+        if (!txn->write_column(r, SMALLBANK_BAL, buf)) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef SMALLBANK_PIECE_H_
+#define SMALLBANK_PIECE_H_
+
+#include "all.h"
+
+namespace deptran {
+
+extern char SMALLBANK_SAVINGS[];
+extern char SMALLBANK_CHECKING[];
+
+// every account a row of savings and one of checking, both keyed by the
+// customer id, bal column 1
+#define SMALLBANK_AMALGAMATE            1
+#define SMALLBANK_BALANCE               2
+#define SMALLBANK_DEPOSIT_CHECKING      3
+#define SMALLBANK_SEND_PAYMENT          4
+#define SMALLBANK_TRANSACT_SAVINGS      5
+#define SMALLBANK_WRITE_CHECK           6
+#define SMALLBANK_AMALGAMATE_NAME       "AMALGAMATE"
+#define SMALLBANK_BALANCE_NAME          "BALANCE"
+#define SMALLBANK_DEPOSIT_CHECKING_NAME "DEPOSIT_CHECKING"
+#define SMALLBANK_SEND_PAYMENT_NAME     "SEND_PAYMENT"
+#define SMALLBANK_TRANSACT_SAVINGS_NAME "TRANSACT_SAVINGS"
+#define SMALLBANK_WRITE_CHECK_NAME      "WRITE_CHECK"
+
+#define SMALLBANK_AMALGAMATE_0          10  // Ri & W savings, c0
+#define SMALLBANK_AMALGAMATE_1          11  // Ri & W checking, c0
+#define SMALLBANK_AMALGAMATE_2          12  // W checking, c1, depends on 0 & 1
+#define SMALLBANK_BALANCE_0             20  // R savings
+#define SMALLBANK_BALANCE_1             21  // R checking
+#define SMALLBANK_DEPOSIT_CHECKING_0    30  // W checking
+#define SMALLBANK_SEND_PAYMENT_0        40  // W checking, once per customer
+#define SMALLBANK_TRANSACT_SAVINGS_0    50  // W savings
+#define SMALLBANK_WRITE_CHECK_0         60  // Ri savings
+#define SMALLBANK_WRITE_CHECK_1         61  // R & W checking, depends on 0
+
+class SmallbankPiece : public Piece {
+
+public:
+
+    void reg_all();
+
+    void reg_pieces();
+};
+
+}
+
+#endif // SMALLBANK_PIECE_H_
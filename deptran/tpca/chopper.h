@@ -55,6 +55,12 @@ public:
 
     virtual bool is_read_only() { return false; }
 
+    virtual bool lock_keys(int pi, std::set<std::string> *keys) {
+        static const char *tables[] = {TPCA_CUSTOMER, TPCA_TELLER, TPCA_BRANCH};
+        keys->insert(lock_key(tables[pi], inputs_[pi][0]));
+        return true;
+    }
+
     virtual void retry() {
         n_started_ = 0;
         n_prepared_ = 0;
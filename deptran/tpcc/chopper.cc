@@ -199,7 +199,9 @@ void TpccChopper::new_order_init(TxnRequest &req) {
                 req.input_[5 + 3 * i],  // 5 ==> ol_supply_w_id
                 Value(std::string()),   // 6 ==> ol_deliver_d
                 req.input_[6 + 3 * i],  // 7 ==> ol_quantity
-                Value((double)0.0),     // 8 ==> ol_amount  depends on piece 5+3*i
+                Value((double)0.0),     // 8 ==> i_price, the piece turns it
+                                        //       into ol_amount. depends on
+                                        //       piece 5+3*i
                 Value(std::string()),   // 9 ==> ol_dist_info depends on piece 6+3*i
                 });
         output_size_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)] = 0;
@@ -207,6 +209,11 @@ void TpccChopper::new_order_init(TxnRequest &req) {
         new_order_shard(TPCC_TB_ORDER_LINE, req.input_,// sharding based on ol_w_id
                 sharding_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)]);
         status_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)] = -1;
+        chain(0, 1, TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i), 2);
+        chain(TPCC_NEW_ORDER_Ith_INDEX_ITEM(i), 1,
+              TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i), 8);
+        chain(TPCC_NEW_ORDER_Ith_INDEX_IM_STOCK(i), 0,
+              TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i), 9);
     }
     // piece 3, W order, depends on piece 0
     inputs_[3] = std::vector<Value>({
@@ -223,6 +230,7 @@ void TpccChopper::new_order_init(TxnRequest &req) {
     new_order_shard(TPCC_TB_ORDER, req.input_, // sharding based on o_w_id
             sharding_[3]);
     status_[3] = -1;
+    chain(0, 1, 3, 0);
 
     // piece 4, W new_order, depends on piece 0
     inputs_[4] = std::vector<Value>({
@@ -235,6 +243,7 @@ void TpccChopper::new_order_init(TxnRequest &req) {
     new_order_shard(TPCC_TB_NEW_ORDER, req.input_, // sharding based on no_w_id
             sharding_[4]);
     status_[4] = -1;
+    chain(0, 1, 4, 0);
 }
 
 bool TpccChopper::new_order_callback(int pi, int res, 
@@ -242,25 +251,29 @@ bool TpccChopper::new_order_callback(int pi, int res,
 
     if (pi == 0) { // piece 0 started, set piece 3, piece 4, piece 8+4i.0
         new_order_dep_.piece_0_dist = true;
+        // pieces shipped chained are out already, leave them alone
         Value o_id = output[1];
         inputs_[3][0] = o_id;
-        status_[3] = 0;
+        if (status_[3] == -1)
+            status_[3] = 0;
         inputs_[4][0] = o_id;
-        status_[4] = 0;
+        if (status_[4] == -1)
+            status_[4] = 0;
 
         for (size_t i = 0; i < new_order_dep_.ol_cnt; i++) {
             inputs_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)][2] = o_id;
-            if (new_order_dep_.piece_items[i] && new_order_dep_.piece_stocks[i])
+            if (new_order_dep_.piece_items[i] && new_order_dep_.piece_stocks[i]
+                    && status_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)] == -1)
                 status_[TPCC_NEW_ORDER_Ith_INDEX_ORDER_LINE(i)] = 0;
         }
 
         return true;
     }
     else if (TPCC_NEW_ORDER_IS_ITEM_INDEX(pi)) { // piece 5+4i started, set piece 8+4i.8
-        inputs_[TPCC_NEW_ORDER_INDEX_ITEM_TO_ORDER_LINE(pi)][8]
-            = Value((double)(output[1].get_double() * inputs_[TPCC_NEW_ORDER_INDEX_ITEM_TO_DEFER_STOCK(pi)][2].get_i32()));
+        inputs_[TPCC_NEW_ORDER_INDEX_ITEM_TO_ORDER_LINE(pi)][8] = output[1];
         new_order_dep_.piece_items[TPCC_NEW_ORDER_INDEX_ITEM_TO_CNT(pi)] = true;
-        if (new_order_dep_.piece_0_dist && new_order_dep_.piece_stocks[TPCC_NEW_ORDER_INDEX_ITEM_TO_CNT(pi)]) {
+        if (new_order_dep_.piece_0_dist && new_order_dep_.piece_stocks[TPCC_NEW_ORDER_INDEX_ITEM_TO_CNT(pi)]
+                && status_[TPCC_NEW_ORDER_INDEX_ITEM_TO_ORDER_LINE(pi)] == -1) {
             status_[TPCC_NEW_ORDER_INDEX_ITEM_TO_ORDER_LINE(pi)] = 0;
             return true;
         }
@@ -270,7 +283,8 @@ bool TpccChopper::new_order_callback(int pi, int res,
     else if (TPCC_NEW_ORDER_IS_IM_STOCK_INDEX(pi)) { // piece 6+4i started, set piece 8+4i.9
         inputs_[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_ORDER_LINE(pi)][9] = output[0];
         new_order_dep_.piece_stocks[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_CNT(pi)] = true;
-        if (new_order_dep_.piece_0_dist && new_order_dep_.piece_items[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_CNT(pi)]) {
+        if (new_order_dep_.piece_0_dist && new_order_dep_.piece_items[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_CNT(pi)]
+                && status_[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_ORDER_LINE(pi)] == -1) {
             status_[TPCC_NEW_ORDER_INDEX_IM_STOCK_TO_ORDER_LINE(pi)] = 0;
             return true;
         }
@@ -981,16 +995,12 @@ void TpccChopper::delivery_retry() {
 }
 
 void TpccChopper::stock_level_shard(const char *tb, const std::vector<mdb::Value> &input, uint32_t &site) {
-    MultiValue mv;
-    if (tb == TPCC_TB_DISTRICT
-     || tb == TPCC_TB_ORDER_LINE)
-        // based on w_id
-        mv = MultiValue(input[0]);
-    else if (tb == TPCC_TB_STOCK)
-        // based on s_w_id
-        mv = MultiValue(input[1]);
-    else
-        verify(0);
+    // based on w_id, s_w_id for stock, input 0 either way. The stock input
+    // is s_w_id, threshold, s_i_id
+    verify(tb == TPCC_TB_DISTRICT
+        || tb == TPCC_TB_ORDER_LINE
+        || tb == TPCC_TB_STOCK);
+    MultiValue mv(input[0]);
     int ret = Sharding::get_site_id(tb, mv, site);
     verify(ret == 0);
 }
@@ -1033,7 +1043,7 @@ void TpccChopper::stock_level_init(TxnRequest &req) {
     stock_level_shard(TPCC_TB_ORDER_LINE, req.input_, sharding_[1]);
     status_[1] = -1;
 
-    // piece 2 - n, R stock init in stock_level_callback
+    // piece 2 - n, R stock per stock site, init in stock_level_callback
 }
 
 bool TpccChopper::stock_level_callback(int pi, int res, const Value *output, uint32_t output_size) {
@@ -1050,24 +1060,39 @@ bool TpccChopper::stock_level_callback(int pi, int res, const Value *output, uin
         std::unordered_set<i32> s_i_ids;
         for (int i = 0; i < output_size; i++)
             s_i_ids.insert(output[i].get_i32());
-        n_pieces_ += s_i_ids.size();
+        // one piece per stock site reads all of its stocks, with s_w_id
+        // sharding that is a single piece
+        std::map<uint32_t, std::vector<Value> > site_inputs;
+        std::vector<Value> probe({
+                Value((i32)stock_level_dep_.w_id),      // 0 ==> s_w_id
+                Value((i32)stock_level_dep_.threshold), // 1 ==> threshold
+                Value()                                 // 2 ==> s_i_id
+                });
+        for (auto s_i_id : s_i_ids) {
+            uint32_t site;
+            probe[2] = Value(s_i_id);
+            stock_level_shard(TPCC_TB_STOCK, probe, site);
+            std::vector<Value> &input = site_inputs[site];
+            if (input.empty())
+                input.assign(probe.begin(), probe.begin() + 2);
+            input.push_back(probe[2]);                  // 2... ==> s_i_id
+        }
+        // no order lines, nothing to read
+        if (site_inputs.empty())
+            return false;
+        n_pieces_ = 2 + site_inputs.size();
         inputs_.resize(n_pieces_);
         output_size_.resize(n_pieces_);
         p_types_.resize(n_pieces_);
         sharding_.resize(n_pieces_);
         status_.resize(n_pieces_);
-        int i = 0;
-        for (std::unordered_set<i32>::iterator s_i_ids_it = s_i_ids.begin();
-                s_i_ids_it != s_i_ids.end(); s_i_ids_it++) {
-            inputs_[2 + i] = std::vector<Value>({
-                    Value(*s_i_ids_it),                     // 0 ==> s_i_id
-                    Value((i32)stock_level_dep_.w_id),      // 1 ==> s_w_id
-                    Value((i32)stock_level_dep_.threshold)  // 2 ==> threshold
-                    });
-            output_size_[2 + i] = 1;
-            p_types_[2 + i] = TPCC_STOCK_LEVEL_2;
-            stock_level_shard(TPCC_TB_STOCK, inputs_[2 + i], sharding_[2 + i]);
-            status_[2 + i] = 0;
+        int i = 2;
+        for (auto &it : site_inputs) {
+            inputs_[i] = std::move(it.second);
+            output_size_[i] = 1;
+            p_types_[i] = TPCC_STOCK_LEVEL_2;
+            sharding_[i] = it.first;
+            status_[i] = 0;
             i++;
         }
         return true;
@@ -1132,6 +1157,32 @@ bool TpccChopper::is_read_only() {
     }
 }
 
+bool TpccChopper::lock_keys(int pi, std::set<std::string> *keys) {
+    // every table but item, which is never written, is by warehouse, so
+    // a piece locks the warehouses of its txn
+    keys->insert(lock_key(TPCC_TB_WAREHOUSE, req_input_[0]));
+    switch (txn_type_) {
+        case TPCC_NEW_ORDER: {
+            // ol_supply_w_id of each item
+            int ol_cnt = req_input_[3].get_i32();
+            for (int i = 0; i < ol_cnt; i++)
+                keys->insert(lock_key(TPCC_TB_WAREHOUSE, req_input_[5 + 3 * i]));
+            break;
+        }
+        case TPCC_PAYMENT:
+            // c_w_id
+            keys->insert(lock_key(TPCC_TB_WAREHOUSE, req_input_[3]));
+            break;
+        case TPCC_ORDER_STATUS:
+        case TPCC_DELIVERY:
+        case TPCC_STOCK_LEVEL:
+            break;
+        default:
+            verify(0);
+    }
+    return true;
+}
+
 TpccChopper::~TpccChopper() {
     if (txn_type_ == TPCC_NEW_ORDER) {
         free(new_order_dep_.piece_items);
@@ -359,6 +359,9 @@ void TpccPiece::reg_new_order() {
                         case MODE_DEPTRAN:
                             r = DepRow::create(tbl->schema(), row_data);
                             break;
+                        case MODE_ROT:
+                            r = DepRow::create(tbl->schema(), row_data, true);
+                            break;
                         default:
                             verify(0);
                     }
@@ -514,6 +517,9 @@ void TpccPiece::reg_new_order() {
                         case MODE_DEPTRAN:
                             r = DepRow::create(tbl->schema(), row_data);
                             break;
+                        case MODE_ROT:
+                            r = DepRow::create(tbl->schema(), row_data, true);
+                            break;
                         default:
                             verify(0);
                     }
@@ -828,9 +834,9 @@ void TpccPiece::reg_new_order() {
                         //Log::debug("stock P1: hv: %u, k: %u, r: %p", mdb::MultiBlob::hash()((*row_map)[TPCC_TB_STOCK].begin()->first), mdb::MultiBlob::hash()(cl.primary_key), r);
                         DepRow *dr = (DepRow *)r;
                         dr->get_dep_entry(2)->touch(tv, false);
-                        dr->get_dep_entry(13)->touch(tv, false);
-                        dr->get_dep_entry(14)->touch(tv, false);
-                        dr->get_dep_entry(15)->touch(tv, false);
+                        dr->get_dep_entry(13)->touch_add(tv, false);
+                        dr->get_dep_entry(14)->touch_add(tv, false);
+                        dr->get_dep_entry(15)->touch_add(tv, false);
                         do_finish = false;
                     } else {
                         //r = (*row_map)[TPCC_TB_STOCK][cl.primary_key];
@@ -851,42 +857,22 @@ void TpccPiece::reg_new_order() {
                     }
                     new_ol_quantity = buf.get_i32() - input[2].get_i32();
 
-                    if (!txn->read_column(r, 13, &buf)) {
-                        *res = REJECT;
-                        *output_size = output_index;
-                        return;
-                    }
-                    Value new_s_ytd(buf.get_i32() + input[2].get_i32());
+                    if (new_ol_quantity < 10)
+                        new_ol_quantity += 91;
+                    Value new_ol_quantity_value(new_ol_quantity);
 
-                    if (!txn->read_column(r, 14, &buf)) {
+                    // W stock, s_quantity
+                    if (!txn->write_column(r, 2, new_ol_quantity_value)) {
                         *res = REJECT;
                         *output_size = output_index;
                         return;
                     }
-                    Value new_s_order_cnt((i32)(buf.get_i32() + 1));
 
-                    if (!txn->read_column(r, 15, &buf)) {
-                        *res = REJECT;
-                        *output_size = output_index;
-                        return;
-                    }
-                    Value new_s_remote_cnt(buf.get_i32() + input[3].get_i32());
-
-                    if (new_ol_quantity < 10)
-                        new_ol_quantity += 91;
-                    Value new_ol_quantity_value(new_ol_quantity);
-
-                    if (!txn->write_columns(r, std::vector<mdb::column_id_t>({
-                                2,  // s_quantity
-                                13, // s_ytd
-                                14, // s_order_cnt
-                                15  // s_remote_cnt
-                            }), std::vector<Value>({
-                                new_ol_quantity_value,
-                                new_s_ytd,
-                                new_s_order_cnt,
-                                new_s_remote_cnt
-                            }))) {
+                    // s_ytd += ol_quantity, s_order_cnt += 1,
+                    // s_remote_cnt += remote
+                    if (!txn->add_column(r, 13, input[2])
+                            || !txn->add_column(r, 14, Value((i32)1))
+                            || !txn->add_column(r, 15, input[3])) {
                         *res = REJECT;
                         *output_size = output_index;
                         return;
@@ -944,6 +930,9 @@ void TpccPiece::reg_new_order() {
 
                 if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
                     std::vector<Value> input_buf(input, input + input_size);
+                    // ol_amount = i_price * ol_quantity
+                    input_buf[8] = Value((double)(input[8].get_double()
+                                                  * input[7].get_i32()));
 
                     switch (TxnRunner::get_running_mode()) {
                         case MODE_2PL:
@@ -956,6 +945,9 @@ void TpccPiece::reg_new_order() {
                         case MODE_DEPTRAN:
                             r = DepRow::create(tbl->schema(), input_buf);
                             break;
+                        case MODE_ROT:
+                            r = DepRow::create(tbl->schema(), input_buf, true);
+                            break;
                         default:
                             verify(0);
                     }
@@ -1293,7 +1285,6 @@ void TpccPiece::reg_payment() {
                 Log::debug("TPCC_PAYMENT, piece: %d", TPCC_PAYMENT_2);
                 i32 output_index = 0;
                 mdb::Txn *txn = TxnRunner::get_txn(header);
-                Value buf;
                 mdb::Row *r = NULL;
                 mdb::MultiBlob mb(2);
                 //cell_locator_t cl(TPCC_TB_DISTRICT, 2);
@@ -1326,7 +1317,7 @@ void TpccPiece::reg_payment() {
                     if (pv) { // start req
                         (*row_map)[TPCC_TB_DISTRICT][mb] = r;
                         DepRow *dr = (DepRow *)r;
-                        dr->get_dep_entry(9)->touch(tv, false);
+                        dr->get_dep_entry(9)->touch_add(tv, false);
                         do_finish = false;
                     } else {
                         //std::unordered_map<mdb::MultiBlob, mdb::Row *, mdb::MultiBlob::hash>::iterator it = (*row_map)[TPCC_TB_DISTRICT].find(cl.primary_key);
@@ -1339,15 +1330,8 @@ void TpccPiece::reg_payment() {
                 }
 
                 if (do_finish) {
-                    if (!txn->read_column(r, 9, &buf)) {
-                        *res = REJECT;
-                        *output_size = output_index;
-                        return;
-                    }
-
-                    // W district
-                    buf.set_double(buf.get_double() + input[2].get_double());
-                    if (!txn->write_column(r, 9, buf)) {
+                    // W district, d_ytd += h_amount
+                    if (!txn->add_column(r, 9, input[2])) {
                         *res = REJECT;
                         *output_size = output_index;
                         return;
@@ -1723,6 +1707,9 @@ void TpccPiece::reg_payment() {
                         case MODE_DEPTRAN:
                             r = DepRow::create(tbl->schema(), row_data);
                             break;
+                        case MODE_ROT:
+                            r = DepRow::create(tbl->schema(), row_data, true);
+                            break;
                         default:
                             verify(0);
                     }
@@ -2948,6 +2935,8 @@ void TpccPiece::reg_stock_level() {
     //                ) {
     //            });
 
+    // input: s_w_id, threshold, then every s_i_id; output: how many of
+    // them are below threshold
     TxnRegistry::reg(
             TPCC_STOCK_LEVEL,
             TPCC_STOCK_LEVEL_2, // R stock
@@ -2964,17 +2953,23 @@ void TpccPiece::reg_stock_level() {
                 std::vector<TxnInfo *> *conflict_txns) {
 
                 verify(row_map == NULL);
-                verify(input_size == 3);
+                verify(input_size >= 3);
                 i32 output_index = 0;
                 Value buf;
                 mdb::Txn *txn = TxnRunner::get_txn(header);
-                mdb::MultiBlob mb(2);
-                //cell_locator_t cl(TPCC_TB_STOCK, 2);
-                mb[0] = input[0].get_blob();
-                mb[1] = input[1].get_blob();
+                std::vector<mdb::MultiBlob> mbs;
+                mbs.reserve(input_size - 2);
+                for (i32 i = 2; i < input_size; i++) {
+                    mdb::MultiBlob mb(2);
+                    mb[0] = input[i].get_blob();
+                    mb[1] = input[0].get_blob();
+                    mbs.push_back(mb);
+                }
 
-                mdb::Row *r = txn->query(txn->get_table(TPCC_TB_STOCK), mb,
-                    output_size, header.pid).next();
+                // all the stocks in one go, the table overlaps their misses
+                std::vector<mdb::Row *> row_list;
+                txn->multi_get(txn->get_table(TPCC_TB_STOCK), mbs, &row_list,
+                        output_size, header.pid);
 
                 if (TxnRunner::get_running_mode() == MODE_2PL
                     && output_size == NULL) {
@@ -2983,29 +2978,33 @@ void TpccPiece::reg_stock_level() {
                     std::function<void(void)> succ_callback = TPL::get_2pl_succ_callback(header, input, input_size, res, ps);
                     std::function<void(void)> fail_callback = TPL::get_2pl_fail_callback(header, res, ps);
 
-                    ps->reg_rw_lock(
-                        std::vector<mdb::column_lock_t>({
-                            mdb::column_lock_t(r, 2, ALock::RLOCK)
-                            }), succ_callback, fail_callback);
-
-                    //((mdb::Txn2PL *)txn)->reg_read_column(r, 2, succ_callback,
-                    //    fail_callback);
+                    std::vector<mdb::column_lock_t> column_locks;
+                    column_locks.reserve(row_list.size());
+                    for (auto r : row_list) {
+                        verify(r != NULL);
+                        column_locks.push_back(
+                                mdb::column_lock_t(r, 2, ALock::RLOCK));
+                    }
+                    ps->reg_rw_lock(column_locks, succ_callback, fail_callback);
                     return;
                 }
 
-                if (pv) {
-                    ((DepRow *)r)->get_dep_entry(2)->ro_touch(conflict_txns);
-                }
+                i32 n_low = 0;
+                for (auto r : row_list) {
+                    verify(r != NULL);
+                    if (conflict_txns) {
+                        ((DepRow *)r)->get_dep_entry(2)->ro_touch(conflict_txns);
+                    }
 
-                if (!txn->read_column(r, 2, &buf)) {
-                    *res = REJECT;
-                    *output_size = output_index;
-                    return;
+                    if (!txn->read_column(r, 2, &buf)) {
+                        *res = REJECT;
+                        *output_size = output_index;
+                        return;
+                    }
+                    if (buf.get_i32() < input[1].get_i32())
+                        n_low++;
                 }
-                if (buf.get_i32() < input[2].get_i32())
-                    output[output_index++] = Value((i32)1);
-                else
-                    output[output_index++] = Value((i32)0);
+                output[output_index++] = Value(n_low);
 
                 verify(*output_size >= output_index);
                 *output_size = output_index;
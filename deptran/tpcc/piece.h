@@ -49,7 +49,7 @@ class Piece;
 #define TPCC_STOCK_LEVEL_NAME       "STOCK LEVEL"
 #define TPCC_STOCK_LEVEL_0          500
 #define TPCC_STOCK_LEVEL_1          501
-#define TPCC_STOCK_LEVEL_2          502
+#define TPCC_STOCK_LEVEL_2          502 // every stock of the txn at once
 
 extern char TPCC_TB_WAREHOUSE[];
 extern char TPCC_TB_DISTRICT[];
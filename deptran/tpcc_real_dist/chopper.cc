@@ -85,8 +85,8 @@ void TpccRealDistChopper::stock_level_shard(const char *tb, const std::vector<md
         // based on d_id & w_id
         mv = MultiValue(std::vector<Value>({input[1], input[0]}));
     else if (tb == TPCC_TB_STOCK)
-        // based on s_i_id & s_w_id
-        mv = MultiValue(std::vector<Value>({input[0], input[1]}));
+        // based on s_i_id & s_w_id, input is s_w_id, threshold, s_i_id
+        mv = MultiValue(std::vector<Value>({input[2], input[0]}));
     else
         verify(0);
     int ret = Sharding::get_site_id(tb, mv, site);
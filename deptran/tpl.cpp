@@ -29,6 +29,9 @@ int TPL::do_prepare(i64 txn_id) {
     verify(txn != NULL);
     switch (TxnRunner::get_running_mode()) {
         case MODE_OCC:
+            // snapshot reads are consistent as of the pin, nothing to verify
+            if (((mdb::TxnOCC *)txn)->is_readonly())
+                return SUCCESS;
             if (((mdb::TxnOCC *)txn)->commit_prepare())
                 return SUCCESS;
             else
@@ -42,6 +45,19 @@ int TPL::do_prepare(i64 txn_id) {
             verify(0);
     }
 }
+bool TPL::has_writes(i64 txn_id) {
+    auto txn = TxnRunner::get_txn(txn_id);
+    verify(txn != NULL);
+    switch (TxnRunner::get_running_mode()) {
+        case MODE_OCC:
+            return ((mdb::TxnOCC *)txn)->has_writes();
+        case MODE_2PL:
+            return ((mdb::Txn2PL *)txn)->has_writes();
+        default:
+            verify(0);
+    }
+}
+
 int TPL::do_abort(i64 txn_id) {
     auto txn = TxnRunner::del_txn(txn_id);
     verify(txn != NULL);
@@ -56,7 +72,10 @@ int TPL::do_commit(i64 txn_id) {
     verify(txn != NULL);
     switch (TxnRunner::get_running_mode()) {
         case MODE_OCC:
-            ((mdb::TxnOCC *)txn)->commit_confirm();
+            // a read only txn has nothing to install, deleting it below
+            // drops its snapshots
+            if (!((mdb::TxnOCC *)txn)->is_readonly())
+                ((mdb::TxnOCC *)txn)->commit_confirm();
             break;
             //case MODE_DEPTRAN:
         case MODE_2PL:
@@ -0,0 +1,111 @@
+#include "all.h"
+
+namespace rococo {
+
+static const char *trace_names[Trace::TR_N] = {
+    "txn",
+    "rpc",
+    "piece",
+    "lock_wait",
+    "to_decide",
+    "exe_deferred",
+    "log_flush"
+};
+
+unsigned int Trace::ring_size_s = 0;
+int Trace::pid_s = 0;
+std::string Trace::name_s;
+std::mutex Trace::all_mtx_s;
+std::vector<Trace::ring_t *> Trace::all_s;
+
+void Trace::init(unsigned int ring_size, int pid, const std::string &name) {
+    pid_s = pid;
+    name_s = name;
+    ring_size_s = ring_size;
+}
+
+Trace::ring_t *Trace::mine() {
+    static thread_local ring_t *ring = nullptr;
+    if (ring == nullptr) {
+        // one per thread for the life of the process
+        ring = new ring_t();
+        ring->recs = new rec_t[ring_size_s];
+        ring->head.store(0);
+        std::lock_guard<std::mutex> guard(all_mtx_s);
+        ring->tid = all_s.size();
+        all_s.push_back(ring);
+    }
+    return ring;
+}
+
+void Trace::record(event_t ev, char ph, i64 txn, i64 piece) {
+    ring_t *ring = mine();
+    uint64_t h = ring->head.load(std::memory_order_relaxed);
+    rec_t &rec = ring->recs[h % ring_size_s];
+    rec.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    rec.txn = txn;
+    rec.piece = piece;
+    rec.ev = ev;
+    rec.ph = ph;
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+std::string Trace::dump() {
+    std::string out = "{\"traceEvents\":[";
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+             "\"args\":{\"name\":\"%s\"}}",
+             pid_s, name_s.c_str());
+    out += buf;
+    if (!on())
+        return out + "]}";
+
+    std::vector<ring_t *> rings;
+    {
+        std::lock_guard<std::mutex> guard(all_mtx_s);
+        rings = all_s;
+    }
+    std::vector<rec_t> recs(ring_size_s);
+    for (auto ring : rings) {
+        uint64_t h = ring->head.load(std::memory_order_acquire);
+        uint64_t from = h > ring_size_s ? h - ring_size_s : 0;
+        for (uint64_t i = from; i < h; i++)
+            recs[i % ring_size_s] = ring->recs[i % ring_size_s];
+        // the writer went on meanwhile, drop what it may have overwritten
+        uint64_t h2 = ring->head.load(std::memory_order_acquire);
+        if (h2 >= ring_size_s && h2 - ring_size_s + 1 > from)
+            from = h2 - ring_size_s + 1;
+        for (uint64_t i = from; i < h; i++) {
+            const rec_t &rec = recs[i % ring_size_s];
+            i64 id = rec.piece != 0 ? rec.piece : rec.txn;
+            int n = snprintf(buf, sizeof(buf),
+                    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+                    "\"ts\":%" PRIu64 ",\"pid\":%d,\"tid\":%d,"
+                    "\"args\":{\"txn\":\"%" PRIx64 "\",\"piece\":\"%" PRIx64 "\"}",
+                    trace_names[rec.ev], trace_names[rec.ev], rec.ph,
+                    rec.ts_us, pid_s, ring->tid,
+                    (uint64_t)rec.txn, (uint64_t)rec.piece);
+            out.append(buf, n);
+            switch (rec.ph) {
+                case 'b':
+                case 'e':
+                case 's':
+                case 'f':
+                    n = snprintf(buf, sizeof(buf), ",\"id\":\"0x%" PRIx64 "\"",
+                            (uint64_t)id);
+                    out.append(buf, n);
+                    if (rec.ph == 'f')
+                        out += ",\"bp\":\"e\"";
+                    break;
+                default:
+                    break;
+            }
+            out += "}";
+        }
+    }
+    return out + "]}";
+}
+
+} // namespace rococo
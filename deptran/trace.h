@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+
+#include "rcc_rpc.h"
+
+namespace rococo {
+
+/**
+ * Event trace, on when the config sets trace_ring. Every thread writes
+ * fixed size records into a ring of its own, the oldest records are
+ * overwritten; a trace point costs a clock read and a store, and one test
+ * of a static when off. dump() renders all rings as Chrome trace events
+ * (also read by Perfetto).
+ *
+ * Every record carries the txn id and the piece id, which coordinator and
+ * servers agree on, so one txn can be followed across processes. A piece
+ * rpc is linked to its run on the server by a flow arrow.
+ */
+class Trace {
+public:
+    typedef enum {
+        TR_TXN,             // coordinator: do_one to the reply, async
+        TR_RPC,             // coordinator: piece sent to its reply, async
+        TR_PIECE,           // server: a piece handler run
+        TR_LOCK_WAIT,       // server: 2pl piece waiting for locks, async
+        TR_TO_DECIDE,       // server: rococo commit waiting on ancestors,
+                            // async
+        TR_EXE_DEFERRED,    // server: rococo deferred pieces run
+        TR_LOG_FLUSH,       // server: start request waiting for the log,
+                            // async
+        TR_N
+    } event_t;
+
+    static void init(unsigned int ring_size, int pid, const std::string &name);
+
+    static inline bool on() {
+        return ring_size_s > 0;
+    }
+
+    /** a span on this thread, ends with end() on the same thread */
+    static inline void begin(event_t ev, i64 txn, i64 piece) {
+        if (on())
+            record(ev, 'B', txn, piece);
+    }
+
+    static inline void end(event_t ev, i64 txn, i64 piece) {
+        if (on())
+            record(ev, 'E', txn, piece);
+    }
+
+    /** a span that may end on any thread, matched by ev and the id:
+     *  piece, or txn where piece is 0. Also the id of an arrow. */
+    static inline void async_begin(event_t ev, i64 txn, i64 piece) {
+        if (on())
+            record(ev, 'b', txn, piece);
+    }
+
+    static inline void async_end(event_t ev, i64 txn, i64 piece) {
+        if (on())
+            record(ev, 'e', txn, piece);
+    }
+
+    /** coordinator: a piece rpc goes out, a TR_RPC span until
+     *  rpc_reply() and the tail of an arrow to the server */
+    static inline void rpc_send(i64 txn, i64 piece) {
+        if (on()) {
+            record(TR_RPC, 'b', txn, piece);
+            // the arrow leaves from a slice, give it one
+            record(TR_RPC, 'B', txn, piece);
+            record(TR_RPC, 's', txn, piece);
+            record(TR_RPC, 'E', txn, piece);
+        }
+    }
+
+    static inline void rpc_reply(i64 txn, i64 piece) {
+        async_end(TR_RPC, txn, piece);
+    }
+
+    /** server: the head of the arrow, inside the TR_PIECE span */
+    static inline void rpc_receive(i64 txn, i64 piece) {
+        if (on())
+            record(TR_RPC, 'f', txn, piece);
+    }
+
+    class Scope {
+    public:
+        Scope(event_t ev, i64 txn, i64 piece)
+                : ev_(ev), txn_(txn), piece_(piece) {
+            begin(ev_, txn_, piece_);
+        }
+        ~Scope() {
+            end(ev_, txn_, piece_);
+        }
+    private:
+        event_t ev_;
+        i64 txn_, piece_;
+    };
+
+    /** the rings as a Chrome trace json document, they keep recording */
+    static std::string dump();
+
+private:
+    typedef struct {
+        uint64_t ts_us;
+        i64 txn;
+        i64 piece;
+        uint16_t ev;
+        char ph;
+    } rec_t;
+
+    typedef struct {
+        int tid;
+        rec_t *recs;
+        // records written so far, the slot of record i is i % ring_size_s
+        std::atomic<uint64_t> head;
+    } ring_t;
+
+    static void record(event_t ev, char ph, i64 txn, i64 piece);
+    static ring_t *mine();
+
+    static unsigned int ring_size_s;
+    static int pid_s;
+    static std::string name_s;
+    static std::mutex all_mtx_s;
+    static std::vector<ring_t *> all_s;
+};
+
+} // namespace rococo
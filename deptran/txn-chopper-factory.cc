@@ -24,11 +24,20 @@ TxnChopper* TxnChopperFactory::gen_chopper(TxnRequest& req, int benchmark) {
         case MICRO_BENCH:
             ch = new MicroBenchChopper();
             break;
+        case YCSB:
+            ch = new YcsbChopper();
+            break;
+        case SMALLBANK:
+            ch = new SmallbankChopper();
+            break;
         default:
             verify(0);
     }
     verify(ch != NULL);
     ch->init(req);
+    ch->req_input_ = req.input_;
+    if (req.start_time_.tv_sec != 0)
+        ch->set_start_time(req.start_time_);
     return ch;
 }
 
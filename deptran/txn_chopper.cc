@@ -8,6 +8,42 @@ TxnChopper::TxnChopper() {
     read_only_failed_ = false;
     pre_time_ = timespec2ms(start_time_);
     early_return_ = Config::get_config()->do_early_return();
+    phase_ = PHASE_START;
+    phase_begin_ = pre_time_;
+    for (int i = 0; i < PHASE_N; i++)
+        phase_ms_[i] = 0.0;
+}
+
+void TxnChopper::set_start_time(const struct timespec &due) {
+    start_time_ = due;
+    phase_ = PHASE_QUEUE;
+    phase_begin_ = timespec2ms(due);
+    phase(PHASE_START);
+}
+
+void TxnChopper::phase(int p) {
+    struct timespec t_buf;
+    clock_gettime(&t_buf);
+    double now = timespec2ms(t_buf);
+    phase_ms_[phase_] += now - phase_begin_;
+    phase_ = p;
+    phase_begin_ = now;
+}
+
+void TxnChopper::phase_sent(int res) {
+    int p = (res == -1) ? PHASE_WAIT : PHASE_START;
+    if (p != phase_)
+        phase(p);
+}
+
+void TxnChopper::phase_retry() {
+    phase(PHASE_START);
+    for (int i = 0; i < PHASE_N; i++) {
+        if (i == PHASE_RETRY || i == PHASE_QUEUE)
+            continue;
+        phase_ms_[PHASE_RETRY] += phase_ms_[i];
+        phase_ms_[i] = 0.0;
+    }
 }
 
 int TxnChopper::next_piece(
@@ -47,6 +83,60 @@ int TxnChopper::next_piece(
     }
 }
 
+void TxnChopper::chain(int from_pi, int out_idx, int to_pi, int in_idx) {
+    chain_t c;
+    c.from_pi = from_pi;
+    c.out_idx = out_idx;
+    c.to_pi = to_pi;
+    c.in_idx = in_idx;
+    chains_.push_back(c);
+}
+
+void TxnChopper::ready_chained() {
+    for (auto &c : chains_)
+        if (status_[c.to_pi] == -1)
+            status_[c.to_pi] = 0;
+}
+
+bool TxnChopper::is_chained(int pi) {
+    for (auto &c : chains_)
+        if (c.from_pi == pi || c.to_pi == pi)
+            return true;
+    return false;
+}
+
+void TxnChopper::chain_of(int pi,
+                          int *n_wait,
+                          std::vector<PieceForward> *forwards) {
+    std::set<int> froms;
+    for (auto &c : chains_) {
+        if (c.to_pi == pi)
+            froms.insert(c.from_pi);
+        if (c.from_pi == pi) {
+            PieceForward f;
+            f.sid = sharding_[c.to_pi];
+            f.pi = c.to_pi;
+            f.out_idx = c.out_idx;
+            f.in_idx = c.in_idx;
+            forwards->push_back(f);
+        }
+    }
+    *n_wait = froms.size();
+}
+
+bool TxnChopper::single_site(int32_t *sid) {
+    verify(sharding_.size() > 0);
+    for (auto s : sharding_)
+        if (s != sharding_[0])
+            return false;
+    *sid = sharding_[0];
+    return true;
+}
+
+std::string TxnChopper::lock_key(const char *table, const mdb::Value &key) {
+    return std::string(table) + "/" + mdb::to_string(key);
+}
+
 int TxnChopper::batch_next_piece(BatchRequestHeader *batch_header, std::vector<mdb::Value> &input, int32_t &server_id, std::vector<int> &pi, Coordinator *coo) {
     if (n_started_ == n_pieces_)
         return 2;
@@ -217,6 +307,10 @@ TxnReply& TxnChopper::get_reply() {
     clock_gettime(&t_buf);
     reply_.time_ = timespec2ms(t_buf) - timespec2ms(start_time_);
     reply_.txn_type_ = (int32_t)txn_type_;
+    phase(phase_);
+    for (int i = 0; i < PHASE_N; i++)
+        reply_.phase_ms_[i] = phase_ms_[i];
+    Trace::async_end(Trace::TR_TXN, txn_id_, 0);
     return reply_;
 }
 
@@ -13,6 +13,7 @@ public:
     int32_t n_try_;
     struct timespec start_time_;
     double time_;
+    double phase_ms_[PHASE_N];
     std::vector<mdb::Value> output_;
     int32_t txn_type_;
 };
@@ -22,6 +23,8 @@ public:
     uint32_t txn_type_;
     std::vector<mdb::Value> input_;    // the inputs for the transactions.
     int n_try_ = 1;
+    // open loop: when the txn was due, zero for now
+    struct timespec start_time_ = {0, 0};
     std::function<void(TxnReply&)> callback_;
 
     void get_log(i64 tid, std::string &log);
@@ -45,12 +48,17 @@ private:
 
     bool early_return_;
 
+    int phase_;
+    double phase_begin_;
+    double phase_ms_[PHASE_N];
+
 public:
     uint64_t txn_id_;
     uint32_t txn_type_;
 
     Graph<TxnInfo> gra_;
 
+    std::vector<mdb::Value> req_input_;  // input of the whole request.
     std::vector<std::vector<mdb::Value> > inputs_;  // input of each piece.
     //std::vector<std::vector<mdb::Value> > outputs_; // output of each piece.
     std::vector<size_t> output_size_;
@@ -59,6 +67,22 @@ public:
     std::vector<uint32_t> sharding_;     /** which server to which piece */
     std::vector<int> status_; // -1 waiting; 0 ready; 1 ongoing; 2 finished;
     std::set<int32_t> proxies_;   /** server involved*/
+    std::set<int32_t> ro_proxies_;   /** servers that voted read only */
+    /** occ read only txns: the snapshots the server reads, -1 for none,
+     *  whether some server ran the txn as plain OCC instead, and whether
+     *  some read a snapshot */
+    i64 ro_snapshot_ts_ = -1;
+    bool ro_fallback_ = false;
+    bool ro_snapshot_read_ = false;
+
+    /** input in_idx of piece to_pi comes from output out_idx of from_pi */
+    typedef struct {
+        int from_pi;
+        int out_idx;
+        int to_pi;
+        int in_idx;
+    } chain_t;
+    std::vector<chain_t> chains_;
 
     int n_start_sent_ = 0;
     int n_pieces_ = 0;
@@ -98,6 +122,32 @@ public:
 
     virtual bool is_read_only() = 0;
 
+    /** declare a dependency a server can resolve on its own. A piece
+     *  either gets all of its dependent inputs this way or none. With
+     *  chaining on, to_pi is then shipped together with from_pi and the
+     *  server running from_pi forwards the value. */
+    void chain(int from_pi, int out_idx, int to_pi, int in_idx);
+
+    /** with chaining on: pieces waiting only for chained inputs are ready */
+    void ready_chained();
+
+    bool is_chained(int pi);
+
+    /** how many pieces pi waits for, and where its outputs go */
+    void chain_of(int pi, int *n_wait, std::vector<PieceForward> *forwards);
+
+    /** return: true if every piece runs on the same server, sid */
+    bool single_site(int32_t *sid);
+
+    /** calvin: the lock keys of piece pi, known before the txn runs. Two
+     *  pieces that may touch the same row share a key. return: false if
+     *  they are not known, the piece then locks its whole server */
+    virtual bool lock_keys(int pi, std::set<std::string> *keys) {
+        return false;
+    }
+
+    static std::string lock_key(const char *table, const mdb::Value &key);
+
     virtual void read_only_reset();
 
     // phase 1, res is NULL
@@ -123,6 +173,22 @@ public:
     /** for retry */
     virtual void retry() = 0;
 
+    /** the txn moves on to phase p, the time since the last call goes to
+     *  the phase it was in */
+    void phase(int p);
+
+    /** a round of start requests went out and next_piece ended with res.
+     *  while some piece waits on the output of another the txn is in
+     *  PHASE_WAIT, once all are out in PHASE_START */
+    void phase_sent(int res);
+
+    /** the attempt failed, all of its time goes to PHASE_RETRY */
+    void phase_retry();
+
+    /** the txn was due at due, it counts from there and the time until
+     *  now goes to PHASE_QUEUE */
+    void set_start_time(const struct timespec &due);
+
     virtual ~TxnChopper() {}
 
 };
@@ -8,6 +8,7 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
     benchmark_ = Config::get_config()->get_benchmark();
     n_try_ = Config::get_config()->get_max_retry();
     single_server_ = Config::get_config()->get_single_server();
+    key_dist_ = Config::get_config()->get_key_dist();
 
     std::map<std::string, uint64_t> table_num_rows;
     Sharding::get_number_rows(table_num_rows);
@@ -18,11 +19,18 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
             micro_bench_para_.n_table_b_ = table_num_rows[std::string(MICRO_BENCH_TABLE_B)];
             micro_bench_para_.n_table_c_ = table_num_rows[std::string(MICRO_BENCH_TABLE_C)];
             micro_bench_para_.n_table_d_ = table_num_rows[std::string(MICRO_BENCH_TABLE_D)];
+            micro_bench_para_.key_a_ = KeyDist::create(micro_bench_para_.n_table_a_);
+            micro_bench_para_.key_b_ = KeyDist::create(micro_bench_para_.n_table_b_);
+            micro_bench_para_.key_c_ = KeyDist::create(micro_bench_para_.n_table_c_);
+            micro_bench_para_.key_d_ = KeyDist::create(micro_bench_para_.n_table_d_);
             break;
         case TPCA:
             tpca_para_.n_branch_ = table_num_rows[std::string(TPCA_BRANCH)];
             tpca_para_.n_teller_ = table_num_rows[std::string(TPCA_TELLER)];
             tpca_para_.n_customer_ = table_num_rows[std::string(TPCA_CUSTOMER)];
+            tpca_para_.branch_key_ = KeyDist::create(tpca_para_.n_branch_);
+            tpca_para_.teller_key_ = KeyDist::create(tpca_para_.n_teller_);
+            tpca_para_.customer_key_ = KeyDist::create(tpca_para_.n_customer_);
             switch (single_server_) {
                 case Config::SS_DISABLED:
                     fix_id_ = -1;
@@ -57,6 +65,7 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
                 uint64_t tb_c_rows = table_num_rows[std::string(TPCC_TB_CUSTOMER)];
                 tpcc_para_.n_c_id_ = (int)tb_c_rows / tb_d_rows;
                 tpcc_para_.n_i_id_ = (int)table_num_rows[std::string(TPCC_TB_ITEM)];
+                tpcc_para_.i_id_key_ = KeyDist::create(tpcc_para_.n_i_id_);
                 tpcc_para_.delivery_d_id_ = RandomGenerator::rand(0, tpcc_para_.n_d_id_ - 1);
                 if (single_server_ != Config::SS_DISABLED){
                     verify(0);
@@ -77,6 +86,7 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
                 uint64_t tb_c_rows = table_num_rows[std::string(TPCC_TB_CUSTOMER)];
                 tpcc_para_.n_c_id_ = (int)tb_c_rows / tb_d_rows;
                 tpcc_para_.n_i_id_ = (int)table_num_rows[std::string(TPCC_TB_ITEM)];
+                tpcc_para_.i_id_key_ = KeyDist::create(tpcc_para_.n_i_id_);
                 tpcc_para_.delivery_d_id_ = RandomGenerator::rand(0, tpcc_para_.n_d_id_ - 1);
                 switch (single_server_) {
                     case Config::SS_DISABLED:
@@ -96,6 +106,34 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
             }
         case RW_BENCHMARK:
             rw_benchmark_para_.n_table_ = table_num_rows[std::string(RW_BENCHMARK_TABLE)];
+            rw_benchmark_para_.key_ = KeyDist::create(rw_benchmark_para_.n_table_);
+            break;
+        case YCSB:
+        {
+            Config *config = Config::get_config();
+            ycsb_para_.n_record_ = table_num_rows[std::string(YCSB_TABLE)];
+            ycsb_para_.n_field_ = ycsb_n_field();
+            ycsb_para_.keys_per_txn_ = config->get_keys_per_txn();
+            ycsb_para_.scan_length_ = config->get_scan_length();
+            ycsb_para_.field_length_ = config->get_field_length();
+            verify(ycsb_para_.n_record_ >= ycsb_para_.keys_per_txn_);
+            // each client inserts into a span of its own, above the
+            // populated keys
+            verify((int64_t)ycsb_para_.n_record_
+                    + (int64_t)(config->get_client_id() + 1) * YCSB_INSERT_SPAN
+                    <= INT32_MAX);
+            ycsb_para_.insert_base_ = ycsb_para_.n_record_
+                + config->get_client_id() * YCSB_INSERT_SPAN;
+            ycsb_para_.key_ = KeyDist::create(ycsb_para_.n_record_);
+            ycsb_n_inserted_.store(0);
+            break;
+        }
+        case SMALLBANK:
+            smallbank_para_.n_customer_ = table_num_rows[std::string(SMALLBANK_CHECKING)];
+            verify(smallbank_para_.n_customer_
+                    == table_num_rows[std::string(SMALLBANK_SAVINGS)]);
+            verify(smallbank_para_.n_customer_ >= 2);
+            smallbank_para_.customer_key_ = KeyDist::create(smallbank_para_.n_customer_);
             break;
         default:
             Log_fatal("benchmark not implemented");
@@ -106,7 +144,7 @@ TxnRequestFactory::TxnRequestFactory() : txn_weight_(Config::get_config()->get_t
 void TxnRequestFactory::get_rw_benchmark_w_txn_req(TxnRequest *req, uint32_t cid) const {
     req->txn_type_ = RW_BENCHMARK_W_TXN;
     req->input_.assign({
-            Value((i32)RandomGenerator::rand(0, rw_benchmark_para_.n_table_ - 1)),
+            Value((i32)rw_benchmark_para_.key_->next()),
             Value((i32)RandomGenerator::rand(0, 10000))
             });
 }
@@ -114,7 +152,7 @@ void TxnRequestFactory::get_rw_benchmark_w_txn_req(TxnRequest *req, uint32_t cid
 void TxnRequestFactory::get_rw_benchmark_r_txn_req(TxnRequest *req, uint32_t cid) const {
     req->txn_type_ = RW_BENCHMARK_R_TXN;
     req->input_.assign({
-            Value((i32)RandomGenerator::rand(0, rw_benchmark_para_.n_table_ - 1))
+            Value((i32)rw_benchmark_para_.key_->next())
             });
 }
 
@@ -153,9 +191,9 @@ void TxnRequestFactory::get_tpca_txn_req(TxnRequest *req, uint32_t cid) const {
     }
     else
         req->input_.assign({
-                Value((i32)RandomGenerator::rand(0, tpca_para_.n_customer_ - 1)),
-                Value((i32)RandomGenerator::rand(0, tpca_para_.n_teller_ - 1)),
-                Value((i32)RandomGenerator::rand(0, tpca_para_.n_branch_ - 1)),
+                Value((i32)tpca_para_.customer_key_->next()),
+                Value((i32)tpca_para_.teller_key_->next()),
+                Value((i32)tpca_para_.branch_key_->next()),
                 amount});
 }
 
@@ -192,18 +230,33 @@ void TxnRequestFactory::get_tpcc_new_order_txn_req(TxnRequest *req, uint32_t cid
     int i = 0;
     for (; i < ol_cnt; i++) {
         //req->input_[4 + 3 * i] = Value((i32)RandomGenerator::nu_rand(8191, 0, tpcc_para_.n_i_id_ - 1)); XXX nurand is the standard
-        rrr::i32 tmp_i_id = (i32)RandomGenerator::rand(0, tpcc_para_.n_i_id_ - 1 - i);
-
-        int pre_n_less = 0, n_less = 0;
-        while (true) {
-            n_less = 0;
-            for (int j = 0; j < i; j++)
-                if (i_id_buf[j] <= tmp_i_id)
-                    n_less++;
-            if (n_less == pre_n_less)
-                break;
-            tmp_i_id += (n_less - pre_n_less);
-            pre_n_less = n_less;
+        rrr::i32 tmp_i_id;
+        if (key_dist_ == KEY_DIST_UNIFORM) {
+            tmp_i_id = (i32)RandomGenerator::rand(0, tpcc_para_.n_i_id_ - 1 - i);
+
+            int pre_n_less = 0, n_less = 0;
+            while (true) {
+                n_less = 0;
+                for (int j = 0; j < i; j++)
+                    if (i_id_buf[j] <= tmp_i_id)
+                        n_less++;
+                if (n_less == pre_n_less)
+                    break;
+                tmp_i_id += (n_less - pre_n_less);
+                pre_n_less = n_less;
+            }
+        }
+        else {
+            // skewed picks repeat, draw again until a new item
+            verify(tpcc_para_.n_i_id_ >= ol_cnt);
+            bool dup = true;
+            while (dup) {
+                tmp_i_id = (i32)tpcc_para_.i_id_key_->next();
+                dup = false;
+                for (int j = 0; j < i; j++)
+                    if (i_id_buf[j] == tmp_i_id)
+                        dup = true;
+            }
         }
 
         i_id_buf[i] = tmp_i_id;
@@ -303,19 +356,19 @@ void TxnRequestFactory::get_tpcc_order_status_txn_req(TxnRequest *req, uint32_t
 void TxnRequestFactory::get_micro_bench_read_req(TxnRequest *req, uint32_t cid) const {
     req->txn_type_ = MICRO_BENCH_R;
     req->input_.resize(4);
-    req->input_[0] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_a_ - 1));
-    req->input_[1] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_b_ - 1));
-    req->input_[2] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_c_ - 1));
-    req->input_[3] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_d_ - 1));
+    req->input_[0] = Value((i32)micro_bench_para_.key_a_->next());
+    req->input_[1] = Value((i32)micro_bench_para_.key_b_->next());
+    req->input_[2] = Value((i32)micro_bench_para_.key_c_->next());
+    req->input_[3] = Value((i32)micro_bench_para_.key_d_->next());
 }
 
 void TxnRequestFactory::get_micro_bench_write_req(TxnRequest *req, uint32_t cid) const {
     req->txn_type_ = MICRO_BENCH_W;
     req->input_.resize(8);
-    req->input_[0] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_a_ - 1));
-    req->input_[1] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_b_ - 1));
-    req->input_[2] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_c_ - 1));
-    req->input_[3] = Value((i32)RandomGenerator::rand(0, micro_bench_para_.n_table_d_ - 1));
+    req->input_[0] = Value((i32)micro_bench_para_.key_a_->next());
+    req->input_[1] = Value((i32)micro_bench_para_.key_b_->next());
+    req->input_[2] = Value((i32)micro_bench_para_.key_c_->next());
+    req->input_[3] = Value((i32)micro_bench_para_.key_d_->next());
     req->input_[4] = Value((i64)RandomGenerator::rand(0, 1000));
     req->input_[5] = Value((i64)RandomGenerator::rand(0, 1000));
     req->input_[6] = Value((i64)RandomGenerator::rand(0, 1000));
@@ -338,6 +391,146 @@ void TxnRequestFactory::get_micro_bench_txn_req(TxnRequest *req, uint32_t cid) c
 
 }
 
+// key i of the key distribution: the populated keys, then the ones this
+// client inserted
+rrr::i32 TxnRequestFactory::ycsb_key(int i) const {
+    if (i < ycsb_para_.n_record_)
+        return i;
+    return ycsb_para_.insert_base_ + (i - ycsb_para_.n_record_);
+}
+
+void TxnRequestFactory::get_ycsb_keys(std::vector<rrr::i32> &keys) const {
+    keys.clear();
+    // skewed picks repeat, draw again until a new key
+    while (keys.size() < (size_t)ycsb_para_.keys_per_txn_) {
+        rrr::i32 key = ycsb_key(ycsb_para_.key_->next());
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+            keys.push_back(key);
+    }
+}
+
+void TxnRequestFactory::get_ycsb_read_req(TxnRequest *req, uint32_t cid) const {
+    req->txn_type_ = YCSB_READ;
+    std::vector<rrr::i32> keys;
+    get_ycsb_keys(keys);
+    req->input_.clear();
+    for (auto key : keys)
+        req->input_.push_back(Value(key));
+}
+
+void TxnRequestFactory::get_ycsb_write_req(TxnRequest *req, uint32_t cid, uint32_t txn_type) const {
+    req->txn_type_ = txn_type;
+    std::vector<rrr::i32> keys;
+    get_ycsb_keys(keys);
+    req->input_.clear();
+    for (auto key : keys) {
+        req->input_.push_back(Value(key));
+        req->input_.push_back(Value((i32)RandomGenerator::rand(0, ycsb_para_.n_field_ - 1)));
+        req->input_.push_back(random_str_value(ycsb_para_.field_length_));
+    }
+}
+
+void TxnRequestFactory::get_ycsb_scan_req(TxnRequest *req, uint32_t cid) const {
+    req->txn_type_ = YCSB_SCAN;
+    req->input_.assign({
+            Value(ycsb_key(ycsb_para_.key_->next())),
+            Value((i32)RandomGenerator::rand(1, ycsb_para_.scan_length_))
+            });
+}
+
+void TxnRequestFactory::get_ycsb_insert_req(TxnRequest *req, uint32_t cid) const {
+    req->txn_type_ = YCSB_INSERT;
+    int seq = ycsb_n_inserted_.fetch_add(1);
+    verify(seq < YCSB_INSERT_SPAN);
+    req->input_.resize(1 + ycsb_para_.n_field_);
+    req->input_[0] = Value((i32)(ycsb_para_.insert_base_ + seq));
+    for (int i = 0; i < ycsb_para_.n_field_; i++)
+        req->input_[1 + i] = random_str_value(ycsb_para_.field_length_);
+    // picked as soon as it is sent, a read that gets there first misses
+    ycsb_para_.key_->inserted(ycsb_para_.n_record_ + seq);
+}
+
+void TxnRequestFactory::get_ycsb_txn_req(TxnRequest *req, uint32_t cid) const {
+    req->n_try_ = n_try_;
+    if (txn_weight_.size() != 5)
+        get_ycsb_read_req(req, cid);
+    else
+        switch (RandomGenerator::weighted_select(txn_weight_)) {
+            case 0:
+                get_ycsb_read_req(req, cid);
+                break;
+            case 1:
+                get_ycsb_write_req(req, cid, YCSB_UPDATE);
+                break;
+            case 2:
+                get_ycsb_write_req(req, cid, YCSB_RMW);
+                break;
+            case 3:
+                get_ycsb_scan_req(req, cid);
+                break;
+            case 4:
+                get_ycsb_insert_req(req, cid);
+                break;
+            default:
+                verify(0);
+        }
+}
+
+// n distinct customers, hot ones as likely as the key distribution says.
+// a distribution that keeps repeating itself, a single hot key say, gets
+// a uniform pick instead after a few tries
+void TxnRequestFactory::get_smallbank_customers(int n, std::vector<Value> &customers) const {
+    std::vector<rrr::i32> ids;
+    int n_try = 0;
+    while (ids.size() < (size_t)n) {
+        rrr::i32 id = n_try++ < 8 * n
+            ? smallbank_para_.customer_key_->next()
+            : RandomGenerator::rand(0, smallbank_para_.n_customer_ - 1);
+        if (std::find(ids.begin(), ids.end(), id) == ids.end())
+            ids.push_back(id);
+    }
+    customers.clear();
+    for (auto id : ids)
+        customers.push_back(Value(id));
+}
+
+void TxnRequestFactory::get_smallbank_txn_req(TxnRequest *req, uint32_t cid) const {
+    static const uint32_t txn_types[] = {
+        SMALLBANK_AMALGAMATE,
+        SMALLBANK_BALANCE,
+        SMALLBANK_DEPOSIT_CHECKING,
+        SMALLBANK_SEND_PAYMENT,
+        SMALLBANK_TRANSACT_SAVINGS,
+        SMALLBANK_WRITE_CHECK
+    };
+    req->n_try_ = n_try_;
+    if (txn_weight_.size() != 6)
+        req->txn_type_ = SMALLBANK_BALANCE;
+    else
+        req->txn_type_ = txn_types[RandomGenerator::weighted_select(txn_weight_)];
+    Value amount((i64)RandomGenerator::rand(1, 100));
+    switch (req->txn_type_) {
+        case SMALLBANK_AMALGAMATE:
+            get_smallbank_customers(2, req->input_);
+            break;
+        case SMALLBANK_BALANCE:
+            get_smallbank_customers(1, req->input_);
+            break;
+        case SMALLBANK_SEND_PAYMENT:
+            get_smallbank_customers(2, req->input_);
+            req->input_.push_back(amount);
+            break;
+        case SMALLBANK_DEPOSIT_CHECKING:
+        case SMALLBANK_TRANSACT_SAVINGS:
+        case SMALLBANK_WRITE_CHECK:
+            get_smallbank_customers(1, req->input_);
+            req->input_.push_back(amount);
+            break;
+        default:
+            verify(0);
+    }
+}
+
 void TxnRequestFactory::get_tpcc_txn_req(TxnRequest *req, uint32_t cid) const {
     req->n_try_ = n_try_;
     if (txn_weight_.size() != 5)
@@ -380,6 +573,12 @@ void TxnRequestFactory::get_txn_req(TxnRequest *req, uint32_t cid) const {
         case MICRO_BENCH:
             get_micro_bench_txn_req(req, cid);
             break;
+        case YCSB:
+            get_ycsb_txn_req(req, cid);
+            break;
+        case SMALLBANK:
+            get_smallbank_txn_req(req, cid);
+            break;
         default:
             Log_fatal("benchmark not implemented");
             verify(0);
@@ -409,6 +608,21 @@ void TxnRequestFactory::get_txn_types(std::map<int32_t, std::string> &txn_types)
             txn_types[MICRO_BENCH_R] = std::string(MICRO_BENCH_R_NAME);
             txn_types[MICRO_BENCH_W] = std::string(MICRO_BENCH_W_NAME);
             break;
+        case YCSB:
+            txn_types[YCSB_READ] = std::string(YCSB_READ_NAME);
+            txn_types[YCSB_UPDATE] = std::string(YCSB_UPDATE_NAME);
+            txn_types[YCSB_RMW] = std::string(YCSB_RMW_NAME);
+            txn_types[YCSB_SCAN] = std::string(YCSB_SCAN_NAME);
+            txn_types[YCSB_INSERT] = std::string(YCSB_INSERT_NAME);
+            break;
+        case SMALLBANK:
+            txn_types[SMALLBANK_AMALGAMATE] = std::string(SMALLBANK_AMALGAMATE_NAME);
+            txn_types[SMALLBANK_BALANCE] = std::string(SMALLBANK_BALANCE_NAME);
+            txn_types[SMALLBANK_DEPOSIT_CHECKING] = std::string(SMALLBANK_DEPOSIT_CHECKING_NAME);
+            txn_types[SMALLBANK_SEND_PAYMENT] = std::string(SMALLBANK_SEND_PAYMENT_NAME);
+            txn_types[SMALLBANK_TRANSACT_SAVINGS] = std::string(SMALLBANK_TRANSACT_SAVINGS_NAME);
+            txn_types[SMALLBANK_WRITE_CHECK] = std::string(SMALLBANK_WRITE_CHECK_NAME);
+            break;
         default:
             Log_fatal("benchmark not implemented");
             verify(0);
@@ -430,6 +644,35 @@ void TxnRequestFactory::destroy() {
 }
 
 TxnRequestFactory::~TxnRequestFactory() {
+    switch (benchmark_) {
+        case MICRO_BENCH:
+            delete micro_bench_para_.key_a_;
+            delete micro_bench_para_.key_b_;
+            delete micro_bench_para_.key_c_;
+            delete micro_bench_para_.key_d_;
+            break;
+        case TPCA:
+            delete tpca_para_.branch_key_;
+            delete tpca_para_.teller_key_;
+            delete tpca_para_.customer_key_;
+            break;
+        case TPCC:
+        case TPCC_DIST_PART:
+        case TPCC_REAL_DIST_PART:
+            delete tpcc_para_.i_id_key_;
+            break;
+        case RW_BENCHMARK:
+            delete rw_benchmark_para_.key_;
+            break;
+        case YCSB:
+            delete ycsb_para_.key_;
+            break;
+        case SMALLBANK:
+            delete smallbank_para_.customer_key_;
+            break;
+        default:
+            break;
+    }
 }
 
 } // namespace rcc
@@ -1,9 +1,12 @@
 #ifndef TXN_REQ_FACTORY_H_
 #define TXN_REQ_FACTORY_H_
 
+#include <atomic>
+
 namespace rococo {
 
 class TxnRequest;
+class KeyDist;
 
 class TxnRequestFactory {
 private:
@@ -11,6 +14,9 @@ private:
         int n_branch_;
         int n_teller_;
         int n_customer_;
+        KeyDist *branch_key_;
+        KeyDist *teller_key_;
+        KeyDist *customer_key_;
     } tpca_para_t;
 
     typedef struct {
@@ -20,10 +26,12 @@ private:
         int n_i_id_;
         int const_home_w_id_;
         int delivery_d_id_;
+        KeyDist *i_id_key_;
     } tpcc_para_t;
 
     typedef struct {
         int n_table_;
+        KeyDist *key_;
     } rw_benchmark_para_t;
 
     typedef struct {
@@ -31,16 +39,42 @@ private:
         int n_table_b_;
         int n_table_c_;
         int n_table_d_;
+        KeyDist *key_a_;
+        KeyDist *key_b_;
+        KeyDist *key_c_;
+        KeyDist *key_d_;
     } micro_bench_para_t;
 
+    typedef struct {
+        int n_record_;
+        int n_field_;
+        int keys_per_txn_;
+        int scan_length_;
+        int field_length_;
+        // where the keys this client inserts start
+        int insert_base_;
+        KeyDist *key_;
+    } ycsb_para_t;
+
+    typedef struct {
+        int n_customer_;
+        KeyDist *customer_key_;
+    } smallbank_para_t;
+
     union {
         tpca_para_t tpca_para_;
         tpcc_para_t tpcc_para_;
         rw_benchmark_para_t rw_benchmark_para_;
         micro_bench_para_t micro_bench_para_;
+        ycsb_para_t ycsb_para_;
+        smallbank_para_t smallbank_para_;
     };
 
+    // ycsb inserts so far by this client
+    mutable std::atomic<int> ycsb_n_inserted_;
+
     int benchmark_;
+    int key_dist_;
     int n_try_;
     int single_server_;
     int fix_id_;
@@ -75,6 +109,19 @@ private:
     void get_micro_bench_write_req(TxnRequest *req, uint32_t cid) const;
     void get_micro_bench_txn_req(TxnRequest *req, uint32_t cid) const;
 
+    // ycsb
+    void get_ycsb_txn_req(TxnRequest *req, uint32_t cid) const;
+    void get_ycsb_read_req(TxnRequest *req, uint32_t cid) const;
+    void get_ycsb_write_req(TxnRequest *req, uint32_t cid, uint32_t txn_type) const;
+    void get_ycsb_scan_req(TxnRequest *req, uint32_t cid) const;
+    void get_ycsb_insert_req(TxnRequest *req, uint32_t cid) const;
+    rrr::i32 ycsb_key(int i) const;
+    void get_ycsb_keys(std::vector<rrr::i32> &keys) const;
+
+    // smallbank
+    void get_smallbank_txn_req(TxnRequest *req, uint32_t cid) const;
+    void get_smallbank_customers(int n, std::vector<Value> &customers) const;
+
     static TxnRequestFactory *txn_req_factory_s;
 
 public:
@@ -0,0 +1,126 @@
+#include "all.h"
+
+namespace deptran {
+
+YcsbChopper::YcsbChopper() {
+}
+
+void YcsbChopper::read_init(TxnRequest &req) {
+    for (auto &key : req.input_) {
+        inputs_.push_back({key});
+        output_size_.push_back(ycsb_n_field());
+        p_types_.push_back(YCSB_READ_0);
+        sharding_.push_back(0);
+        Sharding::get_site_id(YCSB_TABLE, key, sharding_.back());
+    }
+}
+
+void YcsbChopper::write_init(TxnRequest &req, int p_type, size_t output_size) {
+    verify(req.input_.size() % 3 == 0);
+    for (size_t i = 0; i < req.input_.size(); i += 3) {
+        inputs_.push_back({req.input_[i], req.input_[i + 1], req.input_[i + 2]});
+        output_size_.push_back(output_size);
+        p_types_.push_back(p_type);
+        sharding_.push_back(0);
+        Sharding::get_site_id(YCSB_TABLE, req.input_[i], sharding_.back());
+    }
+}
+
+void YcsbChopper::scan_init(TxnRequest &req) {
+    i32 start = req.input_[0].get_i32();
+    i32 len = req.input_[1].get_i32();
+    std::vector<unsigned int> all_sites;
+    Sharding::get_site_id(YCSB_TABLE, all_sites);
+    // a piece on each server with keys in the range, a short scan may
+    // leave some out
+    std::set<unsigned int> sites;
+    for (i32 key = start; key < start + len && sites.size() < all_sites.size();
+            key++) {
+        unsigned int sid;
+        Sharding::get_site_id(YCSB_TABLE, Value(key), sid);
+        sites.insert(sid);
+    }
+    for (auto sid : sites) {
+        inputs_.push_back({req.input_[0], req.input_[1]});
+        output_size_.push_back(len);
+        p_types_.push_back(YCSB_SCAN_0);
+        sharding_.push_back(sid);
+    }
+}
+
+void YcsbChopper::insert_init(TxnRequest &req) {
+    inputs_.push_back(req.input_);
+    output_size_.push_back(0);
+    p_types_.push_back(YCSB_INSERT_0);
+    sharding_.push_back(0);
+    Sharding::get_site_id(YCSB_TABLE, req.input_[0], sharding_.back());
+}
+
+void YcsbChopper::init(TxnRequest &req) {
+    txn_type_ = req.txn_type_;
+    callback_ = req.callback_;
+    max_try_ = req.n_try_;
+    n_try_ = 1;
+    commit_.store(true);
+
+    inputs_.clear();
+    output_size_.clear();
+    p_types_.clear();
+    sharding_.clear();
+    switch (req.txn_type_) {
+        case YCSB_READ:
+            read_init(req);
+            break;
+        case YCSB_UPDATE:
+            write_init(req, YCSB_UPDATE_0, 0);
+            break;
+        case YCSB_RMW:
+            write_init(req, YCSB_RMW_0, ycsb_n_field());
+            break;
+        case YCSB_SCAN:
+            scan_init(req);
+            break;
+        case YCSB_INSERT:
+            insert_init(req);
+            break;
+        default:
+            verify(0);
+    }
+    n_pieces_ = inputs_.size();
+    status_.assign(n_pieces_, 0);
+}
+
+bool YcsbChopper::start_callback(const std::vector<int> &pi, int res, BatchStartArgsHelper &bsah) {
+    return false;
+}
+
+bool YcsbChopper::start_callback(int pi, int res, const std::vector<mdb::Value> &output) {
+    return false;
+}
+
+bool YcsbChopper::is_read_only() {
+    return txn_type_ == YCSB_READ || txn_type_ == YCSB_SCAN;
+}
+
+bool YcsbChopper::lock_keys(int pi, std::set<std::string> *keys) {
+    // a scan reaches keys nobody knows in advance
+    if (p_types_[pi] == YCSB_SCAN_0)
+        return false;
+    keys->insert(lock_key(YCSB_TABLE, inputs_[pi][0]));
+    return true;
+}
+
+void YcsbChopper::retry() {
+    n_started_ = 0;
+    n_prepared_ = 0;
+    n_finished_ = 0;
+    status_.assign(n_pieces_, 0);
+    commit_.store(true);
+    proxies_.clear();
+    n_try_++;
+}
+
+YcsbChopper::~YcsbChopper() {
+}
+
+} // namespace deptran
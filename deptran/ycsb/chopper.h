@@ -0,0 +1,36 @@
+#pragma once
+
+#include "coordinator.h"
+
+namespace deptran {
+
+class YcsbChopper : public TxnChopper {
+private:
+    void read_init(TxnRequest &req);
+
+    void write_init(TxnRequest &req, int p_type, size_t output_size);
+
+    void scan_init(TxnRequest &req);
+
+    void insert_init(TxnRequest &req);
+
+public:
+    YcsbChopper();
+
+    virtual void init(TxnRequest &req);
+
+    virtual bool start_callback(const std::vector<int> &pi, int res, BatchStartArgsHelper &bsah);
+
+    virtual bool start_callback(int pi, int res, const std::vector<mdb::Value> &output);
+
+    virtual bool is_read_only();
+
+    virtual bool lock_keys(int pi, std::set<std::string> *keys);
+
+    virtual void retry();
+
+    virtual ~YcsbChopper();
+
+};
+
+} // namespace deptran
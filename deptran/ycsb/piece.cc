@@ -0,0 +1,342 @@
+#include "all.h"
+
+namespace deptran {
+
+char YCSB_TABLE[] = "usertable";
+
+int ycsb_n_field() {
+    static const int n_field = [] () {
+        mdb::Schema schema;
+        mdb::symbol_t symbol;
+        int n_column = Sharding::init_schema(YCSB_TABLE, &schema, &symbol);
+        verify(n_column > 1);
+        return n_column - 1;
+    }();
+    return n_field;
+}
+
+// the first row of a key, NULL if the key is not there (yet): every piece
+// takes a missing record as a miss, not as an abort
+static mdb::Row *ycsb_row(mdb::Txn *txn, mdb::Table *tbl, const Value &key,
+        bool retrieve, i64 pid) {
+    mdb::ResultSet rs = txn->query(tbl, key, retrieve, pid);
+    return rs.has_next() ? rs.next() : NULL;
+}
+
+// deptran finish req: the row its start req found, if any
+static mdb::Row *ycsb_deferred_row(row_map_t *row_map) {
+    auto &rows = (*row_map)[YCSB_TABLE];
+    return rows.empty() ? NULL : rows.begin()->second;
+}
+
+// 2pl first run: a read lock on every field if read, a write lock on
+// column w_col (0 for none); with no rows there is nothing to wait for
+static void ycsb_lock(const RequestHeader &header, const Value *input,
+        i32 input_size, i32 *res, mdb::Txn *txn,
+        const std::vector<mdb::Row *> &rows, int n_field, bool read,
+        int w_col) {
+    std::vector<mdb::column_lock_t> locks;
+    for (auto r : rows)
+        for (int col = 1; col <= n_field; col++)
+            if (col == w_col)
+                locks.push_back(mdb::column_lock_t(r, col, ALock::WLOCK));
+            else if (read)
+                locks.push_back(mdb::column_lock_t(r, col, ALock::RLOCK));
+    if (locks.empty()) {
+        TPL::get_2pl_proceed_callback(header, input, input_size, res)();
+        return;
+    }
+    mdb::Txn2PL::PieceStatus *ps
+        = ((mdb::Txn2PL *)txn)->get_piece_status(header.pid);
+    ps->reg_rw_lock(locks,
+            TPL::get_2pl_succ_callback(header, input, input_size, res, ps),
+            TPL::get_2pl_fail_callback(header, res, ps));
+}
+
+static bool ycsb_read_fields(mdb::Txn *txn, mdb::Row *r, int n_field,
+        Value *output, i32 *output_index) {
+    Value buf;
+    for (int col = 1; col <= n_field; col++) {
+        if (!txn->read_column(r, col, &buf))
+            return false;
+        output[(*output_index)++] = buf;
+    }
+    return true;
+}
+
+void YcsbPiece::reg_all() {
+    reg_pieces();
+}
+
+void YcsbPiece::reg_pieces() {
+    TxnRegistry::reg(YCSB_READ, YCSB_READ_0, DF_NO,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(row_map == NULL);
+        verify(input_size == 1);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        mdb::Table *tbl = txn->get_table(YCSB_TABLE);
+        int n_field = tbl->schema()->columns_count() - 1;
+        i32 output_index = 0;
+
+        mdb::Row *r = ycsb_row(txn, tbl, input[0], output_size != NULL,
+                header.pid);
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            std::vector<mdb::Row *> rows;
+            if (r != NULL)
+                rows.push_back(r);
+            ycsb_lock(header, input, input_size, res, txn, rows, n_field,
+                    true, 0);
+            return;
+        }
+
+        if (r != NULL) {
+            if (conflict_txns)
+                for (int col = 1; col <= n_field; col++)
+                    ((DepRow *)r)->get_dep_entry(col)->ro_touch(conflict_txns);
+            if (!ycsb_read_fields(txn, r, n_field, output, &output_index)) {
+                *res = REJECT;
+                *output_size = output_index;
+                return;
+            }
+        }
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+
+    // input: key, field, value
+    TxnRegistry::reg(YCSB_UPDATE, YCSB_UPDATE_0, DF_REAL,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(input_size == 3);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        mdb::Table *tbl = txn->get_table(YCSB_TABLE);
+        int n_field = tbl->schema()->columns_count() - 1;
+        int col = input[1].get_i32() + 1;
+        verify(col >= 1 && col <= n_field);
+        i32 output_index = 0;
+        mdb::Row *r = NULL;
+
+        if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
+            r = ycsb_row(txn, tbl, input[0], output_size != NULL, header.pid);
+        }
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            std::vector<mdb::Row *> rows;
+            if (r != NULL)
+                rows.push_back(r);
+            ycsb_lock(header, input, input_size, res, txn, rows, n_field,
+                    false, col);
+            return;
+        }
+
+        if (row_map) { // deptran
+            if (pv) { // start req
+                if (r != NULL) {
+                    (*row_map)[YCSB_TABLE][r->get_key()] = r;
+                    ((DepRow *)r)->get_dep_entry(col)->touch(tv, false);
+                }
+                return;
+            }
+            r = ycsb_deferred_row(row_map);
+        }
+
+        if (r != NULL && !txn->write_column(r, col, input[2])) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+
+    // input: key, field, value; output: the fields before the write
+    TxnRegistry::reg(YCSB_RMW, YCSB_RMW_0, DF_REAL,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(input_size == 3);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        mdb::Table *tbl = txn->get_table(YCSB_TABLE);
+        int n_field = tbl->schema()->columns_count() - 1;
+        int col = input[1].get_i32() + 1;
+        verify(col >= 1 && col <= n_field);
+        i32 output_index = 0;
+        mdb::Row *r = NULL;
+
+        if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
+            r = ycsb_row(txn, tbl, input[0], output_size != NULL, header.pid);
+        }
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            std::vector<mdb::Row *> rows;
+            if (r != NULL)
+                rows.push_back(r);
+            ycsb_lock(header, input, input_size, res, txn, rows, n_field,
+                    true, col);
+            return;
+        }
+
+        if (row_map) { // deptran
+            if (pv) { // start req
+                if (r != NULL) {
+                    (*row_map)[YCSB_TABLE][r->get_key()] = r;
+                    for (int c = 1; c <= n_field; c++)
+                        ((DepRow *)r)->get_dep_entry(c)->touch(tv, false);
+                }
+                return;
+            }
+            r = ycsb_deferred_row(row_map);
+        }
+
+        if (r != NULL) {
+            if (!ycsb_read_fields(txn, r, n_field, output, &output_index)
+                    || !txn->write_column(r, col, input[2])) {
+                *res = REJECT;
+                *output_size = output_index;
+                return;
+            }
+        }
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+
+    // input: start key, length; reads every field of the keys [start,
+    // start + length) this server has, output: their keys, as many as fit
+    TxnRegistry::reg(YCSB_SCAN, YCSB_SCAN_0, DF_NO,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        verify(row_map == NULL);
+        verify(input_size == 2);
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        mdb::Table *tbl = txn->get_table(YCSB_TABLE);
+        int n_field = tbl->schema()->columns_count() - 1;
+        i32 output_index = 0;
+
+        // query_in leaves out both ends
+        Value low((i32)(input[0].get_i32() - 1));
+        Value high((i32)(input[0].get_i32() + input[1].get_i32()));
+        mdb::ResultSet rs = txn->query_in(tbl, low, high,
+                output_size != NULL, header.pid);
+        std::vector<mdb::Row *> rows;
+        while (rs.has_next())
+            rows.push_back(rs.next());
+
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            ycsb_lock(header, input, input_size, res, txn, rows, n_field,
+                    true, 0);
+            return;
+        }
+
+        Value buf;
+        for (auto r : rows) {
+            if (conflict_txns)
+                for (int col = 1; col <= n_field; col++)
+                    ((DepRow *)r)->get_dep_entry(col)->ro_touch(conflict_txns);
+            for (int col = 1; col <= n_field; col++) {
+                if (!txn->read_column(r, col, &buf)) {
+                    *res = REJECT;
+                    *output_size = output_index;
+                    return;
+                }
+            }
+            if (output_index < *output_size)
+                output[output_index++] = r->get_column(0);
+        }
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+
+    // input: key, then every field
+    TxnRegistry::reg(YCSB_INSERT, YCSB_INSERT_0, DF_REAL,
+            [] (const RequestHeader& header,
+                const Value *input,
+                rrr::i32 input_size,
+                rrr::i32* res,
+                Value* output,
+                rrr::i32 *output_size,
+                row_map_t *row_map,
+                Vertex<PieInfo> *pv, Vertex<TxnInfo> *tv, std::vector<TxnInfo *> *conflict_txns) {
+        if (TxnRunner::get_running_mode() == MODE_2PL && output_size == NULL) {
+            TPL::get_2pl_proceed_callback(header, input, input_size, res)();
+            return;
+        }
+
+        mdb::Txn *txn = TxnRunner::get_txn(header);
+        mdb::Table *tbl = txn->get_table(YCSB_TABLE);
+        verify(input_size == (i32)tbl->schema()->columns_count());
+        i32 output_index = 0;
+        mdb::Row *r = NULL;
+
+        if (row_map == NULL || pv != NULL) { // non deptran || deptran start req
+            std::vector<Value> row_data(input, input + input_size);
+            switch (TxnRunner::get_running_mode()) {
+                case MODE_2PL:
+                    r = mdb::FineLockedRow::create(tbl->schema(), row_data);
+                    break;
+                case MODE_NONE:
+                case MODE_CALVIN:
+                case MODE_RPC_NULL:
+                case MODE_OCC:
+                    r = mdb::VersionedRow::create(tbl->schema(), row_data);
+                    break;
+                case MODE_DEPTRAN:
+                    r = DepRow::create(tbl->schema(), row_data);
+                    break;
+                case MODE_ROT:
+                    r = DepRow::create(tbl->schema(), row_data, true);
+                    break;
+                default:
+                    verify(0);
+            }
+        }
+
+        if (row_map) { // deptran
+            if (pv) { // start req
+                ((DepRow *)r)->get_dep_entry(0)->touch(tv, false);
+                (*row_map)[YCSB_TABLE][r->get_key()] = r;
+                return;
+            }
+            r = ycsb_deferred_row(row_map);
+            verify(r != NULL);
+        }
+
+        if (!txn->insert_row(tbl, r)) {
+            *res = REJECT;
+            *output_size = output_index;
+            return;
+        }
+        verify(*output_size >= output_index);
+        *output_size = output_index;
+        *res = SUCCESS;
+    });
+}
+
+}
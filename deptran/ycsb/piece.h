@@ -0,0 +1,46 @@
+#ifndef YCSB_PIECE_H_
+#define YCSB_PIECE_H_
+
+#include "all.h"
+
+namespace deptran {
+
+extern char YCSB_TABLE[];
+
+// every read, update and rmw has a piece per key, a scan one per server of
+// the table, an insert one
+#define YCSB_READ       1
+#define YCSB_UPDATE     2
+#define YCSB_RMW        3
+#define YCSB_SCAN       4
+#define YCSB_INSERT     5
+#define YCSB_READ_NAME      "READ"
+#define YCSB_UPDATE_NAME    "UPDATE"
+#define YCSB_RMW_NAME       "RMW"
+#define YCSB_SCAN_NAME      "SCAN"
+#define YCSB_INSERT_NAME    "INSERT"
+
+#define YCSB_READ_0     10
+#define YCSB_UPDATE_0   20
+#define YCSB_RMW_0      30
+#define YCSB_SCAN_0     40
+#define YCSB_INSERT_0   50
+
+// keys a client process inserts, above the populated ones
+#define YCSB_INSERT_SPAN (1 << 20)
+
+/** fields of a record, the columns of the table past the key */
+int ycsb_n_field();
+
+class YcsbPiece : public Piece {
+
+public:
+
+    void reg_all();
+
+    void reg_pieces();
+};
+
+}
+
+#endif // YCSB_PIECE_H_
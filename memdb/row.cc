@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "value.h"
 #include "row.h"
 #include "schema.h"
@@ -164,32 +166,50 @@ blob Row::get_blob(int column_id) const {
     return b;
 }
 
+// key view of the row as it would be after column_id is overwritten with b
+static MultiBlob key_with_column(const Schema* schema, const MultiBlob& key,
+                                 int column_id, const blob& b) {
+    MultiBlob new_key = key;
+    const std::vector<int>& key_cols = schema->key_columns_id();
+    for (size_t i = 0; i < key_cols.size(); i++) {
+        if (key_cols[i] == column_id) {
+            new_key[i] = b;
+        }
+    }
+    return new_key;
+}
+
 void Row::update_fixed(const Schema::column_info* col, void* ptr, int len) {
     verify(!rdonly_);
-    // check if really updating (new data!), and if necessary to remove/insert into table
-    bool re_insert = false;
+    // check if really updating (new data!), and if necessary to re-key inside table
     if (memcmp(&fixed_part_[col->fixed_size_offst], ptr, len) == 0) {
         // not really updating
         return;
     }
 
-    if (col->indexed) {
-        re_insert = true;
-    }
-
-    // save tbl_, because tbl_->remove() will set it to nullptr
     Table* tbl = tbl_;
-    if (re_insert && tbl != nullptr) {
-        tbl->notify_before_update(this, col->id);
-        tbl->remove(this, false);
+    if (!col->indexed || tbl == nullptr) {
+        memcpy(&fixed_part_[col->fixed_size_offst], ptr, len);
+        return;
     }
 
+    tbl->notify_before_update(this, col->id);
+
+    blob new_blob;
+    new_blob.data = (const char *) ptr;
+    new_blob.len = len;
+    MultiBlob old_key = get_key();
+    MultiBlob new_key = key_with_column(schema_, old_key, col->id, new_blob);
+
+    // tbl_ is set to nullptr if the table has to detach the row
+    bool detached = tbl->rekey(this, old_key, new_key);
+
     memcpy(&fixed_part_[col->fixed_size_offst], ptr, len);
 
-    if (re_insert && tbl != nullptr) {
+    if (detached) {
         tbl->insert(this);
-        tbl->notify_after_update(this, col->id);
     }
+    tbl->notify_after_update(this, col->id);
 }
 
 void Row::update(int column_id, const std::string& v) {
@@ -197,9 +217,7 @@ void Row::update(int column_id, const std::string& v) {
     const Schema::column_info* col = schema_->get_column_info(column_id);
     verify(col->type == Value::STR);
 
-    // check if really updating (new data!), and if necessary to remove/insert into table
-    bool re_insert = false;
-
+    // check if really updating (new data!), and if necessary to re-key inside table
     blob b;
     if (kind_ == SPARSE) {
         if (this->sparse_var_[col->var_size_idx] == v) {
@@ -213,27 +231,40 @@ void Row::update(int column_id, const std::string& v) {
         }
     }
 
-    if (col->indexed) {
-        re_insert = true;
-    }
+    // tiny optimization: in-place update if string size is not changed
+    bool in_place = (kind_ == DENSE && size_t(b.len) == v.size());
 
-    // save tbl_, because tbl_->remove() will set it to nullptr
     Table* tbl = tbl_;
-    if (re_insert && tbl != nullptr) {
+    bool re_key = (col->indexed && tbl != nullptr);
+    bool detached = false;
+    if (re_key) {
         tbl->notify_before_update(this, column_id);
-        tbl->remove(this, false);
+        if (in_place) {
+            blob new_blob;
+            new_blob.data = &v[0];
+            new_blob.len = v.size();
+            MultiBlob old_key = get_key();
+            MultiBlob new_key = key_with_column(schema_, old_key, column_id, new_blob);
+            detached = tbl->rekey(this, old_key, new_key);
+        } else {
+            // the var part is about to be reallocated, so keys held by the
+            // table would dangle; take the row out before touching it
+            tbl->remove(this, false);
+            detached = true;
+        }
     }
 
-    if (kind_ == DENSE && size_t(b.len) == v.size()) {
-        // tiny optimization: in-place update if string size is not changed
+    if (in_place) {
         memcpy(const_cast<char *>(b.data), &v[0], b.len);
     } else {
         this->make_sparse();
         this->sparse_var_[col->var_size_idx] = v;
     }
 
-    if (re_insert && tbl != nullptr) {
-        tbl->insert(this);
+    if (re_key) {
+        if (detached) {
+            tbl->insert(this);
+        }
         tbl->notify_after_update(this, column_id);
     }
 }
@@ -381,156 +412,290 @@ void FineLockedRow::unlock_column_by(column_id_t column_id, uint64_t lock_req_id
     //lock_[column_id]->abort(lock_req_id);
 }
 
-// RO-6: initialize static variable
-version_t MultiVersionedRow::ver_s = 0;
-
-/*
- * RO-6: Do garbage collection. First we record current system time and put it into time_segment
- * since we only call this function when processing x100th value.
- * Then, check which values are deprecated, remove them from old_values_, and also update
- * time_segment
- *
- * @param COLUMN_ID: the column we are updating and doing GC on
- * @oaram ITR: the iterator pointing to the latest (just updated) value entry <timestamp, Value> of
- * old_values_. We put this ITR into time_segment
- */
-void MultiVersionedRow::garbageCollection(int column_id, std::map<i64, Value>::iterator itr) {
-    // current system time in milliseconds
-    i64 currentTime = static_cast<i64>(time(NULL) * 1000);
-    i64 cutTime = currentTime - VERSION_SAFE_TIME;
-    // put itr (along with current time) into time_segment
-    time_segment[column_id].insert(std::pair<i64, std::map<i64, Value>::iterator>(currentTime, itr));
-    for (auto it = time_segment[column_id].begin(); it != time_segment[column_id].end(); ++it) {
-        if (it->first > cutTime) {
-            // we remove all elements up to this entry for both old_values_ and time_segment
-            if (it == time_segment[column_id].begin()) {
-                break;
-            }
-            std::map<i64, Value>::iterator recorded_itr = (--it)->second;
-            time_segment[column_id].erase(time_segment[column_id].begin(), ++it);
-            old_values_[column_id].erase(old_values_[column_id].begin(), ++recorded_itr);
-            break;
+std::atomic<version_t> MultiVersionedRow::clock_s(0);
+std::atomic<version_t> MultiVersionedRow::pending_clock_s(MultiVersionedRow::PENDING);
+std::atomic<version_t> MultiVersionedRow::stable_s(0);
+const version_t MultiVersionedRow::PENDING;
+const version_t MultiVersionedRow::NO_PIN;
+const int MultiVersionedRow::MAX_PIN_SLOTS;
+MultiVersionedRow::pin_slot_t MultiVersionedRow::pin_slots_s[MAX_PIN_SLOTS];
+std::atomic<int> MultiVersionedRow::n_pin_slots_s(0);
+std::atomic<version_t> MultiVersionedRow::gc_floor_s(0);
+std::vector<MultiVersionedRow*> MultiVersionedRow::collect_s;
+
+// the write set of the txn executing on this thread, if any
+static thread_local MultiVersionedRow::write_set_t* writing_s = nullptr;
+
+MultiVersionedRow::~MultiVersionedRow() {
+    if (chain_ != nullptr) {
+        for (size_t i = 0; i < schema_->columns_count(); i++) {
+            free_chain(chain_[i]);
         }
     }
+    delete[] chain_;
+    delete[] ver_;
 }
 
-/*
- * RO-6: get most recent version number for this column.
- * Used when a write needs to record version number for a later read to query at
- */
-version_t MultiVersionedRow::getCurrentVersion(int column_id) {
-    std::map<i64, Value>::iterator itr = old_values_[column_id].end();
-    return (--itr)->first;
-}
-
-/*
- * RO-6: get a value associated with a specific version number
- * @param COLUMN_ID: specify a column
- * @param VERSION_NUM: specify a version number (timestamp) to query with
- *
- * @return: an old value
- */
-Value MultiVersionedRow::get_column_by_version(int column_id, i64 version_num) const {
-    //return old_values_[column_id][version_num];
-    Value v;    // stub
-    return v;   // need to modify this later
-}
-/*
- * RO-6: check ReadTxnIdTracker to get specific version number for reads to query with;
- * We also update it when we have writes coming with a vector of rtxn_ids (those ids were got via
- * that write's dep_check and will be put into Tracker for later possible reads)
- *
- * Write will update the stored version number for each rtxn_id
- * Read will simply fetch needed information
- */
-
-/*
-version_t ReadTxnIdTracker::checkIfTxnIdBeenRecorded(int column_id, i64 txnId, bool forWrites, version_t chosenVersion) {
-    version_t txnTimeToReturn = 0;
-    //recordTime is real time for garbage collection
-    i64 recordTime = static_cast<i64>(time(NULL) * 1000);
-    version_t txnTime = !forWrites ? 0 : chosenVersion;  // a place holder, txnTime should be filled in by writes
-                                                      // after done dep_check
-    //prepare time entry for this transaction. A time entry has transaction's effective time and record time
-    TxnTimes timesEntry = std::make_pair(txnTime, recordTime);
-    //ReadTxnEntry txnIdList = keyToReadTxnIds.get(locatorKey);
-    ReadTxnEntry* rtxn_entry = &keyToReadTxnIds[column_id];
-    if (rtxn_entry->size() == 0) {
-        //the locator_key is even not touched by other read txns yet
-        ReadTxnEntry read_txn_entry;
-        read_txn_entry[txnId] = timesEntry;
-        *rtxn_entry = read_txn_entry;
-        keyToLastAccessedTime[column_id] = recordTime;
-    }
-    else {
-        i64 safetyTime = recordTime - VERSION_SAFE_TIME;
-        // this key has not been checked by dep_check for a while, we need to explicitly do garbage collection
-        if (keyToLastAccessedTime[column_id] < safetyTime) {
-            for (std::pair<i64, TxnTimes> txn_entry : *rtxn_entry) {
-                if (txn_entry.second.second < safetyTime) {
-                    rtxn_entry->erase(txn_entry.first);
-                }
-            }
-            keyToLastAccessedTime[column_id] = recordTime;
+void MultiVersionedRow::copy_into(MultiVersionedRow* row) const {
+    this->Row::copy_into((Row *) row);
+    if (!versioned()) {
+        return;
+    }
+    int n_columns = schema_->columns_count();
+    row->init_ver(n_columns, created_);
+    memcpy(row->ver_, this->ver_, n_columns * sizeof(version_t));
+    for (int i = 0; i < n_columns; i++) {
+        old_version** tail = &row->chain_[i];
+        for (old_version* v = this->chain_[i]; v != nullptr; v = v->older) {
+            *tail = new old_version(v->ver, v->val, nullptr);
+            tail = &(*tail)->older;
         }
-        //ReadTxnEntry read_txn_entry = keyToReadTxnIds[column_id];
+    }
+}
 
-        //ArrayList<Long> findTxnId = txnIdList.get(txnId);
-        if (rtxn_entry->find(txnId) == rtxn_entry->end()) {
-            // locator_key exists but this txnId is not in the record
-            (*rtxn_entry)[txnId] = timesEntry;
-        } else {
-            // if we did find this txnId recorded before, then we return its effective time
-            // if forWrites, to see if we need to update the txnTime, we keep the min of all txnTimes of this txnId
-            txnTimeToReturn = (*rtxn_entry)[txnId].first;
-            if (forWrites) {
-                if (txnTimeToReturn > txnTime ) {
-                    (*rtxn_entry)[txnId].first = txnTime; //update txnTime
-                }
+bool MultiVersionedRow::push_version(int column_id, version_t ver) {
+    // pending writes go on top in execution order, whatever their stamps
+    if (!is_pending(ver) && ver < ver_[column_id]) {
+        return false;
+    }
+    chain_[column_id] = new old_version(ver_[column_id], Row::get_column(column_id), chain_[column_id]);
+    ver_[column_id] = ver;
+    return true;
+}
+
+void MultiVersionedRow::install(int column_id, const Value& v) {
+    switch (v.get_kind()) {
+    case Value::I32:
+        Row::update(column_id, v.get_i32());
+        break;
+    case Value::I64:
+        Row::update(column_id, v.get_i64());
+        break;
+    case Value::DOUBLE:
+        Row::update(column_id, v.get_double());
+        break;
+    case Value::STR:
+        Row::update(column_id, v.get_str());
+        break;
+    default:
+        Log::fatal("unexpected value type %d", v.get_kind());
+        verify(0);
+        break;
+    }
+}
+
+bool MultiVersionedRow::update(int column_id, const Value& v, version_t commit_ver) {
+    if (!versioned()) {
+        install(column_id, v);
+        return true;
+    }
+    if (!push_version(column_id, commit_ver)) {
+        return false;
+    }
+    install(column_id, v);
+    if (is_pending(commit_ver)) {
+        track(commit_ver);
+    }
+    gc(column_id);
+    if (chain_[column_id] != nullptr && !collecting_) {
+        // a snapshot still needs the old version, trim it in collect()
+        collecting_ = true;
+        collect_s.push_back((MultiVersionedRow *) this->ref_copy());
+    }
+    return true;
+}
+
+void MultiVersionedRow::track(version_t pending) {
+    verify(writing_s != nullptr && writing_s->pending == pending);
+    std::vector<MultiVersionedRow*>& rows = writing_s->rows;
+    if (std::find(rows.begin(), rows.end(), this) == rows.end()) {
+        rows.push_back((MultiVersionedRow *) this->ref_copy());
+    }
+}
+
+void MultiVersionedRow::restamp(version_t from, version_t to) {
+    if (created_ == from) {
+        created_ = to;
+    }
+    for (size_t i = 0; i < schema_->columns_count(); i++) {
+        if (ver_[i] == from) {
+            ver_[i] = to;
+        }
+        for (old_version* v = chain_[i]; v != nullptr; v = v->older) {
+            if (v->ver == from) {
+                v->ver = to;
             }
         }
     }
-    // if txnTimeToReturn not equal to 0, then it also means we found this txnId in our record
-    return txnTimeToReturn;
-}
-*/
-/*
- * This will be called by a dep_checkee, the server that a write check dependencies against.
- * It will check Tracker to see if there were read transactions recorded. If so, get those Ids and
- * return them to coordinator, and then coordinator will pass them to the dep_checker server.
- */
-/*
-std::vector<i64> ReadTxnIdTracker::getReadTxnIds(int column_id) {
-    std::vector<i64> returnedIdList;
-    if (keyToReadTxnIds.find(column_id) == keyToReadTxnIds.end())
-        return returnedIdList;
-    i64 currentTime = static_cast<i64>(time(NULL) * 1000);
-    i64 safeTime = currentTime - VERSION_SAFE_TIME;
-    ReadTxnEntry* rtxn_entry = &keyToReadTxnIds[column_id];
-    for (std::pair<i64, TxnTimes> entry : *rtxn_entry) {
-        if (entry.second.second >= safeTime) {
-            returnedIdList.push_back(entry.first);
+}
+
+void MultiVersionedRow::begin_write(write_set_t* ws) {
+    verify(writing_s == nullptr);
+    if (ws->pending == 0) {
+        ws->pending = pending_clock_s++;
+    }
+    writing_s = ws;
+}
+
+void MultiVersionedRow::end_write() {
+    verify(writing_s != nullptr);
+    writing_s = nullptr;
+}
+
+version_t MultiVersionedRow::write_version() {
+    if (writing_s != nullptr) {
+        return writing_s->pending;
+    }
+    version_t ver = next_version();
+    make_stable(ver);
+    return ver;
+}
+
+void MultiVersionedRow::publish(write_set_t* ws, version_t ver) {
+    verify(!is_pending(ver));
+    for (auto row : ws->rows) {
+        row->restamp(ws->pending, ver);
+        row->release();
+    }
+    ws->rows.clear();
+    ws->pending = 0;
+}
+
+void MultiVersionedRow::make_stable(version_t ver) {
+    version_t stable = stable_s.load();
+    while (stable < ver && !stable_s.compare_exchange_weak(stable, ver)) {
+    }
+}
+
+bool MultiVersionedRow::get_column_by_version(int column_id, version_t ver, Value* value) const {
+    if (!versioned() || ver_[column_id] <= ver) {
+        *value = Row::get_column(column_id);
+        return true;
+    }
+    for (old_version* v = chain_[column_id]; v != nullptr; v = v->older) {
+        if (v->ver <= ver) {
+            *value = v->val;
+            return true;
+        }
+    }
+    // the snapshot was not pinned, its version has been collected
+    return false;
+}
+
+int MultiVersionedRow::version_count(int column_id) const {
+    int count = 0;
+    if (!versioned()) {
+        return count;
+    }
+    for (old_version* v = chain_[column_id]; v != nullptr; v = v->older) {
+        count++;
+    }
+    return count;
+}
+
+void MultiVersionedRow::gc(int column_id) {
+    if (!versioned() || chain_[column_id] == nullptr) {
+        return;
+    }
+    // announce the watermark before looking again, a pin published in
+    // between either shows up in the second look or sees the new floor
+    version_t watermark = gc_watermark();
+    version_t floor = gc_floor_s.load();
+    while (floor < watermark && !gc_floor_s.compare_exchange_weak(floor, watermark)) {
+    }
+    watermark = std::min(watermark, gc_watermark());
+
+    if (ver_[column_id] <= watermark) {
+        // every reader sees the current value
+        free_chain(chain_[column_id]);
+        chain_[column_id] = nullptr;
+        return;
+    }
+    // keep everything newer than the watermark, plus the version the oldest
+    // reader sees
+    old_version* v = chain_[column_id];
+    while (v != nullptr && v->ver > watermark) {
+        v = v->older;
+    }
+    if (v != nullptr) {
+        free_chain(v->older);
+        v->older = nullptr;
+    }
+}
+
+void MultiVersionedRow::gc() {
+    for (size_t i = 0; i < schema_->columns_count(); i++) {
+        gc(i);
+    }
+}
+
+void MultiVersionedRow::collect() {
+    size_t kept = 0;
+    for (size_t i = 0; i < collect_s.size(); i++) {
+        MultiVersionedRow* row = collect_s[i];
+        row->gc();
+        bool has_old = false;
+        for (size_t c = 0; c < row->schema_->columns_count(); c++) {
+            has_old = has_old || row->chain_[c] != nullptr;
+        }
+        if (has_old) {
+            collect_s[kept++] = row;
         } else {
-            rtxn_entry->erase(entry.first);
+            row->collecting_ = false;
+            row->release();
         }
     }
-    keyToLastAccessedTime[column_id] = currentTime;
-    return returnedIdList;
-}
-*/
-/*
- * Comment this out here, but we need this functionality when move all implementation to upper level
- * -> RO6DTxn
-Value MultiVersionedRow::get_column(int column_id, i64 txnId) const {
-    version_t version_number = rtxn_tracker.checkIfTxnIdBeenRecorded(column_id, txnId, false, 0);
-    if (version_number != 0) {
-        return get_column_by_version(column_id, version_number);
-    } else {
-        return Row::get_column(column_id);
+    collect_s.resize(kept);
+}
+
+int MultiVersionedRow::pin_slot() {
+    static thread_local int slot = -1;
+    if (slot < 0) {
+        slot = n_pin_slots_s++;
+        verify(slot < MAX_PIN_SLOTS);
     }
+    return slot;
+}
+
+MultiVersionedRow::pin_t MultiVersionedRow::pin_snapshot(version_t ver) {
+    pin_t pin;
+    pin.slot = pin_slot();
+    pin_slot_t& s = pin_slots_s[pin.slot];
+    s.lock.lock();
+    // publish first, then check the floor: a gc that missed the pin has
+    // raised the floor by then, and nothing at or above it is collected
+    pin.ver = std::min(ver, clock_s.load());
+    auto it = s.pins.insert(pin.ver);
+    s.oldest.store(*s.pins.begin());
+    version_t floor = gc_floor_s.load();
+    if (floor > pin.ver) {
+        s.pins.erase(it);
+        pin.ver = floor;
+        s.pins.insert(pin.ver);
+        s.oldest.store(*s.pins.begin());
+    }
+    s.lock.unlock();
+    return pin;
+}
+
+void MultiVersionedRow::unpin_snapshot(const pin_t& pin) {
+    pin_slot_t& s = pin_slots_s[pin.slot];
+    s.lock.lock();
+    auto it = s.pins.find(pin.ver);
+    verify(it != s.pins.end());
+    s.pins.erase(it);
+    s.oldest.store(s.pins.empty() ? NO_PIN : *s.pins.begin());
+    s.lock.unlock();
+}
+
+version_t MultiVersionedRow::gc_watermark() {
+    version_t watermark = clock_s.load();
+    int n_slots = std::min(n_pin_slots_s.load(), MAX_PIN_SLOTS);
+    for (int i = 0; i < n_slots; i++) {
+        watermark = std::min(watermark, pin_slots_s[i].oldest.load());
+    }
+    return watermark;
 }
-*/
-// **** deprecated **** //
 
 } // namespace mdb
 
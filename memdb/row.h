@@ -1,10 +1,11 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <vector>
 #include <string>
-#include <ctime>
+#include <atomic>
 
 #include "utils.h"
 #include "schema.h"
@@ -18,11 +19,6 @@ namespace mdb {
 class Schema;
 class Table;
 
-// RO-6: do GC for every GC_THRESHOLD old values
-const int GC_THRESHOLD = 100;
-// RO-6: GC time for striping out old versions = 5000 ms
-const int VERSION_SAFE_TIME = 5000;
-
 class Row: public RefCounted {
     // fixed size part
     char* fixed_part_;
@@ -93,6 +89,12 @@ public:
     const Schema* schema() const {
         return schema_;
     }
+    // start pulling the row and its fixed columns into cache, a read of
+    // them follows soon
+    void prefetch() const {
+        __builtin_prefetch(this);
+        __builtin_prefetch(fixed_part_);
+    }
     bool readonly() const {
         return rdonly_;
     }
@@ -549,17 +551,122 @@ public:
 };
 
 /*
- * RO-6: This class defines a row which keeps old versions of each column.
- * Old versions are stored in a map of maps <column_id, map<timestamp, value> >.
- * column_id is used to point to specific columns; then for each column, it stores
- * old values and each old value is associated a timestamp to uniquely identify each version.
+ * RO-6: A row that keeps old versions of its columns for snapshot reads.
+ *
+ * The current value of a column lives in the row itself, stamped with the
+ * commit timestamp that wrote it. An update pushes the overwritten value onto
+ * the column's version chain (newest to oldest), so a read at snapshot ts
+ * returns the first version committed at or before ts.
  *
- * We use a global counter ver_s as timestamp.
+ * Writes of a txn are stamped with one pending timestamp while it executes,
+ * above every commit timestamp and so invisible to every snapshot, and get
+ * a single commit timestamp when the txn is decided, see publish(). A
+ * snapshot at stable_version() or below therefore sees each txn either
+ * whole or not at all.
  *
- * Then, O(1) for querying a specific old version; O(k/GC_THRESHOLD) for garbage collection - k is constant as number
- * of versions on average are kept within 5 secs.
+ * Timestamps come from a process wide atomic clock. A snapshot reader pins its
+ * timestamp for as long as it reads old versions; the oldest pinned timestamp
+ * is the GC watermark, and versions superseded at or before it can no longer
+ * be seen by anybody. Those are cut off the chain when the column is updated
+ * again, so a chain only holds versions some active reader may still need.
  */
 class MultiVersionedRow: public Row {
+
+    struct old_version {
+        version_t ver;
+        Value val;
+        old_version* older;
+
+        old_version(version_t v, const Value& value, old_version* next)
+            : ver(v), val(value), older(next) {}
+    };
+
+    // per column: commit timestamp of the current value, and the chain of
+    // values it replaced
+    version_t* ver_;
+    old_version** chain_;
+
+    // commit timestamp of the insert that created the row
+    version_t created_;
+
+    static void free_chain(old_version* v) {
+        while (v != nullptr) {
+            old_version* older = v->older;
+            delete v;
+            v = older;
+        }
+    }
+
+    // keep the current value in the chain, stamp the column with ver; false
+    // if the column already holds a newer version
+    bool push_version(int column_id, version_t ver);
+
+    // write without versioning, bypassing our own update overrides
+    void install(int column_id, const Value& v);
+
+    // whether the row is on the collect list
+    bool collecting_;
+
+    static std::atomic<version_t> clock_s;
+
+    // pending stamps count up from PENDING, one per write set
+    static std::atomic<version_t> pending_clock_s;
+
+    // newest timestamp whose writes are all published
+    static std::atomic<version_t> stable_s;
+
+    // one slot per thread that pins snapshots, holding the oldest version
+    // pinned through it. Pins are dropped through the slot they were taken
+    // on, from whatever thread, hence the lock
+    struct pin_slot_t {
+        std::atomic<version_t> oldest;
+        base::SpinLock lock;
+        std::multiset<version_t> pins;
+
+        pin_slot_t(): oldest(NO_PIN) {}
+    };
+    static const version_t NO_PIN = ~(version_t) 0;
+    static const int MAX_PIN_SLOTS = 256;
+    static pin_slot_t pin_slots_s[MAX_PIN_SLOTS];
+    static std::atomic<int> n_pin_slots_s;
+    static int pin_slot();
+
+    // no version below the floor is guaranteed to be kept: every gc raises
+    // it to its watermark before trimming
+    static std::atomic<version_t> gc_floor_s;
+
+    // rows that kept old versions when they were last updated
+    static std::vector<MultiVersionedRow*> collect_s;
+
+protected:
+
+    MultiVersionedRow(): ver_(nullptr), chain_(nullptr), created_(0), collecting_(false) {}
+
+    // all columns start out at the creation timestamp, see write_version()
+    void init_ver(int n_columns, version_t created) {
+        ver_ = new version_t[n_columns];
+        chain_ = new old_version*[n_columns];
+        created_ = created;
+        for (int i = 0; i < n_columns; i++) {
+            ver_[i] = created;
+        }
+        memset(chain_, 0, sizeof(old_version*) * n_columns);
+        if (is_pending(created)) {
+            track(created);
+        }
+    }
+
+    // remember the row in the write set of the thread, stamped pending
+    void track(version_t pending);
+
+    // every timestamp from into to, of the row and of its old versions
+    void restamp(version_t from, version_t to);
+
+    // protected dtor as required by RefCounted
+    ~MultiVersionedRow();
+
+    void copy_into(MultiVersionedRow* row) const;
+
 public:
 
     virtual symbol_t rtti() const {
@@ -572,114 +679,157 @@ public:
         return row;
     }
 
-    /*
-     * Update the list of old versions for each row update
-     * Overrides Row::update(~)
-     * For update, simply push to the back of the map;
-     *
-     * We create similar functions for different augment types
-     *
-     * Note: We need to pass set of read_txn_ids taken on by each write txn all the way down to here
-     */
-    void update(int column_id, i64 v) {
-        update_internal(column_id, v);
+    // false for rows created without versions, which update in place and
+    // read the same at every snapshot
+    bool versioned() const {
+        return ver_ != nullptr;
     }
 
+    // every update is stamped with write_version()
+    void update(int column_id, i64 v) {
+        if (!versioned()) {
+            Row::update(column_id, v);
+            return;
+        }
+        update(column_id, Value(v), write_version());
+    }
     void update(int column_id, i32 v) {
-        update_internal(column_id, v);
+        if (!versioned()) {
+            Row::update(column_id, v);
+            return;
+        }
+        update(column_id, Value(v), write_version());
     }
-
     void update(int column_id, double v) {
-        update_internal(column_id, v);
+        if (!versioned()) {
+            Row::update(column_id, v);
+            return;
+        }
+        update(column_id, Value(v), write_version());
     }
-
     void update(int column_id, const std::string& str) {
-        update_internal(column_id, str);
+        if (!versioned()) {
+            Row::update(column_id, str);
+            return;
+        }
+        update(column_id, Value(str), write_version());
     }
-
     void update(int column_id, const Value& v) {
-        update_internal(column_id, v);
+        if (!versioned()) {
+            install(column_id, v);
+            return;
+        }
+        update(column_id, v, write_version());
     }
 
-    /*
-     * For update by column name
-     */
     void update(const std::string& col_name, i64 v) {
         this->update(schema_->get_column_id(col_name), v);
     }
-
     void update(const std::string& col_name, i32 v) {
         this->update(schema_->get_column_id(col_name), v);
     }
-
     void update(const std::string& col_name, double v) {
         this->update(schema_->get_column_id(col_name), v);
     }
-
     void update(const std::string& col_name, const std::string& str) {
         this->update(schema_->get_column_id(col_name), str);
     }
-
     void update(const std::string& col_name, const Value& v) {
         this->update(schema_->get_column_id(col_name), v);
     }
 
+    // update committed at a given timestamp, e.g. the commit timestamp
+    // assigned to the writing transaction. False, and nothing written, if
+    // the column already holds a version newer than commit_ver
+    bool update(int column_id, const Value& v, version_t commit_ver);
+
+    // commit timestamp of the current value
+    version_t get_column_ver(column_id_t column_id) const {
+        return versioned() ? ver_[column_id] : created_;
+    }
+
+    // commit timestamp of the insert, the row does not exist in snapshots
+    // taken before it
+    version_t get_create_ver() const {
+        return created_;
+    }
+    bool visible_at(version_t ver) const {
+        return created_ <= ver;
+    }
+
+    // snapshot read: the value of the column as of timestamp ver. False if
+    // that version has been collected, i.e. ver was not pinned
+    bool get_column_by_version(int column_id, version_t ver, Value* value) const;
+
+    // number of old versions kept for the column
+    int version_count(int column_id) const;
 
+    // drop the versions nobody can see any more
+    void gc(int column_id);
+    void gc();
 
-    /*
-     * For reads, we need the id for this read txn
-    Value get_column(int column_id, i64 txnId) const;
+    // gc the rows that kept old versions on their last update, e.g. after
+    // a snapshot has been unpinned. Rows are only trimmed on update
+    // otherwise. Like updates, not thread safe against other row access
+    static void collect();
 
-    Value get_column(const std::string& col_name, i64 txnId) const {
-        return get_column(schema_->get_column_id(col_name), txnId);
+    static version_t next_version() {
+        return ++clock_s;
+    }
+    static version_t current_version() {
+        return clock_s.load();
     }
-     */
 
-    // retrieve current version number
-    version_t getCurrentVersion(int column_id);
+    // stamps at or above PENDING belong to writes not published yet
+    static const version_t PENDING = (version_t) 1 << 63;
+    static bool is_pending(version_t ver) {
+        return ver >= PENDING;
+    }
 
-    // get a value specified by a version number
-    Value get_column_by_version(int column_id, i64 version_num) const;
+    // the rows a txn wrote, stamped pending until it is published
+    struct write_set_t {
+        version_t pending;
+        std::vector<MultiVersionedRow*> rows;
 
-    // TODO: do some tests to see how slow it is
+        write_set_t(): pending(0) {}
+    };
 
-private:
-    static version_t ver_s;
+    // writes on this thread go to ws, until end_write()
+    static void begin_write(write_set_t* ws);
+    static void end_write();
 
-    // garbage collection
-    void garbageCollection(int column_id, std::map<i64, Value>::iterator itr);
+    // the pending stamp of the write set of this thread, or outside of
+    // one a fresh commit timestamp, stable at once
+    static version_t write_version();
 
-    // Internal update logic, a template function to accomodate all types
-    template<typename Type>
-    void update_internal(int column_id, Type v) {
-        // first get current value before update, and put current value in old_values_
-        Value currentValue = Row::get_column(column_id);
-        // get current version
-        version_t currentVersionNumber = getCurrentVersion(column_id);
-        // push this new value to the old versions map
-        std::pair <i64, Value> valueEntry = std::make_pair(next_version(), currentValue);
-        // insert this old version to old_values_
-        std::map<i64, Value>::iterator newElementItr = (old_values_[column_id].insert(valueEntry)).first;
-        if (old_values_[column_id].size() % GC_THRESHOLD == 0) {
-            // do Garbage Collection
-            garbageCollection(column_id, newElementItr);
-        }
+    // stamp all writes of ws with commit timestamp ver, a fresh
+    // next_version(). Txns published at the same ver are seen together
+    // once make_stable(ver) is called
+    static void publish(write_set_t* ws, version_t ver);
+    static void make_stable(version_t ver);
 
-        /*
-         * Should move this part to upper level -> RO6DTxn
-        // Now we need to update rtxn_tracker first
-        for (i64 txnId : txnIds) {
-            rtxn_tracker.checkIfTxnIdBeenRecorded(column_id, txnId, true, currentVersionNumber);
-        }
-         */
-        // then update column as normal
-        Row::update(column_id, v);
+    // newest timestamp a snapshot may read at: no txn is seen in part
+    static version_t stable_version() {
+        return stable_s.load();
     }
 
-public:
-    static version_t next_version() {
-        return ++MultiVersionedRow::ver_s;
+    // a pinned snapshot, versions it can see are kept until it is unpinned
+    struct pin_t {
+        version_t ver;
+        int slot;
+    };
+
+    // pin the current timestamp as a snapshot
+    static pin_t pin_snapshot() {
+        return pin_snapshot(NO_PIN);
     }
+    // pin a snapshot no newer than ver. It may come out newer than ver
+    // if gc has already moved past it
+    static pin_t pin_snapshot(version_t ver);
+    // from any thread
+    static void unpin_snapshot(const pin_t& pin);
+    // oldest pinned snapshot, or the current timestamp if there is none
+    static version_t gc_watermark();
 
     template <class Container>
     static MultiVersionedRow* create(const Schema* schema, const Container& values) {
@@ -691,67 +841,9 @@ public:
             fill_counter++;
         }
         MultiVersionedRow* raw_row = new MultiVersionedRow();
+        raw_row->init_ver(schema->columns_count(), write_version());
         return (MultiVersionedRow * ) Row::create(raw_row, schema, values_ptr);
     }
-    /*
-     * These functions are for testing purpoes. Uncomment them to use
-     *
-    int getTotalVerionNums(int column_id) {
-        return old_values_[column_id].size();
-    }
-
-    i64 getVersionHead(int column_id) {
-        return old_values_[column_id].begin()->second.get_i64();
-    }
-
-    i64 getVersionTail(int column_id) {
-        return (--old_values_[column_id].end())->second.get_i64();
-    }
-     *
-     */
-private:
-    // data structure to keep all old versions for a row
-    std::map<column_id_t, std::map<i64, Value> > old_values_;
-    // data structure to keep real time for each 100 versions. used for GC
-    std::map<column_id_t, std::map<i64, std::map<i64, Value>::iterator> >time_segment;
-    // one ReadTxnIdTracker object for each row, for tracking seen read trasactions
-    // should be tracked and updated by *this* row's update and read.
-    //ReadTxnIdTracker rtxn_tracker;
 };
 
-/*
- * RO-6: A class that keeps tracking of observed read txns.
- * A write (row_update/insert/delete) should update this class of the corresponding row first by
- * doing dep_check on a remote row, get rtxn_ids from there, and update its own row's keyToReadTxnIds map
- * A read will also check this map first to see if it needs to query an old version. The targetted version
- * number will be also included in this map if so.
- *
- * Should be instantiated only by MultiVersionedRow class privately.
- */
-/*
-class ReadTxnIdTracker {
-public:
-    std::map<int, i64> keyToLastAccessedTime;
-
-    version_t checkIfTxnIdBeenRecorded(int column_id, i64 txnId, bool forWrites, version_t chosenVersion);
-
-    std::vector<i64> getReadTxnIds(int column_id);
-
-    void clearContext() {
-        keyToReadTxnIds.clear();
-        keyToLastAccessedTime.clear();
-    }
-
-private:
-    // a pair of information for each read txn (txn_id) we recorded.
-    // first i64 is version number that will be used for later read. Second i64 is the real sys time when this txn_id
-    // is recorded (for GC use)
-    typedef std::pair<i64, i64> TxnTimes;
-    // One entry is for one read txn. i64 is txn_id.
-    typedef std::map<i64, TxnTimes> ReadTxnEntry;
-    // The main data structure used to keep a list of recorded read txns.
-    // "int" is column_id. We
-    std::map<int, ReadTxnEntry> keyToReadTxnIds;
-};
-*/
 } // namespace mdb
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <inttypes.h>
+#include <algorithm>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "utils.h"
 
@@ -54,7 +56,36 @@ public:
     typedef Iterator iterator;
 
     snapshot_range(const Snapshot& snapshot, Iterator it_begin, Iterator it_end)
-        : snapshot_(snapshot), begin_(it_begin), end_(it_end), next_(it_begin), cached_(false), count_(-1) {}
+        : snapshot_(snapshot), begin_(it_begin), end_(it_end), next_(it_begin), cached_(false), count_(-1) {
+        snapshot_.pin_iterators();
+    }
+
+    // every live range holds iterators into the shared data, so compaction
+    // in the group has to wait until all of them are gone
+    snapshot_range(const snapshot_range& o)
+        : snapshot_(o.snapshot_), begin_(o.begin_), end_(o.end_), next_(o.next_),
+          cached_(o.cached_), cached_next_(o.cached_next_), count_(o.count_) {
+        snapshot_.pin_iterators();
+    }
+
+    const snapshot_range& operator= (const snapshot_range& o) {
+        if (this != &o) {
+            snapshot_.unpin_iterators();
+            snapshot_ = o.snapshot_;
+            snapshot_.pin_iterators();
+            begin_ = o.begin_;
+            end_ = o.end_;
+            next_ = o.next_;
+            cached_ = o.cached_;
+            cached_next_ = o.cached_next_;
+            count_ = o.count_;
+        }
+        return *this;
+    }
+
+    ~snapshot_range() {
+        snapshot_.unpin_iterators();
+    }
 
     Iterator begin() const {
         return begin_;
@@ -63,6 +94,11 @@ public:
         return end_;
     }
 
+    void reset() {
+        next_ = begin_;
+        cached_ = false;
+    }
+
     bool has_next() {
         if (cached_) {
             return true;
@@ -104,11 +140,14 @@ struct snapshot_group: public RefCounted {
     // the writer of the group, nullptr means nobody can write to the group
     Snapshot* writer;
 
-    // how many insert/erase has been done since last snapshot
+    // how many insert/erase has been done since last gc
     size_t gc_insert_counter;
     size_t gc_erase_counter;
 
-    snapshot_group(Snapshot* w): writer(w), gc_insert_counter(0), gc_erase_counter(0) {}
+    // number of live ranges iterating over data
+    size_t iterators;
+
+    snapshot_group(Snapshot* w): writer(w), gc_insert_counter(0), gc_erase_counter(0), iterators(0) {}
 
     // protected dtor as required by RefCounted
 protected:
@@ -265,6 +304,7 @@ public:
         versioned_value<Value> vv(ver_, value);
         insert_into_map(ssg_->data, key, vv);
         ssg_->gc_insert_counter++;
+        gc_auto();
     }
 
     void insert(const value_type& kv_pair) {
@@ -273,6 +313,7 @@ public:
         versioned_value<Value> vv(ver_, kv_pair.second);
         insert_into_map(ssg_->data, kv_pair.first, vv);
         ssg_->gc_insert_counter++;
+        gc_auto();
     }
 
     template <class Iterator>
@@ -285,6 +326,7 @@ public:
             ssg_->gc_insert_counter++;
             ++begin;
         }
+        gc_auto();
     }
 
     template <class RangeType>
@@ -297,6 +339,7 @@ public:
             insert_into_map(ssg_->data, kv_pair.first, vv);
             ssg_->gc_insert_counter++;
         }
+        gc_auto();
     }
 
     void erase(const Key& key, bool first_match_only = false) {
@@ -316,6 +359,7 @@ public:
                     break;
                 }
             }
+            gc_auto();
         } else {
             // no body can observe the removed keys, so directly erase them
             if (first_match_only) {
@@ -345,6 +389,7 @@ public:
                     }
                 }
             }
+            gc_auto();
         } else {
             // no body can observe the removed key value pair, so directly erase it
             auto it = ssg_->data.lower_bound(key);
@@ -374,6 +419,7 @@ public:
                 if (it->second.valid_at(orig_ver)) {
                     // only remove visible values
                     it->second.remove(ver_);
+                    ssg_->gc_erase_counter++;
                 }
                 ++it;
             }
@@ -395,6 +441,7 @@ public:
                 if (it->second.valid_at(orig_ver)) {
                     // only remove visible values
                     it->second.remove(ver_);
+                    ssg_->gc_erase_counter++;
                 }
                 ++it;
             }
@@ -462,29 +509,37 @@ public:
         return this->ssg_->gc_insert_counter + this->ssg_->gc_erase_counter;
     }
 
+    void pin_iterators() const {
+        this->ssg_->iterators++;
+    }
+
+    void unpin_iterators() const {
+        verify(this->ssg_->iterators > 0);
+        this->ssg_->iterators--;
+    }
+
     // explicit garbage collection
     // function marked as const so it can be called from const ref/ptr
     void gc_run() const {
-        version_t ver_low = this->ver_;
-        version_t ver_high = -1;
+        verify(ssg_->iterators == 0);
+
+        // only versions of group members can ever be observed, new snapshots
+        // copy one of them and the writer only moves forward
+        std::vector<version_t> vers;
         const snapshot_sortedmap* p = this;
         const snapshot_sortedmap* q = this;
         do {
-            if (q->ver_ < ver_low) {
-                ver_low = q->ver_;
-            }
-            if (q->ver_ > ver_high) {
-                ver_high = q->ver_;
-            }
+            vers.push_back(q->ver_);
             q = q->next_;
         } while(q != p);
+        std::sort(vers.begin(), vers.end());
 
-        // found ver_low and ver_high, drop keys that
-        // created_at > ver_high || (removed_at == -1 && removed_at < ver_low)
+        // drop values that no member is valid_at
         auto it = ssg_->data.begin();
         while (it != ssg_->data.end()) {
             const versioned_value<Value>& vv = it->second;
-            if (vv.created_at > ver_high || (vv.removed_at != -1 && vv.removed_at < ver_low)) {
+            auto first_seen = std::lower_bound(vers.begin(), vers.end(), vv.created_at);
+            if (first_seen == vers.end() || (vv.removed_at != -1 && *first_seen >= vv.removed_at)) {
                 it = ssg_->data.erase(it);
             } else {
                 ++it;
@@ -494,6 +549,19 @@ public:
         ssg_->gc_erase_counter = 0;
     }
 
+    // compact once a good part of the content may be garbage. a gc pass is
+    // linear in gc_size(), so triggering at gc_size() / 2 changes keeps it
+    // amortized constant per insert/erase
+    bool gc_due() const {
+        return gc_counter() >= 16 && gc_counter() >= gc_size() / 2;
+    }
+
+    void gc_auto() const {
+        if (ssg_->iterators == 0 && gc_due()) {
+            gc_run();
+        }
+    }
+
 private:
 
     // empty struct, used to mark a ctor as snapshotting
@@ -515,7 +583,7 @@ private:
 
 
     void make_me_snapshot_of(const snapshot_sortedmap& src) {
-        assert(ver_ < 0);
+        assert(ver_ == (version_t) -1);
         ver_ = src.ver_;
         assert(ssg_ == nullptr);
         ssg_ = (group_type *) src.ssg_->ref_copy();
@@ -531,23 +599,12 @@ private:
         src.prev_->next_ = this;
         src.prev_ = this;
         assert(debug_group_sanity_check());
-
-        if (src.writable()) {
-            src.ssg_->gc_insert_counter = 0;
-            src.ssg_->gc_erase_counter = 0;
-        }
     }
 
     void destroy_me() {
         assert(debug_group_sanity_check());
-        bool auto_gc = false;
 
         if (ssg_->writer == this) {
-            // try to do auto-gc
-            if (gc_counter() >= 16 && gc_counter() >= gc_size() / 2) {
-                // more than 16 elements, and more than half of content are garbage
-                auto_gc = true;
-            }
             // remove writer in snapshot group
             ssg_->writer = nullptr;
         }
@@ -557,10 +614,9 @@ private:
             prev_->next_ = this->next_;
             next_->prev_ = this->prev_;
 
-            // auto gc on next item
-            if (auto_gc) {
-                next_->gc_run();
-            }
+            // leaving may unpin old versions (or all new ones if I was the
+            // writer), auto gc on next item
+            next_->gc_auto();
         }
 
         this->prev_ = nullptr;
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "utils.h"
 #include "table.h"
 
@@ -131,6 +133,61 @@ SortedTable::iterator SortedTable::remove(iterator it, bool do_free /* =? */) {
     }
 }
 
+bool SortedTable::rekey(Row* row, const MultiBlob& old_key, const MultiBlob& new_key) {
+    SortedMultiKey old_smk = SortedMultiKey(old_key, schema_);
+    SortedMultiKey new_smk = SortedMultiKey(new_key, schema_);
+    if (old_smk == new_smk) {
+        // only a secondary index column changed, primary position unaffected
+        return false;
+    }
+
+    auto query_range = rows_.equal_range(old_smk);
+    iterator it = query_range.first;
+    while (it != query_range.second && it->second != row) {
+        ++it;
+    }
+    verify(it != query_range.second);
+
+    // keys stored in rows_ point into the row's own data, so the entry may
+    // not stay while the bytes change under it. Detach it without going
+    // through remove(iterator), so IndexedTable keeps its secondary indices
+    // and master index untouched, and let insert() put it back next to
+    // where it was
+    row->set_table(nullptr);
+    reinsert_hint_ = rows_.erase(it);
+    reinsert_row_ = row;
+    return true;
+}
+
+void SortedTable::query_batch(const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    std::vector<SortedMultiKey> smks;
+    std::vector<size_t> order(keys.size());
+    smks.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        smks.push_back(SortedMultiKey(keys[i], schema_));
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&smks] (size_t a, size_t b) {
+        return smks[a] < smks[b];
+    });
+
+    // walk the tree for every key first, each walk ends on the key bytes
+    // of its row; then prefetch all the hits before the caller reads any,
+    // so their misses overlap instead of coming one per lookup
+    rows->assign(keys.size(), nullptr);
+    for (size_t i : order) {
+        auto it = rows_.lower_bound(smks[i]);
+        if (it != rows_.end() && it->first == smks[i]) {
+            (*rows)[i] = it->second;
+        }
+    }
+    for (Row* row : *rows) {
+        if (row != nullptr) {
+            row->prefetch();
+        }
+    }
+}
+
 UnsortedTable::~UnsortedTable() {
     for (auto& it: rows_) {
         it.second->release();
@@ -166,6 +223,53 @@ void UnsortedTable::remove(Row* row, bool do_free /* =? */) {
     }
 }
 
+bool UnsortedTable::rekey(Row* row, const MultiBlob& old_key, const MultiBlob& new_key) {
+    if (old_key == new_key) {
+        return false;
+    }
+    // the hash bucket changes with the key, so the entry has to move; the row
+    // itself is kept alive and handed back to insert() by the caller
+    iterator it = rows_.find(old_key);
+    verify(it != rows_.end());
+    if (it->second != row) {
+        // only with duplicate keys, walk the rest of them
+        iterator end = rows_.equal_range(old_key).second;
+        while (it != end && it->second != row) {
+            ++it;
+        }
+        verify(it != end);
+    }
+    row->set_table(nullptr);
+    rows_.erase(it);
+    return true;
+}
+
+void UnsortedTable::query_batch(const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    typedef std::unordered_multimap<MultiBlob, Row*, MultiBlob::hash>::const_local_iterator local_iterator;
+
+    // hash every key up front and touch the head of each bucket, so the
+    // cache misses of independent keys overlap instead of serializing
+    std::vector<size_t> buckets(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        buckets[i] = rows_.bucket(keys[i]);
+        local_iterator head = rows_.cbegin(buckets[i]);
+        if (head != rows_.cend(buckets[i])) {
+            __builtin_prefetch(&*head);
+        }
+    }
+
+    rows->assign(keys.size(), nullptr);
+    for (size_t i = 0; i < keys.size(); i++) {
+        for (local_iterator it = rows_.cbegin(buckets[i]); it != rows_.cend(buckets[i]); ++it) {
+            if (it->first == keys[i]) {
+                (*rows)[i] = it->second;
+                it->second->prefetch();
+                break;
+            }
+        }
+    }
+}
+
 UnsortedTable::iterator UnsortedTable::remove(iterator it, bool do_free /* =? */) {
     if (it != rows_.end()) {
         if (do_free) {
@@ -321,37 +425,6 @@ IndexedTable::iterator IndexedTable::remove(iterator it, bool do_free /* =? */)
     }
 }
 
-void IndexedTable::notify_before_update(Row* row, int updated_column_id) {
-    verify(row->get_table() == this);
-
-    Value ptr_value = row->get_column(index_column_id());
-    master_index* master_idx = (master_index *) ptr_value.get_i64();
-    verify(master_idx != nullptr);
-
-    // remove the affected secondary indices
-    for (size_t idx_id = 0; idx_id < indices_.size(); idx_id++) {
-        bool affected = false;
-        for (column_id_t col_id : ((IndexedSchema *) schema_)->get_index(idx_id)) {
-            if (updated_column_id == col_id) {
-                affected = true;
-                break;
-            }
-        }
-        if (!affected) {
-            continue;
-        }
-        Row* affected_index_row = master_idx->at(idx_id);
-        verify(affected_index_row != nullptr);
-
-        // erase affected index row
-        SortedTable* idx_tbl = indices_[idx_id];
-        idx_tbl->remove(affected_index_row, true);
-
-        // also remove the pointer
-        (*master_idx)[idx_id] = nullptr;
-    }
-}
-
 void IndexedTable::notify_after_update(Row* row, int updated_column_id) {
     verify(row->get_table() == this);
 
@@ -359,26 +432,27 @@ void IndexedTable::notify_after_update(Row* row, int updated_column_id) {
     master_index* master_idx = (master_index *) ptr_value.get_i64();
     verify(master_idx != nullptr);
 
-    // re-insert the affected secondary indices
+    // rewrite the affected column on each secondary index row; the index row
+    // lives in a SortedTable, so SortedTable::rekey erases its entry and
+    // insert() puts it back, in constant time if it still sorts before its
+    // old successor
+    Value new_value;
+    bool fetched = false;
     for (size_t idx_id = 0; idx_id < indices_.size(); idx_id++) {
-        bool affected = false;
-        for (column_id_t col_id : ((IndexedSchema *) schema_)->get_index(idx_id)) {
-            if (updated_column_id == col_id) {
-                affected = true;
-                break;
+        const std::vector<column_id_t>& idx_cols = ((IndexedSchema *) schema_)->get_index(idx_id);
+        for (size_t idx_col = 0; idx_col < idx_cols.size(); idx_col++) {
+            if (idx_cols[idx_col] != updated_column_id) {
+                continue;
             }
+            if (!fetched) {
+                new_value = row->get_column(updated_column_id);
+                fetched = true;
+            }
+            Row* index_row = master_idx->at(idx_id);
+            verify(index_row != nullptr);
+            index_row->update((column_id_t) idx_col, new_value);
+            break;
         }
-        if (!affected) {
-            continue;
-        }
-
-        // NOTE: master index pointers will be updated by make_index_row, so we don't need to explicitly write it
-        Row* reconstructed_index_row = make_index_row(row, idx_id, master_idx);
-        verify(master_idx->at(idx_id) != nullptr);
-
-        // re-insert reconstructed index row
-        SortedTable* idx_tbl = indices_[idx_id];
-        idx_tbl->insert(reconstructed_index_row);
     }
 }
 
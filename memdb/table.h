@@ -2,6 +2,8 @@
 
 #include <string>
 #include <list>
+#include <new>
+#include <vector>
 #include <unordered_map>
 
 #include "value.h"
@@ -42,6 +44,17 @@ public:
         // used to notify IndexedTable to update secondary index
     }
 
+    // Called by Row right before an indexed column is overwritten. old_key is
+    // the current key, new_key is the key after the write. Returns true if the
+    // row was detached from the table and must be insert()-ed back once the
+    // new bytes are in place, false if the key does not change and the entry
+    // stays. No table re-keys an entry in place: SortedTable erases it and
+    // its insert() puts it back with the old successor as the hint.
+    virtual bool rekey(Row* row, const MultiBlob& old_key, const MultiBlob& new_key) {
+        remove(row, false);
+        return true;
+    }
+
     virtual symbol_t rtti() const = 0;
 };
 
@@ -92,6 +105,10 @@ protected:
     // indexed by key values
     std::multimap<SortedMultiKey, Row*> rows_;
 
+    // the row rekey() just took out, and the entry that followed it
+    Row* reinsert_row_;
+    iterator reinsert_hint_;
+
 public:
 
     class Cursor: public Enumerator<const Row*> {
@@ -171,7 +188,7 @@ public:
         }
     };
 
-    SortedTable(const Schema* schema): Table(schema) {}
+    SortedTable(const Schema* schema): Table(schema), reinsert_row_(nullptr) {}
 
     ~SortedTable();
 
@@ -183,6 +200,13 @@ public:
         SortedMultiKey key = SortedMultiKey(row->get_key(), schema_);
         verify(row->schema() == schema_);
         row->set_table(this);
+        if (row == reinsert_row_) {
+            // back from rekey(): constant time if it still sorts before
+            // its old successor, a plain insert otherwise
+            reinsert_row_ = nullptr;
+            rows_.emplace_hint(reinsert_hint_, key, row);
+            return;
+        }
         insert_into_map(rows_, key, row);
     }
 
@@ -197,6 +221,12 @@ public:
         return Cursor(range.first, range.second);
     }
 
+    // point lookup of many keys at once: (*rows)[i] is the first row matching
+    // keys[i], or nullptr. Keys are resolved in sorted order so that
+    // neighbouring lookups walk the same upper levels of the tree, and the
+    // hits are all prefetched before any of them is handed back.
+    void query_batch(const std::vector<MultiBlob>& keys, std::vector<Row*>* rows);
+
     Cursor query_lt(const Value& kv, symbol_t order = symbol_t::ORD_ASC) {
         return query_lt(kv.get_blob(), order);
     }
@@ -268,6 +298,8 @@ public:
     void remove(const SortedMultiKey& smk);
     void remove(Row* row, bool do_free = true);
     void remove(Cursor cur);
+
+    virtual bool rekey(Row* row, const MultiBlob& old_key, const MultiBlob& new_key);
 };
 
 
@@ -335,6 +367,11 @@ public:
         return Cursor(std::begin(rows_), std::end(rows_));
     }
 
+    // point lookup of many keys at once: (*rows)[i] is the first row matching
+    // keys[i], or nullptr. All keys are hashed and their buckets prefetched
+    // before any of them is resolved.
+    void query_batch(const std::vector<MultiBlob>& keys, std::vector<Row*>* rows);
+
     void clear();
 
     void remove(const Value& kv) {
@@ -343,6 +380,8 @@ public:
     void remove(const MultiBlob& key);
     void remove(Row* row, bool do_free = true);
 
+    virtual bool rekey(Row* row, const MultiBlob& old_key, const MultiBlob& new_key);
+
 private:
 
     iterator remove(iterator it, bool do_free = true);
@@ -381,53 +420,89 @@ class SnapshotTable: public Table {
 public:
 
     class Cursor: public Enumerator<const Row*> {
-        table_type::range_type* range_;
-        table_type::reverse_range_type* reverse_range_;
-    public:
-        Cursor(const table_type::range_type& range): reverse_range_(nullptr) {
-            range_ = new table_type::range_type(range);
+        typedef table_type::range_type range_type;
+        typedef table_type::reverse_range_type reverse_range_type;
+
+        // the range lives inline, only one of the two is constructed
+        union {
+            range_type range_;
+            reverse_range_type reverse_range_;
+        };
+        bool reverse_;
+
+        void destroy() {
+            if (reverse_) {
+                reverse_range_.~reverse_range_type();
+            } else {
+                range_.~range_type();
+            }
         }
-        Cursor(const table_type::reverse_range_type& range): range_(nullptr) {
-            reverse_range_ = new table_type::reverse_range_type(range);
+        void copy_from(const Cursor& o) {
+            reverse_ = o.reverse_;
+            if (reverse_) {
+                new (&reverse_range_) reverse_range_type(o.reverse_range_);
+            } else {
+                new (&range_) range_type(o.range_);
+            }
         }
-        ~Cursor() {
-            if (range_ != nullptr) {
-                delete range_;
+    public:
+        Cursor(const table_type::range_type& range): range_(range), reverse_(false) {}
+        Cursor(const table_type::reverse_range_type& range): reverse_range_(range), reverse_(true) {}
+        Cursor(const Cursor& o) {
+            copy_from(o);
+        }
+        const Cursor& operator =(const Cursor& o) {
+            if (this != &o) {
+                destroy();
+                copy_from(o);
             }
-            if (reverse_range_ != nullptr) {
-                delete reverse_range_;
+            return *this;
+        }
+        ~Cursor() {
+            destroy();
+        }
+        void reset() {
+            if (reverse_) {
+                reverse_range_.reset();
+            } else {
+                range_.reset();
             }
         }
-        virtual bool has_next() {
-            if (range_ != nullptr) {
-                return range_->has_next();
+        bool has_next() {
+            if (reverse_) {
+                return reverse_range_.has_next();
             } else {
-                return reverse_range_->has_next();
+                return range_.has_next();
             }
         }
-        virtual const Row* next() {
+        operator bool () {
+            return has_next();
+        }
+        const Row* next() {
             verify(has_next());
-            if (range_ != nullptr) {
-                return range_->next().second.get();
+            if (reverse_) {
+                return reverse_range_.next().second.get();
             } else {
-                return reverse_range_->next().second.get();
+                return range_.next().second.get();
             }
         }
         int count() {
-            if (range_ != nullptr) {
-                return range_->count();
+            if (reverse_) {
+                return reverse_range_.count();
             } else {
-                return reverse_range_->count();
+                return range_.count();
             }
         }
         bool is_reverse() const {
-            return reverse_range_ != nullptr;
+            return reverse_;
         }
         const table_type::range_type& get_range() const {
-            return *range_;
+            verify(!reverse_);
+            return range_;
         }
         const table_type::reverse_range_type& get_reverse_range() const {
-            return *reverse_range_;
+            verify(reverse_);
+            return reverse_range_;
         }
     };
 
@@ -463,6 +538,16 @@ public:
         return Cursor(rows_.query(smk));
     }
 
+    // snapshots are read through immutable trees, nothing to batch here
+    void query_batch(const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+        rows->clear();
+        rows->reserve(keys.size());
+        for (auto& key : keys) {
+            table_type::range_type range = rows_.query(SortedMultiKey(key, schema_));
+            rows->push_back(range.has_next() ? range.next().second.get() : nullptr);
+        }
+    }
+
     Cursor query_lt(const Value& kv, symbol_t order = symbol_t::ORD_ASC) {
         return query_lt(kv.get_blob(), order);
     }
@@ -550,6 +635,116 @@ public:
     }
 };
 
+// Value-type cursor over any of the table engines. The engine's own cursor
+// is held inline and calls are dispatched on the engine kind, so a query
+// result can live on the stack without any heap allocation.
+class TableCursor {
+    symbol_t kind_;
+    union {
+        SortedTable::Cursor sorted_;
+        UnsortedTable::Cursor unsorted_;
+        SnapshotTable::Cursor snapshot_;
+    };
+
+    void destroy() {
+        switch (kind_) {
+        case symbol_t::TBL_SORTED:
+            sorted_.~Cursor();
+            break;
+        case symbol_t::TBL_UNSORTED:
+            unsorted_.~Cursor();
+            break;
+        case symbol_t::TBL_SNAPSHOT:
+            snapshot_.~Cursor();
+            break;
+        default:
+            break;
+        }
+        kind_ = symbol_t::NONE;
+    }
+    void copy_from(const TableCursor& o) {
+        kind_ = o.kind_;
+        switch (kind_) {
+        case symbol_t::TBL_SORTED:
+            new (&sorted_) SortedTable::Cursor(o.sorted_);
+            break;
+        case symbol_t::TBL_UNSORTED:
+            new (&unsorted_) UnsortedTable::Cursor(o.unsorted_);
+            break;
+        case symbol_t::TBL_SNAPSHOT:
+            new (&snapshot_) SnapshotTable::Cursor(o.snapshot_);
+            break;
+        default:
+            break;
+        }
+    }
+
+public:
+    // an empty cursor
+    TableCursor(): kind_(symbol_t::NONE) {}
+    TableCursor(const SortedTable::Cursor& cur): kind_(symbol_t::TBL_SORTED), sorted_(cur) {}
+    TableCursor(const UnsortedTable::Cursor& cur): kind_(symbol_t::TBL_UNSORTED), unsorted_(cur) {}
+    TableCursor(const SnapshotTable::Cursor& cur): kind_(symbol_t::TBL_SNAPSHOT), snapshot_(cur) {}
+    TableCursor(const TableCursor& o) {
+        copy_from(o);
+    }
+    const TableCursor& operator =(const TableCursor& o) {
+        if (this != &o) {
+            destroy();
+            copy_from(o);
+        }
+        return *this;
+    }
+    ~TableCursor() {
+        destroy();
+    }
+
+    symbol_t kind() const {
+        return kind_;
+    }
+
+    void reset() {
+        switch (kind_) {
+        case symbol_t::TBL_SORTED:
+            sorted_.reset();
+            break;
+        case symbol_t::TBL_UNSORTED:
+            unsorted_.reset();
+            break;
+        case symbol_t::TBL_SNAPSHOT:
+            snapshot_.reset();
+            break;
+        default:
+            break;
+        }
+    }
+    bool has_next() {
+        switch (kind_) {
+        case symbol_t::TBL_SORTED:
+            return sorted_.has_next();
+        case symbol_t::TBL_UNSORTED:
+            return unsorted_.has_next();
+        case symbol_t::TBL_SNAPSHOT:
+            return snapshot_.has_next();
+        default:
+            return false;
+        }
+    }
+    const Row* next() {
+        switch (kind_) {
+        case symbol_t::TBL_SORTED:
+            return sorted_.next();
+        case symbol_t::TBL_UNSORTED:
+            return unsorted_.next();
+        case symbol_t::TBL_SNAPSHOT:
+            return snapshot_.next();
+        default:
+            verify(kind_ != symbol_t::NONE);
+            return nullptr;
+        }
+    }
+};
+
 // forward declaration
 class IndexedTable;
 
@@ -668,7 +863,6 @@ public:
     // enable searching SortedTable for overloaded `remove` functions
     using SortedTable::remove;
 
-    virtual void notify_before_update(Row* row, int updated_column_id);
     virtual void notify_after_update(Row* row, int updated_column_id);
 
     Index get_index(int idx_id) const {
@@ -1,4 +1,5 @@
 #include <limits>
+#include <memory>
 
 #include "row.h"
 #include "table.h"
@@ -33,6 +34,94 @@ ResultSet Txn::query(Table* tbl, const Value& kv, bool retrieve, int64_t pid) {
     }
 }
 
+void Txn::multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    rows->clear();
+    rows->reserve(keys.size());
+    for (auto& key : keys) {
+        ResultSet rs = this->query(tbl, key);
+        rows->push_back(rs.has_next() ? rs.next() : nullptr);
+    }
+}
+
+// raw table cursors, dispatched on the table engine
+
+static TableCursor table_query(Table* tbl, const MultiBlob& mb) {
+    if (tbl->rtti() == TBL_UNSORTED) {
+        return TableCursor(((UnsortedTable *) tbl)->query(mb));
+    } else if (tbl->rtti() == TBL_SORTED) {
+        return TableCursor(((SortedTable *) tbl)->query(mb));
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        return TableCursor(((SnapshotTable *) tbl)->query(mb));
+    } else {
+        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+        return TableCursor();
+    }
+}
+
+static TableCursor table_query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order) {
+    if (tbl->rtti() == TBL_SORTED) {
+        return TableCursor(((SortedTable *) tbl)->query_lt(smk, order));
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        return TableCursor(((SnapshotTable *) tbl)->query_lt(smk, order));
+    } else {
+        // range query only works on sorted and snapshot table
+        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+        return TableCursor();
+    }
+}
+
+static TableCursor table_query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order) {
+    if (tbl->rtti() == TBL_SORTED) {
+        return TableCursor(((SortedTable *) tbl)->query_gt(smk, order));
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        return TableCursor(((SnapshotTable *) tbl)->query_gt(smk, order));
+    } else {
+        // range query only works on sorted and snapshot table
+        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+        return TableCursor();
+    }
+}
+
+static TableCursor table_query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order) {
+    if (tbl->rtti() == TBL_SORTED) {
+        return TableCursor(((SortedTable *) tbl)->query_in(low, high, order));
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        return TableCursor(((SnapshotTable *) tbl)->query_in(low, high, order));
+    } else {
+        // range query only works on sorted and snapshot table
+        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+        return TableCursor();
+    }
+}
+
+static TableCursor table_all(Table* tbl, symbol_t order) {
+    if (tbl->rtti() == TBL_UNSORTED) {
+        // unsorted tables only accept ORD_ANY
+        verify(order == symbol_t::ORD_ANY);
+        return TableCursor(((UnsortedTable *) tbl)->all());
+    } else if (tbl->rtti() == TBL_SORTED) {
+        return TableCursor(((SortedTable *) tbl)->all(order));
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        return TableCursor(((SnapshotTable *) tbl)->all(order));
+    } else {
+        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+        return TableCursor();
+    }
+}
+
+// batched lookup straight on the raw table
+static void table_query_batch(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    if (tbl->rtti() == TBL_UNSORTED) {
+        ((UnsortedTable *) tbl)->query_batch(keys, rows);
+    } else if (tbl->rtti() == TBL_SORTED) {
+        ((SortedTable *) tbl)->query_batch(keys, rows);
+    } else if (tbl->rtti() == TBL_SNAPSHOT) {
+        ((SnapshotTable *) tbl)->query_batch(keys, rows);
+    } else {
+        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+    }
+}
+
 ResultSet Txn::all(Table* tbl, bool retrieve, int64_t pid, symbol_t order) {
     switch (rtti()) {
         case symbol_t::TXN_2PL:
@@ -82,11 +171,8 @@ ResultSet Txn::query_in(Table* tbl, const MultiBlob& low, const MultiBlob& high,
 }
 
 
-#ifdef CONFLICT_COUNT
-std::map<const Table *, uint64_t> TxnMgr::vc_conflict_count_;
-std::map<const Table *, uint64_t> TxnMgr::rl_conflict_count_;
-std::map<const Table *, uint64_t> TxnMgr::wl_conflict_count_;
-#endif
+std::atomic<conflict_hook_t> TxnMgr::conflict_hook_s(nullptr);
+
 Txn* TxnMgr::start_nested(Txn* base) {
     return new TxnNested(this, base);
 }
@@ -117,122 +203,152 @@ SnapshotTable* TxnMgr::get_snapshot_table(const std::string& tbl_name) const {
 
 
 
+// skips the rows inserted after a snapshot was taken
+class VisibleRowCursor: public Enumerator<const Row*> {
+    ResultSet rs_;
+    version_t ver_;
+    const Row* next_;
+
+    static bool visible(const Row* row, version_t ver) {
+        return row->rtti() != symbol_t::ROW_MULTIVER
+            || ((const MultiVersionedRow *) row)->visible_at(ver);
+    }
+
+public:
+    VisibleRowCursor(const ResultSet& rs, version_t ver): rs_(rs), ver_(ver), next_(nullptr) {}
+    void reset() {
+        rs_.reset();
+        next_ = nullptr;
+    }
+    bool has_next() {
+        while (next_ == nullptr && rs_.has_next()) {
+            const Row* row = rs_.next();
+            if (visible(row, ver_)) {
+                next_ = row;
+            }
+        }
+        return next_ != nullptr;
+    }
+    const Row* next() {
+        verify(has_next());
+        const Row* row = next_;
+        next_ = nullptr;
+        return row;
+    }
+};
+
+ResultSet TxnUnsafe::visible_rows(const ResultSet& rs) const {
+    if (!snapshot_) {
+        return rs;
+    }
+    return ResultSet(new VisibleRowCursor(rs, snapshot_ver_));
+}
+
 bool TxnUnsafe::read_column(Row* row, column_id_t col_id, Value* value) {
+    touch(row);
+    if (snapshot_ && row->rtti() == symbol_t::ROW_MULTIVER) {
+        // fails if the snapshot was not kept pinned
+        return ((MultiVersionedRow *) row)->get_column_by_version(col_id, snapshot_ver_, value);
+    }
     *value = row->get_column(col_id);
     // always allowed
     return true;
 }
 
 bool TxnUnsafe::write_column(Row* row, column_id_t col_id, const Value& value) {
+    touch(row);
+    verify(!snapshot_);
+    if (undo_ != nullptr) {
+        undo_->push_back(undo_t{nullptr, row, col_id, row->get_column(col_id), false});
+    }
     row->update(col_id, value);
     // always allowed
     return true;
 }
 
 bool TxnUnsafe::insert_row(Table* tbl, Row* row) {
+    touch(tbl, row);
+    verify(!snapshot_);
     tbl->insert(row);
+    if (undo_ != nullptr) {
+        undo_->push_back(undo_t{tbl, row, 0, Value(), true});
+    }
     // always allowed
     return true;
 }
 
 bool TxnUnsafe::remove_row(Table* tbl, Row* row) {
-    tbl->remove(row);
+    touch(tbl, row);
+    verify(!snapshot_);
+    if (undo_ != nullptr) {
+        // not freed, rollback puts it back
+        tbl->remove(row, false);
+        undo_->push_back(undo_t{tbl, row, 0, Value(), false});
+    } else {
+        tbl->remove(row);
+    }
     // always allowed
     return true;
 }
 
+void TxnUnsafe::rollback(undo_log_t* log) {
+    for (auto it = log->rbegin(); it != log->rend(); ++it) {
+        if (it->tbl == nullptr) {
+            it->row->update(it->col_id, it->old);
+        } else if (it->inserted) {
+            it->tbl->remove(it->row);
+        } else {
+            it->tbl->insert(it->row);
+        }
+    }
+    log->clear();
+}
+
+void TxnUnsafe::keep(undo_log_t* log) {
+    for (auto& u : *log) {
+        if (u.tbl != nullptr && !u.inserted) {
+            u.row->release();
+        }
+    }
+    log->clear();
+}
+
 ResultSet TxnUnsafe::query(Table* tbl, const MultiBlob& mb) {
     // always sendback query result from raw table
-    if (tbl->rtti() == TBL_UNSORTED) {
-        UnsortedTable* t = (UnsortedTable *) tbl;
-        UnsortedTable::Cursor* cursor = new UnsortedTable::Cursor(t->query(mb));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        SortedTable::Cursor* cursor = new SortedTable::Cursor(t->query(mb));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        SnapshotTable::Cursor* cursor = new SnapshotTable::Cursor(t->query(mb));
-        return ResultSet(cursor);
-    } else {
-        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-        return ResultSet(nullptr);
+    return visible_rows(ResultSet(table_query(tbl, mb)));
+}
+
+void TxnUnsafe::multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    table_query_batch(tbl, keys, rows);
+    if (snapshot_) {
+        for (auto& row : *rows) {
+            if (row != nullptr && row->rtti() == symbol_t::ROW_MULTIVER
+                    && !((MultiVersionedRow *) row)->visible_at(snapshot_ver_)) {
+                row = nullptr;
+            }
+        }
     }
 }
 
 ResultSet TxnUnsafe::query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
     // always sendback query result from raw table
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        SortedTable::Cursor* cursor = new SortedTable::Cursor(t->query_lt(smk, order));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        SnapshotTable::Cursor* cursor = new SnapshotTable::Cursor(t->query_lt(smk, order));
-        return ResultSet(cursor);
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-        return ResultSet(nullptr);
-    }
+    return visible_rows(ResultSet(table_query_lt(tbl, smk, order)));
 }
 
 ResultSet TxnUnsafe::query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
     // always sendback query result from raw table
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        SortedTable::Cursor* cursor = new SortedTable::Cursor(t->query_gt(smk, order));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        SnapshotTable::Cursor* cursor = new SnapshotTable::Cursor(t->query_gt(smk, order));
-        return ResultSet(cursor);
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-        return ResultSet(nullptr);
-    }
+    return visible_rows(ResultSet(table_query_gt(tbl, smk, order)));
 }
 
 ResultSet TxnUnsafe::query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order /* =? */) {
     // always sendback query result from raw table
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        SortedTable::Cursor* cursor = new SortedTable::Cursor(t->query_in(low, high, order));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        SnapshotTable::Cursor* cursor = new SnapshotTable::Cursor(t->query_in(low, high, order));
-        return ResultSet(cursor);
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-        return ResultSet(nullptr);
-    }
+    return visible_rows(ResultSet(table_query_in(tbl, low, high, order)));
 }
 
 
 ResultSet TxnUnsafe::all(Table* tbl, symbol_t order /* =? */) {
     // always sendback query result from raw table
-    if (tbl->rtti() == TBL_UNSORTED) {
-        // unsorted tables only accept ORD_ANY
-        verify(order == symbol_t::ORD_ANY);
-        UnsortedTable* t = (UnsortedTable *) tbl;
-        UnsortedTable::Cursor* cursor = new UnsortedTable::Cursor(t->all());
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        SortedTable::Cursor* cursor = new SortedTable::Cursor(t->all(order));
-        return ResultSet(cursor);
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        SnapshotTable::Cursor* cursor = new SnapshotTable::Cursor(t->all(order));
-        return ResultSet(cursor);
-    } else {
-        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-        return ResultSet(nullptr);
-    }
+    return visible_rows(ResultSet(table_all(tbl, order)));
 }
 
 bool table_row_pair::operator < (const table_row_pair& o) const {
@@ -334,6 +450,11 @@ void Txn2PL::PieceStatus::reg_rm_lock(Row *row,
     FineLockedRow *fl_row = (FineLockedRow *)row;
     for (int i = 0; i < row->schema()->columns_count(); i++)
         rm_lock_group_.add(fl_row->get_alock(i), rrr::ALock::WLOCK);
+    if (TxnMgr::conflict_hooked()) {
+        lock_all_reporting(rm_lock_group_, std::vector<const Row*>({row}),
+                           succ_callback, fail_callback);
+        return;
+    }
     rm_lock_group_.lock_all(succ_callback, fail_callback);
 }
 
@@ -348,9 +469,38 @@ void Txn2PL::PieceStatus::reg_rw_lock(const std::vector<column_lock_t> &col_lock
         rw_lock_group_.add(((FineLockedRow *)it->row)->get_alock(it->column_id),
                 it->type);
     }
+    if (TxnMgr::conflict_hooked()) {
+        std::vector<const Row*> rows;
+        for (it = col_locks.begin(); it != col_locks.end(); it++)
+            if (rows.empty() || rows.back() != it->row)
+                rows.push_back(it->row);
+        lock_all_reporting(rw_lock_group_, rows, succ_callback, fail_callback);
+        return;
+    }
     rw_lock_group_.lock_all(succ_callback, fail_callback);
 }
 
+// the group does not say which lock was in the way, every row asked for
+// gets the conflict
+void Txn2PL::PieceStatus::lock_all_reporting(rrr::ALockGroup &group,
+        const std::vector<const Row*> &rows,
+        const std::function<void(void)> &succ_callback,
+        const std::function<void(void)> &fail_callback) {
+    auto answered = std::make_shared<bool>(false);
+    group.lock_all([answered, succ_callback] () {
+                *answered = true;
+                succ_callback();
+            }, [answered, rows, fail_callback] () {
+                *answered = true;
+                for (auto row : rows)
+                    TxnMgr::conflict(CONFLICT_REFUSE, row);
+                fail_callback();
+            });
+    if (!*answered)
+        for (auto row : rows)
+            TxnMgr::conflict(CONFLICT_WAIT, row);
+}
+
 // insert piece in piece_map_, set reply dragonball & set output
 void Txn2PL::init_piece(i64 tid, i64 pid, rrr::DragonBall *db,
         mdb::Value* output, 
@@ -638,6 +788,7 @@ bool Txn2PL::commit() {
 //}
 
 bool Txn2PL::read_column(Row* row, column_id_t col_id, Value* value) {
+    touch(row);
     verify(this->rtti() == symbol_t::TXN_2PL);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
@@ -695,6 +846,7 @@ bool Txn2PL::read_column(Row* row, column_id_t col_id, Value* value) {
 //}
 
 bool Txn2PL::write_column(Row* row, column_id_t col_id, const Value& value) {
+    touch(row);
     verify(this->rtti() == symbol_t::TXN_2PL);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
@@ -736,6 +888,7 @@ bool Txn2PL::write_column(Row* row, column_id_t col_id, const Value& value) {
 }
 
 bool Txn2PL::insert_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     verify(this->rtti() == symbol_t::TXN_2PL);
     verify(outcome_ == symbol_t::NONE);
     verify(row->get_table() == nullptr);
@@ -745,6 +898,7 @@ bool Txn2PL::insert_row(Table* tbl, Row* row) {
 }
 
 bool Txn2PL::remove_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     verify(this->rtti() == symbol_t::TXN_2PL);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
@@ -804,301 +958,175 @@ public:
 
 
 // merge query result in staging area and real table data
-class MergedCursor: public NoCopy, public Enumerator<const Row*> {
-    Table* tbl_;
-    Enumerator<const Row*>* cursor_;
-
-    bool reverse_order_;
-    std::multiset<table_row_pair>::const_iterator inserts_next_, inserts_end_;
-    std::multiset<table_row_pair>::const_reverse_iterator r_inserts_next_, r_inserts_end_;
-
-    const std::unordered_set<table_row_pair, table_row_pair::hash>& removes_;
+bool ResultSet::prefetch_next() {
+    verify(cached_ == false);
 
-    bool cached_;
-    const Row* cached_next_;
-    const Row* next_candidate_;
-
-    void insert_reset() {
-        //TODO it's OK for the current workload
-    }
+    while (next_candidate_ == nullptr && base_has_next()) {
+        next_candidate_ = base_next();
 
-    bool insert_has_next() {
-        if (reverse_order_) {
-            return r_inserts_next_ != r_inserts_end_;
-        } else {
-            return inserts_next_ != inserts_end_;
-        }
-    }
-
-    const Row* insert_get_next() {
-        if (reverse_order_) {
-            return r_inserts_next_->row;
-        } else {
-            return inserts_next_->row;
+        // check if row has been removeds
+        table_row_pair needle(tbl_, const_cast<Row*>(next_candidate_));
+        if (removes_->find(needle) != removes_->end()) {
+            next_candidate_ = nullptr;
         }
     }
 
-    void insert_advance_next() {
-        if (reverse_order_) {
-            ++r_inserts_next_;
-        } else {
-            ++inserts_next_;
+    // check if there's data in inserts_
+    if (next_candidate_ == nullptr) {
+        if (insert_has_next()) {
+            cached_ = true;
+            cached_next_ = insert_get_next();
+            insert_advance_next();
         }
-    }
-
-    bool prefetch_next() {
-        verify(cached_ == false);
-
-        while (next_candidate_ == nullptr && cursor_->has_next()) {
-            next_candidate_ = cursor_->next();
-
-            // check if row has been removeds
-            table_row_pair needle(tbl_, const_cast<Row*>(next_candidate_));
-            if (removes_.find(needle) != removes_.end()) {
+    } else {
+        // next_candidate_ != nullptr
+        // check which is next: next_candidate_, or next in inserts_
+        cached_ = true;
+        if (insert_has_next()) {
+            if (next_candidate_ < insert_get_next()) {
+                cached_next_ = next_candidate_;
                 next_candidate_ = nullptr;
-            }
-        }
-
-        // check if there's data in inserts_
-        if (next_candidate_ == nullptr) {
-            if (insert_has_next()) {
-                cached_ = true;
+            } else {
                 cached_next_ = insert_get_next();
                 insert_advance_next();
             }
         } else {
-            // next_candidate_ != nullptr
-            // check which is next: next_candidate_, or next in inserts_
-            cached_ = true;
-            if (insert_has_next()) {
-                if (next_candidate_ < insert_get_next()) {
-                    cached_next_ = next_candidate_;
-                    next_candidate_ = nullptr;
-                } else {
-                    cached_next_ = insert_get_next();
-                    insert_advance_next();
-                }
-            } else {
-                cached_next_ = next_candidate_;
-                next_candidate_ = nullptr;
-            }
+            cached_next_ = next_candidate_;
+            next_candidate_ = nullptr;
         }
-
-        return cached_;
     }
 
-public:
-    MergedCursor(Table* tbl,
-                 Enumerator<const Row*>* cursor,
-                 const std::multiset<table_row_pair>::const_iterator& inserts_begin,
-                 const std::multiset<table_row_pair>::const_iterator& inserts_end,
-                 const std::unordered_set<table_row_pair, table_row_pair::hash>& removes)
-        : tbl_(tbl), cursor_(cursor), reverse_order_(false),
-          inserts_next_(inserts_begin), inserts_end_(inserts_end), removes_(removes),
-          cached_(false), cached_next_(nullptr), next_candidate_(nullptr) {}
-
-    MergedCursor(Table* tbl,
-                 Enumerator<const Row*>* cursor,
-                 const std::multiset<table_row_pair>::const_reverse_iterator& inserts_rbegin,
-                 const std::multiset<table_row_pair>::const_reverse_iterator& inserts_rend,
-                 const std::unordered_set<table_row_pair, table_row_pair::hash>& removes)
-        : tbl_(tbl), cursor_(cursor), reverse_order_(true),
-          r_inserts_next_(inserts_rbegin), r_inserts_end_(inserts_rend), removes_(removes),
-          cached_(false), cached_next_(nullptr), next_candidate_(nullptr) {}
-
-    ~MergedCursor() {
-        delete cursor_;
-    }
+    return cached_;
+}
 
+// lets a nested txn read through the result of its base txn
+class BaseResultCursor: public Enumerator<const Row*> {
+    ResultSet rs_;
+public:
+    BaseResultCursor(const ResultSet& rs): rs_(rs) {}
     void reset() {
-        insert_reset();
-        cursor_->reset();
+        rs_.reset();
     }
-
     bool has_next() {
-        if (cached_) {
-            return true;
-        } else {
-            return prefetch_next();
-        }
+        return rs_.has_next();
     }
-
     const Row* next() {
-        if (!cached_) {
-            verify(prefetch_next());
-        }
-        cached_ = false;
-        return cached_next_;
+        return rs_.next();
     }
 };
 
 
+// merge staged inserts in [begin, end) and staged removes into rs
+static void merge_staged(ResultSet* rs, Table* tbl,
+                         const std::multiset<table_row_pair>::const_iterator& inserts_begin,
+                         const std::multiset<table_row_pair>::const_iterator& inserts_end,
+                         const staged_removes_t& removes, symbol_t order) {
+    if (order == symbol_t::ORD_DESC) {
+        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
+        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
+        rs->merge(tbl, inserts_rbegin, inserts_rend, removes);
+    } else {
+        rs->merge(tbl, inserts_begin, inserts_end, removes);
+    }
+}
+
 ResultSet Txn2PL::do_query(Table* tbl, const MultiBlob& mb) {
-    MergedCursor* merged_cursor = nullptr;
     KeyOnlySearchRow key_search_row(tbl->schema(), &mb);
 
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, &key_search_row));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, &key_search_row));
 
-    Enumerator<const Row*>* cursor = nullptr;
-    if (tbl->rtti() == TBL_UNSORTED) {
-        UnsortedTable* t = (UnsortedTable *) tbl;
-        cursor = new UnsortedTable::Cursor(t->query(mb));
-    } else if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        cursor = new SortedTable::Cursor(t->query(mb));
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        cursor = new SnapshotTable::Cursor(t->query(mb));
-    } else {
-        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-    }
-    merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(table_query(tbl, mb));
+    rs.merge(tbl, inserts_begin, inserts_end, removes_);
+    return rs;
 }
 
 
-ResultSet Txn2PL::do_query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
-    verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
+void Txn2PL::do_multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+    table_query_batch(tbl, keys, rows);
 
-    Enumerator<const Row*>* cursor = nullptr;
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        cursor = new SortedTable::Cursor(t->query_lt(smk, order));
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        cursor = new SnapshotTable::Cursor(t->query_lt(smk, order));
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
+    // staged inserts and removes on this table are rare during lookup
+    // pieces; only then do the affected keys go through the merged cursor
+    bool has_inserts = (inserts_.lower_bound(table_row_pair(tbl, table_row_pair::ROW_MIN))
+                        != inserts_.upper_bound(table_row_pair(tbl, table_row_pair::ROW_MAX)));
+    if (!has_inserts && removes_.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        Row* row = (*rows)[i];
+        if (has_inserts || (row != nullptr && removes_.find(table_row_pair(tbl, row)) != removes_.end())) {
+            ResultSet rs = do_query(tbl, keys[i]);
+            (*rows)[i] = rs.has_next() ? rs.next() : nullptr;
+        }
     }
+}
+
+ResultSet Txn2PL::do_query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
+    verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
     KeyOnlySearchRow key_search_row(tbl->schema(), &smk.get_multi_blob());
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, table_row_pair::ROW_MIN));
     auto inserts_end = inserts_.lower_bound(table_row_pair(tbl, &key_search_row));
-    MergedCursor* merged_cursor = nullptr;
-
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
 
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(table_query_lt(tbl, smk, order));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 ResultSet Txn2PL::do_query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = nullptr;
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        cursor = new SortedTable::Cursor(t->query_gt(smk, order));
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        cursor = new SnapshotTable::Cursor(t->query_gt(smk, order));
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-    }
-
     KeyOnlySearchRow key_search_row(tbl->schema(), &smk.get_multi_blob());
     auto inserts_begin = inserts_.upper_bound(table_row_pair(tbl, &key_search_row));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, table_row_pair::ROW_MAX));
-    MergedCursor* merged_cursor = nullptr;
-
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
 
-    return ResultSet(merged_cursor);
+    ResultSet rs(table_query_gt(tbl, smk, order));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 ResultSet Txn2PL::do_query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = nullptr;
-    if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        cursor = new SortedTable::Cursor(t->query_in(low, high, order));
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        cursor = new SnapshotTable::Cursor(t->query_in(low, high, order));
-    } else {
-        // range query only works on sorted and snapshot table
-        verify(tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-    }
-
-    MergedCursor* merged_cursor = nullptr;
     KeyOnlySearchRow key_search_row_low(tbl->schema(), &low.get_multi_blob());
     KeyOnlySearchRow key_search_row_high(tbl->schema(), &high.get_multi_blob());
     auto inserts_begin = inserts_.upper_bound(table_row_pair(tbl, &key_search_row_low));
     auto inserts_end = inserts_.lower_bound(table_row_pair(tbl, &key_search_row_high));
 
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(table_query_in(tbl, low, high, order));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 
 ResultSet Txn2PL::do_all(Table* tbl, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = nullptr;
-    if (tbl->rtti() == TBL_UNSORTED) {
-        // unsorted tables only accept ORD_ANY
-        verify(order == symbol_t::ORD_ANY);
-        UnsortedTable* t = (UnsortedTable *) tbl;
-        cursor = new UnsortedTable::Cursor(t->all());
-    } else if (tbl->rtti() == TBL_SORTED) {
-        SortedTable* t = (SortedTable *) tbl;
-        cursor = new SortedTable::Cursor(t->all(order));
-    } else if (tbl->rtti() == TBL_SNAPSHOT) {
-        SnapshotTable* t = (SnapshotTable *) tbl;
-        cursor = new SnapshotTable::Cursor(t->all(order));
-    } else {
-        verify(tbl->rtti() == TBL_UNSORTED || tbl->rtti() == TBL_SORTED || tbl->rtti() == TBL_SNAPSHOT);
-    }
-
-    MergedCursor* merged_cursor = nullptr;
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, table_row_pair::ROW_MIN));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, table_row_pair::ROW_MAX));
 
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(table_all(tbl, order));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 
 
-TxnOCC::TxnOCC(const TxnMgr* mgr, txn_id_t txnid, const std::vector<std::string>& table_names): Txn2PL(mgr, txnid), verified_(false) {
+TxnOCC::TxnOCC(const TxnMgr* mgr, txn_id_t txnid, const std::vector<std::string>& table_names): Txn2PL(mgr, txnid), verified_(false), own_snapshots_(true) {
     for (auto& it: table_names) {
         SnapshotTable* tbl = get_snapshot_table(it);
         SnapshotTable* snapshot = tbl->snapshot();
         insert_into_map(snapshots_, it, snapshot);
         snapshot_tables_.insert(snapshot);
+        insert_into_map(snapshot_of_, (const Table *) tbl, snapshot);
+    }
+}
+
+TxnOCC::TxnOCC(const TxnMgr* mgr, txn_id_t txnid, const std::map<std::string, SnapshotTable*>& snapshots): Txn2PL(mgr, txnid), verified_(false), own_snapshots_(false) {
+    for (auto& it: snapshots) {
+        insert_into_map(snapshots_, it.first, it.second);
+        snapshot_tables_.insert(it.second);
+        insert_into_map(snapshot_of_, (const Table *) get_snapshot_table(it.first), it.second);
     }
 }
 
@@ -1128,14 +1156,7 @@ bool TxnOCC::version_check(const std::unordered_map<row_column_pair, version_t,
         verify(row->rtti() == ROW_VERSIONED);
         VersionedRow* v_row = (VersionedRow *) row;
         if (v_row->get_column_ver(col_id) != ver) {
-#ifdef CONFLICT_COUNT
-            const Table *tbl = v_row->get_table();
-            auto cc_it = TxnMgr::vc_conflict_count_.find(tbl);
-            if (cc_it == TxnMgr::vc_conflict_count_.end())
-                TxnMgr::vc_conflict_count_[tbl] = 1;
-            else
-                cc_it->second++;
-#endif
+            TxnMgr::conflict(CONFLICT_VERSION, v_row);
             return false;
         }
     }
@@ -1157,6 +1178,7 @@ void TxnOCC::release_resource() {
 
     ver_check_read_.clear();
     ver_check_write_.clear();
+    deltas_.clear();
 
     // release ref copy
     for (auto& it: accessed_rows_) {
@@ -1165,11 +1187,14 @@ void TxnOCC::release_resource() {
     accessed_rows_.clear();
 
     // release snapshots
-    for (auto& it: snapshot_tables_) {
-        delete it;
+    if (own_snapshots_) {
+        for (auto& it: snapshot_tables_) {
+            delete it;
+        }
     }
     snapshot_tables_.clear();
     snapshots_.clear();
+    snapshot_of_.clear();
 }
 
 void TxnOCC::abort() {
@@ -1205,14 +1230,7 @@ bool TxnOCC::commit_prepare() {
         Row* row = it.first.row;
         VersionedRow* v_row = (VersionedRow *) row;
         if (!v_row->rlock_row_by(this->id())) {
-#ifdef CONFLICT_COUNT
-            const Table *tbl = v_row->get_table();
-            auto cc_it = TxnMgr::rl_conflict_count_.find(tbl);
-            if (cc_it == TxnMgr::rl_conflict_count_.end())
-                TxnMgr::rl_conflict_count_[tbl] = 1;
-            else
-                cc_it->second++;
-#endif
+            TxnMgr::conflict(CONFLICT_RLOCK, v_row);
             for (auto& lit : locks_) {
                 Row* row = lit.first;
                 verify(row->rtti() == symbol_t::ROW_VERSIONED);
@@ -1228,14 +1246,23 @@ bool TxnOCC::commit_prepare() {
         Row* row = it.first.row;
         VersionedRow* v_row = (VersionedRow *) row;
         if (!v_row->wlock_row_by(this->id())) {
-#ifdef CONFLICT_COUNT
-            const Table *tbl = v_row->get_table();
-            auto cc_it = TxnMgr::wl_conflict_count_.find(tbl);
-            if (cc_it == TxnMgr::wl_conflict_count_.end())
-                TxnMgr::wl_conflict_count_[tbl] = 1;
-            else
-                cc_it->second++;
-#endif
+            TxnMgr::conflict(CONFLICT_WLOCK, v_row);
+            for (auto& lit : locks_) {
+                Row* row = lit.first;
+                verify(row->rtti() == symbol_t::ROW_VERSIONED);
+                VersionedRow* v_row = (VersionedRow *) row;
+                v_row->unlock_row_by(this->id());
+            }
+            locks_.clear();
+            return false;
+        }
+        insert_into_map(locks_, row, -1);
+    }
+    for (auto& it : deltas_) {
+        // other deltas may share the row, plain writers may not
+        Row* row = it.first.row;
+        VersionedRow* v_row = (VersionedRow *) row;
+        if (!v_row->rlock_row_by(this->id())) {
             for (auto& lit : locks_) {
                 Row* row = lit.first;
                 verify(row->rtti() == symbol_t::ROW_VERSIONED);
@@ -1256,6 +1283,19 @@ void TxnOCC::commit_confirm() {
     verify(outcome_ == symbol_t::NONE);
     verify(verified_ == true);
 
+    // apply deltas on top of the latest values, they become plain updates
+    for (auto& it : deltas_) {
+        Row* row = it.first.row;
+        column_id_t column_id = it.first.col_id;
+        Value value = row->get_column(column_id);
+        value.add(it.second);
+        if (policy_ == symbol_t::OCC_EAGER) {
+            // OCC_LAZY bumps it with the other updates below
+            ((VersionedRow *) row)->incr_column_ver(column_id);
+        }
+        insert_into_map(updates_, row, make_pair(column_id, value));
+    }
+
     for (auto& it : inserts_) {
         it.table->insert(it.row);
     }
@@ -1328,6 +1368,7 @@ void TxnOCC::commit_confirm() {
 
 
 bool TxnOCC::read_column(Row* row, column_id_t col_id, Value* value) {
+    touch(row);
     if (is_readonly()) {
         *value = row->get_column(col_id);
         return true;
@@ -1363,10 +1404,17 @@ bool TxnOCC::read_column(Row* row, column_id_t col_id, Value* value) {
     *value = row->get_column(col_id);
     insert_into_map(reads_, row, col_id);
 
+    // my own pending delta, the version tracked above orders it
+    auto it_delta = deltas_.find(row_column_pair(row, col_id));
+    if (it_delta != deltas_.end()) {
+        value->add(it_delta->second);
+    }
+
     return true;
 }
 
 bool TxnOCC::write_column(Row* row, column_id_t col_id, const Value& value) {
+    touch(row);
     verify(!is_readonly());
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
@@ -1385,6 +1433,9 @@ bool TxnOCC::write_column(Row* row, column_id_t col_id, const Value& value) {
         }
     }
 
+    // a blind write overrides my pending delta
+    deltas_.erase(row_column_pair(row, col_id));
+
     // update staging area, track version
     if (row->rtti() == symbol_t::ROW_VERSIONED) {
         VersionedRow* v_row = (VersionedRow *) row;
@@ -1404,7 +1455,44 @@ bool TxnOCC::write_column(Row* row, column_id_t col_id, const Value& value) {
     return true;
 }
 
+bool TxnOCC::add_column(Row* row, column_id_t col_id, const Value& delta) {
+    verify(!is_readonly());
+    assert(debug_check_row_valid(row));
+    verify(outcome_ == symbol_t::NONE);
+
+    if (row->get_table() == nullptr) {
+        // row not inserted into table, just add in staging area
+        Value v = row->get_column(col_id);
+        v.add(delta);
+        row->update(col_id, v);
+        return true;
+    }
+
+    auto eq_range = updates_.equal_range(row);
+    for (auto it = eq_range.first; it != eq_range.second; ++it) {
+        if (it->second.first == col_id) {
+            // already written by me, which is version checked anyway
+            it->second.second.add(delta);
+            return true;
+        }
+    }
+
+    verify(row->rtti() == symbol_t::ROW_VERSIONED);
+    row_column_pair rc(row, col_id);
+    auto it = deltas_.find(rc);
+    if (it == deltas_.end()) {
+        insert_into_map(deltas_, rc, delta);
+        // keep the row alive until commit applies the delta
+        incr_row_refcount(row);
+    } else {
+        it->second.add(delta);
+    }
+
+    return true;
+}
+
 bool TxnOCC::insert_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     verify(!is_readonly());
     verify(outcome_ == symbol_t::NONE);
     verify(row->rtti() == symbol_t::ROW_VERSIONED);
@@ -1419,6 +1507,7 @@ bool TxnOCC::insert_row(Table* tbl, Row* row) {
 }
 
 bool TxnOCC::remove_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     verify(!is_readonly());
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
@@ -1464,6 +1553,45 @@ bool TxnOCC::remove_row(Table* tbl, Row* row) {
     return true;
 }
 
+void TxnOCC::marshal_stage(std::string &str) {
+    Txn2PL::marshal_stage(str);
+    uint64_t len = str.size();
+
+    // marshal deltas_, same layout as updates_
+    uint32_t num_deltas = deltas_.size();
+    str.resize(len + sizeof(num_deltas));
+    memcpy((void *)(str.data() + len), (void *)&num_deltas, sizeof(num_deltas));
+    len += sizeof(num_deltas);
+    verify(len == str.size());
+    for (auto &it : deltas_) {
+        MultiBlob mb = it.first.row->get_key();
+        int count = mb.count();
+        str.resize(len + sizeof(count));
+        memcpy((void *)(str.data() + len), (void *)(&count), sizeof(count));
+        len += sizeof(count);
+        verify(len == str.size());
+        for (int i = 0; i < count; i++) {
+            str.resize(len + sizeof(mb[i].len) + mb[i].len);
+            memcpy((void *)(str.data() + len), (void *)(&(mb[i].len)), sizeof(mb[i].len));
+            len += sizeof(mb[i].len);
+            memcpy((void *)(str.data() + len), (void *)mb[i].data, mb[i].len);
+            len += mb[i].len;
+        }
+        verify(len == str.size());
+        str.resize(len + sizeof(it.first.col_id));
+        memcpy((void *)(str.data() + len), (void *)(&it.first.col_id), sizeof(it.first.col_id));
+        len += sizeof(it.first.col_id);
+        std::string v_str = to_string(it.second);
+        uint32_t v_str_len = v_str.size();
+        str.resize(len + sizeof(v_str_len) + v_str_len);
+        memcpy((void *)(str.data() + len), (void *)&v_str_len, sizeof(v_str_len));
+        len += sizeof(v_str_len);
+        memcpy((void *)(str.data() + len), (void *)v_str.data(), v_str_len);
+        len += v_str_len;
+        verify(len == str.size());
+    }
+}
+
 
 void TxnNested::abort() {
     verify(outcome_ == symbol_t::NONE);
@@ -1489,6 +1617,7 @@ bool TxnNested::commit() {
 }
 
 bool TxnNested::read_column(Row* row, column_id_t col_id, Value* value) {
+    touch(row);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
 
@@ -1514,6 +1643,7 @@ bool TxnNested::read_column(Row* row, column_id_t col_id, Value* value) {
 }
 
 bool TxnNested::write_column(Row* row, column_id_t col_id, const Value& value) {
+    touch(row);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
 
@@ -1541,6 +1671,7 @@ bool TxnNested::write_column(Row* row, column_id_t col_id, const Value& value) {
 }
 
 bool TxnNested::insert_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     verify(outcome_ == symbol_t::NONE);
     verify(row->get_table() == nullptr);
     inserts_.insert(table_row_pair(tbl, row));
@@ -1550,6 +1681,7 @@ bool TxnNested::insert_row(Table* tbl, Row* row) {
 }
 
 bool TxnNested::remove_row(Table* tbl, Row* row) {
+    touch(tbl, row);
     assert(debug_check_row_valid(row));
     verify(outcome_ == symbol_t::NONE);
 
@@ -1583,98 +1715,59 @@ ResultSet TxnNested::query(Table* tbl, const MultiBlob& mb) {
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, &key_search_row));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, &key_search_row));
 
-    Enumerator<const Row*>* cursor = base_->query(tbl, mb).unbox();
-    MergedCursor* merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    return ResultSet(merged_cursor);
+    ResultSet rs(new BaseResultCursor(base_->query(tbl, mb)));
+    rs.merge(tbl, inserts_begin, inserts_end, removes_);
+    return rs;
 }
 
 
 ResultSet TxnNested::query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = base_->query_lt(tbl, smk, order).unbox();
-
     KeyOnlySearchRow key_search_row(tbl->schema(), &smk.get_multi_blob());
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, table_row_pair::ROW_MIN));
     auto inserts_end = inserts_.lower_bound(table_row_pair(tbl, &key_search_row));
-    MergedCursor* merged_cursor = nullptr;
-
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
 
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(new BaseResultCursor(base_->query_lt(tbl, smk, order)));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 ResultSet TxnNested::query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = base_->query_gt(tbl, smk, order).unbox();
-
     KeyOnlySearchRow key_search_row(tbl->schema(), &smk.get_multi_blob());
     auto inserts_begin = inserts_.upper_bound(table_row_pair(tbl, &key_search_row));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, table_row_pair::ROW_MAX));
-    MergedCursor* merged_cursor = nullptr;
 
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(new BaseResultCursor(base_->query_gt(tbl, smk, order)));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 ResultSet TxnNested::query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = base_->query_in(tbl, low, high, order).unbox();
-
-    MergedCursor* merged_cursor = nullptr;
     KeyOnlySearchRow key_search_row_low(tbl->schema(), &low.get_multi_blob());
     KeyOnlySearchRow key_search_row_high(tbl->schema(), &high.get_multi_blob());
     auto inserts_begin = inserts_.upper_bound(table_row_pair(tbl, &key_search_row_low));
     auto inserts_end = inserts_.lower_bound(table_row_pair(tbl, &key_search_row_high));
 
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(new BaseResultCursor(base_->query_in(tbl, low, high, order)));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 
 ResultSet TxnNested::all(Table* tbl, symbol_t order /* =? */) {
     verify(order == symbol_t::ORD_ASC || order == symbol_t::ORD_DESC || order == symbol_t::ORD_ANY);
 
-    Enumerator<const Row*>* cursor = base_->all(tbl, order).unbox();
-
-    MergedCursor* merged_cursor = nullptr;
     auto inserts_begin = inserts_.lower_bound(table_row_pair(tbl, table_row_pair::ROW_MIN));
     auto inserts_end = inserts_.upper_bound(table_row_pair(tbl, table_row_pair::ROW_MAX));
 
-    if (order == symbol_t::ORD_DESC) {
-        auto inserts_rbegin = std::multiset<table_row_pair>::const_reverse_iterator(inserts_end);
-        auto inserts_rend = std::multiset<table_row_pair>::const_reverse_iterator(inserts_begin);
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_rbegin, inserts_rend, removes_);
-    } else {
-        merged_cursor = new MergedCursor(tbl, cursor, inserts_begin, inserts_end, removes_);
-    }
-
-    return ResultSet(merged_cursor);
+    ResultSet rs(new BaseResultCursor(base_->all(tbl, order)));
+    merge_staged(&rs, tbl, inserts_begin, inserts_end, removes_, order);
+    return rs;
 }
 
 
@@ -6,62 +6,157 @@
 #include <map>
 #include <unordered_set>
 #include <set>
+#include <atomic>
 
 #include "utils.h"
 #include "value.h"
+#include "table.h"
 
 namespace mdb {
 
 // forward declaration
-class Row;
-class Table;
-class UnsortedTable;
-class SortedTable;
-class SnapshotTable;
 class TxnMgr;
-class SortedMultiKey;
 
 typedef i64 txn_id_t;
 
-// forward declaration
-class TxnNested;
+struct table_row_pair {
+    Table* table;
+    Row* row;
+
+    table_row_pair(Table* t, Row* r): table(t), row(r) {}
+
+    // NOTE: used by set, to do range query in insert_ set
+    bool operator < (const table_row_pair& o) const;
+
+    // NOTE: only used by unsorted_set, to lookup in removes_ set
+    bool operator == (const table_row_pair& o) const {
+        return table == o.table && row == o.row;
+    }
+
+    struct hash {
+        size_t operator() (const table_row_pair& p) const {
+            size_t v1 = size_t(p.table);
+            size_t v2 = size_t(p.row);
+            return inthash64(v1, v2);
+        }
+    };
+
+    static Row* ROW_MIN;
+    static Row* ROW_MAX;
+};
+
+typedef std::unordered_set<table_row_pair, table_row_pair::hash> staged_removes_t;
 
+// Result of a query: a cursor on the raw table, optionally merged with the
+// rows a txn has staged for insert or remove. ResultSet is a value type, the
+// table cursor is held inline so a query does not touch the heap, and each
+// copy iterates on its own. Only results wrapping an arbitrary Enumerator
+// (e.g. a nested txn reading through its base) are boxed and shared.
 class ResultSet: public Enumerator<Row*> {
-    friend class TxnNested;
+    typedef std::multiset<table_row_pair>::const_iterator insert_iterator;
+    typedef std::multiset<table_row_pair>::const_reverse_iterator reverse_insert_iterator;
 
+    TableCursor cursor_;
+
+    // used instead of cursor_ if not null
+    Enumerator<const Row*>* boxed_;
     int* refcnt_;
-    bool unboxed_;
-    Enumerator<const Row*>* rows_;
+
+    // staging area to merge with, not merged if removes_ is null
+    Table* tbl_;
+    const staged_removes_t* removes_;
+    bool reverse_order_;
+    insert_iterator inserts_begin_, inserts_next_, inserts_end_;
+    reverse_insert_iterator r_inserts_begin_, r_inserts_next_, r_inserts_end_;
+
+    bool cached_;
+    const Row* cached_next_;
+    const Row* next_candidate_;
 
     void decr_ref() {
-        (*refcnt_)--;
-        if (*refcnt_ == 0) {
-            delete refcnt_;
-            if (!unboxed_) {
-                delete rows_;
+        if (refcnt_ != nullptr) {
+            (*refcnt_)--;
+            if (*refcnt_ == 0) {
+                delete refcnt_;
+                delete boxed_;
             }
         }
     }
 
-    // only called by TxnNested
-    Enumerator<const Row*>* unbox() {
-        verify(!unboxed_);
-        unboxed_ = true;
-        return rows_;
+    bool base_has_next() {
+        return (boxed_ != nullptr) ? boxed_->has_next() : cursor_.has_next();
+    }
+    const Row* base_next() {
+        return (boxed_ != nullptr) ? boxed_->next() : cursor_.next();
     }
 
+    bool insert_has_next() const {
+        if (reverse_order_) {
+            return r_inserts_next_ != r_inserts_end_;
+        } else {
+            return inserts_next_ != inserts_end_;
+        }
+    }
+    const Row* insert_get_next() const {
+        if (reverse_order_) {
+            return r_inserts_next_->row;
+        } else {
+            return inserts_next_->row;
+        }
+    }
+    void insert_advance_next() {
+        if (reverse_order_) {
+            ++r_inserts_next_;
+        } else {
+            ++inserts_next_;
+        }
+    }
+
+    bool prefetch_next();
+
 public:
-    ResultSet(Enumerator<const Row*>* rows): refcnt_(new int(1)), unboxed_(false), rows_(rows) {}
-    ResultSet(const ResultSet& o): refcnt_(o.refcnt_), unboxed_(o.unboxed_), rows_(o.rows_) {
-        (*refcnt_)++;
+    explicit ResultSet(const TableCursor& cursor)
+        : cursor_(cursor), boxed_(nullptr), refcnt_(nullptr),
+          tbl_(nullptr), removes_(nullptr), reverse_order_(false),
+          cached_(false), cached_next_(nullptr), next_candidate_(nullptr) {}
+
+    // takes ownership of rows
+    ResultSet(Enumerator<const Row*>* rows)
+        : boxed_(rows), refcnt_(new int(1)),
+          tbl_(nullptr), removes_(nullptr), reverse_order_(false),
+          cached_(false), cached_next_(nullptr), next_candidate_(nullptr) {}
+
+    ResultSet(const ResultSet& o)
+        : cursor_(o.cursor_), boxed_(o.boxed_), refcnt_(o.refcnt_),
+          tbl_(o.tbl_), removes_(o.removes_), reverse_order_(o.reverse_order_),
+          inserts_begin_(o.inserts_begin_), inserts_next_(o.inserts_next_), inserts_end_(o.inserts_end_),
+          r_inserts_begin_(o.r_inserts_begin_), r_inserts_next_(o.r_inserts_next_), r_inserts_end_(o.r_inserts_end_),
+          cached_(o.cached_), cached_next_(o.cached_next_), next_candidate_(o.next_candidate_) {
+        if (refcnt_ != nullptr) {
+            (*refcnt_)++;
+        }
     }
     const ResultSet& operator =(const ResultSet& o) {
         if (this != &o) {
+            if (o.refcnt_ != nullptr) {
+                (*o.refcnt_)++;
+            }
             decr_ref();
+            cursor_ = o.cursor_;
+            boxed_ = o.boxed_;
             refcnt_ = o.refcnt_;
-            unboxed_ = o.unboxed_;
-            rows_ = o.rows_;
-            (*refcnt_)++;
+            tbl_ = o.tbl_;
+            removes_ = o.removes_;
+            reverse_order_ = o.reverse_order_;
+            inserts_begin_ = o.inserts_begin_;
+            inserts_next_ = o.inserts_next_;
+            inserts_end_ = o.inserts_end_;
+            r_inserts_begin_ = o.r_inserts_begin_;
+            r_inserts_next_ = o.r_inserts_next_;
+            r_inserts_end_ = o.r_inserts_end_;
+            cached_ = o.cached_;
+            cached_next_ = o.cached_next_;
+            next_candidate_ = o.next_candidate_;
         }
         return *this;
     }
@@ -69,15 +164,51 @@ public:
         decr_ref();
     }
 
+    // merge staged inserts [begin, end) and staged removes into the result
+    void merge(Table* tbl, const insert_iterator& begin, const insert_iterator& end, const staged_removes_t& removes) {
+        verify(removes_ == nullptr);
+        tbl_ = tbl;
+        removes_ = &removes;
+        reverse_order_ = false;
+        inserts_begin_ = inserts_next_ = begin;
+        inserts_end_ = end;
+    }
+    void merge(Table* tbl, const reverse_insert_iterator& rbegin, const reverse_insert_iterator& rend, const staged_removes_t& removes) {
+        verify(removes_ == nullptr);
+        tbl_ = tbl;
+        removes_ = &removes;
+        reverse_order_ = true;
+        r_inserts_begin_ = r_inserts_next_ = rbegin;
+        r_inserts_end_ = rend;
+    }
+
     void reset() {
-        rows_->reset();
+        if (boxed_ != nullptr) {
+            boxed_->reset();
+        } else {
+            cursor_.reset();
+        }
+        inserts_next_ = inserts_begin_;
+        r_inserts_next_ = r_inserts_begin_;
+        cached_ = false;
+        next_candidate_ = nullptr;
     }
 
     bool has_next() {
-        return rows_->has_next();
+        if (removes_ == nullptr) {
+            return base_has_next();
+        }
+        return cached_ || prefetch_next();
     }
     Row* next() {
-        return const_cast<Row*>(rows_->next());
+        if (removes_ == nullptr) {
+            return const_cast<Row*>(base_next());
+        }
+        if (!cached_) {
+            verify(prefetch_next());
+        }
+        cached_ = false;
+        return const_cast<Row*>(cached_next_);
     }
 };
 
@@ -85,9 +216,40 @@ class Txn: public NoCopy {
 protected:
     const TxnMgr* mgr_;
     txn_id_t txnid_;
-    Txn(const TxnMgr* mgr, txn_id_t txnid): mgr_(mgr), txnid_(txnid) {}
+    // rows read or written through this txn, back to back accesses to one
+    // row count once; in all and by table
+    uint64_t n_touched_;
+    const Row* last_touched_;
+    std::map<const Table*, uint64_t> n_touched_by_table_;
+    const Table* last_table_;
+    uint64_t* last_table_count_;
+    Txn(const TxnMgr* mgr, txn_id_t txnid): mgr_(mgr), txnid_(txnid), n_touched_(0), last_touched_(nullptr),
+            last_table_(nullptr), last_table_count_(nullptr) {}
+
+    void touch(const Table* tbl, const Row* row) {
+        if (row != last_touched_) {
+            last_touched_ = row;
+            n_touched_++;
+            if (tbl != last_table_ || last_table_count_ == nullptr) {
+                last_table_ = tbl;
+                last_table_count_ = &n_touched_by_table_[tbl];
+            }
+            (*last_table_count_)++;
+        }
+    }
+    void touch(const Row* row) {
+        touch(row->get_table(), row);
+    }
 
 public:
+    uint64_t n_touched() const {
+        return n_touched_;
+    }
+    // rows not in a table yet under nullptr
+    const std::map<const Table*, uint64_t>& n_touched_by_table() const {
+        return n_touched_by_table_;
+    }
+
     virtual ~Txn() {}
     virtual symbol_t rtti() const = 0;
     txn_id_t id() const {
@@ -112,6 +274,20 @@ public:
 
     virtual bool read_column(Row* row, column_id_t col_id, Value* value) = 0;
     virtual bool write_column(Row* row, column_id_t col_id, const Value& value) = 0;
+
+    // value += delta. adds commute with each other, so a txn mgr may merge
+    // them at commit without ordering them, only reads of the column order
+    // against them. by default it is a plain read-modify-write; 2PL keeps
+    // it, rrr::ALock has only read and write modes and a piece that adds
+    // still registers a WLOCK
+    virtual bool add_column(Row* row, column_id_t col_id, const Value& delta) {
+        Value v;
+        if (!read_column(row, col_id, &v)) {
+            return false;
+        }
+        v.add(delta);
+        return write_column(row, col_id, v);
+    }
     virtual bool insert_row(Table* tbl, Row* row) = 0;
     virtual bool remove_row(Table* tbl, Row* row) = 0;
 
@@ -150,6 +326,15 @@ public:
         return query(tbl, mb);
     }
 
+    // batched point lookups: (*rows)[i] is the first row matching keys[i],
+    // or nullptr if there is none
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows);
+
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows, bool retrieve, int64_t pid) {
+        verify(rtti() != symbol_t::TXN_2PL);
+        multi_get(tbl, keys, rows);
+    }
+
     ResultSet query_lt(Table* tbl, const Value& kv, symbol_t order = symbol_t::ORD_ASC) {
         return query_lt(tbl, kv.get_blob(), order);
     }
@@ -185,22 +370,39 @@ public:
 };
 
 
+typedef enum {
+    CONFLICT_VERSION,   // occ validation saw a newer version
+    CONFLICT_RLOCK,     // occ commit could not read lock the row
+    CONFLICT_WLOCK,     // occ commit could not write lock the row
+    CONFLICT_WAIT,      // 2pl lock request had to wait
+    CONFLICT_REFUSE,    // 2pl lock request was refused, wait/wound die
+    CONFLICT_DEP,       // a txn was ordered after another on a cell
+    CONFLICT_N
+} conflict_t;
+
+typedef void (*conflict_hook_t)(conflict_t kind, const Row* row);
+
 class TxnMgr: public NoCopy {
     std::map<std::string, Table*> tables_;
 
 public:
 
-#ifdef CONFLICT_COUNT
-    static std::map<const Table *, uint64_t> vc_conflict_count_;
-    static std::map<const Table *, uint64_t> rl_conflict_count_;
-    static std::map<const Table *, uint64_t> wl_conflict_count_;
-#endif
-    virtual ~TxnMgr() {
-#ifdef CONFLICT_COUNT
-        for (auto it : tables_)
-            Log::info("CONFLICT COUNT: Table: %10s,\tversion check: %5llu, read: %5llu\twrite: %5llu", it.first.c_str(), vc_conflict_count_[it.second], rl_conflict_count_[it.second], wl_conflict_count_[it.second]);
-#endif
+    // when set, told about every conflict between txns on a row; may be
+    // set or cleared while txns run
+    static std::atomic<conflict_hook_t> conflict_hook_s;
+
+    static bool conflict_hooked() {
+        return conflict_hook_s.load(std::memory_order_relaxed) != nullptr;
+    }
+
+    static void conflict(conflict_t kind, const Row* row) {
+        conflict_hook_t hook = conflict_hook_s.load(std::memory_order_relaxed);
+        if (hook != nullptr) {
+            hook(kind, row);
+        }
     }
+
+    virtual ~TxnMgr() {}
     virtual symbol_t rtti() const = 0;
     virtual Txn* start(txn_id_t txnid) = 0;
     Txn* start_nested(Txn* base);
@@ -227,10 +429,49 @@ public:
 
 class TxnUnsafe: public Txn {
 public:
-    TxnUnsafe(const TxnMgr* mgr, txn_id_t txnid): Txn(mgr, txnid) {}
+    // how to take back one write: the old value of a column, or a row
+    // inserted (removed on rollback) or removed (put back, kept alive)
+    struct undo_t {
+        Table* tbl;
+        Row* row;
+        column_id_t col_id;
+        Value old;
+        bool inserted;
+    };
+    typedef std::vector<undo_t> undo_log_t;
+
+private:
+    // read only txns see MultiVersionedRows as of snapshot_ver_
+    bool snapshot_;
+    version_t snapshot_ver_;
+    undo_log_t* undo_;
+
+    ResultSet visible_rows(const ResultSet& rs) const;
+
+public:
+    TxnUnsafe(const TxnMgr* mgr, txn_id_t txnid): Txn(mgr, txnid), snapshot_(false), snapshot_ver_(0), undo_(nullptr) {}
+
+    // read only txn on the snapshot taken at timestamp snapshot_ver
+    TxnUnsafe(const TxnMgr* mgr, txn_id_t txnid, version_t snapshot_ver)
+        : Txn(mgr, txnid), snapshot_(true), snapshot_ver_(snapshot_ver), undo_(nullptr) {}
+
+    // the writes from now on are logged to log, nullptr stops logging.
+    // the caller keeps other txns off the rows until it rolls back or
+    // keeps the log
+    void set_undo(undo_log_t* log) {
+        undo_ = log;
+    }
+    // takes back the logged writes, newest first, and empties log
+    static void rollback(undo_log_t* log);
+    // the logged writes stay, empties log
+    static void keep(undo_log_t* log);
+
     virtual symbol_t rtti() const {
         return symbol_t::TXN_UNSAFE;
     }
+    bool is_readonly() const {
+        return snapshot_;
+    }
     void abort() {
         // do nothing
     }
@@ -250,6 +491,9 @@ public:
     virtual ResultSet query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order = symbol_t::ORD_ASC);
 
     virtual ResultSet all(Table* tbl, symbol_t order = symbol_t::ORD_ANY);
+
+    using Txn::multi_get;
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows);
 };
 
 class TxnMgrUnsafe: public TxnMgr {
@@ -257,38 +501,17 @@ public:
     virtual Txn* start(txn_id_t txnid) {
         return new TxnUnsafe(this, txnid);
     }
+    // reads MultiVersionedRows as of snapshot_ver, which the caller keeps
+    // from being garbage collected while the txn runs
+    TxnUnsafe* start_readonly(txn_id_t txnid, version_t snapshot_ver) {
+        return new TxnUnsafe(this, txnid, snapshot_ver);
+    }
     virtual symbol_t rtti() const {
         return symbol_t::TXN_UNSAFE;
     }
 };
 
 
-struct table_row_pair {
-    Table* table;
-    Row* row;
-
-    table_row_pair(Table* t, Row* r): table(t), row(r) {}
-
-    // NOTE: used by set, to do range query in insert_ set
-    bool operator < (const table_row_pair& o) const;
-
-    // NOTE: only used by unsorted_set, to lookup in removes_ set
-    bool operator == (const table_row_pair& o) const {
-        return table == o.table && row == o.row;
-    }
-
-    struct hash {
-        size_t operator() (const table_row_pair& p) const {
-            size_t v1 = size_t(p.table);
-            size_t v2 = size_t(p.row);
-            return inthash64(v1, v2);
-        }
-    };
-
-    static Row* ROW_MIN;
-    static Row* ROW_MAX;
-};
-
 struct column_lock_t {
     Row *row;
     column_id_t column_id;
@@ -301,18 +524,25 @@ struct column_lock_t {
 struct query_buf_t {
     int retrieve_index;
     std::vector<ResultSet> buf;
+    // results of multi_get, replayed the same way as buf
+    int batch_retrieve_index;
+    std::vector<std::vector<Row*>> batch_buf;
 
-    query_buf_t() : retrieve_index(0) {
+    query_buf_t() : retrieve_index(0), batch_retrieve_index(0) {
     }
 
     query_buf_t(const query_buf_t &o) {
         retrieve_index = o.retrieve_index;
         buf = o.buf;
+        batch_retrieve_index = o.batch_retrieve_index;
+        batch_buf = o.batch_buf;
     }
 
     const query_buf_t &operator=(const query_buf_t &rhs) {
         retrieve_index = rhs.retrieve_index;
         buf = rhs.buf;
+        batch_retrieve_index = rhs.batch_retrieve_index;
+        batch_buf = rhs.batch_buf;
         return *this;
     }
 };
@@ -344,6 +574,7 @@ protected:
     }
 
     ResultSet do_query(Table* tbl, const MultiBlob& mb);
+    void do_multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows);
 
     ResultSet do_query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC);
     ResultSet do_query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC);
@@ -447,6 +678,12 @@ public:
                 const std::function<void(void)> &succ_callback,
                 const std::function<void(void)> &fail_callback);
 
+        // lock_all, telling TxnMgr::conflict_hook_s about waits and refusals
+        void lock_all_reporting(rrr::ALockGroup &group,
+                const std::vector<const Row*> &rows,
+                const std::function<void(void)> &succ_callback,
+                const std::function<void(void)> &fail_callback);
+
         void abort() {
             verify(finish_);
             if (rw_succ_)
@@ -540,6 +777,12 @@ public:
     }
     ~Txn2PL();
 
+    // false if the txn only read on this server, so there is nothing
+    // to install and it can vote read only at prepare
+    virtual bool has_writes() const {
+        return !inserts_.empty() || !updates_.empty() || !removes_.empty();
+    }
+
     bool is_wound() {
         return wound_;
     }
@@ -664,6 +907,20 @@ public:
             return rs;
         }
     }
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+        do_multi_get(tbl, keys, rows);
+    }
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows, bool retrieve, int64_t pid) {
+        query_buf_t &qb = (pid == ps_cache_->pid_) ? ps_cache_->query_buf_
+            : piece_map_[pid]->query_buf_;
+        if (retrieve) {
+            *rows = qb.batch_buf[qb.batch_retrieve_index++];
+        }
+        else {
+            do_multi_get(tbl, keys, rows);
+            qb.batch_buf.push_back(*rows);
+        }
+    }
 };
 
 class TxnMgr2PL: public TxnMgr {
@@ -715,8 +972,24 @@ class TxnOCC: public Txn2PL {
     // OCC_EAGER (default): update version at first write (early conflict detection)
     symbol_t policy_;
 
+    // pending add_column deltas, applied to the latest value at commit
+    std::unordered_map<row_column_pair, Value, row_column_pair::hash> deltas_;
+
     std::map<std::string, SnapshotTable*> snapshots_;
     std::set<Table*> snapshot_tables_;
+    // live table => its pinned snapshot, handlers only know the live tables
+    std::map<const Table*, SnapshotTable*> snapshot_of_;
+    // false if the snapshots are shared, whoever handed them in frees them
+    bool own_snapshots_;
+
+    Table* snapshot_of(Table* tbl) const {
+        if (!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end()) {
+            return tbl;
+        }
+        auto it = snapshot_of_.find(tbl);
+        verify(it != snapshot_of_.end());
+        return it->second;
+    }
 
     void incr_row_refcount(Row* r);
     bool version_check();
@@ -724,10 +997,13 @@ class TxnOCC: public Txn2PL {
     void release_resource();
 
 public:
-    TxnOCC(const TxnMgr* mgr, txn_id_t txnid): Txn2PL(mgr, txnid), verified_(false), policy_(symbol_t::OCC_EAGER) {}
+    TxnOCC(const TxnMgr* mgr, txn_id_t txnid): Txn2PL(mgr, txnid), verified_(false), policy_(symbol_t::OCC_EAGER), own_snapshots_(true) {}
 
     TxnOCC(const TxnMgr* mgr, txn_id_t txnid, const std::vector<std::string>& table_names);
 
+    // reads snapshots taken by the caller, which must outlive the txn
+    TxnOCC(const TxnMgr* mgr, txn_id_t txnid, const std::map<std::string, SnapshotTable*>& snapshots);
+
     ~TxnOCC();
 
     virtual symbol_t rtti() const {
@@ -760,6 +1036,10 @@ public:
     virtual bool commit_prepare();
     void commit_confirm();
 
+    virtual bool has_writes() const {
+        return !deltas_.empty() || Txn2PL::has_writes();
+    }
+
     bool commit_prepare_or_abort() {
         bool ret = commit_prepare();
         if (!ret) {
@@ -770,37 +1050,42 @@ public:
 
     virtual bool read_column(Row* row, column_id_t col_id, Value* value);
     virtual bool write_column(Row* row, column_id_t col_id, const Value& value);
+    // deltas are neither version checked nor write locked, prepare only
+    // read locks their rows to keep plain writers out until confirm
+    virtual bool add_column(Row* row, column_id_t col_id, const Value& delta);
     virtual bool insert_row(Table* tbl, Row* row);
     virtual bool remove_row(Table* tbl, Row* row);
 
+    virtual void marshal_stage(std::string &str);
+
     using Txn::query;
     using Txn::query_lt;
     using Txn::query_gt;
     using Txn::query_in;
 
     virtual ResultSet query(Table* tbl, const MultiBlob& mb) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_query(tbl, mb);
+        return do_query(snapshot_of(tbl), mb);
     }
     virtual ResultSet query(Table *tbl, const MultiBlob &mb, bool, int64_t) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_query(tbl, mb);
+        return do_query(snapshot_of(tbl), mb);
     }
     virtual ResultSet query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_query_lt(tbl, smk, order);
+        return do_query_lt(snapshot_of(tbl), smk, order);
     }
     virtual ResultSet query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_query_gt(tbl, smk, order);
+        return do_query_gt(snapshot_of(tbl), smk, order);
     }
     virtual ResultSet query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order = symbol_t::ORD_ASC) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_query_in(tbl, low, high, order);
+        return do_query_in(snapshot_of(tbl), low, high, order);
     }
     virtual ResultSet all(Table* tbl, symbol_t order = symbol_t::ORD_ANY) {
-        verify(!is_readonly() || snapshot_tables_.find(tbl) != snapshot_tables_.end());
-        return do_all(tbl, order);
+        return do_all(snapshot_of(tbl), order);
+    }
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+        do_multi_get(snapshot_of(tbl), keys, rows);
+    }
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows, bool, int64_t) {
+        do_multi_get(snapshot_of(tbl), keys, rows);
     }
 };
 
@@ -817,6 +1102,9 @@ public:
     TxnOCC* start_readonly(txn_id_t txnid, const std::vector<std::string>& table_names) {
         return new TxnOCC(this, txnid, table_names);
     }
+    TxnOCC* start_readonly(txn_id_t txnid, const std::map<std::string, SnapshotTable*>& snapshots) {
+        return new TxnOCC(this, txnid, snapshots);
+    }
 };
 
 
@@ -843,6 +1131,13 @@ public:
     virtual ResultSet query(Table* tbl, const MultiBlob& mb, bool, int64_t) {
         return query(tbl, mb);
     }
+    // nested lookups must see the base txn's staged rows, go key by key
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows) {
+        Txn::multi_get(tbl, keys, rows);
+    }
+    virtual void multi_get(Table* tbl, const std::vector<MultiBlob>& keys, std::vector<Row*>* rows, bool, int64_t) {
+        Txn::multi_get(tbl, keys, rows);
+    }
     ResultSet query_lt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC);
     ResultSet query_gt(Table* tbl, const SortedMultiKey& smk, symbol_t order = symbol_t::ORD_ASC);
     ResultSet query_in(Table* tbl, const SortedMultiKey& low, const SortedMultiKey& high, symbol_t order = symbol_t::ORD_ASC);
@@ -60,6 +60,29 @@ int Value::compare(const Value& o) const {
     return 0;
 }
 
+void Value::add(const Value& delta) {
+    verify(k_ == delta.k_);
+
+    switch (k_) {
+    case I32:
+        i32_ += delta.i32_;
+        break;
+
+    case I64:
+        i64_ += delta.i64_;
+        break;
+
+    case DOUBLE:
+        double_ += delta.double_;
+        break;
+
+    default:
+        Log::fatal("cannot add to value type %d", k_);
+        verify(0);
+        break;
+    }
+}
+
 
 void Value::write_binary(char* buf) const {
     switch (k_) {
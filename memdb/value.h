@@ -85,6 +85,10 @@ public:
     // both side should have same kind
     int compare(const Value& o) const;
 
+    // numeric only: this += delta
+    // both side should have same kind
+    void add(const Value& delta);
+
     bool operator ==(const Value& o) const {
         return compare(o) == 0;
     }
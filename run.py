@@ -9,6 +9,8 @@ import subprocess
 import time
 import os
 import shutil
+import glob
+import json
 import xml.etree.ElementTree as ET
 import sys
 sys.path += os.path.abspath(os.path.join(os.path.split(__file__)[0], "./rrr/pylib")),
@@ -22,16 +24,80 @@ cwd = os.getcwd()
 deptran_home, ff = os.path.split(os.path.realpath(__file__))
 g_log_dir = deptran_home + "/log"
 
+# "x% LATENCY" and the like in RECORDING_RESULT: the mean of the lowest x
+# share; PERCENTILE_RESULT has the x percentile itself as "LATENCY Px"
 g_latencies_percentage = [0.5, 0.9, 0.99, 0.999]
 g_latencies_header = [str(x * 100) + "% LATENCY" for x in g_latencies_percentage]
+g_latencies_p_header = ["LATENCY P" + str(x * 100) for x in g_latencies_percentage]
 g_att_latencies_percentage = [0.5, 0.9, 0.99, 0.999]
 g_att_latencies_header = [str(x * 100) + "% ATT_LT" for x in g_att_latencies_percentage]
+g_att_latencies_p_header = ["ATT_LT P" + str(x * 100) for x in g_att_latencies_percentage]
 g_n_try_percentage = [0.5, 0.9, 0.99, 0.999]
 g_n_try_header = [str(x * 100) + "% N_TRY" for x in g_n_try_percentage]
+g_n_try_p_header = ["N_TRY P" + str(x * 100) for x in g_n_try_percentage]
 g_interest_txn = "NEW ORDER"
 g_max_latency = 99999.9
+g_phase_names = ["START", "PREPARE", "FINISH", "RETRY", "QUEUE", "WAIT"] # PHASE_* in constants.hpp
+g_conflict_names = ["VERSION", "RLOCK", "WLOCK", "WAIT", "REFUSE", "DEP"] # mdb::conflict_t in memdb/txn.h
+g_phase_percentage = [0.5, 0.99]
 g_max_try = 99999.9
 
+class LatencyHist(object):
+    """ client histograms merged, bucket layout as in deptran/latency_hist.h """
+    def __init__(self):
+        self.sub_bits = 0
+        self.unit = 1.0
+        self.buckets = dict()
+
+    def merge(self, h):
+        self.sub_bits = h.sub_bits
+        self.unit = h.unit
+        for b, c in h.buckets.items():
+            self.buckets[b] = self.buckets.get(b, 0) + c
+
+    def size(self):
+        return sum(self.buckets.values())
+
+    def value(self, b):
+        # middle of the bucket, within half a bucket of any value in it
+        sub = 1 << self.sub_bits
+        if b < sub:
+            low, width = b, 1
+        else:
+            shift = (b >> self.sub_bits) - 1
+            low, width = (sub + (b & (sub - 1))) << shift, 1 << shift
+        return (low + (width - 1) / 2.0) * self.unit
+
+    def min(self):
+        return self.value(min(self.buckets.keys()))
+
+    def max(self):
+        return self.value(max(self.buckets.keys()))
+
+    def percentile(self, q):
+        total = self.size()
+        rank = min(int(q * total), total - 1)
+        seen = 0
+        for b in sorted(self.buckets.keys()):
+            seen += self.buckets[b]
+            if seen > rank:
+                return self.value(b)
+
+    def low_mean(self, q):
+        # mean of the lowest q share, None if that is nothing
+        n = int(q * self.size())
+        if n == 0:
+            return None
+        left = n
+        total = 0.0
+        for b in sorted(self.buckets.keys()):
+            c = min(self.buckets[b], left)
+            total += c * self.value(b)
+            left -= c
+            if left == 0:
+                break
+        return total / n
+
 class TxnInfo(object):
     def __init__(self, txn_type, txn_name, interest):
         self.txn_type = txn_type
@@ -65,9 +131,10 @@ class TxnInfo(object):
         self.mid_pre_commit_txn = 0
         self.mid_commit_txn = 0
         self.mid_time = 0.0
-        self.mid_latencies = []
-        self.mid_attempt_latencies = []
-        self.mid_n_try = []
+        self.mid_latencies = LatencyHist()
+        self.mid_attempt_latencies = LatencyHist()
+        self.mid_n_try = LatencyHist()
+        self.mid_phases = [LatencyHist() for x in g_phase_names]
 
     def set_mid_status(self):
         self.mid_status += 1
@@ -93,7 +160,7 @@ class TxnInfo(object):
             self.mid_total_try = 0
             self.mid_commit_txn = 0
 
-    def push_res(self, start_txn, total_txn, total_try, commit_txn, this_latencies, last_latencies, latencies, attempt_latencies, interval_time, n_tried):
+    def push_res(self, start_txn, total_txn, total_try, commit_txn, this_latencies, last_latencies, latencies, attempt_latencies, interval_time, n_tried, phase_latencies):
         self.start_txn += start_txn
         self.total_txn += total_txn
         self.total_try += total_try
@@ -111,10 +178,12 @@ class TxnInfo(object):
             self.mid_pre_total_try += total_try
             self.mid_pre_commit_txn += commit_txn
         elif self.mid_status == 1:
-            self.mid_latencies.extend(latencies)
-            self.mid_attempt_latencies.extend(attempt_latencies)
+            self.mid_latencies.merge(latencies)
+            self.mid_attempt_latencies.merge(attempt_latencies)
             self.mid_time += interval_time
-            self.mid_n_try.extend(n_tried)
+            self.mid_n_try.merge(n_tried)
+            for p, h in zip(self.mid_phases, phase_latencies):
+                p.merge(h)
             self.mid_start_txn += start_txn
             self.mid_total_txn += total_txn
             self.mid_total_try += total_try
@@ -213,54 +282,74 @@ class TxnInfo(object):
         self.mid_time /= num_clients
         tps = str(int(round((self.mid_commit_txn - self.mid_pre_commit_txn) / self.mid_time)))
 
-        self.mid_latencies.sort()
-        self.mid_attempt_latencies.sort()
-        self.mid_n_try.sort()
-
         min_latency = g_max_latency
         max_latency = g_max_latency
         latency_str = ""
-        latencies_size = len(self.mid_latencies)
+        latencies_size = self.mid_latencies.size()
         if (latencies_size > 0):
-            min_latency = self.mid_latencies[0]
-            max_latency = self.mid_latencies[latencies_size - 1]
-        latencies_sample_size = [int(x * latencies_size) for x in g_latencies_percentage]
+            min_latency = self.mid_latencies.min()
+            max_latency = self.mid_latencies.max()
+        percentile_str = ""
         i = 0
         while i < len(g_latencies_header):
             latency_str += "; " + g_latencies_header[i] + ": "
-            s_size = latencies_sample_size[i]
-            if s_size != 0:
-                latency_str += str(sum(self.mid_latencies[0:s_size]) / s_size)
+            low_mean = self.mid_latencies.low_mean(g_latencies_percentage[i])
+            if low_mean is not None:
+                latency_str += str(low_mean)
             else:
                 latency_str += str(g_max_latency)
+            percentile_str += "; " + g_latencies_p_header[i] + ": "
+            if latencies_size > 0:
+                percentile_str += str(self.mid_latencies.percentile(g_latencies_percentage[i]))
+            else:
+                percentile_str += str(g_max_latency)
             i += 1
 
-        attempt_latencies_size = len(self.mid_attempt_latencies)
-        attempt_latencies_sample_size = [int(x * attempt_latencies_size) for x in g_att_latencies_percentage]
+        attempt_latencies_size = self.mid_attempt_latencies.size()
         i = 0
         while i < len(g_att_latencies_header):
             latency_str += "; " + g_att_latencies_header[i] + ": "
-            s_size = attempt_latencies_sample_size[i]
-            if s_size != 0:
-                latency_str += str(sum(self.mid_attempt_latencies[0:s_size]) / s_size)
+            low_mean = self.mid_attempt_latencies.low_mean(g_att_latencies_percentage[i])
+            if low_mean is not None:
+                latency_str += str(low_mean)
             else:
                 latency_str += str(g_max_latency)
+            percentile_str += "; " + g_att_latencies_p_header[i] + ": "
+            if attempt_latencies_size > 0:
+                percentile_str += str(self.mid_attempt_latencies.percentile(g_att_latencies_percentage[i]))
+            else:
+                percentile_str += str(g_max_latency)
             i += 1
 
         n_tried_str = ""
-        n_try_size = len(self.mid_n_try)
-        n_try_sample_size = [int(x * n_try_size) for x in g_n_try_percentage]
+        n_try_size = self.mid_n_try.size()
         i = 0
         while i < len(g_n_try_header):
             n_tried_str += "; " + g_n_try_header[i] + ": "
-            s_size = n_try_sample_size[i]
-            if s_size != 0:
-                n_tried_str += str(sum(self.mid_n_try[0:s_size]) * 1.0 / s_size)
+            low_mean = self.mid_n_try.low_mean(g_n_try_percentage[i])
+            if low_mean is not None:
+                n_tried_str += str(low_mean)
             else:
                 n_tried_str += str(g_max_try)
+            percentile_str += "; " + g_n_try_p_header[i] + ": "
+            if n_try_size > 0:
+                percentile_str += str(self.mid_n_try.percentile(g_n_try_percentage[i]))
+            else:
+                percentile_str += str(g_max_try)
             i += 1
 
         print "RECORDING_RESULT: TXN: <" + self.txn_name + ">; STARTED_TXNS: " + start_txn + "; FINISHED_TXNS: " + total_txn + "; ATTEMPTS: " + tries + "; COMMITS: " + commit_txn + "; TPS: " + tps + latency_str + "; TIME: " + str(self.mid_time) + "; LATENCY MIN: " + str(min_latency) + "; LATENCY MAX: " + str(max_latency) + n_tried_str
+        print "PERCENTILE_RESULT: TXN: <" + self.txn_name + ">" + percentile_str
+
+        phase_str = ""
+        for name, h in zip(g_phase_names, self.mid_phases):
+            for x in g_phase_percentage:
+                phase_str += "; " + name + " " + str(x * 100) + "%: "
+                if h.size() > 0:
+                    phase_str += str(h.percentile(x))
+                else:
+                    phase_str += str(g_max_latency)
+        print "PHASE_RESULT: TXN: <" + self.txn_name + ">" + phase_str
 
     def print_max(self):
         latency_str = ""
@@ -308,6 +397,7 @@ class ClientController(object):
         self.run_nsec = 0
         self.pre_run_nsec = 0
         self.n_asking = 0;
+        self.queue_depth = LatencyHist()
         self.single_server = str(single_server)
         self.machine_n_cores = dict()
         self.taskset = taskset
@@ -401,6 +491,7 @@ class ClientController(object):
             print "Clients started"
 
             self.benchmark_record(do_sample, do_sample_lock)
+            self.client_dump_trace()
             self.client_shutdown()
 
         except:
@@ -465,10 +556,11 @@ class ClientController(object):
                     self.total_txn += res.txn_info[txn_type].total_txn
                     self.total_try += res.txn_info[txn_type].total_try
                     self.commit_txn += res.txn_info[txn_type].commit_txn
-                    self.txn_infos[txn_type].push_res(res.txn_info[txn_type].start_txn, res.txn_info[txn_type].total_txn, res.txn_info[txn_type].total_try, res.txn_info[txn_type].commit_txn, res.txn_info[txn_type].this_latency, res.txn_info[txn_type].last_latency, res.txn_info[txn_type].interval_latency, res.txn_info[txn_type].attempt_latency, period_time, res.txn_info[txn_type].num_try)
+                    self.txn_infos[txn_type].push_res(res.txn_info[txn_type].start_txn, res.txn_info[txn_type].total_txn, res.txn_info[txn_type].total_try, res.txn_info[txn_type].commit_txn, res.txn_info[txn_type].this_latency, res.txn_info[txn_type].last_latency, res.txn_info[txn_type].interval_latency, res.txn_info[txn_type].attempt_latency, period_time, res.txn_info[txn_type].num_try, res.txn_info[txn_type].phase_latency)
                 self.run_sec += res.run_sec
                 self.run_nsec += res.run_nsec
                 self.n_asking += res.n_asking
+                self.queue_depth.merge(res.queue_depth)
                 if (res.is_finish == 1):
                     self.finish_set.add(i)
                 i += 1
@@ -528,6 +620,9 @@ class ClientController(object):
         output_str += "INTERVAL: elapsed time: " + str(round(interval_time, 2)) + "\n"
         output_str += tabulate(interval_table, headers=interval_header) + "\n"
         output_str += "\tTotal asking finish: " + str(self.n_asking) + "\n"
+        if (self.queue_depth.size() > 0):
+            # open loop only, sampled at each arrival since the start
+            output_str += "QUEUE_DEPTH: p50: " + str(self.queue_depth.percentile(0.5)) + "; p99: " + str(self.queue_depth.percentile(0.99)) + "; max: " + str(self.queue_depth.max()) + "\n"
         output_str += "----------------------------------------------------------------------\n"
         print output_str
 
@@ -558,6 +653,12 @@ class ClientController(object):
             except:
                 pass
 
+    def client_dump_trace(self):
+        i = 0
+        while (i < len(self.rpc_proxy)):
+            write_trace(self.rpc_proxy[i].sync_client_dump_trace(), self.log_dir + "/trace-client-" + str(i) + ".json")
+            i += 1
+
     def client_shutdown(self):
         print "Shutting down clients ..."
         i = 0
@@ -655,6 +756,10 @@ class ServerController(object):
             avg_r_sz = 0.0
             avg_cpu_util = 0.0
             sample_result = []
+            piece_result = []
+            rows_result = []
+            hot_result = []
+            conflict_result = []
             #timeout_counter = 0
             while (True):
                 do_statistics = False
@@ -669,6 +774,10 @@ class ServerController(object):
                 r_sz_sum = 0
                 r_sz_num = 0
                 statistics = dict()
+                pieces = dict()
+                rows = dict()
+                hot_keys = []
+                conflicts = dict()
                 cpu_util = [0.0] * len(self.rpc_proxy)
                 futures = []
                 while (i < len(self.rpc_proxy)):
@@ -693,6 +802,27 @@ class ServerController(object):
                                 statistics[k] = ServerResponse(v)
                             else:
                                 statistics[k].add_one(v)
+                        for ps in ret.piece_stats:
+                            k = (ps.t_type, ps.p_type)
+                            if k not in pieces:
+                                pieces[k] = [0] * 6
+                            sums = pieces[k]
+                            sums[0] += ps.n_exec
+                            sums[1] += ps.exec_us
+                            sums[2] += ps.n_immediate
+                            sums[3] += ps.n_deferred
+                            sums[4] += ps.wait_us
+                            sums[5] += ps.n_rows
+                        for k, v in ret.rows_touched.items():
+                            rows[k] = rows.get(k, 0) + v
+                        # servers hold different keys, no merging needed
+                        for hk in ret.hot_keys:
+                            hot_keys.append([i, hk.table, hk.key, hk.count, hk.error, hk.by_kind])
+                        for k, v in ret.table_conflicts.items():
+                            if k not in conflicts:
+                                conflicts[k] = [0] * len(v)
+                            for j in range(len(v)):
+                                conflicts[k][j] += v[j]
                     else:
                         futures[i].wait()
                     i += 1
@@ -721,6 +851,10 @@ class ServerController(object):
                     #do_sample_lock.acquire()
                     #if (do_sample.value == 1):
                     sample_result = interval_result
+                    piece_result = sorted(pieces.items(), key=lambda x: -x[1][1])
+                    rows_result = sorted(rows.items(), key=lambda x: -x[1])
+                    hot_result = sorted(hot_keys, key=lambda x: -x[3])
+                    conflict_result = sorted(conflicts.items(), key=lambda x: -sum(x[1]))
                     #    avg_cpu_util = sum(cpu_util) / len(cpu_util)
 
                     #    do_sample.value = 0
@@ -744,11 +878,26 @@ class ServerController(object):
 
             for single_record in sample_result:
                 print "SERVREC: " + str(single_record[0]) + ": VALUE: " + str(single_record[1]) + "; TIMES: " + str(single_record[2]) + "; MEAN: " + str(single_record[3]) + "; TIME: " + str(single_record[4])
+            # piece_profile, costliest first
+            for k, v in piece_result:
+                print "PIECE_PROFILE: TXN: " + str(k[0]) + "; PIECE: " + str(k[1]) + "; EXEC: " + str(v[0]) + "; EXEC_US: " + str(v[1]) + "; IMMEDIATE: " + str(v[2]) + "; DEFERRED: " + str(v[3]) + "; WAIT_US: " + str(v[4]) + "; ROWS: " + str(v[5])
+            for k, v in rows_result:
+                print "ROWS_TOUCHED: " + str(k) + ": " + str(v)
+            # contention_top_k, by mdb::conflict_t
+            for k, v in conflict_result:
+                print "TABLE_CONFLICTS: " + str(k) + ": " + "; ".join([g_conflict_names[j] + ": " + str(v[j]) for j in range(len(v))])
+            for hk in hot_result:
+                print "HOT_KEY: SERVER: " + str(hk[0]) + "; TABLE: " + hk[1] + "; KEY: " + hk[2] + "; COUNT: " + str(hk[3]) + "; ERROR: " + str(hk[4]) + "; " + "; ".join([g_conflict_names[j] + ": " + str(hk[5][j]) for j in range(len(hk[5]))])
             print "CPUINFO: " + str(avg_cpu_util) + ";"
             print "AVG_LOG_FLUSH_CNT: " + str(avg_r_cnt) + ";"
             print "AVG_LOG_FLUSH_SZ: " + str(avg_r_sz) + ";"
             print "BENCHMARK_SUCCEED"
 
+            i = 0
+            while (i < len(self.rpc_proxy)):
+                write_trace(self.rpc_proxy[i].sync_server_dump_trace(), self.log_dir + "/trace-site-" + str(i) + ".json")
+                i += 1
+
             print "Shutting down servers ..."
             i = 0
             while (i < len(self.rpc_proxy)):
@@ -804,6 +953,29 @@ class ServerController(object):
             subprocess.call(['ssh', '-n', '-f', self.s_info[i][0], cmd])
             i += 1
 
+# trace_ring: one chrome trace per process, empty ones are left out
+def write_trace(trace, path):
+    if len(json.loads(trace)["traceEvents"]) <= 1:
+        return
+    f = open(path, "w")
+    f.write(trace)
+    f.close()
+
+# all processes in one file for chrome://tracing or perfetto
+def merge_traces(log_dir):
+    paths = glob.glob(log_dir + "/trace-*.json")
+    if len(paths) == 0:
+        return
+    events = []
+    for path in paths:
+        f = open(path)
+        events += json.load(f)["traceEvents"]
+        f.close()
+    f = open(log_dir + "/trace.json", "w")
+    json.dump({"traceEvents": events}, f)
+    f.close()
+    print "TRACE: " + log_dir + "/trace.json"
+
 def main():
     try:
         parser = OptionParser()
@@ -951,6 +1123,7 @@ def main():
         server_process.join()
         server_controller.server_kill()
         client_controller.client_kill()
+        merge_traces(log_dir)
 
     except:
         try:
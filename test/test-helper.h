@@ -6,6 +6,7 @@
 #include "memdb/row.h"
 #include "memdb/schema.h"
 #include "memdb/txn.h"
+#include "deptran/all.h"
 
 
 template <class T>
@@ -15,6 +16,31 @@ void report_qps(const char* action, T n_ops, double duration) {
 }
 
 
+// key i32 "key", then i64 "value"
+static inline mdb::Schema* key_value_schema() {
+    mdb::Schema* schema = new mdb::Schema;
+    schema->add_key_column("key", mdb::Value::I32);
+    schema->add_column("value", mdb::Value::I64);
+    return schema;
+}
+
+// runs one piece through the registered handler, every call a new pid of
+// txn 1
+static inline rrr::i32 exec_piece(rrr::i32 t_type, rrr::i32 p_type,
+        const std::vector<mdb::Value>& input, std::vector<mdb::Value>* output) {
+    static rrr::i64 pid = 0;
+    rococo::RequestHeader header;
+    header.t_type = t_type;
+    header.p_type = p_type;
+    header.cid = 0;
+    header.tid = 1;
+    header.pid = ++pid;
+    rrr::i32 res = REJECT;
+    rococo::TxnRegistry::execute(header, input, &res, output);
+    return res;
+}
+
+
 template <class EnumeratorOfRows>
 bool rows_are_sorted(EnumeratorOfRows rows, mdb::symbol_t order = mdb::symbol_t::ORD_ASC) {
     if (order == mdb::symbol_t::ORD_ANY) {
@@ -0,0 +1,71 @@
+#include "base/all.hpp"
+#include "deptran/all.h"
+
+using namespace rococo;
+
+// picks of key k over n draws, every one checked to be in [lo, hi]
+static std::vector<int> key_dist_count(KeyDist *dist, int lo, int hi, int n) {
+    std::vector<int> count(hi + 1);
+    for (int i = 0; i < n; i++) {
+        int key = dist->next();
+        EXPECT_GE(key, lo);
+        EXPECT_LE(key, hi);
+        if (key >= lo && key <= hi)
+            count[key]++;
+    }
+    return count;
+}
+
+static int key_dist_hottest(const std::vector<int> &count) {
+    return std::max_element(count.begin(), count.end()) - count.begin();
+}
+
+TEST(key_dist, scramble_is_permutation) {
+    for (int n : {1, 2, 7, 100, 1000, 1025}) {
+        std::vector<int> hit(n);
+        for (int i = 0; i < n; i++)
+            hit[KeyDist::scramble(i, n)]++;
+        EXPECT_EQ(std::count(hit.begin(), hit.end(), 1), n);
+    }
+}
+
+TEST(key_dist, zipf) {
+    const int n = 1000;
+    ZipfDist dist(n, 0.99);
+    std::vector<int> count = key_dist_count(&dist, 0, n - 1, 100000);
+    // rank 0 takes about 1 / zeta(n), some 13%, but not as key 0
+    int hot = key_dist_hottest(count);
+    EXPECT_EQ(hot, KeyDist::scramble(0, n));
+    EXPECT_NE(hot, 0);
+    EXPECT_GT(count[hot], 10000);
+    // the ten hottest ranks are not the ten lowest keys
+    int low = 0;
+    for (int k = 0; k < 10; k++)
+        low += count[k];
+    EXPECT_LT(low, 10000);
+}
+
+TEST(key_dist, hotspot) {
+    const int n = 1000;
+    HotspotDist dist(n, 10, 0.9);
+    std::vector<int> count = key_dist_count(&dist, 0, n - 1, 100000);
+    int hot = 0;
+    for (int i = 0; i < 10; i++)
+        hot += count[KeyDist::scramble(i, n)];
+    EXPECT_GT(hot, 88000);
+    EXPECT_LT(hot, 92000);
+}
+
+TEST(key_dist, latest) {
+    const int n = 1000;
+    LatestDist dist(n, 0.99);
+    std::vector<int> count = key_dist_count(&dist, 0, n - 1, 100000);
+    // the newest is the hottest, unscrambled
+    EXPECT_EQ(key_dist_hottest(count), n - 1);
+
+    // inserts move the window, out of order ones do not move it back
+    dist.inserted(n + 5);
+    dist.inserted(n + 2);
+    count = key_dist_count(&dist, 6, n + 5, 100000);
+    EXPECT_EQ(key_dist_hottest(count), n + 5);
+}
@@ -0,0 +1,64 @@
+#include "base/all.hpp"
+#include "deptran/all.h"
+#include "deptran/latency_hist.h"
+
+using namespace rococo;
+
+// every bucket b starts at bucket_low(b) and ends right before the next one
+TEST(latency_hist, bucket_round_trip) {
+    for (int b = 0; b < LatencyHist::N_BUCKETS - 1; b++) {
+        uint64_t low = LatencyHist::bucket_low(b);
+        uint64_t high = low + LatencyHist::bucket_width(b) - 1;
+        EXPECT_EQ(LatencyHist::bucket_of(low), b);
+        EXPECT_EQ(LatencyHist::bucket_of(high), b);
+        EXPECT_EQ(LatencyHist::bucket_low(b + 1), high + 1);
+    }
+    // past 2^MAX_BITS, all in the last one
+    int last = LatencyHist::N_BUCKETS - 1;
+    EXPECT_EQ(LatencyHist::bucket_of((uint64_t)1 << LatencyHist::MAX_BITS),
+            last);
+    EXPECT_EQ(LatencyHist::bucket_of(~(uint64_t)0), last);
+}
+
+TEST(latency_hist, relative_error) {
+    for (uint64_t v = 1; v < ((uint64_t)1 << 40); v = v * 3 + 1) {
+        int b = LatencyHist::bucket_of(v);
+        if (b == LatencyHist::N_BUCKETS - 1)
+            break;
+        EXPECT_LE(LatencyHist::bucket_low(b), v);
+        EXPECT_LE(LatencyHist::bucket_width(b) - 1,
+                v / LatencyHist::SUB_BUCKETS);
+    }
+}
+
+TEST(latency_hist, percentile) {
+    // recorded and read back in seconds, kept in us
+    LatencyHist hist(0.000001);
+    Histogram h;
+    h.count = 0;
+    h.sum = 0;
+    EXPECT_EQ(LatencyHist::percentile(h, 0.5), 0.0);
+
+    for (int ms = 1; ms <= 100; ms++)
+        hist.record_value(ms * 0.001);
+    hist.drain(&h);
+    EXPECT_EQ(h.count, 100);
+    EXPECT_EQ(h.sum, 5050 * 1000);
+    EXPECT_EQ(h.unit, 0.000001);
+    EXPECT_NEAR(LatencyHist::percentile(h, 0.5), 0.051, 0.051 / 128);
+    EXPECT_NEAR(LatencyHist::percentile(h, 0.99), 0.1, 0.1 / 128);
+    EXPECT_NEAR(LatencyHist::percentile(h, 1.0), 0.1, 0.1 / 128);
+    EXPECT_NEAR(LatencyHist::percentile(h, 0.0), 0.001, 0.001 / 128);
+
+    // drained empty, the next drain adds on top
+    hist.record_value(200 * 0.001);
+    hist.drain(&h);
+    EXPECT_EQ(h.count, 101);
+    EXPECT_NEAR(LatencyHist::percentile(h, 1.0), 0.2, 0.2 / 128);
+    Histogram empty;
+    empty.count = 0;
+    empty.sum = 0;
+    hist.drain(&empty);
+    EXPECT_EQ(empty.count, 0);
+    EXPECT_TRUE(empty.buckets.empty());
+}
@@ -0,0 +1,153 @@
+#include "base/all.hpp"
+#include "memdb/schema.h"
+#include "memdb/row.h"
+#include "test-helper.h"
+
+using namespace mdb;
+
+static MultiVersionedRow *mvrow_create(Schema *schema, i64 v) {
+    return MultiVersionedRow::create(schema,
+            std::vector<Value>({Value((i32) 1), Value(v)}));
+}
+
+TEST(mvrow, snapshot_visibility) {
+    Schema *schema = key_value_schema();
+    MultiVersionedRow *row = mvrow_create(schema, 10);
+    MultiVersionedRow::pin_t s1 = MultiVersionedRow::pin_snapshot();
+    EXPECT_TRUE(row->visible_at(s1.ver));
+
+    row->update(1, Value((i64) 11));
+    MultiVersionedRow::pin_t s2 = MultiVersionedRow::pin_snapshot();
+    row->update(1, Value((i64) 12));
+
+    Value v;
+    EXPECT_TRUE(row->get_column_by_version(1, s1.ver, &v));
+    EXPECT_EQ(v.get_i64(), 10);
+    EXPECT_TRUE(row->get_column_by_version(1, s2.ver, &v));
+    EXPECT_EQ(v.get_i64(), 11);
+    EXPECT_EQ(row->get_column(1).get_i64(), 12);
+
+    // rows created after a snapshot do not exist in it
+    MultiVersionedRow *late = mvrow_create(schema, 20);
+    EXPECT_FALSE(late->visible_at(s2.ver));
+
+    MultiVersionedRow::unpin_snapshot(s1);
+    MultiVersionedRow::unpin_snapshot(s2);
+    MultiVersionedRow::collect();
+    late->release();
+    row->release();
+}
+
+TEST(mvrow, out_of_order_commit) {
+    Schema *schema = key_value_schema();
+    MultiVersionedRow *row = mvrow_create(schema, 10);
+    version_t ver = MultiVersionedRow::next_version();
+    EXPECT_TRUE(row->update(1, Value((i64) 11), MultiVersionedRow::next_version()));
+    // an older commit timestamp is refused, not installed
+    EXPECT_FALSE(row->update(1, Value((i64) 12), ver));
+    EXPECT_EQ(row->get_column(1).get_i64(), 11);
+    row->release();
+}
+
+TEST(mvrow, gc_keeps_pinned_versions) {
+    Schema *schema = key_value_schema();
+    MultiVersionedRow *row = mvrow_create(schema, 10);
+    row->update(1, Value((i64) 11));
+    // nobody pinned, the old value is dropped right away
+    EXPECT_EQ(row->version_count(1), 0);
+
+    MultiVersionedRow::pin_t s1 = MultiVersionedRow::pin_snapshot();
+    row->update(1, Value((i64) 12));
+    row->update(1, Value((i64) 13));
+    // only the version s1 sees is kept below the newer ones
+    EXPECT_EQ(row->version_count(1), 2);
+
+    MultiVersionedRow::pin_t s2 = MultiVersionedRow::pin_snapshot();
+    row->update(1, Value((i64) 14));
+    MultiVersionedRow::unpin_snapshot(s1);
+    // nothing is trimmed until collect, or the next update
+    EXPECT_EQ(row->version_count(1), 3);
+    MultiVersionedRow::collect();
+    EXPECT_EQ(row->version_count(1), 1);
+    Value v;
+    EXPECT_TRUE(row->get_column_by_version(1, s2.ver, &v));
+    EXPECT_EQ(v.get_i64(), 13);
+    // s1 is gone, its version with it
+    EXPECT_FALSE(row->get_column_by_version(1, s1.ver, &v));
+
+    MultiVersionedRow::unpin_snapshot(s2);
+    MultiVersionedRow::collect();
+    EXPECT_EQ(row->version_count(1), 0);
+    row->release();
+}
+
+TEST(mvrow, pin_behind_gc) {
+    Schema *schema = key_value_schema();
+    MultiVersionedRow *row = mvrow_create(schema, 10);
+    version_t old = MultiVersionedRow::current_version();
+    row->update(1, Value((i64) 11));
+    row->update(1, Value((i64) 12));
+    // gc went past old, the pin comes out at the floor instead
+    MultiVersionedRow::pin_t s = MultiVersionedRow::pin_snapshot(old);
+    EXPECT_GT(s.ver, old);
+    Value v;
+    EXPECT_TRUE(row->get_column_by_version(1, s.ver, &v));
+    EXPECT_EQ(v.get_i64(), 12);
+    MultiVersionedRow::unpin_snapshot(s);
+    row->release();
+}
+
+TEST(mvrow, txn_published_whole) {
+    Schema *schema = key_value_schema();
+    MultiVersionedRow *a = mvrow_create(schema, 10);
+    MultiVersionedRow *b = mvrow_create(schema, 20);
+    version_t before = MultiVersionedRow::stable_version();
+
+    MultiVersionedRow::write_set_t t1, t2;
+    MultiVersionedRow::begin_write(&t1);
+    a->update(1, Value((i64) 11));
+    MultiVersionedRow *c = mvrow_create(schema, 30);
+    MultiVersionedRow::end_write();
+    // t2 writes a after t1, before t1 is decided
+    MultiVersionedRow::begin_write(&t2);
+    a->update(1, Value((i64) 12));
+    MultiVersionedRow::end_write();
+    MultiVersionedRow::begin_write(&t1);
+    b->update(1, Value((i64) 21));
+    MultiVersionedRow::end_write();
+
+    // nothing of either is seen yet, not even at the newest stamp
+    Value v;
+    version_t now = MultiVersionedRow::stable_version();
+    EXPECT_EQ(now, before);
+    EXPECT_TRUE(a->get_column_by_version(1, now, &v));
+    EXPECT_EQ(v.get_i64(), 10);
+    EXPECT_TRUE(b->get_column_by_version(1, now, &v));
+    EXPECT_EQ(v.get_i64(), 20);
+    EXPECT_FALSE(c->visible_at(now));
+    EXPECT_EQ(a->get_column(1).get_i64(), 12);
+
+    version_t v1 = MultiVersionedRow::next_version();
+    MultiVersionedRow::publish(&t1, v1);
+    MultiVersionedRow::make_stable(v1);
+    EXPECT_EQ(MultiVersionedRow::stable_version(), v1);
+    // all of t1, none of t2
+    EXPECT_TRUE(a->get_column_by_version(1, v1, &v));
+    EXPECT_EQ(v.get_i64(), 11);
+    EXPECT_TRUE(b->get_column_by_version(1, v1, &v));
+    EXPECT_EQ(v.get_i64(), 21);
+    EXPECT_TRUE(c->visible_at(v1));
+
+    version_t v2 = MultiVersionedRow::next_version();
+    MultiVersionedRow::publish(&t2, v2);
+    MultiVersionedRow::make_stable(v2);
+    EXPECT_TRUE(a->get_column_by_version(1, v2, &v));
+    EXPECT_EQ(v.get_i64(), 12);
+    EXPECT_TRUE(a->get_column_by_version(1, v1, &v));
+    EXPECT_EQ(v.get_i64(), 11);
+
+    MultiVersionedRow::collect();
+    c->release();
+    b->release();
+    a->release();
+}
@@ -0,0 +1,92 @@
+#include "base/all.hpp"
+#include "memdb/schema.h"
+#include "memdb/table.h"
+#include "memdb/row.h"
+#include "test-helper.h"
+
+using namespace mdb;
+
+// keys 0, 10, 20, ... (n - 1) * 10, the value of each its key
+template <class T>
+static std::vector<Row *> rekey_fill(T *tbl, const Schema *schema, int n) {
+    std::vector<Row *> rows;
+    for (i32 k = 0; k < n; k++) {
+        Row *row = Row::create(schema, std::vector<Value>({
+                    Value(k * 10), Value((i64) k * 10)}));
+        tbl->insert(row);
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+template <class T>
+static Row *rekey_find(T *tbl, i32 key) {
+    typename T::Cursor cur = tbl->query(Value(key));
+    return cur.has_next() ? const_cast<Row *>(cur.next()) : nullptr;
+}
+
+static std::vector<i32> rekey_keys(SortedTable *tbl) {
+    std::vector<i32> keys;
+    SortedTable::Cursor cur = tbl->all();
+    while (cur.has_next())
+        keys.push_back(cur.next()->get_column(0).get_i32());
+    return keys;
+}
+
+TEST(rekey, sorted_same_position) {
+    Schema *schema = key_value_schema();
+    SortedTable *tbl = new SortedTable(schema);
+    std::vector<Row *> rows = rekey_fill(tbl, schema, 5);
+
+    // 20 -> 25 still sorts between 10 and 30
+    rows[2]->update(0, (i32) 25);
+    EXPECT_EQ(rekey_find(tbl, 20), nullptr);
+    EXPECT_EQ(rekey_find(tbl, 25), rows[2]);
+    EXPECT_EQ(rows[2]->get_table(), tbl);
+    EXPECT_EQ(rekey_keys(tbl), std::vector<i32>({0, 10, 25, 30, 40}));
+    EXPECT_EQ(tbl->all().count(), 5);
+    delete tbl;
+}
+
+TEST(rekey, sorted_moves) {
+    Schema *schema = key_value_schema();
+    SortedTable *tbl = new SortedTable(schema);
+    std::vector<Row *> rows = rekey_fill(tbl, schema, 5);
+
+    rows[0]->update(0, (i32) 35);
+    rows[4]->update(0, (i32) 5);
+    EXPECT_EQ(rekey_find(tbl, 35), rows[0]);
+    EXPECT_EQ(rekey_find(tbl, 5), rows[4]);
+    EXPECT_EQ(rekey_keys(tbl), std::vector<i32>({5, 10, 20, 30, 35}));
+
+    // onto a key that is already there, both rows stay reachable
+    rows[1]->update(0, (i32) 20);
+    SortedTable::Cursor cur = tbl->query(Value((i32) 20));
+    EXPECT_EQ(cur.count(), 2);
+    EXPECT_EQ(rekey_keys(tbl), std::vector<i32>({5, 20, 20, 30, 35}));
+
+    // a non key column never moves the row
+    rows[3]->update(1, (i64) 7);
+    EXPECT_EQ(rekey_find(tbl, 30), rows[3]);
+    EXPECT_EQ(rows[3]->get_column(1).get_i64(), 7);
+    delete tbl;
+}
+
+TEST(rekey, unsorted) {
+    Schema *schema = key_value_schema();
+    UnsortedTable *tbl = new UnsortedTable(schema);
+    std::vector<Row *> rows = rekey_fill(tbl, schema, 5);
+
+    rows[2]->update(0, (i32) 25);
+    EXPECT_EQ(rekey_find(tbl, 20), nullptr);
+    EXPECT_EQ(rekey_find(tbl, 25), rows[2]);
+    EXPECT_EQ(rows[2]->get_table(), tbl);
+
+    // duplicates: the second row of a key moves, the first stays
+    rows[3]->update(0, (i32) 10);
+    rows[3]->update(0, (i32) 11);
+    EXPECT_EQ(rekey_find(tbl, 10), rows[1]);
+    EXPECT_EQ(rekey_find(tbl, 11), rows[3]);
+    EXPECT_EQ(tbl->all().count(), 5);
+    delete tbl;
+}
@@ -0,0 +1,96 @@
+#include "base/all.hpp"
+#include "deptran/all.h"
+#include "test-helper.h"
+
+using namespace rococo;
+
+// customer k has bal[k] in the table
+static mdb::Table *smallbank_table(const std::vector<i64> &bal) {
+    mdb::Schema *schema = new mdb::Schema;
+    schema->add_key_column("custid", Value::I32);
+    schema->add_column("bal", Value::I64);
+    mdb::Table *tbl = new mdb::SortedTable(schema);
+    for (i32 k = 0; k < (i32)bal.size(); k++)
+        tbl->insert(mdb::VersionedRow::create(schema, std::vector<Value>({
+                        Value(k), Value(bal[k])})));
+    return tbl;
+}
+
+static i64 smallbank_bal(char *table, i32 c_id) {
+    std::vector<Value> output(1);
+    exec_piece(SMALLBANK_BALANCE,
+            table == SMALLBANK_SAVINGS ? SMALLBANK_BALANCE_0
+                                       : SMALLBANK_BALANCE_1,
+            {Value(c_id)}, &output);
+    verify(output.size() == 1);
+    return output[0].get_i64();
+}
+
+static void smallbank_setup() {
+    TxnRunner::init(MODE_NONE);
+    TxnRunner::reg_table(SMALLBANK_SAVINGS, smallbank_table({10, 100}));
+    TxnRunner::reg_table(SMALLBANK_CHECKING, smallbank_table({5, 50}));
+    TxnRegistry::clear();
+    SmallbankPiece().reg_all();
+}
+
+static void smallbank_teardown() {
+    TxnRegistry::clear();
+    TxnRunner::fini();
+}
+
+// write check: the piece runs on the savings the first one read
+static void smallbank_write_check(i32 c_id, i64 amount) {
+    std::vector<Value> output(1);
+    EXPECT_EQ(exec_piece(SMALLBANK_WRITE_CHECK, SMALLBANK_WRITE_CHECK_0,
+                {Value(c_id)}, &output), SUCCESS);
+    ASSERT_EQ(output.size(), 1);
+    Value savings = output[0];
+    output.resize(0);
+    EXPECT_EQ(exec_piece(SMALLBANK_WRITE_CHECK, SMALLBANK_WRITE_CHECK_1,
+                {Value(c_id), Value(amount), savings}, &output), SUCCESS);
+}
+
+TEST(smallbank, write_check_overdraft) {
+    smallbank_setup();
+
+    // 10 + 5 covers 15, no fee
+    smallbank_write_check(0, 15);
+    EXPECT_EQ(smallbank_bal(SMALLBANK_CHECKING, 0), -10);
+    // 10 - 10 no longer covers 1, it costs one more
+    smallbank_write_check(0, 1);
+    EXPECT_EQ(smallbank_bal(SMALLBANK_CHECKING, 0), -12);
+    // savings are never touched
+    EXPECT_EQ(smallbank_bal(SMALLBANK_SAVINGS, 0), 10);
+
+    smallbank_teardown();
+}
+
+TEST(smallbank, amalgamate) {
+    smallbank_setup();
+
+    std::vector<Value> output(1);
+    EXPECT_EQ(exec_piece(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_0,
+                {Value((i32) 0)}, &output), SUCCESS);
+    ASSERT_EQ(output.size(), 1);
+    Value savings = output[0];
+    output.resize(1);
+    EXPECT_EQ(exec_piece(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_1,
+                {Value((i32) 0)}, &output), SUCCESS);
+    ASSERT_EQ(output.size(), 1);
+    Value checking = output[0];
+    EXPECT_EQ(savings.get_i64(), 10);
+    EXPECT_EQ(checking.get_i64(), 5);
+
+    output.resize(0);
+    EXPECT_EQ(exec_piece(SMALLBANK_AMALGAMATE, SMALLBANK_AMALGAMATE_2,
+                {Value((i32) 1), savings, checking}, &output), SUCCESS);
+
+    // c0 is emptied, all of it lands in the checking of c1
+    EXPECT_EQ(smallbank_bal(SMALLBANK_SAVINGS, 0), 0);
+    EXPECT_EQ(smallbank_bal(SMALLBANK_CHECKING, 0), 0);
+    EXPECT_EQ(smallbank_bal(SMALLBANK_SAVINGS, 1), 100);
+    EXPECT_EQ(smallbank_bal(SMALLBANK_CHECKING, 1), 65);
+
+    smallbank_teardown();
+}
@@ -0,0 +1,86 @@
+#include "base/all.hpp"
+#include "memdb/snapshot.h"
+
+using namespace mdb;
+
+typedef snapshot_sortedmap<i32, i32> snapshot_map;
+
+// keys [0, n), the value of each its key
+static void snapshot_fill(snapshot_map *m, i32 n) {
+    for (i32 k = 0; k < n; k++)
+        m->insert(k, k);
+}
+
+static std::vector<i32> snapshot_values(const snapshot_map &m) {
+    std::vector<i32> vals;
+    snapshot_map::range_type range = m.all();
+    while (range.has_next())
+        vals.push_back(range.next().second);
+    return vals;
+}
+
+TEST(snapshot, gc_keeps_member_versions) {
+    snapshot_map m;
+    snapshot_fill(&m, 4);
+    snapshot_map *s1 = new snapshot_map(m.snapshot());
+    m.erase(0);
+    // created and erased between s1 and s2, nobody ever sees it
+    m.insert(10, 10);
+    m.erase(10);
+    snapshot_map *s2 = new snapshot_map(m.snapshot());
+    m.erase(1);
+
+    m.gc_run();
+    EXPECT_EQ(m.gc_size(), 4);
+    EXPECT_EQ(snapshot_values(*s1), std::vector<i32>({0, 1, 2, 3}));
+    EXPECT_EQ(snapshot_values(*s2), std::vector<i32>({1, 2, 3}));
+    EXPECT_EQ(snapshot_values(m), std::vector<i32>({2, 3}));
+
+    // 0 was only for s1
+    delete s1;
+    m.gc_run();
+    EXPECT_EQ(m.gc_size(), 3);
+    EXPECT_EQ(snapshot_values(*s2), std::vector<i32>({1, 2, 3}));
+
+    delete s2;
+    m.gc_run();
+    EXPECT_EQ(m.gc_size(), 2);
+    EXPECT_EQ(snapshot_values(m), std::vector<i32>({2, 3}));
+}
+
+TEST(snapshot, gc_auto_under_churn) {
+    snapshot_map m;
+    snapshot_fill(&m, 10);
+    // every update is seen by a snapshot, then nobody
+    for (i32 i = 0; i < 1000; i++) {
+        snapshot_map s = m.snapshot();
+        m.erase(i % 10);
+        m.insert(i % 10, i);
+        EXPECT_EQ(s.all().count(), 10);
+    }
+    EXPECT_EQ(m.all().count(), 10);
+    // compacted every max(16, gc_size / 2) changes
+    EXPECT_LT(m.gc_size(), 50);
+}
+
+TEST(snapshot, gc_waits_for_open_ranges) {
+    snapshot_map m;
+    snapshot_fill(&m, 10);
+    snapshot_map::range_type *range = new snapshot_map::range_type(m.all());
+    for (i32 i = 0; i < 100; i++) {
+        m.erase(i % 10);
+        m.insert(i % 10, 100 + i);
+    }
+    // nothing is dropped under the range, it still sees the old values
+    EXPECT_EQ(m.gc_size(), 110);
+    std::vector<i32> vals;
+    while (range->has_next())
+        vals.push_back(range->next().second);
+    EXPECT_EQ(vals, std::vector<i32>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // the next change after it is gone catches up
+    delete range;
+    m.erase(0);
+    EXPECT_EQ(m.gc_size(), 9);
+    EXPECT_EQ(m.all().count(), 9);
+}
@@ -0,0 +1,57 @@
+#include "base/all.hpp"
+#include "memdb/schema.h"
+#include "memdb/table.h"
+#include "memdb/row.h"
+#include "memdb/txn.h"
+#include "test-helper.h"
+
+using namespace mdb;
+
+static Row *undo_row(const Schema *schema, i32 key, i64 value) {
+    return Row::create(schema, std::vector<Value>({Value(key), Value(value)}));
+}
+
+static std::vector<i64> undo_values(SortedTable *tbl) {
+    std::vector<i64> vals;
+    SortedTable::Cursor cur = tbl->all();
+    while (cur.has_next())
+        vals.push_back(cur.next()->get_column(1).get_i64());
+    return vals;
+}
+
+TEST(undo, rollback_and_keep) {
+    Schema *schema = key_value_schema();
+    SortedTable *tbl = new SortedTable(schema);
+    Row *r0 = undo_row(schema, 0, 0);
+    Row *r1 = undo_row(schema, 1, 10);
+    tbl->insert(r0);
+    tbl->insert(r1);
+    TxnMgrUnsafe mgr;
+    Txn *txn = mgr.start(0);
+    TxnUnsafe::undo_log_t log;
+
+    // a write, an insert written over, a remove; all taken back
+    ((TxnUnsafe *) txn)->set_undo(&log);
+    txn->write_column(r0, 1, Value((i64) 1));
+    Row *r2 = undo_row(schema, 2, 20);
+    txn->insert_row(tbl, r2);
+    txn->write_column(r2, 1, Value((i64) 21));
+    txn->remove_row(tbl, r1);
+    EXPECT_EQ(undo_values(tbl), std::vector<i64>({1, 21}));
+    TxnUnsafe::rollback(&log);
+    EXPECT_TRUE(log.empty());
+    EXPECT_EQ(undo_values(tbl), std::vector<i64>({0, 10}));
+
+    // kept, and no longer logged after set_undo(nullptr)
+    txn->write_column(r0, 1, Value((i64) 2));
+    txn->remove_row(tbl, r1);
+    TxnUnsafe::keep(&log);
+    ((TxnUnsafe *) txn)->set_undo(nullptr);
+    txn->write_column(r0, 1, Value((i64) 3));
+    EXPECT_TRUE(log.empty());
+    EXPECT_EQ(undo_values(tbl), std::vector<i64>({3}));
+
+    delete txn;
+    delete tbl;
+    delete schema;
+}
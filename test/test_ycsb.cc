@@ -0,0 +1,77 @@
+#include "base/all.hpp"
+#include "deptran/all.h"
+#include "test-helper.h"
+
+using namespace rococo;
+
+// two fields, key k holds "a<k>", "b<k>" for k in [0, n)
+static mdb::Table *ycsb_table(int n) {
+    mdb::Schema *schema = new mdb::Schema;
+    schema->add_key_column("ycsb_key", Value::I32);
+    schema->add_column("field0", Value::STR);
+    schema->add_column("field1", Value::STR);
+    mdb::Table *tbl = new mdb::SortedTable(schema);
+    for (i32 k = 0; k < n; k++) {
+        std::string s = std::to_string(k);
+        tbl->insert(mdb::VersionedRow::create(schema, std::vector<Value>({
+                        Value(k), Value("a" + s), Value("b" + s)})));
+    }
+    return tbl;
+}
+
+TEST(ycsb, pieces_no_cc) {
+    TxnRunner::init(MODE_NONE);
+    TxnRunner::reg_table(YCSB_TABLE, ycsb_table(2));
+    TxnRegistry::clear();
+    YcsbPiece().reg_all();
+
+    std::vector<Value> output(2);
+    EXPECT_EQ(exec_piece(YCSB_READ, YCSB_READ_0, {Value((i32) 1)}, &output),
+            SUCCESS);
+    EXPECT_EQ(output.size(), 2);
+    EXPECT_EQ(output[0].get_str(), "a1");
+    EXPECT_EQ(output[1].get_str(), "b1");
+
+    // a missing key is a miss, not an abort
+    output.resize(2);
+    EXPECT_EQ(exec_piece(YCSB_READ, YCSB_READ_0, {Value((i32) 5)}, &output),
+            SUCCESS);
+    EXPECT_EQ(output.size(), 0);
+
+    // rmw hands back the fields from before its write
+    output.resize(2);
+    EXPECT_EQ(exec_piece(YCSB_RMW, YCSB_RMW_0,
+                {Value((i32) 1), Value((i32) 0), Value("x")}, &output),
+            SUCCESS);
+    EXPECT_EQ(output.size(), 2);
+    EXPECT_EQ(output[0].get_str(), "a1");
+    output.resize(0);
+    EXPECT_EQ(exec_piece(YCSB_UPDATE, YCSB_UPDATE_0,
+                {Value((i32) 1), Value((i32) 1), Value("y")}, &output),
+            SUCCESS);
+    output.resize(2);
+    exec_piece(YCSB_READ, YCSB_READ_0, {Value((i32) 1)}, &output);
+    EXPECT_EQ(output[0].get_str(), "x");
+    EXPECT_EQ(output[1].get_str(), "y");
+
+    output.resize(0);
+    EXPECT_EQ(exec_piece(YCSB_INSERT, YCSB_INSERT_0,
+                {Value((i32) 5), Value("a5"), Value("b5")}, &output),
+            SUCCESS);
+    output.resize(2);
+    exec_piece(YCSB_READ, YCSB_READ_0, {Value((i32) 5)}, &output);
+    EXPECT_EQ(output.size(), 2);
+    EXPECT_EQ(output[1].get_str(), "b5");
+
+    // scan outputs the keys it found in [start, start + length)
+    output.resize(10);
+    EXPECT_EQ(exec_piece(YCSB_SCAN, YCSB_SCAN_0,
+                {Value((i32) 1), Value((i32) 5)}, &output),
+            SUCCESS);
+    EXPECT_EQ(output.size(), 2);
+    EXPECT_EQ(output[0].get_i32(), 1);
+    EXPECT_EQ(output[1].get_i32(), 5);
+
+    TxnRegistry::clear();
+    TxnRunner::fini();
+}